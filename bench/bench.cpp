@@ -0,0 +1,103 @@
+#include "app/application.hpp"
+#include "platform/frame-stats.hpp"
+#include "platform/log.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+
+namespace {
+
+struct benchOpts {
+  int width = 1280;
+  int height = 720;
+  uint32_t frames = 500;
+  uint32_t warmup = 50;
+  // Fail when p99 CPU frame time exceeds this budget, 0 disables the check
+  double budget_ms = 0.0;
+  // Render on the main thread instead of overlapping it with the next frame's UI
+  bool serial = false;
+};
+
+void PrintUsage() {
+  std::printf("usage: osc_bench [--frames N] [--warmup N] [--width W] [--height H] "
+              "[--budget-ms MS] [--serial]\n");
+}
+
+bool ParseArgs(int argc, char **argv, benchOpts &opts) {
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--serial") == 0) {
+      opts.serial = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      return false;
+    }
+    const char *value = argv[++i];
+    if (std::strcmp(argv[i - 1], "--frames") == 0) {
+      opts.frames = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    } else if (std::strcmp(argv[i - 1], "--warmup") == 0) {
+      opts.warmup = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    } else if (std::strcmp(argv[i - 1], "--width") == 0) {
+      opts.width = std::atoi(value);
+    } else if (std::strcmp(argv[i - 1], "--height") == 0) {
+      opts.height = std::atoi(value);
+    } else if (std::strcmp(argv[i - 1], "--budget-ms") == 0) {
+      opts.budget_ms = std::strtod(value, nullptr);
+    } else {
+      return false;
+    }
+  }
+  return opts.frames > opts.warmup && opts.width > 0 && opts.height > 0;
+}
+
+void PrintSummary(const char *name, const platform::frameTimeSummary &s) {
+  if (s.samples == 0) {
+    std::printf("%-4s n/a\n", name);
+    return;
+  }
+  std::printf("%-4s frames=%zu min=%.3fms avg=%.3fms p99=%.3fms max=%.3fms\n", name, s.samples,
+              s.min_ms, s.avg_ms, s.p99_ms, s.max_ms);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  benchOpts opts;
+  if (!ParseArgs(argc, argv, opts)) {
+    PrintUsage();
+    return EXIT_FAILURE;
+  }
+
+  platform::Log::Init(platform::Log::FromEnvironment());
+  platform::windowOpts windowOpts{opts.width, opts.height, "osc_bench"};
+  windowOpts.headless = true;
+
+  platform::FrameStats stats;
+  try {
+    core::Application app(windowOpts);
+    runOpts runOptions;
+    runOptions.frame_limit = opts.frames;
+    runOptions.stats = &stats;
+    // Every frame has to be rendered to be measured
+    runOptions.idle = false;
+    runOptions.pipelined = !opts.serial;
+    app.Run(runOptions);
+  } catch (const std::exception &e) {
+    TE_CRITICAL("Benchmark failed: {}", e.what());
+    platform::Log::Shutdown();
+    return EXIT_FAILURE;
+  }
+  platform::Log::Shutdown();
+
+  platform::frameTimeSummary cpu = stats.SummarizeCpu(opts.warmup);
+  platform::frameTimeSummary gpu = stats.SummarizeGpu(opts.warmup);
+  PrintSummary("cpu", cpu);
+  PrintSummary("gpu", gpu);
+
+  if (opts.budget_ms > 0.0 && cpu.p99_ms > opts.budget_ms) {
+    std::printf("p99 CPU frame time %.3fms exceeds budget %.3fms\n", cpu.p99_ms, opts.budget_ms);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
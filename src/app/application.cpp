@@ -8,16 +8,81 @@
 
 namespace core {
 
-Application::Application(platform::windowOpts opts) {
+Application::Application(platform::windowOpts opts, vulkanOpts vk_opts) {
   TE_TRACE(glfwGetVersionString());
-  if (platform::Init() == GLFW_FALSE) {
-    throw std::runtime_error("glfw init error");
+  vk_opts.headless = opts.headless;
+  {
+    platform::StartupScope phase(&startup_, "glfw");
+    if (platform::Init(opts.headless) == GLFW_FALSE) {
+      throw std::runtime_error("glfw init error");
+    }
   }
-  if (platform_window_.Init(opts) == GLFW_FALSE) {
+  const float scale = platform::Window::GetPrimaryMonitorScale();
+
+  // Vulkan instance and device creation, pipeline cache loading and font rasterization run on
+  // workers while this thread creates the window, GLFW only allows that on the main thread
+  VkResult instanceResult = VK_SUCCESS;
+  VkResult deviceResult = VK_SUCCESS;
+  VkResult cacheResult = VK_SUCCESS;
+  tf::Taskflow startup("startup");
+  tf::Task instance = startup.emplace([&] {
+    platform::StartupScope phase(&startup_, "Vulkan instance");
+    instanceResult = vulkan_ctx_.InitInstance(&executor_, vk_opts);
+  });
+  tf::Task cacheLoad = startup.emplace([&] {
+    if (instanceResult == VK_SUCCESS) {
+      platform::StartupScope phase(&startup_, "Pipeline cache load");
+      vulkan_ctx_.LoadPipelineCache(vk_opts.pipeline_cache_dir);
+    }
+  });
+  tf::Task device = startup.emplace([&] {
+    if (instanceResult == VK_SUCCESS) {
+      platform::StartupScope phase(&startup_, "Vulkan device");
+      deviceResult = vulkan_ctx_.InitDevice();
+    }
+  });
+  tf::Task cache = startup.emplace([&] {
+    if (instanceResult == VK_SUCCESS && deviceResult == VK_SUCCESS) {
+      platform::StartupScope phase(&startup_, "Pipeline cache");
+      cacheResult = vulkan_ctx_.CreatePipelineCache();
+    }
+  });
+  startup.emplace([&] {
+    platform::StartupScope phase(&startup_, "Fonts");
+    imgui_ctx_.InitFonts(scale);
+  });
+  instance.precede(cacheLoad, device);
+  cache.succeed(cacheLoad, device);
+  tf::Future<void> running = executor_.run(startup);
+
+  int windowResult;
+  {
+    platform::StartupScope phase(&startup_, "Window");
+    windowResult = platform_window_.Init(opts);
+  }
+  running.wait();
+  if (windowResult == GLFW_FALSE) {
     throw std::runtime_error("Error creating window");
   }
-  if (VkResult res = vulkan_ctx_.Init(platform_window_.GetWindowHandle()); res != VK_SUCCESS) {
-    throw std::runtime_error(string_VkResult(res));
+  for (VkResult res : {instanceResult, deviceResult, cacheResult}) {
+    if (res != VK_SUCCESS) {
+      throw std::runtime_error(string_VkResult(res));
+    }
+  }
+
+  {
+    platform::StartupScope phase(&startup_, "Swapchain");
+    if (VkResult res = vulkan_ctx_.InitWindow(platform_window_.GetWindowHandle(), vk_opts);
+        res != VK_SUCCESS) {
+      throw std::runtime_error(string_VkResult(res));
+    }
+  }
+  {
+    platform::StartupScope phase(&startup_, "ImGui renderer");
+    if (VkResult res = imgui_ctx_.Init(&vulkan_ctx_, &platform_window_, &executor_);
+        res != VK_SUCCESS) {
+      throw std::runtime_error(string_VkResult(res));
+    }
   }
 }
 
@@ -26,8 +91,19 @@ Application::~Application() {
   vulkan_ctx_.Terminate();
   platform_window_.Destroy();
   platform::Exit();
+#ifdef TE_ENABLE_ZONES
+  platform::Trace::DumpChromeTrace("osc-trace.json");
+#endif
 }
 
-void Application::Run() { imgui_ctx_.Run(&vulkan_ctx_, &platform_window_); }
+void Application::Run(runOpts opts) {
+  if (!opts.ingest) {
+    opts.ingest = &ingest_;
+  }
+  if (!opts.startup && !startup_.IsFinished()) {
+    opts.startup = &startup_;
+  }
+  imgui_ctx_.Run(&vulkan_ctx_, &platform_window_, &executor_, opts);
+}
 
 } // namespace core
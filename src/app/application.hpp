@@ -1,20 +1,31 @@
 #pragma once
 #include "gfx/vulkan-context.hpp"
+#include "ingest/ingest.hpp"
+#include "platform/startup-report.hpp"
 #include "platform/window.hpp"
 #include "ui/imgui-context.hpp"
+#include <taskflow/taskflow.hpp>
 
 namespace core {
 
 class Application {
 public:
-  Application(platform::windowOpts);
+  Application(platform::windowOpts, vulkanOpts = {});
   ~Application();
 
-  void Run();
+  void Run(runOpts opts = {});
 
   void Update();
 
+  // Add channels before Run, acquisition threads push into them while it runs
+  ingest::Ingest &GetIngest() { return ingest_; }
+
 private:
+  // Created first so its clock starts with construction
+  platform::StartupReport startup_;
+  // Shared worker pool for the frame pipeline and background work
+  tf::Executor executor_;
+  ingest::Ingest ingest_;
   platform::Window platform_window_;
   VulkanContext vulkan_ctx_;
   ImGuiContext imgui_ctx_;
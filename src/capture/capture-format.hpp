@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+
+// On-disk layout of a capture, little endian, every section starts on a kPageSize boundary so
+// a mapping of the file hands out aligned sample columns.
+//
+//   fileHeader, channelInfo[channel_count]   padded to a page
+//   chunk | chunk | ... | indexBlock | chunk | ... | indexBlock
+//
+// A chunk holds chunk_samples samples of one channel followed by min and max over every
+// kSummaryBlock samples. Every chunk of a channel is full except its last one, so sample i of
+// a channel lives in the channel's chunk i / chunk_samples. Index blocks are appended
+// periodically and link back to the previous one, the header points at the newest, so a capture
+// cut short by a crash is readable up to its last index flush.
+namespace capture {
+
+constexpr uint32_t kCaptureMagic = 0x4f534343; // "OSCC"
+constexpr uint32_t kIndexMagic = 0x4f534349;   // "OSCI"
+constexpr uint32_t kCaptureVersion = 1;
+constexpr uint64_t kPageSize = 4096;
+constexpr uint32_t kSummaryBlock = 512;
+constexpr uint32_t kMaxChannelName = 56;
+
+struct fileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t channel_count;
+  uint32_t chunk_samples;
+  // Offset of the newest index block, 0 before the first flush
+  uint64_t index_offset;
+  uint64_t reserved[5];
+};
+
+struct channelInfo {
+  char name[kMaxChannelName];
+  uint64_t reserved;
+};
+
+struct indexBlock {
+  uint32_t magic;
+  uint32_t count;
+  // Previous index block, 0 for the first one
+  uint64_t previous;
+};
+
+// Followed by count entries
+struct chunkEntry {
+  uint64_t offset;
+  uint64_t first_sample;
+  // Steady clock nanoseconds since the capture started, taken when the first sample arrived
+  uint64_t timestamp_ns;
+  uint32_t channel;
+  uint32_t count;
+  float min;
+  float max;
+};
+
+static_assert(sizeof(fileHeader) == 64);
+static_assert(sizeof(channelInfo) == 64);
+static_assert(sizeof(indexBlock) == 16);
+static_assert(sizeof(chunkEntry) == 40);
+
+inline uint64_t AlignToPage(uint64_t size) { return (size + kPageSize - 1) & ~(kPageSize - 1); }
+
+// Samples plus both summary arrays, padded to a page
+inline uint64_t ChunkBytes(uint32_t chunk_samples) {
+  return AlignToPage(uint64_t{chunk_samples} * sizeof(float) +
+                     2 * uint64_t{chunk_samples / kSummaryBlock} * sizeof(float));
+}
+
+} // namespace capture
@@ -0,0 +1,204 @@
+#include "capture/image-writer.hpp"
+#include "platform/log.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace capture {
+
+namespace {
+
+constexpr std::array<uint32_t, 256> kCrcTable = [] {
+  std::array<uint32_t, 256> table{};
+  for (uint32_t i = 0; i < 256; ++i) {
+    uint32_t c = i;
+    for (int k = 0; k < 8; ++k) {
+      c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+    }
+    table[i] = c;
+  }
+  return table;
+}();
+
+// Largest stored deflate block
+constexpr size_t kStoredBlock = 65535;
+
+uint8_t *PutBe32(uint8_t *out, uint32_t value) {
+  out[0] = static_cast<uint8_t>(value >> 24);
+  out[1] = static_cast<uint8_t>(value >> 16);
+  out[2] = static_cast<uint8_t>(value >> 8);
+  out[3] = static_cast<uint8_t>(value);
+  return out + 4;
+}
+
+uint32_t Adler32(const uint8_t *data, size_t size, uint32_t adler) {
+  uint32_t a = adler & 0xffff;
+  uint32_t b = adler >> 16;
+  while (size > 0) {
+    // Largest run that can't overflow b before the modulo
+    size_t n = std::min<size_t>(size, 5552);
+    for (size_t i = 0; i < n; ++i) {
+      a += data[i];
+      b += a;
+    }
+    a %= 65521;
+    b %= 65521;
+    data += n;
+    size -= n;
+  }
+  return (b << 16) | a;
+}
+
+void ToRgb(const imageView &image, uint32_t y, uint8_t *out) {
+  const uint8_t *row = image.pixels + size_t{y} * image.stride;
+  const int r = image.order == PixelOrder::Rgba ? 0 : 2;
+  for (uint32_t x = 0; x < image.width; ++x) {
+    out[3 * x] = row[4 * x + r];
+    out[3 * x + 1] = row[4 * x + 1];
+    out[3 * x + 2] = row[4 * x + 2 - r];
+  }
+}
+
+} // namespace
+
+uint32_t Crc32(const uint8_t *data, size_t size, uint32_t crc) {
+  crc = ~crc;
+  for (size_t i = 0; i < size; ++i) {
+    crc = kCrcTable[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+bool PngWriter::Write(const std::string &path, const imageView &image) {
+  static constexpr uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+  const size_t row_bytes = 1 + size_t{image.width} * 3;
+  const size_t raw_bytes = row_bytes * image.height;
+  const size_t blocks = std::max<size_t>(1, (raw_bytes + kStoredBlock - 1) / kStoredBlock);
+  const size_t idat_bytes = 2 + blocks * 5 + raw_bytes + 4;
+  buffer_.resize(sizeof(kSignature) + 25 + 12 + idat_bytes + 12);
+
+  uint8_t *out = buffer_.data();
+  std::memcpy(out, kSignature, sizeof(kSignature));
+  out += sizeof(kSignature);
+
+  uint8_t *chunk = out;
+  out = PutBe32(out, 13);
+  std::memcpy(out, "IHDR", 4);
+  out = PutBe32(out + 4, image.width);
+  out = PutBe32(out, image.height);
+  // 8 bit RGB, deflate, adaptive filtering, no interlace
+  *out++ = 8;
+  *out++ = 2;
+  *out++ = 0;
+  *out++ = 0;
+  *out++ = 0;
+  out = PutBe32(out, Crc32(chunk + 4, 17));
+
+  chunk = out;
+  out = PutBe32(out, static_cast<uint32_t>(idat_bytes));
+  std::memcpy(out, "IDAT", 4);
+  out += 4;
+  // zlib header for deflate with a 32K window and no preset dictionary
+  *out++ = 0x78;
+  *out++ = 0x01;
+  // Rows are laid out for the whole stream, then slid down front to back to make room for each
+  // stored block header
+  uint8_t *raw = out + blocks * 5;
+  for (uint32_t y = 0; y < image.height; ++y) {
+    uint8_t *row = raw + row_bytes * y;
+    row[0] = 0;
+    ToRgb(image, y, row + 1);
+  }
+  uint32_t adler = Adler32(raw, raw_bytes, 1);
+  for (size_t b = 0; b < blocks; ++b) {
+    size_t first = b * kStoredBlock;
+    size_t length = std::min(kStoredBlock, raw_bytes - std::min(raw_bytes, first));
+    uint8_t *block = out + b * 5 + first;
+    std::memmove(block + 5, raw + first, length);
+    block[0] = b + 1 == blocks ? 1 : 0;
+    block[1] = static_cast<uint8_t>(length);
+    block[2] = static_cast<uint8_t>(length >> 8);
+    block[3] = static_cast<uint8_t>(~length);
+    block[4] = static_cast<uint8_t>(~length >> 8);
+  }
+  out = PutBe32(out + blocks * 5 + raw_bytes, adler);
+  out = PutBe32(out, Crc32(chunk + 4, 4 + idat_bytes));
+
+  chunk = out;
+  out = PutBe32(out, 0);
+  std::memcpy(out, "IEND", 4);
+  out = PutBe32(out + 4, Crc32(chunk + 4, 4));
+
+  std::FILE *file = std::fopen(path.c_str(), "wb");
+  if (!file) {
+    TE_ERROR("Error creating '{}'", path);
+    return false;
+  }
+  bool ok = std::fwrite(buffer_.data(), 1, buffer_.size(), file) == buffer_.size();
+  ok = std::fclose(file) == 0 && ok;
+  if (!ok) {
+    TE_ERROR("Error writing '{}'", path);
+  }
+  return ok;
+}
+
+bool Y4mWriter::Open(const std::string &path, uint32_t width, uint32_t height, uint32_t fps) {
+  Close();
+  file_ = std::fopen(path.c_str(), "wb");
+  if (!file_) {
+    TE_ERROR("Error creating '{}'", path);
+    return false;
+  }
+  width_ = width;
+  height_ = height;
+  planes_.resize(size_t{width} * height * 3);
+  if (std::fprintf(file_, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C444 XCOLORRANGE=LIMITED\n", width,
+                   height, std::max(fps, 1u)) < 0) {
+    TE_ERROR("Error writing '{}'", path);
+    Close();
+    return false;
+  }
+  TE_TRACE("Video '{}' opened, {}x{}", path, width, height);
+  return true;
+}
+
+void Y4mWriter::Close() {
+  if (file_) {
+    std::fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+bool Y4mWriter::WriteFrame(const imageView &image) {
+  if (!file_ || image.width != width_ || image.height != height_) {
+    return false;
+  }
+  const size_t plane = size_t{width_} * height_;
+  uint8_t *ys = planes_.data();
+  uint8_t *us = ys + plane;
+  uint8_t *vs = us + plane;
+  const int ri = image.order == PixelOrder::Rgba ? 0 : 2;
+  for (uint32_t y = 0; y < height_; ++y) {
+    const uint8_t *row = image.pixels + size_t{y} * image.stride;
+    size_t at = size_t{y} * width_;
+    for (uint32_t x = 0; x < width_; ++x, ++at) {
+      int r = row[4 * x + ri];
+      int g = row[4 * x + 1];
+      int b = row[4 * x + 2 - ri];
+      // BT.709 in 8.8 fixed point, scaled to 16..235 and 16..240
+      ys[at] = static_cast<uint8_t>(16 + ((47 * r + 157 * g + 16 * b + 128) >> 8));
+      us[at] = static_cast<uint8_t>(
+          std::clamp(((-26 * r - 87 * g + 113 * b + 32896) >> 8), 16, 240));
+      vs[at] = static_cast<uint8_t>(
+          std::clamp(((112 * r - 102 * g - 10 * b + 32896) >> 8), 16, 240));
+    }
+  }
+  if (std::fputs("FRAME\n", file_) < 0 ||
+      std::fwrite(planes_.data(), 1, planes_.size(), file_) != planes_.size()) {
+    TE_ERROR("Error writing video frame");
+    return false;
+  }
+  return true;
+}
+
+} // namespace capture
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace capture {
+
+enum class PixelOrder { Rgba, Bgra };
+
+// 8 bit pixels, four bytes each, rows stride bytes apart. Alpha is ignored.
+struct imageView {
+  const uint8_t *pixels = nullptr;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t stride = 0;
+  PixelOrder order = PixelOrder::Rgba;
+};
+
+uint32_t Crc32(const uint8_t *data, size_t size, uint32_t crc = 0);
+
+// RGB PNGs in stored (uncompressed) deflate blocks. Writing is a copy plus two checksums, fast
+// enough to keep up with frames at the cost of raw-sized files.
+class PngWriter {
+public:
+  bool Write(const std::string &path, const imageView &image);
+
+private:
+  // Reused between frames
+  std::vector<uint8_t> buffer_;
+};
+
+// YUV4MPEG2 stream of 4:4:4 BT.709 limited range frames, readable by ffmpeg and most players.
+// The extent is fixed when the stream is opened.
+class Y4mWriter {
+public:
+  Y4mWriter() = default;
+  ~Y4mWriter() { Close(); }
+
+  Y4mWriter(const Y4mWriter &) = delete;
+  Y4mWriter &operator=(const Y4mWriter &) = delete;
+
+  bool Open(const std::string &path, uint32_t width, uint32_t height, uint32_t fps);
+  void Close();
+  bool IsOpen() const { return file_ != nullptr; }
+  uint32_t GetWidth() const { return width_; }
+  uint32_t GetHeight() const { return height_; }
+
+  // image has to match the stream's extent
+  bool WriteFrame(const imageView &image);
+
+private:
+  std::FILE *file_ = nullptr;
+  uint32_t width_ = 0;
+  uint32_t height_ = 0;
+  std::vector<uint8_t> planes_;
+};
+
+} // namespace capture
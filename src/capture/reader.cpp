@@ -0,0 +1,207 @@
+#include "capture/reader.hpp"
+#include "platform/log.hpp"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace capture {
+
+bool Reader::Open(const std::string &path) {
+  Close();
+  if (!file_.Open(path)) {
+    return false;
+  }
+
+  fileHeader header;
+  if (file_.GetSize() < kPageSize) {
+    TE_ERROR("'{}' is too small to be a capture", path);
+    Close();
+    return false;
+  }
+  std::memcpy(&header, file_.GetData(), sizeof(header));
+  if (header.magic != kCaptureMagic || header.version != kCaptureVersion ||
+      header.chunk_samples == 0 || header.chunk_samples % kSummaryBlock != 0 ||
+      sizeof(header) + uint64_t{header.channel_count} * sizeof(channelInfo) > file_.GetSize()) {
+    TE_ERROR("'{}' is not a supported capture", path);
+    Close();
+    return false;
+  }
+  chunk_samples_ = header.chunk_samples;
+
+  channels_.resize(header.channel_count);
+  const auto *infos = reinterpret_cast<const channelInfo *>(file_.GetData() + sizeof(header));
+  for (uint32_t i = 0; i < header.channel_count; ++i) {
+    channels_[i].name.assign(infos[i].name, strnlen(infos[i].name, kMaxChannelName));
+  }
+
+  if (!ReadIndex(header.index_offset)) {
+    TE_ERROR("'{}' has a corrupt index", path);
+    Close();
+    return false;
+  }
+  TE_TRACE("Capture '{}' opened, {} channels, {} MiB", path, channels_.size(),
+           file_.GetSize() >> 20);
+  return true;
+}
+
+void Reader::Close() {
+  file_.Close();
+  channels_.clear();
+  chunk_samples_ = 0;
+}
+
+bool Reader::ReadIndex(uint64_t offset) {
+  // Blocks link newest to oldest, entries are collected in file order
+  std::vector<uint64_t> blocks;
+  while (offset != 0) {
+    if (offset % kPageSize != 0 || offset + sizeof(indexBlock) > file_.GetSize() ||
+        (!blocks.empty() && offset >= blocks.back())) {
+      return false;
+    }
+    indexBlock block;
+    std::memcpy(&block, file_.GetData() + offset, sizeof(block));
+    if (block.magic != kIndexMagic ||
+        offset + sizeof(block) + uint64_t{block.count} * sizeof(chunkEntry) > file_.GetSize()) {
+      return false;
+    }
+    blocks.push_back(offset);
+    offset = block.previous;
+  }
+
+  uint64_t chunk_bytes = ChunkBytes(chunk_samples_);
+  for (auto it = blocks.rbegin(); it != blocks.rend(); ++it) {
+    indexBlock block;
+    std::memcpy(&block, file_.GetData() + *it, sizeof(block));
+    // Index blocks start on a page and entries are 8 byte aligned after the block header
+    const auto *entries =
+        reinterpret_cast<const chunkEntry *>(file_.GetData() + *it + sizeof(indexBlock));
+    for (uint32_t i = 0; i < block.count; ++i) {
+      const chunkEntry &entry = entries[i];
+      if (entry.channel >= channels_.size() || entry.count == 0 ||
+          entry.count > chunk_samples_ || entry.offset + chunk_bytes > file_.GetSize()) {
+        return false;
+      }
+      channels_[entry.channel].chunks.push_back(&entry);
+    }
+  }
+  return true;
+}
+
+uint64_t Reader::GetSampleCount(uint32_t channel) const {
+  const std::vector<const chunkEntry *> &chunks = channels_[channel].chunks;
+  return chunks.empty() ? 0 : chunks.back()->first_sample + chunks.back()->count;
+}
+
+uint64_t Reader::GetDurationNs() const {
+  uint64_t duration = 0;
+  for (const channel &c : channels_) {
+    if (!c.chunks.empty()) {
+      duration = std::max(duration, c.chunks.back()->timestamp_ns);
+    }
+  }
+  return duration;
+}
+
+size_t Reader::FindChunk(const channel &c, uint64_t sample) const {
+  // Last chunk starting at or before sample, c.chunks.size() when there is none
+  auto it = std::upper_bound(
+      c.chunks.begin(), c.chunks.end(), sample,
+      [](uint64_t s, const chunkEntry *entry) { return s < entry->first_sample; });
+  return it == c.chunks.begin() ? c.chunks.size() : static_cast<size_t>(it - c.chunks.begin()) - 1;
+}
+
+const float *Reader::GetSamples(uint32_t channel, uint64_t sample, uint64_t *first,
+                                uint32_t *count) const {
+  const Reader::channel &c = channels_[channel];
+  size_t index = FindChunk(c, sample);
+  if (index == c.chunks.size()) {
+    return nullptr;
+  }
+  const chunkEntry &entry = *c.chunks[index];
+  if (sample >= entry.first_sample + entry.count) {
+    return nullptr;
+  }
+  *first = entry.first_sample;
+  *count = entry.count;
+  return reinterpret_cast<const float *>(file_.GetData() + entry.offset);
+}
+
+uint64_t Reader::FindSample(uint32_t channel, uint64_t timestamp_ns) const {
+  const std::vector<const chunkEntry *> &chunks = channels_[channel].chunks;
+  auto it = std::upper_bound(
+      chunks.begin(), chunks.end(), timestamp_ns,
+      [](uint64_t t, const chunkEntry *entry) { return t < entry->timestamp_ns; });
+  return it == chunks.begin() ? 0 : (*(it - 1))->first_sample;
+}
+
+void Reader::ReduceChunk(const chunkEntry &entry, uint32_t begin, uint32_t end, float *lo,
+                         float *hi) const {
+  const auto *samples = reinterpret_cast<const float *>(file_.GetData() + entry.offset);
+  const float *mins = samples + chunk_samples_;
+  const float *maxs = mins + chunk_samples_ / kSummaryBlock;
+  // Whole summary blocks in the middle, raw samples on the edges. The last block may be short,
+  // its summary still covers it when the range runs to the end of the chunk.
+  uint32_t first_block = (begin + kSummaryBlock - 1) / kSummaryBlock;
+  uint32_t last_block = end == entry.count ? (end + kSummaryBlock - 1) / kSummaryBlock
+                                           : end / kSummaryBlock;
+  if (first_block >= last_block) {
+    for (uint32_t i = begin; i < end; ++i) {
+      *lo = std::min(*lo, samples[i]);
+      *hi = std::max(*hi, samples[i]);
+    }
+    return;
+  }
+  for (uint32_t b = first_block; b < last_block; ++b) {
+    *lo = std::min(*lo, mins[b]);
+    *hi = std::max(*hi, maxs[b]);
+  }
+  for (uint32_t i = begin; i < first_block * kSummaryBlock; ++i) {
+    *lo = std::min(*lo, samples[i]);
+    *hi = std::max(*hi, samples[i]);
+  }
+  for (uint32_t i = std::min(last_block * kSummaryBlock, end); i < end; ++i) {
+    *lo = std::min(*lo, samples[i]);
+    *hi = std::max(*hi, samples[i]);
+  }
+}
+
+dsp::plotColumn Reader::Reduce(uint32_t channel, uint64_t first, uint64_t last) const {
+  dsp::plotColumn column{std::numeric_limits<float>::infinity(),
+                         -std::numeric_limits<float>::infinity(), 0.0f};
+  const Reader::channel &c = channels_[channel];
+  size_t index = FindChunk(c, first);
+  if (index == c.chunks.size()) {
+    index = 0;
+  }
+  for (; index < c.chunks.size() && c.chunks[index]->first_sample < last; ++index) {
+    const chunkEntry &entry = *c.chunks[index];
+    uint64_t begin = std::max(first, entry.first_sample);
+    uint64_t end = std::min(last, entry.first_sample + entry.count);
+    if (begin >= end) {
+      continue;
+    }
+    if (begin == entry.first_sample && end == entry.first_sample + entry.count) {
+      column.min = std::min(column.min, entry.min);
+      column.max = std::max(column.max, entry.max);
+    } else {
+      ReduceChunk(entry, static_cast<uint32_t>(begin - entry.first_sample),
+                  static_cast<uint32_t>(end - entry.first_sample), &column.min, &column.max);
+    }
+  }
+  return column;
+}
+
+uint32_t Reader::Decimate(uint32_t channel, uint64_t first, uint64_t last, uint32_t columns,
+                          dsp::plotColumn *out) const {
+  if (last <= first || columns == 0) {
+    return 0;
+  }
+  uint64_t n = last - first;
+  columns = static_cast<uint32_t>(std::min<uint64_t>(columns, n));
+  for (uint32_t i = 0; i < columns; ++i) {
+    out[i] = Reduce(channel, first + n * i / columns, first + n * (i + 1) / columns);
+  }
+  return columns;
+}
+
+} // namespace capture
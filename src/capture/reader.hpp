@@ -0,0 +1,58 @@
+#pragma once
+#include "capture/capture-format.hpp"
+#include "dsp/minmax-pyramid.hpp"
+#include "platform/mapped-file.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace capture {
+
+// Maps a capture and serves samples and summaries straight from the mapping. Opening reads the
+// header and the index chain only, everything else is paged in when a view touches it, so the
+// cost of opening and scrubbing doesn't depend on the file size. Samples written after the last
+// index flush are not visible.
+class Reader {
+public:
+  bool Open(const std::string &path);
+  void Close();
+  bool IsOpen() const { return file_.GetData() != nullptr; }
+
+  uint32_t GetChannelCount() const { return static_cast<uint32_t>(channels_.size()); }
+  const std::string &GetChannelName(uint32_t channel) const { return channels_[channel].name; }
+  uint32_t GetChunkSamples() const { return chunk_samples_; }
+  // One past the channel's last indexed sample
+  uint64_t GetSampleCount(uint32_t channel) const;
+  uint64_t GetDurationNs() const;
+
+  // The chunk holding sample, pointing into the mapping: count samples starting at *first.
+  // nullptr when the sample was dropped while capturing or is out of range.
+  const float *GetSamples(uint32_t channel, uint64_t sample, uint64_t *first,
+                          uint32_t *count) const;
+  // First sample of the chunk that was being captured at timestamp_ns
+  uint64_t FindSample(uint32_t channel, uint64_t timestamp_ns) const;
+
+  // Same contract as dsp::MinMaxPyramid, from the chunk and block summaries wherever they cover
+  // the range. Means aren't stored and read as 0, dropped ranges are skipped.
+  dsp::plotColumn Reduce(uint32_t channel, uint64_t first, uint64_t last) const;
+  uint32_t Decimate(uint32_t channel, uint64_t first, uint64_t last, uint32_t columns,
+                    dsp::plotColumn *out) const;
+
+private:
+  struct channel {
+    std::string name;
+    // Into the mapping, ordered by first_sample
+    std::vector<const chunkEntry *> chunks;
+  };
+
+  bool ReadIndex(uint64_t offset);
+  size_t FindChunk(const channel &c, uint64_t sample) const;
+  void ReduceChunk(const chunkEntry &entry, uint32_t begin, uint32_t end, float *lo,
+                   float *hi) const;
+
+  platform::MappedFile file_;
+  uint32_t chunk_samples_ = 0;
+  std::vector<channel> channels_;
+};
+
+} // namespace capture
@@ -0,0 +1,254 @@
+#include "capture/writer.hpp"
+#include "platform/log.hpp"
+#include "platform/trace.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+namespace capture {
+
+namespace {
+
+const uint8_t kZeros[kPageSize] = {};
+
+} // namespace
+
+bool Writer::Open(const std::string &path, const std::vector<std::string> &channels,
+                  writerOpts opts) {
+  Close();
+  opts.chunk_samples = std::max<uint32_t>(opts.chunk_samples, kSummaryBlock);
+  opts.chunk_samples = (opts.chunk_samples + kSummaryBlock - 1) / kSummaryBlock * kSummaryBlock;
+  opts_ = opts;
+
+  file_ = std::fopen(path.c_str(), "wb");
+  if (!file_) {
+    TE_ERROR("Error creating capture '{}'", path);
+    return false;
+  }
+
+  fileHeader header{};
+  header.magic = kCaptureMagic;
+  header.version = kCaptureVersion;
+  header.channel_count = static_cast<uint32_t>(channels.size());
+  header.chunk_samples = opts_.chunk_samples;
+  std::vector<channelInfo> infos(channels.size());
+  for (size_t i = 0; i < channels.size(); ++i) {
+    std::memset(&infos[i], 0, sizeof(channelInfo));
+    std::strncpy(infos[i].name, channels[i].c_str(), kMaxChannelName - 1);
+  }
+
+  failed_ = false;
+  file_end_ = 0;
+  bytes_written_ = 0;
+  dropped_chunks_ = 0;
+  Write(&header, sizeof(header));
+  Write(infos.data(), infos.size() * sizeof(channelInfo));
+  Write(kZeros, AlignToPage(file_end_) - file_end_);
+  if (failed_) {
+    std::fclose(file_);
+    file_ = nullptr;
+    return false;
+  }
+
+  channels_.clear();
+  channels_.resize(channels.size());
+  start_ns_ = platform::Trace::SteadyNanoseconds();
+  last_index_ = 0;
+  last_index_ns_ = start_ns_;
+  entries_.clear();
+  summary_.resize(2 * opts_.chunk_samples / kSummaryBlock);
+  stopping_ = false;
+  thread_ = std::thread([this] { Run(); });
+  TE_TRACE("Capture '{}' opened with {} channels", path, channels.size());
+  return true;
+}
+
+bool Writer::Close() {
+  if (!file_) {
+    return true;
+  }
+  for (channel &c : channels_) {
+    if (c.open && c.open->count > 0) {
+      Submit(std::move(c.open));
+    }
+    c.open.reset();
+  }
+  {
+    std::lock_guard lock(mutex_);
+    stopping_ = true;
+  }
+  cv_.notify_one();
+  thread_.join();
+
+  std::fclose(file_);
+  file_ = nullptr;
+  channels_.clear();
+  queue_.clear();
+  free_.clear();
+  if (failed_) {
+    TE_ERROR("Capture closed after a write error");
+  }
+  return !failed_;
+}
+
+void Writer::Append(uint32_t channel, const float *samples, size_t count) {
+  Writer::channel &c = channels_[channel];
+  while (count > 0) {
+    if (!c.open) {
+      c.open = AcquireChunk();
+      c.open->channel = channel;
+      c.open->first_sample = c.next_sample;
+      c.open->timestamp_ns = platform::Trace::SteadyNanoseconds() - start_ns_;
+      c.open->count = 0;
+    }
+    chunk &open = *c.open;
+    size_t n = std::min<size_t>(count, opts_.chunk_samples - open.count);
+    std::memcpy(open.samples.data() + open.count, samples, n * sizeof(float));
+    open.count += static_cast<uint32_t>(n);
+    c.next_sample += n;
+    samples += n;
+    count -= n;
+    if (open.count == opts_.chunk_samples) {
+      Submit(std::move(c.open));
+    }
+  }
+}
+
+std::unique_ptr<Writer::chunk> Writer::AcquireChunk() {
+  {
+    std::lock_guard lock(mutex_);
+    if (!free_.empty()) {
+      std::unique_ptr<chunk> c = std::move(free_.back());
+      free_.pop_back();
+      return c;
+    }
+  }
+  auto c = std::make_unique<chunk>();
+  c->samples.resize(opts_.chunk_samples);
+  return c;
+}
+
+void Writer::Submit(std::unique_ptr<chunk> full) {
+  {
+    std::lock_guard lock(mutex_);
+    if (queue_.size() >= opts_.max_queued_chunks) {
+      ++dropped_chunks_;
+      free_.push_back(std::move(full));
+      return;
+    }
+    queue_.push_back(std::move(full));
+  }
+  cv_.notify_one();
+}
+
+void Writer::Run() {
+  TE_ZONE_THREAD("capture writer");
+  std::unique_lock lock(mutex_);
+  while (true) {
+    cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+    if (queue_.empty()) {
+      break;
+    }
+    std::unique_ptr<chunk> c = std::move(queue_.front());
+    queue_.pop_front();
+    lock.unlock();
+
+    WriteChunk(*c);
+    uint64_t now = platform::Trace::SteadyNanoseconds();
+    if (entries_.size() >= opts_.index_chunks ||
+        static_cast<double>(now - last_index_ns_) * 1e-9 >= opts_.index_interval_s) {
+      WriteIndex();
+      last_index_ns_ = now;
+    }
+
+    lock.lock();
+    free_.push_back(std::move(c));
+  }
+  lock.unlock();
+  WriteIndex();
+}
+
+bool Writer::Write(const void *data, size_t size) {
+  if (failed_ || size == 0) {
+    return !failed_;
+  }
+  if (std::fwrite(data, 1, size, file_) != size) {
+    TE_ERROR("Error writing capture");
+    failed_ = true;
+    return false;
+  }
+  file_end_ += size;
+  bytes_written_ += size;
+  return true;
+}
+
+bool Writer::WriteChunk(chunk &c) {
+  TE_ZONE("Writer::WriteChunk");
+  uint32_t blocks = (c.count + kSummaryBlock - 1) / kSummaryBlock;
+  uint32_t capacity = opts_.chunk_samples / kSummaryBlock;
+  float *mins = summary_.data();
+  float *maxs = summary_.data() + capacity;
+  std::fill(summary_.begin(), summary_.end(), 0.0f);
+  for (uint32_t b = 0; b < blocks; ++b) {
+    const float *begin = c.samples.data() + b * kSummaryBlock;
+    const float *end = c.samples.data() + std::min(c.count, (b + 1) * kSummaryBlock);
+    auto [lo, hi] = std::minmax_element(begin, end);
+    mins[b] = *lo;
+    maxs[b] = *hi;
+  }
+  // Only the last chunk of a channel is partial, its tail is written as zeros
+  std::fill(c.samples.begin() + c.count, c.samples.end(), 0.0f);
+
+  chunkEntry entry{};
+  entry.offset = file_end_;
+  entry.first_sample = c.first_sample;
+  entry.timestamp_ns = c.timestamp_ns;
+  entry.channel = c.channel;
+  entry.count = c.count;
+  entry.min = *std::min_element(mins, mins + blocks);
+  entry.max = *std::max_element(maxs, maxs + blocks);
+
+  uint64_t start = file_end_;
+  Write(c.samples.data(), c.samples.size() * sizeof(float));
+  Write(summary_.data(), summary_.size() * sizeof(float));
+  Write(kZeros, start + ChunkBytes(opts_.chunk_samples) - file_end_);
+  if (failed_) {
+    return false;
+  }
+  entries_.push_back(entry);
+  return true;
+}
+
+bool Writer::WriteIndex() {
+  if (entries_.empty() || failed_) {
+    return !failed_;
+  }
+  TE_ZONE("Writer::WriteIndex");
+  uint64_t offset = file_end_;
+  indexBlock block{};
+  block.magic = kIndexMagic;
+  block.count = static_cast<uint32_t>(entries_.size());
+  block.previous = last_index_;
+  Write(&block, sizeof(block));
+  Write(entries_.data(), entries_.size() * sizeof(chunkEntry));
+  Write(kZeros, AlignToPage(file_end_) - file_end_);
+  if (failed_) {
+    return false;
+  }
+
+  // Chunks and index reach the file before the header points at them
+  bool ok = std::fflush(file_) == 0 &&
+            std::fseek(file_, offsetof(fileHeader, index_offset), SEEK_SET) == 0 &&
+            std::fwrite(&offset, sizeof(offset), 1, file_) == 1 && std::fflush(file_) == 0 &&
+            std::fseek(file_, 0, SEEK_END) == 0;
+  if (!ok) {
+    TE_ERROR("Error writing capture index");
+    failed_ = true;
+    return false;
+  }
+  last_index_ = offset;
+  entries_.clear();
+  return true;
+}
+
+} // namespace capture
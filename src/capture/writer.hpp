@@ -0,0 +1,95 @@
+#pragma once
+#include "capture/capture-format.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace capture {
+
+struct writerOpts {
+  // Rounded up to a multiple of kSummaryBlock
+  uint32_t chunk_samples = 1u << 16;
+  // An index block is written after this many chunks or this long after the previous one
+  uint32_t index_chunks = 256;
+  double index_interval_s = 1.0;
+  // Full chunks waiting for the disk beyond this are dropped
+  uint32_t max_queued_chunks = 256;
+};
+
+// Streams channels into a capture file. Append only copies into the channel's open chunk, full
+// chunks go to a writer thread that summarizes them and writes everything sequentially. When
+// the disk can't keep up whole chunks are dropped and counted, their samples keep their indices.
+class Writer {
+public:
+  Writer() = default;
+  ~Writer() { Close(); }
+
+  Writer(const Writer &) = delete;
+  Writer &operator=(const Writer &) = delete;
+
+  bool Open(const std::string &path, const std::vector<std::string> &channels,
+            writerOpts opts = {});
+  // Writes the partial chunks and a final index, returns false when any write failed
+  bool Close();
+  bool IsOpen() const { return file_ != nullptr; }
+
+  // A single producer thread, e.g. the frame loop consuming Ingest
+  void Append(uint32_t channel, const float *samples, size_t count);
+
+  uint64_t GetBytesWritten() const { return bytes_written_; }
+  uint64_t GetDroppedChunks() const { return dropped_chunks_; }
+
+private:
+  struct chunk {
+    uint32_t channel = 0;
+    uint64_t first_sample = 0;
+    uint64_t timestamp_ns = 0;
+    uint32_t count = 0;
+    std::vector<float> samples;
+  };
+
+  struct channel {
+    std::unique_ptr<chunk> open;
+    uint64_t next_sample = 0;
+  };
+
+  std::unique_ptr<chunk> AcquireChunk();
+  void Submit(std::unique_ptr<chunk> full);
+  void Run();
+  bool Write(const void *data, size_t size);
+  bool WriteChunk(chunk &c);
+  bool WriteIndex();
+
+  std::FILE *file_ = nullptr;
+  writerOpts opts_;
+  uint64_t start_ns_ = 0;
+  // Producer thread only
+  std::vector<channel> channels_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::unique_ptr<chunk>> queue_;
+  std::vector<std::unique_ptr<chunk>> free_;
+  bool stopping_ = false;
+  std::thread thread_;
+
+  // Writer thread only
+  uint64_t file_end_ = 0;
+  uint64_t last_index_ = 0;
+  uint64_t last_index_ns_ = 0;
+  std::vector<chunkEntry> entries_;
+  std::vector<float> summary_;
+  bool failed_ = false;
+
+  std::atomic<uint64_t> bytes_written_ = 0;
+  std::atomic<uint64_t> dropped_chunks_ = 0;
+};
+
+} // namespace capture
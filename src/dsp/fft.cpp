@@ -0,0 +1,151 @@
+#include "dsp/fft.hpp"
+#include <cassert>
+#include <cmath>
+#include <numbers>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define DSP_SSE2 1
+#endif
+
+namespace dsp {
+
+float MakeWindow(WindowKind kind, float *out, size_t count) {
+  // Periodic windows, what spectral analysis of a running stream wants
+  const double step = 2.0 * std::numbers::pi / static_cast<double>(count);
+  double sum = 0.0;
+  for (size_t i = 0; i < count; ++i) {
+    double x = step * static_cast<double>(i);
+    double w = 1.0;
+    switch (kind) {
+    case WindowKind::Rectangular:
+      break;
+    case WindowKind::Hann:
+      w = 0.5 - 0.5 * std::cos(x);
+      break;
+    case WindowKind::Hamming:
+      w = 0.54 - 0.46 * std::cos(x);
+      break;
+    case WindowKind::BlackmanHarris:
+      w = 0.35875 - 0.48829 * std::cos(x) + 0.14128 * std::cos(2.0 * x) -
+          0.01168 * std::cos(3.0 * x);
+      break;
+    case WindowKind::FlatTop:
+      w = 0.21557895 - 0.41663158 * std::cos(x) + 0.277263158 * std::cos(2.0 * x) -
+          0.083578947 * std::cos(3.0 * x) + 0.006947368 * std::cos(4.0 * x);
+      break;
+    }
+    out[i] = static_cast<float>(w);
+    sum += w;
+  }
+  return static_cast<float>(sum);
+}
+
+RealFft::RealFft(uint32_t size) : size_(size), half_(size / 2) {
+  assert(size >= 4 && (size & (size - 1)) == 0);
+  uint32_t bits = 0;
+  while ((1u << bits) < half_) {
+    ++bits;
+  }
+  bit_reverse_.resize(half_);
+  for (uint32_t i = 0; i < half_; ++i) {
+    uint32_t r = 0;
+    for (uint32_t b = 0; b < bits; ++b) {
+      r |= ((i >> b) & 1u) << (bits - 1 - b);
+    }
+    bit_reverse_[i] = r;
+  }
+
+  stage_re_.resize(half_ > 1 ? half_ - 1 : 1);
+  stage_im_.resize(stage_re_.size());
+  for (uint32_t h = 1; h < half_; h *= 2) {
+    for (uint32_t k = 0; k < h; ++k) {
+      double angle = -std::numbers::pi * k / h;
+      stage_re_[h - 1 + k] = static_cast<float>(std::cos(angle));
+      stage_im_[h - 1 + k] = static_cast<float>(std::sin(angle));
+    }
+  }
+
+  split_re_.resize(half_ / 2 + 1);
+  split_im_.resize(half_ / 2 + 1);
+  for (uint32_t k = 0; k <= half_ / 2; ++k) {
+    double angle = -2.0 * std::numbers::pi * k / size_;
+    split_re_[k] = static_cast<float>(std::cos(angle));
+    split_im_[k] = static_cast<float>(std::sin(angle));
+  }
+}
+
+void RealFft::Butterflies(float *re, float *im) const {
+  for (uint32_t h = 1; h < half_; h *= 2) {
+    const float *wr = stage_re_.data() + h - 1;
+    const float *wi = stage_im_.data() + h - 1;
+    for (uint32_t s = 0; s < half_; s += 2 * h) {
+      float *ar = re + s;
+      float *ai = im + s;
+      float *br = ar + h;
+      float *bi = ai + h;
+      uint32_t k = 0;
+#ifdef DSP_SSE2
+      // Split real and imaginary arrays make four butterflies one set of vector ops
+      for (; k + 4 <= h; k += 4) {
+        __m128 twr = _mm_loadu_ps(wr + k);
+        __m128 twi = _mm_loadu_ps(wi + k);
+        __m128 xr = _mm_loadu_ps(br + k);
+        __m128 xi = _mm_loadu_ps(bi + k);
+        __m128 tr = _mm_sub_ps(_mm_mul_ps(twr, xr), _mm_mul_ps(twi, xi));
+        __m128 ti = _mm_add_ps(_mm_mul_ps(twr, xi), _mm_mul_ps(twi, xr));
+        __m128 yr = _mm_loadu_ps(ar + k);
+        __m128 yi = _mm_loadu_ps(ai + k);
+        _mm_storeu_ps(br + k, _mm_sub_ps(yr, tr));
+        _mm_storeu_ps(bi + k, _mm_sub_ps(yi, ti));
+        _mm_storeu_ps(ar + k, _mm_add_ps(yr, tr));
+        _mm_storeu_ps(ai + k, _mm_add_ps(yi, ti));
+      }
+#endif
+      for (; k < h; ++k) {
+        float tr = wr[k] * br[k] - wi[k] * bi[k];
+        float ti = wr[k] * bi[k] + wi[k] * br[k];
+        br[k] = ar[k] - tr;
+        bi[k] = ai[k] - ti;
+        ar[k] += tr;
+        ai[k] += ti;
+      }
+    }
+  }
+}
+
+void RealFft::Forward(const float *in, float *re, float *im) const {
+  // Even samples as the real part, odd as the imaginary part, permuted on the way in
+  for (uint32_t n = 0; n < half_; ++n) {
+    re[bit_reverse_[n]] = in[2 * n];
+    im[bit_reverse_[n]] = in[2 * n + 1];
+  }
+  Butterflies(re, im);
+
+  // Split the half size spectrum Z into the real spectrum X, pairing bins k and half - k:
+  // X[k] = E + W^k O and X[half - k] = conj(E - W^k O), with E = (Z[k] + conj(Z[half - k])) / 2
+  // and O = -i (Z[k] - conj(Z[half - k])) / 2
+  float z0r = re[0];
+  float z0i = im[0];
+  re[0] = z0r + z0i;
+  im[0] = 0.0f;
+  re[half_] = z0r - z0i;
+  im[half_] = 0.0f;
+  for (uint32_t k = 1; k <= half_ / 2; ++k) {
+    uint32_t m = half_ - k;
+    float er = 0.5f * (re[k] + re[m]);
+    float ei = 0.5f * (im[k] - im[m]);
+    float or_ = 0.5f * (im[k] + im[m]);
+    float oi = -0.5f * (re[k] - re[m]);
+    float tr = split_re_[k] * or_ - split_im_[k] * oi;
+    float ti = split_re_[k] * oi + split_im_[k] * or_;
+    re[k] = er + tr;
+    im[k] = ei + ti;
+    if (m != k) {
+      re[m] = er - tr;
+      im[m] = -(ei - ti);
+    }
+  }
+}
+
+} // namespace dsp
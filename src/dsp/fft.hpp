@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dsp {
+
+enum class WindowKind {
+  Rectangular,
+  Hann,
+  Hamming,
+  BlackmanHarris,
+  FlatTop,
+};
+
+// Fills count window coefficients, returns their sum for amplitude correction
+float MakeWindow(WindowKind kind, float *out, size_t count);
+
+// Real input FFT of a fixed power of two size, computed as a half size complex FFT plus a split
+// pass. Bit reversal, stage twiddles and split twiddles are tabulated at construction, Forward
+// only reads them, so one transform can serve any number of threads.
+class RealFft {
+public:
+  // size is a power of two, at least 4
+  explicit RealFft(uint32_t size);
+
+  uint32_t GetSize() const { return size_; }
+
+  // Transforms size samples into bins 0..size/2 inclusive. re and im hold size/2 + 1 values and
+  // double as the working storage.
+  void Forward(const float *in, float *re, float *im) const;
+
+private:
+  void Butterflies(float *re, float *im) const;
+
+  uint32_t size_;
+  uint32_t half_;
+  std::vector<uint32_t> bit_reverse_;
+  // Stage with span h uses entries [h - 1, 2h - 1): exp(-i pi k / h)
+  std::vector<float> stage_re_;
+  std::vector<float> stage_im_;
+  // exp(-2 pi i k / size) for k in [0, size / 4]
+  std::vector<float> split_re_;
+  std::vector<float> split_im_;
+};
+
+} // namespace dsp
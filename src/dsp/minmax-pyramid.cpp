@@ -0,0 +1,302 @@
+#include "dsp/minmax-pyramid.hpp"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define DSP_SSE2 1
+#endif
+
+namespace dsp {
+
+namespace {
+
+static_assert(MinMaxPyramid::kFactor == 8, "bucket kernels reduce 8 values");
+
+#ifdef DSP_SSE2
+float HorizontalMin(__m128 v) {
+  v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+  v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+  return _mm_cvtss_f32(v);
+}
+
+float HorizontalMax(__m128 v) {
+  v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+  v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+  return _mm_cvtss_f32(v);
+}
+
+float HorizontalSum(__m128 v) {
+  v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+  v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+  return _mm_cvtss_f32(v);
+}
+#endif
+
+// Each kernel reduces buckets of 8 consecutive values into one output per bucket
+
+void BucketMinMax(const float *src, size_t buckets, float *mins, float *maxs) {
+  for (size_t b = 0; b < buckets; ++b, src += 8) {
+#ifdef DSP_SSE2
+    __m128 lo = _mm_loadu_ps(src);
+    __m128 hi = _mm_loadu_ps(src + 4);
+    mins[b] = HorizontalMin(_mm_min_ps(lo, hi));
+    maxs[b] = HorizontalMax(_mm_max_ps(lo, hi));
+#else
+    mins[b] = *std::min_element(src, src + 8);
+    maxs[b] = *std::max_element(src, src + 8);
+#endif
+  }
+}
+
+void BucketMin(const float *src, size_t buckets, float *out) {
+  for (size_t b = 0; b < buckets; ++b, src += 8) {
+#ifdef DSP_SSE2
+    out[b] = HorizontalMin(_mm_min_ps(_mm_loadu_ps(src), _mm_loadu_ps(src + 4)));
+#else
+    out[b] = *std::min_element(src, src + 8);
+#endif
+  }
+}
+
+void BucketMax(const float *src, size_t buckets, float *out) {
+  for (size_t b = 0; b < buckets; ++b, src += 8) {
+#ifdef DSP_SSE2
+    out[b] = HorizontalMax(_mm_max_ps(_mm_loadu_ps(src), _mm_loadu_ps(src + 4)));
+#else
+    out[b] = *std::max_element(src, src + 8);
+#endif
+  }
+}
+
+void BucketMean(const float *src, size_t buckets, float *out) {
+  for (size_t b = 0; b < buckets; ++b, src += 8) {
+#ifdef DSP_SSE2
+    out[b] = HorizontalSum(_mm_add_ps(_mm_loadu_ps(src), _mm_loadu_ps(src + 4))) * 0.125f;
+#else
+    float sum = 0.0f;
+    for (int i = 0; i < 8; ++i) {
+      sum += src[i];
+    }
+    out[b] = sum * 0.125f;
+#endif
+  }
+}
+
+// Min over mins and max over maxs, both n long. Raw samples pass the same pointer twice.
+void RangeMinMax(const float *mins, const float *maxs, size_t n, float *lo, float *hi) {
+  size_t i = 0;
+  float vmin = std::numeric_limits<float>::infinity();
+  float vmax = -std::numeric_limits<float>::infinity();
+#ifdef DSP_SSE2
+  if (n >= 4) {
+    __m128 accMin = _mm_loadu_ps(mins);
+    __m128 accMax = _mm_loadu_ps(maxs);
+    for (i = 4; i + 4 <= n; i += 4) {
+      accMin = _mm_min_ps(accMin, _mm_loadu_ps(mins + i));
+      accMax = _mm_max_ps(accMax, _mm_loadu_ps(maxs + i));
+    }
+    vmin = HorizontalMin(accMin);
+    vmax = HorizontalMax(accMax);
+  }
+#endif
+  for (; i < n; ++i) {
+    vmin = std::min(vmin, mins[i]);
+    vmax = std::max(vmax, maxs[i]);
+  }
+  *lo = vmin;
+  *hi = vmax;
+}
+
+double RangeSum(const float *values, size_t n) {
+  size_t i = 0;
+  double sum = 0.0;
+#ifdef DSP_SSE2
+  // Float lanes over short blocks, accumulated in double so long ranges keep their precision
+  for (; i + 64 <= n; i += 64) {
+    __m128 acc = _mm_setzero_ps();
+    for (size_t j = i; j < i + 64; j += 4) {
+      acc = _mm_add_ps(acc, _mm_loadu_ps(values + j));
+    }
+    sum += HorizontalSum(acc);
+  }
+#endif
+  for (; i < n; ++i) {
+    sum += values[i];
+  }
+  return sum;
+}
+
+} // namespace
+
+uint64_t MinMaxPyramid::GetBucketSize(uint32_t level) const {
+  return uint64_t{1} << (3 * level);
+}
+
+void MinMaxPyramid::Reserve(uint64_t samples) {
+  uint64_t buckets = samples / kFactor;
+  for (size_t l = 0; buckets > 0; ++l, buckets /= kFactor) {
+    if (l == levels_.size()) {
+      levels_.emplace_back();
+    }
+    levels_[l].min.reserve(buckets);
+    levels_[l].max.reserve(buckets);
+    if (keep_mean_) {
+      levels_[l].mean.reserve(buckets);
+    }
+  }
+}
+
+void MinMaxPyramid::Reset() {
+  // Keeps the storage for the next trace
+  for (level &lv : levels_) {
+    lv.min.clear();
+    lv.max.clear();
+    lv.mean.clear();
+  }
+  sample_count_ = 0;
+  pending_count_ = 0;
+}
+
+void MinMaxPyramid::Append(const float *samples, size_t count) {
+  sample_count_ += count;
+  if (pending_count_ > 0) {
+    size_t take = std::min<size_t>(count, kFactor - pending_count_);
+    std::memcpy(pending_ + pending_count_, samples, take * sizeof(float));
+    pending_count_ += static_cast<uint32_t>(take);
+    samples += take;
+    count -= take;
+    if (pending_count_ < kFactor) {
+      return;
+    }
+    AppendBuckets(pending_, 1);
+    pending_count_ = 0;
+  }
+
+  size_t buckets = count / kFactor;
+  AppendBuckets(samples, buckets);
+  samples += buckets * kFactor;
+  count -= buckets * kFactor;
+  std::memcpy(pending_, samples, count * sizeof(float));
+  pending_count_ = static_cast<uint32_t>(count);
+  Cascade();
+}
+
+void MinMaxPyramid::AppendBuckets(const float *samples, size_t buckets) {
+  if (buckets == 0) {
+    return;
+  }
+  if (levels_.empty()) {
+    levels_.emplace_back();
+  }
+  level &first = levels_[0];
+  size_t done = first.min.size();
+  first.min.resize(done + buckets);
+  first.max.resize(done + buckets);
+  BucketMinMax(samples, buckets, first.min.data() + done, first.max.data() + done);
+  if (keep_mean_) {
+    first.mean.resize(done + buckets);
+    BucketMean(samples, buckets, first.mean.data() + done);
+  }
+}
+
+void MinMaxPyramid::Cascade() {
+  for (size_t l = 0; l < levels_.size(); ++l) {
+    size_t complete = levels_[l].min.size() / kFactor;
+    if (complete == 0) {
+      break;
+    }
+    if (l + 1 == levels_.size()) {
+      levels_.emplace_back();
+    }
+    const level &child = levels_[l];
+    level &parent = levels_[l + 1];
+    size_t done = parent.min.size();
+    if (complete == done) {
+      // Nothing new reached this level, so nothing can reach the ones above
+      break;
+    }
+    size_t fresh = complete - done;
+    parent.min.resize(complete);
+    parent.max.resize(complete);
+    BucketMin(child.min.data() + done * kFactor, fresh, parent.min.data() + done);
+    BucketMax(child.max.data() + done * kFactor, fresh, parent.max.data() + done);
+    if (keep_mean_) {
+      parent.mean.resize(complete);
+      BucketMean(child.mean.data() + done * kFactor, fresh, parent.mean.data() + done);
+    }
+  }
+}
+
+uint32_t MinMaxPyramid::SelectLevel(double samples_per_column) const {
+  uint32_t level = 0;
+  while (level + 1 < GetLevelCount() &&
+         static_cast<double>(GetBucketSize(level + 1)) <= samples_per_column) {
+    ++level;
+  }
+  return level;
+}
+
+void MinMaxPyramid::summary::Merge(const summary &other) {
+  min = std::min(min, other.min);
+  max = std::max(max, other.max);
+  sum += other.sum;
+  count += other.count;
+}
+
+uint32_t MinMaxPyramid::Decimate(const float *raw, uint64_t first, uint64_t last,
+                                 uint32_t columns, plotColumn *out) const {
+  if (last <= first || columns == 0) {
+    return 0;
+  }
+  uint64_t n = last - first;
+  columns = static_cast<uint32_t>(std::min<uint64_t>(columns, n));
+  uint32_t lvl = SelectLevel(static_cast<double>(n) / columns);
+  for (uint32_t i = 0; i < columns; ++i) {
+    uint64_t begin = first + n * i / columns;
+    uint64_t end = first + n * (i + 1) / columns;
+    summary acc = ReduceLevel(raw, begin, end, lvl);
+    out[i] = {acc.min, acc.max, static_cast<float>(acc.sum / static_cast<double>(acc.count))};
+  }
+  return columns;
+}
+
+plotColumn MinMaxPyramid::Reduce(const float *raw, uint64_t first, uint64_t last) const {
+  summary acc = ReduceLevel(raw, first, last, GetLevelCount() - 1);
+  float mean = acc.count > 0 ? static_cast<float>(acc.sum / static_cast<double>(acc.count)) : 0;
+  return {acc.min, acc.max, mean};
+}
+
+MinMaxPyramid::summary MinMaxPyramid::ReduceLevel(const float *raw, uint64_t first,
+                                                  uint64_t last, uint32_t lvl) const {
+  summary acc;
+  if (last <= first) {
+    return acc;
+  }
+  if (lvl == 0) {
+    size_t n = static_cast<size_t>(last - first);
+    RangeMinMax(raw + first, raw + first, n, &acc.min, &acc.max);
+    acc.sum = keep_mean_ ? RangeSum(raw + first, n) : 0.0;
+    acc.count = n;
+    return acc;
+  }
+
+  // Whole buckets of this level in the middle, finer levels for the ragged edges
+  const level &lv = levels_[lvl - 1];
+  uint64_t size = GetBucketSize(lvl);
+  uint64_t lo = (first + size - 1) / size;
+  uint64_t hi = std::min<uint64_t>(last / size, lv.min.size());
+  if (lo >= hi) {
+    return ReduceLevel(raw, first, last, lvl - 1);
+  }
+  size_t buckets = static_cast<size_t>(hi - lo);
+  RangeMinMax(lv.min.data() + lo, lv.max.data() + lo, buckets, &acc.min, &acc.max);
+  acc.sum = keep_mean_ ? RangeSum(lv.mean.data() + lo, buckets) * static_cast<double>(size) : 0.0;
+  acc.count = buckets * size;
+  acc.Merge(ReduceLevel(raw, first, lo * size, lvl - 1));
+  acc.Merge(ReduceLevel(raw, hi * size, last, lvl - 1));
+  return acc;
+}
+
+} // namespace dsp
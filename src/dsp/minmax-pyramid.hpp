@@ -0,0 +1,78 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace dsp {
+
+struct plotColumn {
+  float min;
+  float max;
+  // Only filled when the pyramid keeps means
+  float mean;
+};
+
+// Min/max (and optionally mean) decimation pyramid over an append-only sample stream. Level l
+// summarizes buckets of kFactor^l samples, level 0 is the raw data, which the caller keeps and
+// passes to Decimate. Appending updates only the buckets the new samples complete, so building
+// is O(new samples) and a view costs O(columns) whatever the trace length.
+class MinMaxPyramid {
+public:
+  static constexpr uint32_t kFactor = 8;
+
+  explicit MinMaxPyramid(bool keep_mean = false) : keep_mean_(keep_mean) {}
+
+  // Appends samples following everything appended so far
+  void Append(const float *samples, size_t count);
+  void Reset();
+  // Reserves level storage for a trace of this many samples
+  void Reserve(uint64_t samples);
+
+  uint64_t GetSampleCount() const { return sample_count_; }
+  // Including level 0
+  uint32_t GetLevelCount() const { return static_cast<uint32_t>(levels_.size()) + 1; }
+  uint64_t GetBucketSize(uint32_t level) const;
+
+  // Coarsest level whose buckets hold no more than samples_per_column samples
+  uint32_t SelectLevel(double samples_per_column) const;
+
+  // Splits [first, last) of raw into columns equal parts and reduces each one from the level
+  // picked by SelectLevel. With one column per pixel that is the two points per pixel a min/max
+  // envelope needs. Returns the number of columns written, min(columns, last - first).
+  uint32_t Decimate(const float *raw, uint64_t first, uint64_t last, uint32_t columns,
+                    plotColumn *out) const;
+
+  // Min/max/mean over an arbitrary range, using whole buckets where they fit
+  plotColumn Reduce(const float *raw, uint64_t first, uint64_t last) const;
+
+private:
+  struct level {
+    std::vector<float> min;
+    std::vector<float> max;
+    std::vector<float> mean;
+  };
+
+  struct summary {
+    float min = std::numeric_limits<float>::infinity();
+    float max = -std::numeric_limits<float>::infinity();
+    double sum = 0.0;
+    uint64_t count = 0;
+
+    void Merge(const summary &other);
+  };
+
+  void AppendBuckets(const float *samples, size_t buckets);
+  void Cascade();
+  summary ReduceLevel(const float *raw, uint64_t first, uint64_t last, uint32_t level) const;
+
+  bool keep_mean_;
+  uint64_t sample_count_ = 0;
+  // levels_[i] is level i + 1
+  std::vector<level> levels_;
+  // Raw samples of the incomplete level 1 bucket
+  float pending_[kFactor];
+  uint32_t pending_count_ = 0;
+};
+
+} // namespace dsp
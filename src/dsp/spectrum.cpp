@@ -0,0 +1,110 @@
+#include "dsp/spectrum.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace dsp {
+
+namespace {
+
+// Black through purple, red and yellow to white, packed as RGBA8 in memory order
+void MakePalette(std::array<uint32_t, 256> &palette) {
+  constexpr float kStops[][3] = {{0.0f, 0.0f, 0.0f},
+                                 {0.3f, 0.0f, 0.5f},
+                                 {0.8f, 0.1f, 0.2f},
+                                 {1.0f, 0.6f, 0.0f},
+                                 {1.0f, 1.0f, 0.9f}};
+  constexpr size_t kSegments = std::size(kStops) - 1;
+  for (size_t i = 0; i < palette.size(); ++i) {
+    float t = static_cast<float>(i) / 255.0f * kSegments;
+    size_t s = std::min(static_cast<size_t>(t), kSegments - 1);
+    float f = t - static_cast<float>(s);
+    uint32_t texel = 0xff000000u;
+    for (int c = 0; c < 3; ++c) {
+      float v = kStops[s][c] + (kStops[s + 1][c] - kStops[s][c]) * f;
+      texel |= static_cast<uint32_t>(std::lround(v * 255.0f)) << (8 * c);
+    }
+    palette[i] = texel;
+  }
+}
+
+float ToDb(float power) { return 10.0f * std::log10(std::max(power, 1e-30f)); }
+
+} // namespace
+
+SpectrumAnalyzer::SpectrumAnalyzer(const spectrumOpts &opts) : opts_(opts), fft_(opts.fft_size) {
+  opts_.waterfall_rows = std::max(opts_.waterfall_rows, 1u);
+  float overlap = std::clamp(opts_.overlap, 0.0f, 0.95f);
+  hop_ = std::max(1u, static_cast<uint32_t>(static_cast<float>(opts_.fft_size) * (1.0f - overlap)));
+  window_.resize(opts_.fft_size);
+  float sum = MakeWindow(opts_.window, window_.data(), window_.size());
+  // A full scale sine peaks at sum / 2 in its bin, one sided spectra double it back
+  reference_ = 0.25f * sum * sum;
+
+  pending_limit_ = opts_.fft_size + size_t{hop_} * (kMaxFramesPerProcess - 1);
+  pending_.reserve(pending_limit_);
+  frame_.resize(opts_.fft_size);
+  re_.resize(opts_.fft_size / 2 + 1);
+  im_.resize(opts_.fft_size / 2 + 1);
+  average_.resize(GetBinCount());
+  spectrum_db_.assign(GetBinCount(), opts_.min_db);
+  waterfall_.assign(size_t{opts_.waterfall_rows} * GetBinCount(), 0xff000000u);
+  MakePalette(palette_);
+}
+
+void SpectrumAnalyzer::Feed(const float *samples, size_t count) {
+  // Only the newest pending_limit_ samples can be transformed by the next Process
+  if (count >= pending_limit_) {
+    samples += count - pending_limit_;
+    count = pending_limit_;
+    pending_.clear();
+  } else if (pending_.size() + count > pending_limit_) {
+    size_t excess = pending_.size() + count - pending_limit_;
+    pending_.erase(pending_.begin(), pending_.begin() + static_cast<ptrdiff_t>(excess));
+  }
+  pending_.insert(pending_.end(), samples, samples + count);
+}
+
+uint32_t SpectrumAnalyzer::Process() {
+  const uint32_t bins = GetBinCount();
+  const float scale = 1.0f / reference_;
+  const float db_to_index = 255.0f / std::max(opts_.max_db - opts_.min_db, 1e-3f);
+  uint32_t frames = 0;
+  size_t offset = 0;
+  for (; offset + opts_.fft_size <= pending_.size(); offset += hop_) {
+    const float *in = pending_.data() + offset;
+    for (uint32_t i = 0; i < opts_.fft_size; ++i) {
+      frame_[i] = in[i] * window_[i];
+    }
+    fft_.Forward(frame_.data(), re_.data(), im_.data());
+
+    uint32_t *row = waterfall_.data() + (rows_ % opts_.waterfall_rows) * bins;
+    for (uint32_t k = 0; k < bins; ++k) {
+      float power = (re_[k] * re_[k] + im_[k] * im_[k]) * scale;
+      if (!averaged_ || opts_.averaging == Averaging::None) {
+        average_[k] = power;
+      } else if (opts_.averaging == Averaging::Exponential) {
+        average_[k] = opts_.smoothing * average_[k] + (1.0f - opts_.smoothing) * power;
+      } else {
+        average_[k] = std::max(average_[k], power);
+      }
+      float index = (ToDb(power) - opts_.min_db) * db_to_index;
+      row[k] = palette_[static_cast<size_t>(std::clamp(index, 0.0f, 255.0f))];
+    }
+    averaged_ = true;
+    ++rows_;
+    ++frames;
+  }
+  if (frames == 0) {
+    return 0;
+  }
+  for (uint32_t k = 0; k < bins; ++k) {
+    spectrum_db_[k] = ToDb(average_[k]);
+  }
+  // Keep the overlap for the next frame
+  pending_.erase(pending_.begin(),
+                 pending_.begin() + static_cast<ptrdiff_t>(std::min(offset, pending_.size())));
+  return frames;
+}
+
+} // namespace dsp
@@ -0,0 +1,79 @@
+#pragma once
+#include "dsp/fft.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dsp {
+
+enum class Averaging {
+  None,
+  Exponential,
+  PeakHold,
+};
+
+struct spectrumOpts {
+  // Power of two
+  uint32_t fft_size = 2048;
+  WindowKind window = WindowKind::Hann;
+  // Fraction of each frame shared with the previous one, below 1
+  float overlap = 0.5f;
+  Averaging averaging = Averaging::Exponential;
+  // Weight of the running average against a new frame
+  float smoothing = 0.8f;
+  uint32_t waterfall_rows = 256;
+  // Waterfall color range
+  float min_db = -120.0f;
+  float max_db = 0.0f;
+};
+
+// Windowed, overlapped power spectrum of one stream plus a waterfall of every transformed frame.
+// All storage is sized at construction. Feed and Process must not run at the same time, Process
+// only touches this analyzer so different analyzers can run on different threads.
+class SpectrumAnalyzer {
+public:
+  // Frames one Process call transforms at most, older input is dropped
+  static constexpr uint32_t kMaxFramesPerProcess = 16;
+
+  explicit SpectrumAnalyzer(const spectrumOpts &opts = {});
+
+  const spectrumOpts &GetOptions() const { return opts_; }
+  // Bins 0..fft_size/2 - 1, Nyquist is left out
+  uint32_t GetBinCount() const { return opts_.fft_size / 2; }
+
+  void Feed(const float *samples, size_t count);
+  // Transforms every complete frame fed so far, returns how many
+  uint32_t Process();
+
+  // Averaged spectrum in dB relative to a full scale sine
+  const float *GetSpectrum() const { return spectrum_db_.data(); }
+
+  // Waterfall rows are GetBinCount() RGBA8 texels. Row r lives at r % waterfall_rows, only the
+  // last waterfall_rows rows are kept.
+  uint64_t GetRowCount() const { return rows_; }
+  const uint32_t *GetRow(uint64_t row) const {
+    return waterfall_.data() + (row % opts_.waterfall_rows) * GetBinCount();
+  }
+
+private:
+  spectrumOpts opts_;
+  RealFft fft_;
+  uint32_t hop_;
+  std::vector<float> window_;
+  // Power of a full scale sine, so it reads 0 dB
+  float reference_;
+  std::vector<float> pending_;
+  size_t pending_limit_;
+  std::vector<float> frame_;
+  std::vector<float> re_;
+  std::vector<float> im_;
+  std::vector<float> average_;
+  bool averaged_ = false;
+  std::vector<float> spectrum_db_;
+  std::vector<uint32_t> waterfall_;
+  uint64_t rows_ = 0;
+  std::array<uint32_t, 256> palette_;
+};
+
+} // namespace dsp
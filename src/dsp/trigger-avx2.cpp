@@ -0,0 +1,116 @@
+#include "dsp/trigger-kernels.hpp"
+#include <bit>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace dsp {
+
+#ifdef __AVX2__
+
+namespace {
+
+// Index of the first set lane in either half of a 16 sample step, 16 when none is set
+inline size_t FirstLane(__m256 a, __m256 b) {
+  unsigned mask = static_cast<unsigned>(_mm256_movemask_ps(a)) |
+                  static_cast<unsigned>(_mm256_movemask_ps(b)) << 8;
+  return mask == 0 ? 16 : static_cast<size_t>(std::countr_zero(mask));
+}
+
+size_t Avx2FirstAtOrAbove(const float *samples, size_t count, float threshold) {
+  __m256 t = _mm256_set1_ps(threshold);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    size_t lane = FirstLane(_mm256_cmp_ps(_mm256_loadu_ps(samples + i), t, _CMP_GE_OQ),
+                            _mm256_cmp_ps(_mm256_loadu_ps(samples + i + 8), t, _CMP_GE_OQ));
+    if (lane < 16) {
+      return i + lane;
+    }
+  }
+  for (; i < count; ++i) {
+    if (samples[i] >= threshold) {
+      return i;
+    }
+  }
+  return count;
+}
+
+size_t Avx2FirstBelow(const float *samples, size_t count, float threshold) {
+  __m256 t = _mm256_set1_ps(threshold);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    size_t lane = FirstLane(_mm256_cmp_ps(_mm256_loadu_ps(samples + i), t, _CMP_LT_OQ),
+                            _mm256_cmp_ps(_mm256_loadu_ps(samples + i + 8), t, _CMP_LT_OQ));
+    if (lane < 16) {
+      return i + lane;
+    }
+  }
+  for (; i < count; ++i) {
+    if (samples[i] < threshold) {
+      return i;
+    }
+  }
+  return count;
+}
+
+inline __m256 Outside(__m256 v, __m256 lo, __m256 hi) {
+  return _mm256_or_ps(_mm256_cmp_ps(v, lo, _CMP_LT_OQ), _mm256_cmp_ps(v, hi, _CMP_GT_OQ));
+}
+
+inline __m256 Inside(__m256 v, __m256 lo, __m256 hi) {
+  return _mm256_and_ps(_mm256_cmp_ps(v, lo, _CMP_GE_OQ), _mm256_cmp_ps(v, hi, _CMP_LE_OQ));
+}
+
+size_t Avx2FirstOutside(const float *samples, size_t count, float lo, float hi) {
+  __m256 l = _mm256_set1_ps(lo);
+  __m256 h = _mm256_set1_ps(hi);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    size_t lane = FirstLane(Outside(_mm256_loadu_ps(samples + i), l, h),
+                            Outside(_mm256_loadu_ps(samples + i + 8), l, h));
+    if (lane < 16) {
+      return i + lane;
+    }
+  }
+  for (; i < count; ++i) {
+    if (samples[i] < lo || samples[i] > hi) {
+      return i;
+    }
+  }
+  return count;
+}
+
+size_t Avx2FirstInside(const float *samples, size_t count, float lo, float hi) {
+  __m256 l = _mm256_set1_ps(lo);
+  __m256 h = _mm256_set1_ps(hi);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    size_t lane = FirstLane(Inside(_mm256_loadu_ps(samples + i), l, h),
+                            Inside(_mm256_loadu_ps(samples + i + 8), l, h));
+    if (lane < 16) {
+      return i + lane;
+    }
+  }
+  for (; i < count; ++i) {
+    if (samples[i] >= lo && samples[i] <= hi) {
+      return i;
+    }
+  }
+  return count;
+}
+
+const triggerKernels kAvx2Kernels = {Avx2FirstAtOrAbove, Avx2FirstBelow, Avx2FirstOutside,
+                                     Avx2FirstInside};
+
+} // namespace
+
+const triggerKernels *GetAvx2TriggerKernels() { return &kAvx2Kernels; }
+
+#else
+
+const triggerKernels *GetAvx2TriggerKernels() { return nullptr; }
+
+#endif
+
+} // namespace dsp
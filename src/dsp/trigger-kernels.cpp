@@ -0,0 +1,165 @@
+#include "dsp/trigger-kernels.hpp"
+#include <bit>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define DSP_SSE2 1
+#endif
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace dsp {
+
+namespace {
+
+size_t ScalarFirstAtOrAbove(const float *samples, size_t count, float threshold) {
+  for (size_t i = 0; i < count; ++i) {
+    if (samples[i] >= threshold) {
+      return i;
+    }
+  }
+  return count;
+}
+
+size_t ScalarFirstBelow(const float *samples, size_t count, float threshold) {
+  for (size_t i = 0; i < count; ++i) {
+    if (samples[i] < threshold) {
+      return i;
+    }
+  }
+  return count;
+}
+
+size_t ScalarFirstOutside(const float *samples, size_t count, float lo, float hi) {
+  for (size_t i = 0; i < count; ++i) {
+    if (samples[i] < lo || samples[i] > hi) {
+      return i;
+    }
+  }
+  return count;
+}
+
+size_t ScalarFirstInside(const float *samples, size_t count, float lo, float hi) {
+  for (size_t i = 0; i < count; ++i) {
+    if (samples[i] >= lo && samples[i] <= hi) {
+      return i;
+    }
+  }
+  return count;
+}
+
+const triggerKernels kScalarKernels = {ScalarFirstAtOrAbove, ScalarFirstBelow,
+                                       ScalarFirstOutside, ScalarFirstInside};
+
+#ifdef DSP_SSE2
+// Four lanes per step, the scalar kernel finishes the tail
+size_t Sse2FirstAtOrAbove(const float *samples, size_t count, float threshold) {
+  __m128 t = _mm_set1_ps(threshold);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    int mask = _mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(samples + i), t));
+    if (mask != 0) {
+      return i + static_cast<size_t>(std::countr_zero(static_cast<unsigned>(mask)));
+    }
+  }
+  return i + ScalarFirstAtOrAbove(samples + i, count - i, threshold);
+}
+
+size_t Sse2FirstBelow(const float *samples, size_t count, float threshold) {
+  __m128 t = _mm_set1_ps(threshold);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    int mask = _mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(samples + i), t));
+    if (mask != 0) {
+      return i + static_cast<size_t>(std::countr_zero(static_cast<unsigned>(mask)));
+    }
+  }
+  return i + ScalarFirstBelow(samples + i, count - i, threshold);
+}
+
+size_t Sse2FirstOutside(const float *samples, size_t count, float lo, float hi) {
+  __m128 l = _mm_set1_ps(lo);
+  __m128 h = _mm_set1_ps(hi);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128 v = _mm_loadu_ps(samples + i);
+    int mask = _mm_movemask_ps(_mm_or_ps(_mm_cmplt_ps(v, l), _mm_cmpgt_ps(v, h)));
+    if (mask != 0) {
+      return i + static_cast<size_t>(std::countr_zero(static_cast<unsigned>(mask)));
+    }
+  }
+  return i + ScalarFirstOutside(samples + i, count - i, lo, hi);
+}
+
+size_t Sse2FirstInside(const float *samples, size_t count, float lo, float hi) {
+  __m128 l = _mm_set1_ps(lo);
+  __m128 h = _mm_set1_ps(hi);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128 v = _mm_loadu_ps(samples + i);
+    int mask = _mm_movemask_ps(_mm_and_ps(_mm_cmpge_ps(v, l), _mm_cmple_ps(v, h)));
+    if (mask != 0) {
+      return i + static_cast<size_t>(std::countr_zero(static_cast<unsigned>(mask)));
+    }
+  }
+  return i + ScalarFirstInside(samples + i, count - i, lo, hi);
+}
+
+const triggerKernels kSse2Kernels = {Sse2FirstAtOrAbove, Sse2FirstBelow, Sse2FirstOutside,
+                                     Sse2FirstInside};
+#endif
+
+bool CpuHasAvx2() {
+#if defined(_MSC_VER) && defined(_M_X64)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7) {
+    return false;
+  }
+  __cpuid(info, 1);
+  // OSXSAVE and AVX, then the OS has to save the YMM registers
+  if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 ||
+      (_xgetbv(0) & 0x6) != 0x6) {
+    return false;
+  }
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#elif defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+  return __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
+}
+
+} // namespace
+
+const triggerKernels *GetTriggerKernels(TriggerIsa isa) {
+  switch (isa) {
+  case TriggerIsa::Scalar:
+    return &kScalarKernels;
+  case TriggerIsa::Sse2:
+#ifdef DSP_SSE2
+    return &kSse2Kernels;
+#else
+    return nullptr;
+#endif
+  case TriggerIsa::Avx2:
+    return CpuHasAvx2() ? GetAvx2TriggerKernels() : nullptr;
+  }
+  return nullptr;
+}
+
+TriggerIsa GetBestTriggerIsa() {
+  static const TriggerIsa best = [] {
+    if (GetTriggerKernels(TriggerIsa::Avx2)) {
+      return TriggerIsa::Avx2;
+    }
+    return GetTriggerKernels(TriggerIsa::Sse2) ? TriggerIsa::Sse2 : TriggerIsa::Scalar;
+  }();
+  return best;
+}
+
+} // namespace dsp
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+
+namespace dsp {
+
+enum class TriggerIsa {
+  Scalar,
+  Sse2,
+  Avx2,
+};
+
+// Scans that find the next comparator transition, the trigger state machine only runs where
+// they stop. Each returns the index of the first matching sample, count when none matches.
+struct triggerKernels {
+  size_t (*first_at_or_above)(const float *samples, size_t count, float threshold);
+  size_t (*first_below)(const float *samples, size_t count, float threshold);
+  // Outside is below lo or above hi, inside is lo <= x <= hi
+  size_t (*first_outside)(const float *samples, size_t count, float lo, float hi);
+  size_t (*first_inside)(const float *samples, size_t count, float lo, float hi);
+};
+
+// nullptr when the build or the CPU doesn't have the instruction set
+const triggerKernels *GetTriggerKernels(TriggerIsa isa);
+// Widest instruction set the CPU runs, picked once
+TriggerIsa GetBestTriggerIsa();
+
+// Defined in trigger-avx2.cpp, the only file built with AVX2 enabled. nullptr when the compiler
+// couldn't target it.
+const triggerKernels *GetAvx2TriggerKernels();
+
+} // namespace dsp
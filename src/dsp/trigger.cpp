@@ -0,0 +1,95 @@
+#include "dsp/trigger.hpp"
+#include <algorithm>
+
+namespace dsp {
+
+TriggerEngine::TriggerEngine(const triggerOpts &opts)
+    : TriggerEngine(opts, GetBestTriggerIsa()) {}
+
+TriggerEngine::TriggerEngine(const triggerOpts &opts, TriggerIsa isa) : opts_(opts) {
+  kernels_ = GetTriggerKernels(isa);
+  if (!kernels_) {
+    kernels_ = GetTriggerKernels(TriggerIsa::Scalar);
+  }
+}
+
+void TriggerEngine::SetOptions(const triggerOpts &opts) {
+  opts_ = opts;
+  primed_ = false;
+}
+
+bool TriggerEngine::Fires(uint64_t width) const {
+  // high_ is already the state after the transition
+  switch (opts_.mode) {
+  case TriggerMode::Rising:
+  case TriggerMode::Window:
+    return high_;
+  case TriggerMode::Falling:
+    return !high_;
+  case TriggerMode::PulseWidth:
+    return !high_ && whole_run_ && width >= opts_.min_width && width <= opts_.max_width;
+  case TriggerMode::Glitch:
+    return whole_run_ && width < opts_.max_width;
+  }
+  return false;
+}
+
+size_t TriggerEngine::Process(const float *samples, size_t count, triggerEvent *out,
+                              size_t max_events) {
+  if (count == 0) {
+    return 0;
+  }
+  const bool window = opts_.mode == TriggerMode::Window;
+  const bool falling = opts_.mode == TriggerMode::Falling;
+  // Two thresholds hysteresis apart, the comparator goes high at upper and low below lower
+  const float upper = falling ? opts_.level + opts_.hysteresis : opts_.level;
+  const float lower = falling ? opts_.level : opts_.level - opts_.hysteresis;
+  const float inner_lo = opts_.low + opts_.hysteresis;
+  const float inner_hi = opts_.high - opts_.hysteresis;
+
+  size_t i = 0;
+  if (!primed_) {
+    // Starting between the thresholds counts as not armed, the first edge needs a full swing
+    float x = samples[0];
+    high_ = window ? !(x >= inner_lo && x <= inner_hi) : x >= (falling ? upper : lower);
+    whole_run_ = false;
+    run_start_ = position_;
+    primed_ = true;
+    i = 1;
+  }
+
+  size_t written = 0;
+  while (i < count) {
+    size_t n = count - i;
+    size_t j;
+    if (window) {
+      j = high_ ? kernels_->first_inside(samples + i, n, inner_lo, inner_hi)
+                : kernels_->first_outside(samples + i, n, opts_.low, opts_.high);
+    } else {
+      j = high_ ? kernels_->first_below(samples + i, n, lower)
+                : kernels_->first_at_or_above(samples + i, n, upper);
+    }
+    if (j == n) {
+      break;
+    }
+    uint64_t at = position_ + i + j;
+    uint64_t width = at - run_start_;
+    high_ = !high_;
+    if (Fires(width) && at >= holdoff_until_) {
+      if (written < max_events) {
+        out[written++] = {at, static_cast<uint32_t>(std::min<uint64_t>(width, UINT32_MAX)),
+                          opts_.mode};
+      } else {
+        ++dropped_;
+      }
+      holdoff_until_ = at + 1 + opts_.holdoff;
+    }
+    whole_run_ = true;
+    run_start_ = at;
+    i += j + 1;
+  }
+  position_ += count;
+  return written;
+}
+
+} // namespace dsp
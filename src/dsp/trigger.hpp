@@ -0,0 +1,78 @@
+#pragma once
+#include "dsp/trigger-kernels.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace dsp {
+
+enum class TriggerMode {
+  Rising,
+  Falling,
+  // Fires when the signal leaves [low, high]
+  Window,
+  // Fires at the end of a positive pulse min_width..max_width samples wide
+  PulseWidth,
+  // Fires at the end of any high or low run shorter than max_width samples
+  Glitch,
+};
+
+struct triggerOpts {
+  TriggerMode mode = TriggerMode::Rising;
+  float level = 0.0f;
+  // Rising edges and pulses re-arm below level - hysteresis, falling edges above
+  // level + hysteresis and windows that far inside [low, high]. Keeps noise from firing.
+  float hysteresis = 0.0f;
+  float low = -1.0f;
+  float high = 1.0f;
+  uint32_t min_width = 0;
+  uint32_t max_width = 0;
+  // Samples after an event during which nothing fires
+  uint64_t holdoff = 0;
+};
+
+struct triggerEvent {
+  // Stream index of the sample that fired
+  uint64_t sample;
+  // Length of the run that just ended, in samples
+  uint32_t width;
+  TriggerMode mode;
+};
+
+// Edge, window and pulse detection over a sample stream split into arbitrary blocks. The
+// comparator state only changes where the signal crosses a threshold, so the vector kernels skip
+// to the next crossing and the state machine runs once per transition instead of once per sample.
+class TriggerEngine {
+public:
+  // Kernels for the widest instruction set this CPU runs
+  explicit TriggerEngine(const triggerOpts &opts = {});
+  // Scalar if the instruction set is unavailable
+  TriggerEngine(const triggerOpts &opts, TriggerIsa isa);
+
+  // The next sample decides the initial state again, stream positions carry on
+  void SetOptions(const triggerOpts &opts);
+  const triggerOpts &GetOptions() const { return opts_; }
+
+  // Scans samples following everything scanned so far and writes up to max_events events, oldest
+  // first. Returns the number written, further events are counted as dropped.
+  size_t Process(const float *samples, size_t count, triggerEvent *out, size_t max_events);
+
+  uint64_t GetSampleCount() const { return position_; }
+  uint64_t GetDroppedEvents() const { return dropped_; }
+
+private:
+  bool Fires(uint64_t width) const;
+
+  const triggerKernels *kernels_;
+  triggerOpts opts_;
+  uint64_t position_ = 0;
+  bool primed_ = false;
+  // Comparator above its threshold, or outside the window
+  bool high_ = false;
+  // The current run started after priming, so its width is known
+  bool whole_run_ = false;
+  uint64_t run_start_ = 0;
+  uint64_t holdoff_until_ = 0;
+  uint64_t dropped_ = 0;
+};
+
+} // namespace dsp
@@ -0,0 +1,128 @@
+#include "block-allocator.hpp"
+#include <algorithm>
+#include <bit>
+
+BuddyAllocator::BuddyAllocator(uint64_t size, uint64_t min_block)
+    : min_block_(std::bit_ceil(std::max<uint64_t>(min_block, 1))) {
+  if (size < min_block_) {
+    return;
+  }
+  max_order_ = static_cast<uint32_t>(std::bit_width(size / min_block_) - 1);
+  size_ = BlockSize(max_order_);
+  free_.resize(max_order_ + 1);
+  free_[max_order_].insert(0);
+}
+
+uint64_t BuddyAllocator::Allocate(uint64_t size, uint64_t alignment) {
+  if (size == 0 || size_ == 0) {
+    return kInvalidOffset;
+  }
+  uint64_t needed = std::bit_ceil(std::max({size, alignment, min_block_}));
+  if (needed > size_) {
+    return kInvalidOffset;
+  }
+  uint32_t order = static_cast<uint32_t>(std::countr_zero(needed / min_block_));
+
+  uint32_t found = order;
+  while (found <= max_order_ && free_[found].empty()) {
+    ++found;
+  }
+  if (found > max_order_) {
+    return kInvalidOffset;
+  }
+
+  uint64_t offset = *free_[found].begin();
+  free_[found].erase(free_[found].begin());
+  // Split down to the requested order, keeping the low half and freeing the upper buddies
+  while (found > order) {
+    --found;
+    free_[found].insert(offset + BlockSize(found));
+  }
+
+  allocated_.emplace(offset, order);
+  used_ += BlockSize(order);
+  return offset;
+}
+
+void BuddyAllocator::Free(uint64_t offset) {
+  auto it = allocated_.find(offset);
+  if (it == allocated_.end()) {
+    return;
+  }
+  uint32_t order = it->second;
+  allocated_.erase(it);
+  used_ -= BlockSize(order);
+
+  while (order < max_order_) {
+    uint64_t buddy = offset ^ BlockSize(order);
+    if (free_[order].erase(buddy) == 0) {
+      break;
+    }
+    offset = std::min(offset, buddy);
+    ++order;
+  }
+  free_[order].insert(offset);
+}
+
+uint64_t LinearAllocator::Allocate(uint64_t size, uint64_t alignment) {
+  if (size == 0) {
+    return kInvalidOffset;
+  }
+  alignment = std::max<uint64_t>(alignment, 1);
+  uint64_t offset = (head_ + alignment - 1) / alignment * alignment;
+  if (offset > size_ || size > size_ - offset) {
+    return kInvalidOffset;
+  }
+  head_ = offset + size;
+  ++live_;
+  return offset;
+}
+
+void LinearAllocator::Free(uint64_t offset) {
+  if (live_ == 0 || offset >= head_) {
+    return;
+  }
+  if (--live_ == 0) {
+    head_ = 0;
+  }
+}
+
+void LinearAllocator::Reset() {
+  head_ = 0;
+  live_ = 0;
+}
+
+uint64_t RingAllocator::Allocate(uint64_t size, uint64_t alignment) {
+  if (size == 0 || size > size_) {
+    return kInvalidOffset;
+  }
+  if (head_ == tail_) {
+    // Empty, start over at the beginning so any size fits
+    head_ = (head_ + size_ - 1) / size_ * size_;
+    tail_ = head_;
+  }
+  alignment = std::max<uint64_t>(alignment, 1);
+  uint64_t start = head_;
+  uint64_t physical = start % size_;
+  uint64_t offset = (physical + alignment - 1) / alignment * alignment;
+  if (offset > size_ || size > size_ - offset) {
+    // Doesn't fit before the end, skip the rest of the range
+    start += size_ - physical;
+    offset = 0;
+  } else {
+    start += offset - physical;
+  }
+  if (start + size - tail_ > size_) {
+    return kInvalidOffset;
+  }
+  head_ = start + size;
+  return offset;
+}
+
+void RingAllocator::Release(uint64_t position) {
+  tail_ = std::clamp(position, tail_, head_);
+}
+
+void RingAllocator::Rewind(uint64_t position) {
+  head_ = std::clamp(position, tail_, head_);
+}
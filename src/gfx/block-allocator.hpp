@@ -0,0 +1,95 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+// Offset-only sub-allocators, they manage ranges inside a memory block and never touch memory
+
+// Power-of-two buddy allocator for long-lived allocations with arbitrary lifetimes. Blocks are
+// aligned to their own size, so any alignment up to the block size comes for free and freed
+// neighbours merge back without fragmenting the range.
+class BuddyAllocator {
+public:
+  static constexpr uint64_t kInvalidOffset = UINT64_MAX;
+
+  BuddyAllocator() = default;
+  // size is rounded down to a power of two multiple of min_block
+  BuddyAllocator(uint64_t size, uint64_t min_block);
+
+  uint64_t Allocate(uint64_t size, uint64_t alignment = 1);
+  void Free(uint64_t offset);
+
+  uint64_t GetSize() const { return size_; }
+  // Bytes handed out including power-of-two rounding
+  uint64_t GetUsed() const { return used_; }
+  size_t GetAllocationCount() const { return allocated_.size(); }
+  bool IsEmpty() const { return allocated_.empty(); }
+
+private:
+  uint64_t BlockSize(uint32_t order) const { return min_block_ << order; }
+
+  uint64_t size_ = 0;
+  uint64_t min_block_ = 1;
+  uint32_t max_order_ = 0;
+  uint64_t used_ = 0;
+  // Free block offsets per order, lowest offset first to keep allocations packed
+  std::vector<std::set<uint64_t>> free_;
+  std::unordered_map<uint64_t, uint32_t> allocated_;
+};
+
+// Bump allocator for transient allocations, space is reclaimed all at once when the last
+// allocation is freed or on Reset()
+class LinearAllocator {
+public:
+  static constexpr uint64_t kInvalidOffset = UINT64_MAX;
+
+  LinearAllocator() = default;
+  explicit LinearAllocator(uint64_t size) : size_(size) {}
+
+  uint64_t Allocate(uint64_t size, uint64_t alignment = 1);
+  void Free(uint64_t offset);
+  void Reset();
+
+  uint64_t GetSize() const { return size_; }
+  uint64_t GetUsed() const { return head_; }
+  size_t GetAllocationCount() const { return live_; }
+  bool IsEmpty() const { return live_ == 0; }
+
+private:
+  uint64_t size_ = 0;
+  uint64_t head_ = 0;
+  size_t live_ = 0;
+};
+
+// FIFO allocator for streamed data, space is reclaimed in allocation order once the consumer is
+// done with it. An allocation never straddles the end of the range, it starts over at 0 instead.
+// Positions are monotonic byte counters, offsets are positions modulo the size.
+class RingAllocator {
+public:
+  static constexpr uint64_t kInvalidOffset = UINT64_MAX;
+
+  RingAllocator() = default;
+  explicit RingAllocator(uint64_t size) : size_(size) {}
+
+  // Any alignment, not only powers of two. kInvalidOffset until enough space is released.
+  uint64_t Allocate(uint64_t size, uint64_t alignment = 1);
+  // Position after the newest allocation, marks the end of a group of allocations
+  uint64_t GetHead() const { return head_; }
+  // Frees every allocation before a position from GetHead, older positions are ignored
+  void Release(uint64_t position);
+  // Drops the allocations after a position from GetHead, for ones that were never consumed.
+  // Positions older than the oldest live allocation drop everything.
+  void Rewind(uint64_t position);
+
+  uint64_t GetSize() const { return size_; }
+  uint64_t GetUsed() const { return head_ - tail_; }
+  bool IsEmpty() const { return head_ == tail_; }
+
+private:
+  uint64_t size_ = 0;
+  // The ring holds [tail_, head_)
+  uint64_t head_ = 0;
+  uint64_t tail_ = 0;
+};
@@ -0,0 +1,313 @@
+#include "device-allocator.hpp"
+#include "platform/log.hpp"
+#include <algorithm>
+
+const char *MemoryUsageName(MemoryUsage usage) {
+  switch (usage) {
+  case MemoryUsage::GpuOnly:
+    return "GPU only";
+  case MemoryUsage::Upload:
+    return "Upload";
+  case MemoryUsage::Readback:
+    return "Readback";
+  default:
+    return "Unknown";
+  }
+}
+
+VkResult DeviceAllocator::Init(VkDevice device, VkPhysicalDevice physical_device,
+                               const VkAllocationCallbacks *allocator) {
+  device_ = device;
+  allocator_ = allocator;
+  vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties_);
+
+  // Buddy blocks are aligned to their size, so linear buffers and optimal images that share a
+  // block never land on the same granularity page
+  VkPhysicalDeviceProperties deviceProperties;
+  vkGetPhysicalDeviceProperties(physical_device, &deviceProperties);
+  min_allocation_ =
+      std::max<VkDeviceSize>(kMinAllocation, deviceProperties.limits.bufferImageGranularity);
+
+  TE_TRACE("Device allocator initialized with {} memory types",
+           memory_properties_.memoryTypeCount);
+  return VK_SUCCESS;
+}
+
+void DeviceAllocator::Destroy() {
+  std::lock_guard lock(mutex_);
+  for (uint32_t i = 0; i < blocks_.size(); ++i) {
+    if (blocks_[i]) {
+      FreeBlock(i);
+    }
+  }
+  blocks_.clear();
+}
+
+uint32_t DeviceAllocator::FindMemoryType(uint32_t type_bits, MemoryUsage usage) const {
+  VkMemoryPropertyFlags required = 0;
+  VkMemoryPropertyFlags preferred = 0;
+  switch (usage) {
+  case MemoryUsage::GpuOnly:
+    preferred = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    break;
+  case MemoryUsage::Upload:
+    required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    break;
+  case MemoryUsage::Readback:
+    required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    preferred = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+    break;
+  default:
+    break;
+  }
+
+  uint32_t fallback = UINT32_MAX;
+  for (uint32_t i = 0; i < memory_properties_.memoryTypeCount; ++i) {
+    VkMemoryPropertyFlags flags = memory_properties_.memoryTypes[i].propertyFlags;
+    if ((type_bits & (1u << i)) == 0 || (flags & required) != required) {
+      continue;
+    }
+    if ((flags & preferred) == preferred) {
+      return i;
+    }
+    if (fallback == UINT32_MAX) {
+      fallback = i;
+    }
+  }
+  return fallback;
+}
+
+VkResult DeviceAllocator::AllocateBlock(uint32_t memory_type, MemoryUsage usage,
+                                        VkDeviceSize size, bool dedicated, uint32_t *index) {
+  auto block = std::make_unique<memoryBlock>();
+  block->memory_type = memory_type;
+  block->usage = usage;
+  block->size = size;
+  block->dedicated = dedicated;
+
+  VkMemoryAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.allocationSize = size;
+  allocInfo.memoryTypeIndex = memory_type;
+  VkResult res = vkAllocateMemory(device_, &allocInfo, allocator_, &block->memory);
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error allocating {} bytes of {} device memory", size, MemoryUsageName(usage));
+    return res;
+  }
+
+  if (memory_properties_.memoryTypes[memory_type].propertyFlags &
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+    res = vkMapMemory(device_, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped);
+    if (res != VK_SUCCESS) {
+      TE_ERROR("Error mapping device memory block");
+      vkFreeMemory(device_, block->memory, allocator_);
+      return res;
+    }
+  }
+
+  if (!dedicated) {
+    if (usage == MemoryUsage::Upload) {
+      block->linear = LinearAllocator(size);
+    } else {
+      block->buddy = BuddyAllocator(size, min_allocation_);
+    }
+  }
+
+  auto slot = std::find(blocks_.begin(), blocks_.end(), nullptr);
+  if (slot == blocks_.end()) {
+    slot = blocks_.insert(blocks_.end(), nullptr);
+  }
+  *slot = std::move(block);
+  *index = static_cast<uint32_t>(slot - blocks_.begin());
+  TE_TRACE("Allocated {} device memory block of {} bytes{}", MemoryUsageName(usage), size,
+           dedicated ? " (dedicated)" : "");
+  return VK_SUCCESS;
+}
+
+void DeviceAllocator::FreeBlock(uint32_t index) {
+  memoryBlock &block = *blocks_[index];
+  if (block.mapped) {
+    vkUnmapMemory(device_, block.memory);
+  }
+  vkFreeMemory(device_, block.memory, allocator_);
+  blocks_[index].reset();
+}
+
+bool DeviceAllocator::SubAllocate(memoryBlock &block, const VkMemoryRequirements &requirements,
+                                  VkDeviceSize *offset) {
+  if (block.usage == MemoryUsage::Upload) {
+    *offset = block.linear.Allocate(requirements.size, requirements.alignment);
+    return *offset != LinearAllocator::kInvalidOffset;
+  }
+  *offset = block.buddy.Allocate(requirements.size, requirements.alignment);
+  return *offset != BuddyAllocator::kInvalidOffset;
+}
+
+VkResult DeviceAllocator::Allocate(const VkMemoryRequirements &requirements, MemoryUsage usage,
+                                   deviceAllocation *allocation) {
+  uint32_t memoryType = FindMemoryType(requirements.memoryTypeBits, usage);
+  if (memoryType == UINT32_MAX) {
+    TE_ERROR("No memory type for {} allocation", MemoryUsageName(usage));
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+
+  std::lock_guard lock(mutex_);
+  uint32_t index = UINT32_MAX;
+  VkDeviceSize offset = 0;
+  if (requirements.size > kBlockSize / 2) {
+    VkResult res = AllocateBlock(memoryType, usage, requirements.size, true, &index);
+    if (res != VK_SUCCESS) {
+      return res;
+    }
+  } else {
+    for (uint32_t i = 0; i < blocks_.size(); ++i) {
+      memoryBlock *block = blocks_[i].get();
+      if (block && !block->dedicated && block->usage == usage &&
+          block->memory_type == memoryType && SubAllocate(*block, requirements, &offset)) {
+        index = i;
+        break;
+      }
+    }
+    if (index == UINT32_MAX) {
+      VkResult res = AllocateBlock(memoryType, usage, kBlockSize, false, &index);
+      if (res != VK_SUCCESS) {
+        return res;
+      }
+      if (!SubAllocate(*blocks_[index], requirements, &offset)) {
+        // Only an alignment the block can't honour gets here, memory starts are always aligned
+        TE_WARN("{} byte allocation aligned to {} doesn't fit a block, using dedicated memory",
+                requirements.size, requirements.alignment);
+        FreeBlock(index);
+        offset = 0;
+        res = AllocateBlock(memoryType, usage, requirements.size, true, &index);
+        if (res != VK_SUCCESS) {
+          return res;
+        }
+      }
+    }
+  }
+
+  memoryBlock &block = *blocks_[index];
+  allocation->memory = block.memory;
+  allocation->offset = offset;
+  allocation->size = requirements.size;
+  allocation->mapped = block.mapped ? static_cast<char *>(block.mapped) + offset : nullptr;
+  allocation->block = index;
+  return VK_SUCCESS;
+}
+
+void DeviceAllocator::Free(deviceAllocation &allocation) {
+  if (allocation.block == UINT32_MAX) {
+    return;
+  }
+
+  std::lock_guard lock(mutex_);
+  memoryBlock &block = *blocks_[allocation.block];
+  bool empty = true;
+  if (!block.dedicated) {
+    if (block.usage == MemoryUsage::Upload) {
+      block.linear.Free(allocation.offset);
+      empty = block.linear.IsEmpty();
+    } else {
+      block.buddy.Free(allocation.offset);
+      empty = block.buddy.IsEmpty();
+    }
+  }
+
+  // Keep the last block of a usage around so a steady alloc/free pattern doesn't thrash
+  if (empty) {
+    bool last = !block.dedicated && std::none_of(blocks_.begin(), blocks_.end(), [&](auto &b) {
+      return b && b.get() != &block && !b->dedicated && b->usage == block.usage;
+    });
+    if (!last) {
+      FreeBlock(allocation.block);
+    }
+  }
+  allocation = {};
+}
+
+VkResult DeviceAllocator::CreateBuffer(const VkBufferCreateInfo &info, MemoryUsage usage,
+                                       VkBuffer *buffer, deviceAllocation *allocation) {
+  VkResult res = vkCreateBuffer(device_, &info, allocator_, buffer);
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error creating buffer");
+    return res;
+  }
+
+  VkMemoryRequirements requirements;
+  vkGetBufferMemoryRequirements(device_, *buffer, &requirements);
+  res = Allocate(requirements, usage, allocation);
+  if (res == VK_SUCCESS) {
+    res = vkBindBufferMemory(device_, *buffer, allocation->memory, allocation->offset);
+  }
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error binding buffer memory");
+    Free(*allocation);
+    vkDestroyBuffer(device_, *buffer, allocator_);
+    *buffer = VK_NULL_HANDLE;
+  }
+  return res;
+}
+
+VkResult DeviceAllocator::CreateImage(const VkImageCreateInfo &info, MemoryUsage usage,
+                                      VkImage *image, deviceAllocation *allocation) {
+  VkResult res = vkCreateImage(device_, &info, allocator_, image);
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error creating image");
+    return res;
+  }
+
+  VkMemoryRequirements requirements;
+  vkGetImageMemoryRequirements(device_, *image, &requirements);
+  res = Allocate(requirements, usage, allocation);
+  if (res == VK_SUCCESS) {
+    res = vkBindImageMemory(device_, *image, allocation->memory, allocation->offset);
+  }
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error binding image memory");
+    Free(*allocation);
+    vkDestroyImage(device_, *image, allocator_);
+    *image = VK_NULL_HANDLE;
+  }
+  return res;
+}
+
+deviceMemoryStats DeviceAllocator::GetStats(MemoryUsage usage) const {
+  std::lock_guard lock(mutex_);
+  deviceMemoryStats stats;
+  for (const auto &block : blocks_) {
+    if (!block || block->usage != usage) {
+      continue;
+    }
+    ++stats.blocks;
+    stats.reserved_bytes += block->size;
+    if (block->dedicated) {
+      ++stats.allocations;
+      stats.used_bytes += block->size;
+    } else if (usage == MemoryUsage::Upload) {
+      stats.allocations += static_cast<uint32_t>(block->linear.GetAllocationCount());
+      stats.used_bytes += block->linear.GetUsed();
+    } else {
+      stats.allocations += static_cast<uint32_t>(block->buddy.GetAllocationCount());
+      stats.used_bytes += block->buddy.GetUsed();
+    }
+  }
+  return stats;
+}
+
+VkDeviceSize DeviceAllocator::GetHeapReservedBytes(uint32_t heap) const {
+  std::lock_guard lock(mutex_);
+  VkDeviceSize reserved = 0;
+  for (const auto &block : blocks_) {
+    if (block && memory_properties_.memoryTypes[block->memory_type].heapIndex == heap) {
+      reserved += block->size;
+    }
+  }
+  return reserved;
+}
+
+uint32_t DeviceAllocator::GetDeviceAllocationCount() const {
+  std::lock_guard lock(mutex_);
+  return static_cast<uint32_t>(
+      std::count_if(blocks_.begin(), blocks_.end(), [](const auto &b) { return b != nullptr; }));
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include "gfx/block-allocator.hpp"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+enum class MemoryUsage : uint32_t {
+  // Device local and long lived: textures, vertex buffers. Buddy sub-allocated.
+  GpuOnly,
+  // Host visible and coherent, written by the CPU for uploads or per-frame data. Linear
+  // sub-allocated, a block is reused once everything in it has been freed.
+  Upload,
+  // Host visible and preferably cached for GPU to CPU copies. Buddy sub-allocated.
+  Readback,
+  Count,
+};
+
+const char *MemoryUsageName(MemoryUsage usage);
+
+struct deviceAllocation {
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkDeviceSize offset = 0;
+  VkDeviceSize size = 0;
+  // Persistently mapped pointer to offset for host visible usages
+  void *mapped = nullptr;
+
+  uint32_t block = UINT32_MAX;
+};
+
+struct deviceMemoryStats {
+  uint32_t blocks = 0;
+  uint32_t allocations = 0;
+  // Allocated from the driver and handed out to callers
+  VkDeviceSize reserved_bytes = 0;
+  VkDeviceSize used_bytes = 0;
+};
+
+// Sub-allocates buffers and images from large VkDeviceMemory blocks so the number of
+// vkAllocateMemory calls stays far below maxMemoryAllocationCount. Requests bigger than half
+// a block get a dedicated allocation.
+class DeviceAllocator {
+public:
+  static constexpr VkDeviceSize kBlockSize = VkDeviceSize{64} << 20;
+  static constexpr VkDeviceSize kMinAllocation = 256;
+  static constexpr uint32_t kUsageCount = static_cast<uint32_t>(MemoryUsage::Count);
+
+  VkResult Init(VkDevice device, VkPhysicalDevice physical_device,
+                const VkAllocationCallbacks *allocator);
+  void Destroy();
+
+  VkResult Allocate(const VkMemoryRequirements &requirements, MemoryUsage usage,
+                    deviceAllocation *allocation);
+  void Free(deviceAllocation &allocation);
+
+  // Create the resource, allocate memory for it and bind it in one go
+  VkResult CreateBuffer(const VkBufferCreateInfo &info, MemoryUsage usage, VkBuffer *buffer,
+                        deviceAllocation *allocation);
+  VkResult CreateImage(const VkImageCreateInfo &info, MemoryUsage usage, VkImage *image,
+                       deviceAllocation *allocation);
+
+  deviceMemoryStats GetStats(MemoryUsage usage) const;
+  uint32_t GetDeviceAllocationCount() const;
+  // Bytes of VkDeviceMemory held in a memory heap, across all usages
+  VkDeviceSize GetHeapReservedBytes(uint32_t heap) const;
+  const VkPhysicalDeviceMemoryProperties &GetMemoryProperties() const { return memory_properties_; }
+
+private:
+  struct memoryBlock {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    uint32_t memory_type = 0;
+    MemoryUsage usage = MemoryUsage::GpuOnly;
+    VkDeviceSize size = 0;
+    void *mapped = nullptr;
+    bool dedicated = false;
+    BuddyAllocator buddy;
+    LinearAllocator linear;
+  };
+
+  uint32_t FindMemoryType(uint32_t type_bits, MemoryUsage usage) const;
+  VkResult AllocateBlock(uint32_t memory_type, MemoryUsage usage, VkDeviceSize size,
+                         bool dedicated, uint32_t *index);
+  void FreeBlock(uint32_t index);
+  bool SubAllocate(memoryBlock &block, const VkMemoryRequirements &requirements,
+                   VkDeviceSize *offset);
+
+  VkDevice device_ = VK_NULL_HANDLE;
+  const VkAllocationCallbacks *allocator_ = nullptr;
+  VkPhysicalDeviceMemoryProperties memory_properties_{};
+  VkDeviceSize min_allocation_ = kMinAllocation;
+
+  mutable std::mutex mutex_;
+  // Freed slots are nullptr and reused, allocations refer to blocks by index
+  std::vector<std::unique_ptr<memoryBlock>> blocks_;
+};
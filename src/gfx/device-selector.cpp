@@ -0,0 +1,451 @@
+#include "device-selector.hpp"
+#include "platform/log.hpp"
+#include "platform/trace.hpp"
+#include "spdlog/fmt/fmt.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace {
+
+// Device class dominates the score, so memory and limits only order devices within a class
+constexpr int64_t kClassWeight = 1'000'000;
+constexpr VkDeviceSize kGiB = VkDeviceSize(1) << 30;
+constexpr VkDeviceSize kBenchmarkBytes = VkDeviceSize(64) << 20;
+constexpr uint32_t kBenchmarkFills = 8;
+
+int64_t ClassRank(VkPhysicalDeviceType type, DevicePolicy policy) {
+  switch (policy) {
+  case DevicePolicy::LowPower:
+    switch (type) {
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+      return 4;
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+      return 3;
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+      return 2;
+    case VK_PHYSICAL_DEVICE_TYPE_CPU:
+      return 1;
+    default:
+      return 0;
+    }
+  case DevicePolicy::Software:
+    switch (type) {
+    case VK_PHYSICAL_DEVICE_TYPE_CPU:
+      return 4;
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+      return 3;
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+      return 2;
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+      return 1;
+    default:
+      return 0;
+    }
+  default:
+    switch (type) {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+      return 4;
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+      return 3;
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+      return 2;
+    case VK_PHYSICAL_DEVICE_TYPE_CPU:
+      return 1;
+    default:
+      return 0;
+    }
+  }
+}
+
+const char *TypeName(VkPhysicalDeviceType type) {
+  switch (type) {
+  case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+    return "discrete GPU";
+  case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+    return "integrated GPU";
+  case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+    return "virtual GPU";
+  case VK_PHYSICAL_DEVICE_TYPE_CPU:
+    return "CPU";
+  default:
+    return "other device";
+  }
+}
+
+const char *PolicyName(DevicePolicy policy) {
+  switch (policy) {
+  case DevicePolicy::LowPower:
+    return "low power";
+  case DevicePolicy::Software:
+    return "software";
+  case DevicePolicy::Pinned:
+    return "pinned";
+  default:
+    return "performance";
+  }
+}
+
+int32_t FindMemoryType(const VkPhysicalDeviceMemoryProperties &memory, uint32_t type_bits,
+                       VkMemoryPropertyFlags flags) {
+  for (uint32_t i = 0; i < memory.memoryTypeCount; ++i) {
+    if ((type_bits & (1u << i)) && (memory.memoryTypes[i].propertyFlags & flags) == flags) {
+      return static_cast<int32_t>(i);
+    }
+  }
+  return -1;
+}
+
+} // namespace
+
+bool physicalDeviceInfo::HasExtension(const char *name) const {
+  return std::find(extensions.begin(), extensions.end(), name) != extensions.end();
+}
+
+int physicalDeviceInfo::GraphicsFamily() const {
+  for (size_t i = 0; i < queue_families.size(); ++i) {
+    if ((queue_families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0 &&
+        queue_families[i].queueCount > 0) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+VkDeviceSize physicalDeviceInfo::DeviceLocalBytes() const {
+  VkDeviceSize bytes = 0;
+  for (uint32_t i = 0; i < memory.memoryHeapCount; ++i) {
+    if (memory.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+      bytes += memory.memoryHeaps[i].size;
+    }
+  }
+  return bytes;
+}
+
+bool ParseDeviceUuid(const char *text, std::array<uint8_t, VK_UUID_SIZE> &uuid) {
+  std::array<uint8_t, VK_UUID_SIZE> parsed{};
+  size_t digits = 0;
+  for (const char *c = text; *c; ++c) {
+    if (*c == '-') {
+      continue;
+    }
+    if (!std::isxdigit(static_cast<unsigned char>(*c)) || digits == 2 * VK_UUID_SIZE) {
+      return false;
+    }
+    uint8_t nibble = std::isdigit(static_cast<unsigned char>(*c))
+                         ? *c - '0'
+                         : std::tolower(static_cast<unsigned char>(*c)) - 'a' + 10;
+    parsed[digits / 2] = static_cast<uint8_t>(parsed[digits / 2] << 4 | nibble);
+    ++digits;
+  }
+  if (digits != 2 * VK_UUID_SIZE) {
+    return false;
+  }
+  uuid = parsed;
+  return true;
+}
+
+std::string FormatDeviceUuid(const std::array<uint8_t, VK_UUID_SIZE> &uuid) {
+  static constexpr char kHex[] = "0123456789abcdef";
+  std::string text;
+  for (size_t i = 0; i < uuid.size(); ++i) {
+    if (i == 4 || i == 6 || i == 8 || i == 10) {
+      text += '-';
+    }
+    text += kHex[uuid[i] >> 4];
+    text += kHex[uuid[i] & 0xf];
+  }
+  return text;
+}
+
+deviceScore ScoreDevice(const physicalDeviceInfo &device, const deviceSelectionOpts &opts) {
+  deviceScore result;
+  int graphics = device.GraphicsFamily();
+  if (graphics < 0) {
+    result.score = -1;
+    result.reasons.emplace_back("no graphics queue");
+  } else if (!device.present_families.empty() && !device.present_families[graphics]) {
+    // Frames are presented from the graphics queue
+    result.score = -1;
+    result.reasons.emplace_back("graphics queue can't present");
+  }
+  if (!device.HasExtension(VK_KHR_SWAPCHAIN_EXTENSION_NAME)) {
+    result.score = -1;
+    result.reasons.emplace_back("no " VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+  }
+  if (result.score < 0) {
+    return result;
+  }
+
+  VkPhysicalDeviceType type = device.properties.deviceType;
+  int64_t rank = ClassRank(type, opts.policy);
+  if (opts.policy == DevicePolicy::Pinned && device.has_uuid && device.uuid == opts.uuid) {
+    rank = 10;
+    result.reasons.emplace_back("pinned UUID");
+  }
+  result.score = rank * kClassWeight;
+  result.reasons.emplace_back(TypeName(type));
+
+  // Memory is capped so absurd heap sizes reported by CPU devices can't outgrow a class
+  VkDeviceSize local = device.DeviceLocalBytes();
+  result.score += static_cast<int64_t>(std::min<VkDeviceSize>(local / (kGiB / 16), 64 * 16)) * 100;
+  result.reasons.emplace_back(fmt::format("{:.1f} GiB device local", double(local) / kGiB));
+  if (device.properties.apiVersion >= VK_API_VERSION_1_3) {
+    result.score += 500;
+    result.reasons.emplace_back("Vulkan 1.3");
+  }
+  result.score += device.properties.limits.maxImageDimension2D / 1024;
+  return result;
+}
+
+int PickDevice(const std::vector<physicalDeviceInfo> &devices, const deviceSelectionOpts &opts) {
+  int best = -1;
+  int64_t bestScore = -1;
+  for (size_t i = 0; i < devices.size(); ++i) {
+    int64_t score = ScoreDevice(devices[i], opts).score;
+    if (score < 0) {
+      continue;
+    }
+    bool better = best < 0 || score > bestScore;
+    // Within a class a measured benchmark outranks the static score
+    double ms = devices[i].benchmark_ms;
+    if (best >= 0 && score / kClassWeight == bestScore / kClassWeight &&
+        (ms >= 0.0 || devices[best].benchmark_ms >= 0.0)) {
+      better = ms >= 0.0 && (devices[best].benchmark_ms < 0.0 || ms < devices[best].benchmark_ms);
+    }
+    if (better) {
+      best = static_cast<int>(i);
+      bestScore = score;
+    }
+  }
+  return best;
+}
+
+VkResult DeviceSelector::Probe(VkInstance instance, uint32_t api_version,
+                               PresentSupport present) {
+  devices_.clear();
+  uint32_t count = 0;
+  VkResult res = vkEnumeratePhysicalDevices(instance, &count, nullptr);
+  if (res != VK_SUCCESS) {
+    TE_CRITICAL("Cannot enumerate physical devices");
+    return res;
+  }
+  std::vector<VkPhysicalDevice> handles(count);
+  res = vkEnumeratePhysicalDevices(instance, &count, handles.data());
+  if (res != VK_SUCCESS && res != VK_INCOMPLETE) {
+    TE_CRITICAL("Cannot enumerate physical devices");
+    return res;
+  }
+  handles.resize(count);
+  TE_TRACE("Found {} VkDevices", count);
+
+  devices_.resize(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    physicalDeviceInfo &info = devices_[i];
+    info.device = handles[i];
+    vkGetPhysicalDeviceProperties(info.device, &info.properties);
+    // deviceUUID needs vkGetPhysicalDeviceProperties2, core from 1.1 on both sides
+    if (api_version >= VK_API_VERSION_1_1 && info.properties.apiVersion >= VK_API_VERSION_1_1) {
+      VkPhysicalDeviceIDProperties id{};
+      id.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+      VkPhysicalDeviceProperties2 properties2{};
+      properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+      properties2.pNext = &id;
+      vkGetPhysicalDeviceProperties2(info.device, &properties2);
+      std::memcpy(info.uuid.data(), id.deviceUUID, VK_UUID_SIZE);
+      info.has_uuid = true;
+    }
+
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(info.device, &familyCount, nullptr);
+    info.queue_families.resize(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(info.device, &familyCount,
+                                             info.queue_families.data());
+    if (present) {
+      info.present_families.resize(familyCount);
+      for (uint32_t f = 0; f < familyCount; ++f) {
+        info.present_families[f] = present(instance, info.device, f) != 0;
+      }
+    }
+    vkGetPhysicalDeviceMemoryProperties(info.device, &info.memory);
+
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(info.device, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(info.device, nullptr, &extensionCount,
+                                         extensions.data());
+    info.extensions.reserve(extensionCount);
+    for (uint32_t e = 0; e < extensionCount; ++e) {
+      info.extensions.emplace_back(extensions[e].extensionName);
+    }
+  }
+  return VK_SUCCESS;
+}
+
+int DeviceSelector::Select(const deviceSelectionOpts &opts,
+                           const VkAllocationCallbacks *allocator) {
+  int chosen = PickDevice(devices_, opts);
+  if (opts.benchmark && chosen >= 0) {
+    int64_t bestClass = ScoreDevice(devices_[chosen], opts).score / kClassWeight;
+    std::vector<size_t> tied;
+    for (size_t i = 0; i < devices_.size(); ++i) {
+      int64_t score = ScoreDevice(devices_[i], opts).score;
+      if (score >= 0 && score / kClassWeight == bestClass) {
+        tied.push_back(i);
+      }
+    }
+    if (tied.size() > 1) {
+      for (size_t i : tied) {
+        devices_[i].benchmark_ms = Benchmark(devices_[i], allocator);
+      }
+      chosen = PickDevice(devices_, opts);
+    }
+  }
+  Log(opts, chosen);
+  return chosen;
+}
+
+double DeviceSelector::Benchmark(const physicalDeviceInfo &info,
+                                 const VkAllocationCallbacks *allocator) {
+  float priority = 1.0f;
+  VkDeviceQueueCreateInfo queueInfo{};
+  queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queueInfo.queueFamilyIndex = static_cast<uint32_t>(info.GraphicsFamily());
+  queueInfo.queueCount = 1;
+  queueInfo.pQueuePriorities = &priority;
+  VkDeviceCreateInfo deviceInfo{};
+  deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  deviceInfo.queueCreateInfoCount = 1;
+  deviceInfo.pQueueCreateInfos = &queueInfo;
+
+  VkDevice device = VK_NULL_HANDLE;
+  if (vkCreateDevice(info.device, &deviceInfo, allocator, &device) != VK_SUCCESS) {
+    TE_WARN("Cannot create a benchmark device on {}", info.properties.deviceName);
+    return -1.0;
+  }
+  VkQueue queue;
+  vkGetDeviceQueue(device, queueInfo.queueFamilyIndex, 0, &queue);
+
+  VkBuffer buffer = VK_NULL_HANDLE;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkCommandPool pool = VK_NULL_HANDLE;
+  VkFence fence = VK_NULL_HANDLE;
+  double ms = -1.0;
+
+  VkBufferCreateInfo bufferInfo{};
+  bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferInfo.size = kBenchmarkBytes;
+  bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  VkMemoryRequirements requirements{};
+  int32_t memoryType = -1;
+  if (vkCreateBuffer(device, &bufferInfo, allocator, &buffer) == VK_SUCCESS) {
+    vkGetBufferMemoryRequirements(device, buffer, &requirements);
+    memoryType = FindMemoryType(info.memory, requirements.memoryTypeBits,
+                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (memoryType < 0) {
+      memoryType = FindMemoryType(info.memory, requirements.memoryTypeBits, 0);
+    }
+  }
+
+  VkMemoryAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.allocationSize = requirements.size;
+  allocInfo.memoryTypeIndex = static_cast<uint32_t>(memoryType);
+  VkCommandPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.queueFamilyIndex = queueInfo.queueFamilyIndex;
+  VkFenceCreateInfo fenceInfo{};
+  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+  if (memoryType >= 0 && vkAllocateMemory(device, &allocInfo, allocator, &memory) == VK_SUCCESS &&
+      vkBindBufferMemory(device, buffer, memory, 0) == VK_SUCCESS &&
+      vkCreateCommandPool(device, &poolInfo, allocator, &pool) == VK_SUCCESS &&
+      vkCreateFence(device, &fenceInfo, allocator, &fence) == VK_SUCCESS) {
+    VkCommandBufferAllocateInfo cmdInfo{};
+    cmdInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    cmdInfo.commandPool = pool;
+    cmdInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    cmdInfo.commandBufferCount = 1;
+    VkCommandBuffer cmd;
+    vkAllocateCommandBuffers(device, &cmdInfo, &cmd);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    vkBeginCommandBuffer(cmd, &beginInfo);
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    for (uint32_t i = 0; i < kBenchmarkFills; ++i) {
+      vkCmdFillBuffer(cmd, buffer, 0, VK_WHOLE_SIZE, i);
+      vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                           1, &barrier, 0, nullptr, 0, nullptr);
+    }
+    vkEndCommandBuffer(cmd);
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &cmd;
+    // The first run pays for clock ramp-up and lazy driver setup, only the second is timed
+    for (int run = 0; run < 2; ++run) {
+      uint64_t begin = platform::Trace::SteadyNanoseconds();
+      if (vkQueueSubmit(queue, 1, &submitInfo, fence) != VK_SUCCESS ||
+          vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX) != VK_SUCCESS) {
+        ms = -1.0;
+        break;
+      }
+      vkResetFences(device, 1, &fence);
+      ms = double(platform::Trace::SteadyNanoseconds() - begin) * 1e-6;
+    }
+  }
+
+  vkDeviceWaitIdle(device);
+  vkDestroyFence(device, fence, allocator);
+  vkDestroyCommandPool(device, pool, allocator);
+  vkDestroyBuffer(device, buffer, allocator);
+  vkFreeMemory(device, memory, allocator);
+  vkDestroyDevice(device, allocator);
+  if (ms < 0.0) {
+    TE_WARN("Benchmark failed on {}", info.properties.deviceName);
+  }
+  return ms;
+}
+
+void DeviceSelector::Log(const deviceSelectionOpts &opts, int chosen) const {
+  TE_INFO("Physical devices, {} policy:", PolicyName(opts.policy));
+  for (size_t i = 0; i < devices_.size(); ++i) {
+    const physicalDeviceInfo &info = devices_[i];
+    deviceScore score = ScoreDevice(info, opts);
+    if (info.benchmark_ms >= 0.0) {
+      score.reasons.emplace_back(fmt::format("{:.2f} ms benchmark", info.benchmark_ms));
+    }
+    std::string reasons;
+    for (const std::string &reason : score.reasons) {
+      reasons += reasons.empty() ? reason : ", " + reason;
+    }
+    TE_INFO("{} [{}] {} (vendor {:#06x}, Vulkan {}.{}, {}) score {}: {}",
+            int(i) == chosen ? '*' : ' ', i, info.properties.deviceName, info.properties.vendorID,
+            VK_API_VERSION_MAJOR(info.properties.apiVersion),
+            VK_API_VERSION_MINOR(info.properties.apiVersion),
+            info.has_uuid ? FormatDeviceUuid(info.uuid) : std::string("no UUID"), score.score,
+            reasons);
+  }
+
+  if (chosen < 0) {
+    TE_ERROR("No physical device has a graphics queue that can present and swapchain support");
+    return;
+  }
+  const physicalDeviceInfo &info = devices_[chosen];
+  if (opts.policy == DevicePolicy::Pinned && !(info.has_uuid && info.uuid == opts.uuid)) {
+    TE_WARN("No device with UUID {}, falling back to the performance policy",
+            FormatDeviceUuid(opts.uuid));
+  }
+  if (opts.policy != DevicePolicy::Software &&
+      info.properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU) {
+    TE_WARN("Running on the CPU implementation {}, no usable GPU was found",
+            info.properties.deviceName);
+  }
+  TE_INFO("Selected {}", info.properties.deviceName);
+}
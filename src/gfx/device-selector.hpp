@@ -0,0 +1,85 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+enum class DevicePolicy {
+  // Discrete over integrated over virtual over CPU, then the most device local memory
+  Performance,
+  // Integrated first, for laptops that should leave the discrete GPU asleep
+  LowPower,
+  // A CPU implementation such as lavapipe, for machines without a usable GPU and for tests
+  Software,
+  // The device whose deviceUUID matches, falling back to Performance when it isn't present
+  Pinned,
+};
+
+struct deviceSelectionOpts {
+  DevicePolicy policy = DevicePolicy::Performance;
+  // Used by DevicePolicy::Pinned
+  std::array<uint8_t, VK_UUID_SIZE> uuid{};
+  // Time a short fill on every usable device of the best device's class and take the fastest
+  bool benchmark = false;
+};
+
+struct physicalDeviceInfo {
+  VkPhysicalDevice device = VK_NULL_HANDLE;
+  VkPhysicalDeviceProperties properties{};
+  // All zero when the instance or device predates Vulkan 1.1
+  std::array<uint8_t, VK_UUID_SIZE> uuid{};
+  bool has_uuid = false;
+  std::vector<VkQueueFamilyProperties> queue_families;
+  // Whether each queue family can present to the platform's windows, empty when unchecked
+  std::vector<bool> present_families;
+  VkPhysicalDeviceMemoryProperties memory{};
+  std::vector<std::string> extensions;
+  // Milliseconds for the tie-break benchmark, negative when it didn't run
+  double benchmark_ms = -1.0;
+
+  bool HasExtension(const char *name) const;
+  // First family with graphics support, -1 when there is none
+  int GraphicsFamily() const;
+  VkDeviceSize DeviceLocalBytes() const;
+};
+
+struct deviceScore {
+  // Negative when the device can't run the application at all
+  int64_t score = 0;
+  // Human readable, for the selection log
+  std::vector<std::string> reasons;
+};
+
+// Parses 32 hex digits, dashes anywhere are ignored
+bool ParseDeviceUuid(const char *text, std::array<uint8_t, VK_UUID_SIZE> &uuid);
+std::string FormatDeviceUuid(const std::array<uint8_t, VK_UUID_SIZE> &uuid);
+
+deviceScore ScoreDevice(const physicalDeviceInfo &device, const deviceSelectionOpts &opts);
+
+// Index of the best usable device, -1 when none is. Within a device class a measured
+// benchmark_ms outranks memory and limits.
+int PickDevice(const std::vector<physicalDeviceInfo> &devices, const deviceSelectionOpts &opts);
+
+// Whether a queue family can present, glfwGetPhysicalDevicePresentationSupport fits
+using PresentSupport = int (*)(VkInstance instance, VkPhysicalDevice device, uint32_t family);
+
+// Enumerates, probes, scores and logs every physical device and picks one
+class DeviceSelector {
+public:
+  // Without present, e.g. when headless, presentation support isn't checked
+  VkResult Probe(VkInstance instance, uint32_t api_version, PresentSupport present = nullptr);
+  // Runs the optional benchmark, logs the ranking and returns an index into GetDevices(), -1
+  // when no device is usable
+  int Select(const deviceSelectionOpts &opts, const VkAllocationCallbacks *allocator);
+
+  const std::vector<physicalDeviceInfo> &GetDevices() const { return devices_; }
+
+private:
+  // Creates a throwaway logical device and times a few large buffer fills on its graphics queue
+  static double Benchmark(const physicalDeviceInfo &device,
+                          const VkAllocationCallbacks *allocator);
+  void Log(const deviceSelectionOpts &opts, int chosen) const;
+
+  std::vector<physicalDeviceInfo> devices_;
+};
@@ -0,0 +1,282 @@
+#include "gfx/frame-capture.hpp"
+#include "platform/log.hpp"
+#include "platform/trace.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+
+namespace {
+
+bool PixelOrderFor(VkFormat format, capture::PixelOrder *order) {
+  switch (format) {
+  case VK_FORMAT_B8G8R8A8_UNORM:
+  case VK_FORMAT_B8G8R8A8_SRGB:
+    *order = capture::PixelOrder::Bgra;
+    return true;
+  case VK_FORMAT_R8G8B8A8_UNORM:
+  case VK_FORMAT_R8G8B8A8_SRGB:
+    *order = capture::PixelOrder::Rgba;
+    return true;
+  default:
+    return false;
+  }
+}
+
+} // namespace
+
+VkResult FrameCapture::Start(VkDevice device, DeviceAllocator *device_allocator,
+                             VkExtent2D extent, frameCaptureOpts opts,
+                             const VkAllocationCallbacks *allocator) {
+  Stop();
+  device_ = device;
+  device_allocator_ = device_allocator;
+  allocator_ = allocator;
+  opts_ = std::move(opts);
+  opts_.slots = std::max<uint32_t>(opts_.slots, 1);
+
+  if (opts_.format == FrameCaptureFormat::Png) {
+    std::error_code error;
+    std::filesystem::create_directories(opts_.path, error);
+    if (error) {
+      TE_ERROR("Error creating frame capture directory '{}'", opts_.path);
+      return VK_ERROR_INITIALIZATION_FAILED;
+    }
+  }
+
+  slots_.assign(opts_.slots, slot{});
+  free_.clear();
+  for (uint32_t i = 0; i < opts_.slots; ++i) {
+    VkResult res = Reserve(slots_[i], VkDeviceSize{extent.width} * extent.height * 4);
+    if (res != VK_SUCCESS) {
+      Stop();
+      return res;
+    }
+    free_.push_back(i);
+  }
+
+  recording_ = kNoSlot;
+  in_flight_.clear();
+  queue_.clear();
+  y4m_segment_ = 0;
+  sequence_ = 0;
+  warned_format_ = false;
+  captured_frames_ = 0;
+  dropped_frames_ = 0;
+  written_frames_ = 0;
+  stopping_ = false;
+  thread_ = std::thread([this] { Run(); });
+  active_ = true;
+  TE_TRACE("Frame capture to '{}' started with {} slots", opts_.path, opts_.slots);
+  return VK_SUCCESS;
+}
+
+void FrameCapture::Stop() {
+  if (thread_.joinable()) {
+    if (recording_ != kNoSlot) {
+      Release(recording_);
+      recording_ = kNoSlot;
+    }
+    Collect(UINT64_MAX);
+    {
+      std::lock_guard lock(mutex_);
+      stopping_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+    y4m_.Close();
+    TE_TRACE("Frame capture stopped, {} frames written, {} dropped", written_frames_.load(),
+             dropped_frames_.load());
+  }
+  for (slot &s : slots_) {
+    if (s.buffer != VK_NULL_HANDLE) {
+      vkDestroyBuffer(device_, s.buffer, allocator_);
+      device_allocator_->Free(s.allocation);
+    }
+  }
+  slots_.clear();
+  active_ = false;
+}
+
+VkResult FrameCapture::Reserve(slot &s, VkDeviceSize size) {
+  if (size <= s.capacity) {
+    return VK_SUCCESS;
+  }
+  if (s.buffer != VK_NULL_HANDLE) {
+    vkDestroyBuffer(device_, s.buffer, allocator_);
+    device_allocator_->Free(s.allocation);
+    s.buffer = VK_NULL_HANDLE;
+    s.capacity = 0;
+  }
+
+  VkBufferCreateInfo info{};
+  info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  info.size = std::max<VkDeviceSize>(size, 4);
+  info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  VkResult res =
+      device_allocator_->CreateBuffer(info, MemoryUsage::Readback, &s.buffer, &s.allocation);
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error creating frame capture readback buffer");
+    s.buffer = VK_NULL_HANDLE;
+    return res;
+  }
+  s.capacity = info.size;
+  return VK_SUCCESS;
+}
+
+void FrameCapture::Record(VkCommandBuffer cmd, VkImage image, VkFormat format, VkExtent2D extent) {
+  TE_ZONE("FrameCapture::Record");
+  // The previous frame failed before it was submitted
+  if (recording_ != kNoSlot) {
+    Release(recording_);
+    recording_ = kNoSlot;
+  }
+
+  capture::PixelOrder order;
+  if (!PixelOrderFor(format, &order)) {
+    if (!warned_format_) {
+      TE_WARN("Frame capture doesn't support surface format {}", static_cast<int>(format));
+      warned_format_ = true;
+    }
+    ++dropped_frames_;
+    return;
+  }
+
+  uint32_t index;
+  {
+    std::lock_guard lock(mutex_);
+    if (free_.empty()) {
+      ++dropped_frames_;
+      return;
+    }
+    index = free_.back();
+    free_.pop_back();
+  }
+  slot &s = slots_[index];
+  // Only a resize grows a slot, every other frame reuses the buffer as is
+  if (Reserve(s, VkDeviceSize{extent.width} * extent.height * 4) != VK_SUCCESS) {
+    Release(index);
+    ++dropped_frames_;
+    return;
+  }
+  s.extent = extent;
+  s.order = order;
+
+  VkImageMemoryBarrier imageBarrier{};
+  imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  imageBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  imageBarrier.oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  imageBarrier.image = image;
+  imageBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1,
+                       &imageBarrier);
+
+  VkBufferImageCopy region{};
+  region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+  region.imageExtent = {extent.width, extent.height, 1};
+  vkCmdCopyImageToBuffer(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, s.buffer, 1, &region);
+
+  // Presentation is ordered by the render-complete semaphore, only the host read needs a barrier
+  imageBarrier.srcAccessMask = 0;
+  imageBarrier.dstAccessMask = 0;
+  imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  imageBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  VkBufferMemoryBarrier bufferBarrier{};
+  bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  bufferBarrier.buffer = s.buffer;
+  bufferBarrier.size = VK_WHOLE_SIZE;
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_HOST_BIT | VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0,
+                       nullptr, 1, &bufferBarrier, 1, &imageBarrier);
+  recording_ = index;
+}
+
+void FrameCapture::Submitted(uint64_t frame_number) {
+  if (recording_ == kNoSlot) {
+    return;
+  }
+  slots_[recording_].frame_number = frame_number;
+  in_flight_.push_back(recording_);
+  recording_ = kNoSlot;
+  ++captured_frames_;
+}
+
+void FrameCapture::Collect(uint64_t completed_frames) {
+  if (in_flight_.empty() || slots_[in_flight_.front()].frame_number > completed_frames) {
+    return;
+  }
+  {
+    std::lock_guard lock(mutex_);
+    while (!in_flight_.empty() && slots_[in_flight_.front()].frame_number <= completed_frames) {
+      queue_.push_back(in_flight_.front());
+      in_flight_.pop_front();
+    }
+  }
+  cv_.notify_one();
+}
+
+void FrameCapture::Release(uint32_t index) {
+  std::lock_guard lock(mutex_);
+  free_.push_back(index);
+}
+
+void FrameCapture::Run() {
+  TE_ZONE_THREAD("frame encoder");
+  std::unique_lock lock(mutex_);
+  while (true) {
+    cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+    if (queue_.empty()) {
+      break;
+    }
+    uint32_t index = queue_.front();
+    queue_.pop_front();
+    lock.unlock();
+
+    Encode(slots_[index]);
+
+    lock.lock();
+    free_.push_back(index);
+  }
+}
+
+void FrameCapture::Encode(slot &s) {
+  TE_ZONE("FrameCapture::Encode");
+  capture::imageView image;
+  image.pixels = static_cast<const uint8_t *>(s.allocation.mapped);
+  image.width = s.extent.width;
+  image.height = s.extent.height;
+  image.stride = s.extent.width * 4;
+  image.order = s.order;
+
+  bool ok;
+  if (opts_.format == FrameCaptureFormat::Png) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "frame-%06llu.png",
+                  static_cast<unsigned long long>(sequence_));
+    ok = png_.Write((std::filesystem::path(opts_.path) / name).string(), image);
+  } else {
+    if (!y4m_.IsOpen() || y4m_.GetWidth() != image.width || y4m_.GetHeight() != image.height) {
+      std::filesystem::path path(opts_.path);
+      if (y4m_segment_ > 0) {
+        path.replace_filename(path.stem().string() + "-" + std::to_string(y4m_segment_) +
+                              path.extension().string());
+      }
+      ++y4m_segment_;
+      y4m_.Open(path.string(), image.width, image.height, opts_.fps);
+    }
+    ok = y4m_.WriteFrame(image);
+  }
+  ++sequence_;
+  if (ok) {
+    ++written_frames_;
+  }
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include "capture/image-writer.hpp"
+#include "gfx/device-allocator.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+enum class FrameCaptureFormat { Png, Y4m };
+
+struct frameCaptureOpts {
+  // A directory of numbered PNGs, or the Y4M file. A Y4M stream restarts in a numbered sibling
+  // file whenever the extent changes.
+  std::string path;
+  FrameCaptureFormat format = FrameCaptureFormat::Y4m;
+  // Readback buffers, a frame finding all of them in flight or being encoded is dropped
+  uint32_t slots = 4;
+  // Frame rate written to the Y4M header
+  uint32_t fps = 60;
+};
+
+// Records frames to disk without stalling the render thread. Each captured frame's command
+// buffer copies the finished image into a host visible readback slot, the slot is handed to an
+// encoder thread once the frame's completion has been observed and comes back after encoding.
+// Per frame CPU cost is a free list pop and three commands.
+class FrameCapture {
+public:
+  FrameCapture() = default;
+
+  FrameCapture(const FrameCapture &) = delete;
+  FrameCapture &operator=(const FrameCapture &) = delete;
+
+  // Slots are allocated for extent up front and grow when a larger frame is recorded
+  VkResult Start(VkDevice device, DeviceAllocator *device_allocator, VkExtent2D extent,
+                 frameCaptureOpts opts, const VkAllocationCallbacks *allocator = nullptr);
+  // The GPU has to be done with every recorded frame, the ones not yet encoded are encoded
+  // before returning
+  void Stop();
+  bool IsActive() const { return active_; }
+
+  // Copies image, in PRESENT_SRC_KHR layout after the frame's rendering, into a free slot and
+  // leaves it in the same layout. Only 8 bit RGBA and BGRA formats are captured.
+  void Record(VkCommandBuffer cmd, VkImage image, VkFormat format, VkExtent2D extent);
+  // Ties the slot recorded since the last call to the submission of frame_number
+  void Submitted(uint64_t frame_number);
+  // Hands slots whose frames have finished on the GPU to the encoder
+  void Collect(uint64_t completed_frames);
+
+  const std::string &GetPath() const { return opts_.path; }
+  uint64_t GetCapturedFrames() const { return captured_frames_; }
+  uint64_t GetDroppedFrames() const { return dropped_frames_; }
+  uint64_t GetWrittenFrames() const { return written_frames_; }
+
+private:
+  static constexpr uint32_t kNoSlot = UINT32_MAX;
+
+  struct slot {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    deviceAllocation allocation;
+    VkDeviceSize capacity = 0;
+    VkExtent2D extent{};
+    capture::PixelOrder order = capture::PixelOrder::Rgba;
+    uint64_t frame_number = 0;
+  };
+
+  VkResult Reserve(slot &s, VkDeviceSize size);
+  void Release(uint32_t index);
+  void Run();
+  void Encode(slot &s);
+
+  VkDevice device_ = VK_NULL_HANDLE;
+  DeviceAllocator *device_allocator_ = nullptr;
+  const VkAllocationCallbacks *allocator_ = nullptr;
+  frameCaptureOpts opts_;
+  bool active_ = false;
+  bool warned_format_ = false;
+  std::vector<slot> slots_;
+
+  // Render thread only, in submission order
+  uint32_t recording_ = kNoSlot;
+  std::deque<uint32_t> in_flight_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<uint32_t> free_;
+  std::deque<uint32_t> queue_;
+  bool stopping_ = false;
+  std::thread thread_;
+
+  // Encoder thread only
+  capture::PngWriter png_;
+  capture::Y4mWriter y4m_;
+  uint32_t y4m_segment_ = 0;
+  uint64_t sequence_ = 0;
+
+  std::atomic<uint64_t> captured_frames_ = 0;
+  std::atomic<uint64_t> dropped_frames_ = 0;
+  std::atomic<uint64_t> written_frames_ = 0;
+};
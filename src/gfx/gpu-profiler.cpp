@@ -0,0 +1,132 @@
+#include "gpu-profiler.hpp"
+#include "platform/log.hpp"
+
+const char *GpuZoneName(GpuZone zone) {
+  switch (zone) {
+  case GpuZone::Frame:
+    return "Frame";
+  case GpuZone::RenderPass:
+    return "Render pass";
+  case GpuZone::ImGui:
+    return "ImGui";
+  default:
+    return "Unknown";
+  }
+}
+
+VkResult GpuProfiler::Init(VkDevice device, VkPhysicalDevice physical_device,
+                           uint32_t queue_family, uint32_t frame_slots,
+                           const VkAllocationCallbacks *allocator) {
+  Destroy();
+  device_ = device;
+  allocator_ = allocator;
+  for (std::atomic<double> &ms : last_ms_) {
+    ms.store(-1.0, std::memory_order_relaxed);
+  }
+
+  uint32_t familyCount;
+  vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &familyCount, nullptr);
+  std::vector<VkQueueFamilyProperties> queueFamilyProperties(familyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &familyCount,
+                                           queueFamilyProperties.data());
+  uint32_t validBits = queueFamilyProperties[queue_family].timestampValidBits;
+
+  VkPhysicalDeviceProperties deviceProperties;
+  vkGetPhysicalDeviceProperties(physical_device, &deviceProperties);
+  if (validBits == 0 || deviceProperties.limits.timestampPeriod == 0.0f) {
+    TE_WARN("Timestamp queries are not supported, GPU timings are unavailable");
+    return VK_SUCCESS;
+  }
+  timestamp_mask_ = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+  timestamp_period_ = deviceProperties.limits.timestampPeriod;
+
+  frame_slots_ = frame_slots;
+  current_slot_ = 0;
+  slot_written_.assign(frame_slots_, false);
+
+  VkQueryPoolCreateInfo createInfo{};
+  createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  createInfo.queryCount = frame_slots_ * kZoneCount * 2;
+
+  VkResult res = vkCreateQueryPool(device_, &createInfo, allocator_, &pool_);
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error creating timestamp query pool");
+    return res;
+  }
+  TE_TRACE("GPU profiler initialized with {} frame slots", frame_slots_);
+  return res;
+}
+
+void GpuProfiler::Destroy() {
+  if (pool_ != VK_NULL_HANDLE) {
+    vkDestroyQueryPool(device_, pool_, allocator_);
+    pool_ = VK_NULL_HANDLE;
+  }
+}
+
+void GpuProfiler::BeginFrame(VkCommandBuffer cmd, uint32_t slot) {
+  if (!IsEnabled()) {
+    return;
+  }
+  ReadSlot(slot);
+
+  current_slot_ = slot;
+  vkCmdResetQueryPool(cmd, pool_, QueryIndex(GpuZone::Frame, false), kZoneCount * 2);
+  BeginZone(cmd, GpuZone::Frame);
+}
+
+void GpuProfiler::EndFrame(VkCommandBuffer cmd) {
+  if (!IsEnabled()) {
+    return;
+  }
+  EndZone(cmd, GpuZone::Frame);
+  slot_written_[current_slot_] = true;
+}
+
+void GpuProfiler::BeginZone(VkCommandBuffer cmd, GpuZone zone) {
+  if (IsEnabled()) {
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, pool_, QueryIndex(zone, false));
+  }
+}
+
+void GpuProfiler::EndZone(VkCommandBuffer cmd, GpuZone zone) {
+  if (IsEnabled()) {
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, pool_, QueryIndex(zone, true));
+  }
+}
+
+void GpuProfiler::ReadSlot(uint32_t slot) {
+  if (!slot_written_[slot]) {
+    return;
+  }
+  slot_written_[slot] = false;
+
+  // Every query is followed by its availability word, zones skipped this frame read as missing
+  uint64_t results[kZoneCount * 2][2];
+  VkResult res = vkGetQueryPoolResults(
+      device_, pool_, slot * kZoneCount * 2, kZoneCount * 2, sizeof(results), results,
+      sizeof(results[0]), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+  if (res != VK_SUCCESS && res != VK_NOT_READY) {
+    return;
+  }
+
+  std::lock_guard lock(results_mutex_);
+  for (uint32_t zone = 0; zone < kZoneCount; ++zone) {
+    const uint64_t *begin = results[zone * 2];
+    const uint64_t *end = results[zone * 2 + 1];
+    if (begin[1] == 0 || end[1] == 0) {
+      last_ms_[zone].store(-1.0, std::memory_order_relaxed);
+      history_[zone][history_head_] = 0.0f;
+      continue;
+    }
+    uint64_t ticks = (end[0] - begin[0]) & timestamp_mask_;
+    double ms = static_cast<double>(ticks) * timestamp_period_ * 1e-6;
+    last_ms_[zone].store(ms, std::memory_order_relaxed);
+    history_[zone][history_head_] = static_cast<float>(ms);
+  }
+  history_head_ = (history_head_ + 1) % kHistorySize;
+  if (history_count_ < kHistorySize) {
+    ++history_count_;
+  }
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+enum class GpuZone : uint32_t { Frame, RenderPass, ImGui, Count };
+
+const char *GpuZoneName(GpuZone zone);
+
+// Timestamp profiler with one query slot set per frame in flight. Results for a slot are read
+// back when that slot is reused, after its fence has signaled, so readback never waits.
+// Readback may run on a render worker, hold GetResultsMutex() while reading the history.
+class GpuProfiler {
+public:
+  static constexpr size_t kHistorySize = 256;
+  static constexpr uint32_t kZoneCount = static_cast<uint32_t>(GpuZone::Count);
+
+  VkResult Init(VkDevice device, VkPhysicalDevice physical_device, uint32_t queue_family,
+                uint32_t frame_slots, const VkAllocationCallbacks *allocator = nullptr);
+  void Destroy();
+
+  void BeginFrame(VkCommandBuffer cmd, uint32_t slot);
+  void EndFrame(VkCommandBuffer cmd);
+  void BeginZone(VkCommandBuffer cmd, GpuZone zone);
+  void EndZone(VkCommandBuffer cmd, GpuZone zone);
+
+  bool IsEnabled() const { return pool_ != VK_NULL_HANDLE; }
+
+  // Milliseconds of the most recently completed frame, negative when unavailable
+  double GetLastTime(GpuZone zone) const {
+    return last_ms_[static_cast<uint32_t>(zone)].load(std::memory_order_relaxed);
+  }
+
+  // Rolling history, oldest sample at GetHistoryOffset()
+  const float *GetHistory(GpuZone zone) const {
+    return history_[static_cast<uint32_t>(zone)].data();
+  }
+  size_t GetHistoryOffset() const { return history_count_ < kHistorySize ? 0 : history_head_; }
+  size_t GetHistoryCount() const { return history_count_; }
+  std::mutex &GetResultsMutex() const { return results_mutex_; }
+
+private:
+  uint32_t QueryIndex(GpuZone zone, bool end) const {
+    return (current_slot_ * kZoneCount + static_cast<uint32_t>(zone)) * 2 + (end ? 1 : 0);
+  }
+  void ReadSlot(uint32_t slot);
+
+  VkDevice device_ = VK_NULL_HANDLE;
+  const VkAllocationCallbacks *allocator_ = nullptr;
+  VkQueryPool pool_ = VK_NULL_HANDLE;
+  uint32_t frame_slots_ = 0;
+  uint32_t current_slot_ = 0;
+  uint64_t timestamp_mask_ = 0;
+  float timestamp_period_ = 0.0f;
+  std::vector<bool> slot_written_;
+
+  mutable std::mutex results_mutex_;
+  std::array<std::atomic<double>, kZoneCount> last_ms_{-1.0, -1.0, -1.0};
+  std::array<std::array<float, kHistorySize>, kZoneCount> history_{};
+  size_t history_head_ = 0;
+  size_t history_count_ = 0;
+};
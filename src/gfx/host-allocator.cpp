@@ -0,0 +1,168 @@
+#include "host-allocator.hpp"
+#include "platform/memory-stats.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+struct allocationHeader {
+  size_t size;
+  // Distance from the start of the underlying block to the returned pointer
+  uint32_t offset;
+  uint32_t scope;
+  bool arena;
+};
+
+// Command scope allocations are freed before the Vulkan call returns, on the calling thread
+struct threadArena {
+  alignas(std::max_align_t) std::byte data[HostAllocator::kArenaSize];
+  size_t head = 0;
+  size_t live = 0;
+};
+
+threadArena &ThisThreadArena() {
+  thread_local std::unique_ptr<threadArena> arena = std::make_unique<threadArena>();
+  return *arena;
+}
+
+allocationHeader *HeaderOf(void *memory) {
+  return reinterpret_cast<allocationHeader *>(memory) - 1;
+}
+
+std::byte *Place(std::byte *raw, size_t alignment) {
+  uintptr_t address = reinterpret_cast<uintptr_t>(raw) + sizeof(allocationHeader);
+  address = (address + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+  return reinterpret_cast<std::byte *>(address);
+}
+
+} // namespace
+
+HostAllocator::HostAllocator() {
+  callbacks_.pUserData = this;
+  callbacks_.pfnAllocation = Allocate;
+  callbacks_.pfnReallocation = Reallocate;
+  callbacks_.pfnFree = Free;
+  callbacks_.pfnInternalAllocation = InternalAllocation;
+  callbacks_.pfnInternalFree = InternalFree;
+}
+
+hostScopeStats HostAllocator::GetStats(VkSystemAllocationScope scope) const {
+  const scopeCounters &counters = scopes_[scope];
+  hostScopeStats stats;
+  stats.live_bytes = counters.live_bytes.load(std::memory_order_relaxed);
+  stats.live_allocations = counters.live_allocations.load(std::memory_order_relaxed);
+  stats.total_allocations = counters.total_allocations.load(std::memory_order_relaxed);
+  stats.internal_bytes = counters.internal_bytes.load(std::memory_order_relaxed);
+  return stats;
+}
+
+hostScopeStats HostAllocator::GetTotalStats() const {
+  hostScopeStats total;
+  for (uint32_t scope = 0; scope < kScopeCount; ++scope) {
+    hostScopeStats stats = GetStats(static_cast<VkSystemAllocationScope>(scope));
+    total.live_bytes += stats.live_bytes;
+    total.live_allocations += stats.live_allocations;
+    total.total_allocations += stats.total_allocations;
+    total.internal_bytes += stats.internal_bytes;
+  }
+  return total;
+}
+
+void *HostAllocator::Allocate(void *user_data, size_t size, size_t alignment,
+                              VkSystemAllocationScope scope) {
+  auto *self = static_cast<HostAllocator *>(user_data);
+  if (size == 0) {
+    return nullptr;
+  }
+  alignment = std::max(alignment, alignof(allocationHeader));
+  size_t total = size + sizeof(allocationHeader) + alignment - 1;
+
+  std::byte *raw = nullptr;
+  bool arena = false;
+  if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND) {
+    threadArena &a = ThisThreadArena();
+    if (total <= kArenaSize - a.head) {
+      raw = a.data + a.head;
+      a.head += total;
+      ++a.live;
+      arena = true;
+    } else {
+      self->arena_fallbacks_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  if (!raw) {
+    raw = static_cast<std::byte *>(std::malloc(total));
+    if (!raw) {
+      return nullptr;
+    }
+  }
+
+  std::byte *memory = Place(raw, alignment);
+  *HeaderOf(memory) = {size, static_cast<uint32_t>(memory - raw), static_cast<uint32_t>(scope),
+                       arena};
+
+  if (!arena) {
+    platform::MemoryStats::CountAllocation(platform::MemoryTag::Gfx, size);
+  }
+  scopeCounters &counters = self->scopes_[scope];
+  counters.live_bytes.fetch_add(size, std::memory_order_relaxed);
+  counters.live_allocations.fetch_add(1, std::memory_order_relaxed);
+  counters.total_allocations.fetch_add(1, std::memory_order_relaxed);
+  return memory;
+}
+
+void *HostAllocator::Reallocate(void *user_data, void *original, size_t size, size_t alignment,
+                                VkSystemAllocationScope scope) {
+  if (!original) {
+    return Allocate(user_data, size, alignment, scope);
+  }
+  if (size == 0) {
+    Free(user_data, original);
+    return nullptr;
+  }
+
+  void *memory = Allocate(user_data, size, alignment, scope);
+  if (!memory) {
+    // The original allocation stays valid on failure
+    return nullptr;
+  }
+  std::memcpy(memory, original, std::min(size, HeaderOf(original)->size));
+  Free(user_data, original);
+  return memory;
+}
+
+void HostAllocator::Free(void *user_data, void *memory) {
+  if (!memory) {
+    return;
+  }
+  auto *self = static_cast<HostAllocator *>(user_data);
+  allocationHeader header = *HeaderOf(memory);
+
+  scopeCounters &counters = self->scopes_[header.scope];
+  counters.live_bytes.fetch_sub(header.size, std::memory_order_relaxed);
+  counters.live_allocations.fetch_sub(1, std::memory_order_relaxed);
+
+  if (header.arena) {
+    threadArena &a = ThisThreadArena();
+    if (--a.live == 0) {
+      a.head = 0;
+    }
+  } else {
+    platform::MemoryStats::CountFree(platform::MemoryTag::Gfx, header.size);
+    std::free(static_cast<std::byte *>(memory) - header.offset);
+  }
+}
+
+void HostAllocator::InternalAllocation(void *user_data, size_t size, VkInternalAllocationType,
+                                       VkSystemAllocationScope scope) {
+  auto *self = static_cast<HostAllocator *>(user_data);
+  self->scopes_[scope].internal_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void HostAllocator::InternalFree(void *user_data, size_t size, VkInternalAllocationType,
+                                 VkSystemAllocationScope scope) {
+  auto *self = static_cast<HostAllocator *>(user_data);
+  self->scopes_[scope].internal_bytes.fetch_sub(size, std::memory_order_relaxed);
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vulkan/vulkan_core.h>
+
+struct hostScopeStats {
+  size_t live_bytes = 0;
+  size_t live_allocations = 0;
+  size_t total_allocations = 0;
+  // Driver allocations reported through pfnInternalAllocation, not served by us
+  size_t internal_bytes = 0;
+};
+
+// VkAllocationCallbacks that count live host memory per VkSystemAllocationScope. Command scope
+// allocations only live for the duration of one Vulkan call, they are bump-allocated from a
+// per-thread arena that rewinds once the call has freed everything.
+class HostAllocator {
+public:
+  static constexpr uint32_t kScopeCount = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+  static constexpr size_t kArenaSize = 64 * 1024;
+
+  HostAllocator();
+
+  HostAllocator(const HostAllocator &) = delete;
+  HostAllocator &operator=(const HostAllocator &) = delete;
+
+  const VkAllocationCallbacks *GetCallbacks() const { return &callbacks_; }
+
+  hostScopeStats GetStats(VkSystemAllocationScope scope) const;
+  hostScopeStats GetTotalStats() const;
+  // Command scope allocations that did not fit in the arena
+  size_t GetArenaFallbackCount() const { return arena_fallbacks_.load(std::memory_order_relaxed); }
+
+private:
+  struct scopeCounters {
+    std::atomic<size_t> live_bytes{0};
+    std::atomic<size_t> live_allocations{0};
+    std::atomic<size_t> total_allocations{0};
+    std::atomic<size_t> internal_bytes{0};
+  };
+
+  static void *VKAPI_PTR Allocate(void *user_data, size_t size, size_t alignment,
+                                  VkSystemAllocationScope scope);
+  static void *VKAPI_PTR Reallocate(void *user_data, void *original, size_t size,
+                                    size_t alignment, VkSystemAllocationScope scope);
+  static void VKAPI_PTR Free(void *user_data, void *memory);
+  static void VKAPI_PTR InternalAllocation(void *user_data, size_t size,
+                                           VkInternalAllocationType type,
+                                           VkSystemAllocationScope scope);
+  static void VKAPI_PTR InternalFree(void *user_data, size_t size, VkInternalAllocationType type,
+                                     VkSystemAllocationScope scope);
+
+  VkAllocationCallbacks callbacks_{};
+  std::array<scopeCounters, kScopeCount> scopes_;
+  std::atomic<size_t> arena_fallbacks_{0};
+};
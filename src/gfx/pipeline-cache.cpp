@@ -0,0 +1,132 @@
+#include "pipeline-cache.hpp"
+#include "platform/log.hpp"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+
+constexpr uint32_t kPipelineCacheMagic = 0x4f534350; // "OSCP"
+constexpr uint32_t kPipelineCacheFileVersion = 1;
+
+struct pipelineCacheFileHeader {
+  uint32_t magic;
+  uint32_t file_version;
+  uint32_t vendor_id;
+  uint32_t device_id;
+  uint32_t driver_version;
+  uint8_t cache_uuid[VK_UUID_SIZE];
+  uint64_t data_size;
+  uint64_t checksum;
+};
+
+uint64_t Fnv1a(const uint8_t *data, size_t size) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= data[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+bool MatchesDevice(const pipelineCacheFileHeader &header, const VkPhysicalDeviceProperties &props) {
+  return header.vendor_id == props.vendorID && header.device_id == props.deviceID &&
+         header.driver_version == props.driverVersion &&
+         std::memcmp(header.cache_uuid, props.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+// The driver's own header must agree with ours, otherwise the blob came from somewhere else
+bool MatchesVulkanHeader(const std::vector<uint8_t> &data, const VkPhysicalDeviceProperties &props) {
+  VkPipelineCacheHeaderVersionOne header;
+  if (data.size() < sizeof(header)) {
+    return false;
+  }
+  std::memcpy(&header, data.data(), sizeof(header));
+  return header.headerSize >= sizeof(header) && header.headerSize <= data.size() &&
+         header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         header.vendorID == props.vendorID && header.deviceID == props.deviceID &&
+         std::memcmp(header.pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+} // namespace
+
+std::string PipelineCachePath(const std::string &dir, const VkPhysicalDeviceProperties &props) {
+  char name[96];
+  std::snprintf(name, sizeof(name), "pipeline-cache-%08x-%08x-%08x.bin", props.vendorID,
+                props.deviceID, props.driverVersion);
+  return (std::filesystem::path(dir) / name).string();
+}
+
+std::vector<uint8_t> LoadPipelineCacheData(const std::string &path,
+                                           const VkPhysicalDeviceProperties &props) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file) {
+    TE_TRACE("No pipeline cache found at {}", path);
+    return {};
+  }
+
+  std::streamsize fileSize = file.tellg();
+  file.seekg(0);
+
+  pipelineCacheFileHeader header;
+  if (fileSize < static_cast<std::streamsize>(sizeof(header)) ||
+      !file.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+    TE_WARN("Pipeline cache {} is truncated, ignoring it", path);
+    return {};
+  }
+  if (header.magic != kPipelineCacheMagic || header.file_version != kPipelineCacheFileVersion ||
+      header.data_size != static_cast<uint64_t>(fileSize) - sizeof(header)) {
+    TE_WARN("Pipeline cache {} has an invalid header, ignoring it", path);
+    return {};
+  }
+  if (!MatchesDevice(header, props)) {
+    TE_WARN("Pipeline cache {} was written by another device or driver, ignoring it", path);
+    return {};
+  }
+
+  std::vector<uint8_t> data(header.data_size);
+  if (!file.read(reinterpret_cast<char *>(data.data()), static_cast<std::streamsize>(data.size())) ||
+      Fnv1a(data.data(), data.size()) != header.checksum || !MatchesVulkanHeader(data, props)) {
+    TE_WARN("Pipeline cache {} is corrupt, ignoring it", path);
+    return {};
+  }
+
+  TE_TRACE("Loaded {} bytes of pipeline cache from {}", data.size(), path);
+  return data;
+}
+
+bool SavePipelineCacheData(const std::string &path, const VkPhysicalDeviceProperties &props,
+                           const std::vector<uint8_t> &data) {
+  pipelineCacheFileHeader header{};
+  header.magic = kPipelineCacheMagic;
+  header.file_version = kPipelineCacheFileVersion;
+  header.vendor_id = props.vendorID;
+  header.device_id = props.deviceID;
+  header.driver_version = props.driverVersion;
+  std::memcpy(header.cache_uuid, props.pipelineCacheUUID, VK_UUID_SIZE);
+  header.data_size = data.size();
+  header.checksum = Fnv1a(data.data(), data.size());
+
+  // Write next to the target and rename so a crash never leaves a half-written cache behind
+  std::string tmpPath = path + ".tmp";
+  {
+    std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!file.write(reinterpret_cast<const char *>(&header), sizeof(header)) ||
+        !file.write(reinterpret_cast<const char *>(data.data()),
+                    static_cast<std::streamsize>(data.size()))) {
+      TE_ERROR("Error writing pipeline cache to {}", tmpPath);
+      return false;
+    }
+  }
+
+  std::error_code ec;
+  std::filesystem::rename(tmpPath, path, ec);
+  if (ec) {
+    TE_ERROR("Error moving pipeline cache into place: {}", ec.message());
+    std::filesystem::remove(tmpPath, ec);
+    return false;
+  }
+  TE_TRACE("Saved {} bytes of pipeline cache to {}", data.size(), path);
+  return true;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+// On-disk pipeline cache blobs are keyed by vendor, device, driver version and cache UUID.
+// Anything that doesn't match the running device exactly is treated as a cache miss.
+
+std::string PipelineCachePath(const std::string &dir, const VkPhysicalDeviceProperties &props);
+
+// Returns an empty blob when the file is missing, corrupt or was written by another device
+std::vector<uint8_t> LoadPipelineCacheData(const std::string &path,
+                                           const VkPhysicalDeviceProperties &props);
+
+bool SavePipelineCacheData(const std::string &path, const VkPhysicalDeviceProperties &props,
+                           const std::vector<uint8_t> &data);
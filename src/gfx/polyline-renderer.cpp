@@ -0,0 +1,489 @@
+#include "gfx/polyline-renderer.hpp"
+#include "platform/log.hpp"
+#include "platform/trace.hpp"
+#include <algorithm>
+#include <cstring>
+#include <imgui_impl_vulkan.h>
+
+namespace {
+
+const uint32_t kPolylineVert[] = {
+#include "shaders/polyline.vert.inc"
+};
+
+const uint32_t kPolylineFrag[] = {
+#include "shaders/polyline.frag.inc"
+};
+
+// Smallest trace allocation, in bytes
+constexpr VkDeviceSize kMinTraceBlock = 4096;
+
+struct pushConstants {
+  float scale[2];
+  float translate[2];
+  uint32_t record_base;
+  uint32_t record_count;
+};
+
+VkResult CreateShaderModule(VkDevice device, const VkAllocationCallbacks *allocator,
+                            const uint32_t *code, size_t size, VkShaderModule *module) {
+  VkShaderModuleCreateInfo info{};
+  info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  info.codeSize = size;
+  info.pCode = code;
+  return vkCreateShaderModule(device, &info, allocator, module);
+}
+
+} // namespace
+
+VkResult PolylineRenderer::Init(VulkanContext *v, uint32_t queued_frames,
+                                VkDeviceSize pool_size) {
+  v_ = v;
+  queued_frames_ = queued_frames;
+  VkDevice device = v_->GetDevice();
+  const VkAllocationCallbacks *allocator = v_->GetAllocationCallbacks();
+
+  VkBufferCreateInfo bufferInfo{};
+  bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferInfo.size = pool_size;
+  bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  // Samples are written in place, so the pool never changes queue family ownership
+  v_->GetUploader().ShareBuffer(&bufferInfo);
+  VkResult res = v_->GetDeviceAllocator().CreateBuffer(bufferInfo, MemoryUsage::GpuOnly, &pool_,
+                                                      &pool_memory_);
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error creating polyline sample pool");
+    return res;
+  }
+  pool_allocator_ = BuddyAllocator(pool_size, kMinTraceBlock);
+
+  bufferInfo.size = sizeof(gpuRecord) * kRecordRingSize;
+  bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+  bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  bufferInfo.queueFamilyIndexCount = 0;
+  bufferInfo.pQueueFamilyIndices = nullptr;
+  res = v_->GetDeviceAllocator().CreateBuffer(bufferInfo, MemoryUsage::Upload, &records_,
+                                              &records_memory_);
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error creating polyline record ring");
+    return res;
+  }
+
+  VkDescriptorSetLayoutBinding bindings[2] = {};
+  for (uint32_t i = 0; i < 2; ++i) {
+    bindings[i].binding = i;
+    bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[i].descriptorCount = 1;
+    bindings[i].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+  }
+  VkDescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.bindingCount = 2;
+  layoutInfo.pBindings = bindings;
+  res = vkCreateDescriptorSetLayout(device, &layoutInfo, allocator, &set_layout_);
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error creating polyline descriptor set layout");
+    return res;
+  }
+
+  VkDescriptorSetAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorPool = v_->GetDescriptorPool();
+  allocInfo.descriptorSetCount = 1;
+  allocInfo.pSetLayouts = &set_layout_;
+  res = vkAllocateDescriptorSets(device, &allocInfo, &descriptor_set_);
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error allocating polyline descriptor set");
+    return res;
+  }
+
+  VkDescriptorBufferInfo bufferInfos[2] = {{pool_, 0, VK_WHOLE_SIZE},
+                                           {records_, 0, VK_WHOLE_SIZE}};
+  VkWriteDescriptorSet writes[2] = {};
+  for (uint32_t i = 0; i < 2; ++i) {
+    writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[i].dstSet = descriptor_set_;
+    writes[i].dstBinding = i;
+    writes[i].descriptorCount = 1;
+    writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[i].pBufferInfo = &bufferInfos[i];
+  }
+  vkUpdateDescriptorSets(device, 2, writes, 0, nullptr);
+
+  VkPushConstantRange pushRange{};
+  pushRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+  pushRange.size = sizeof(pushConstants);
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = 1;
+  pipelineLayoutInfo.pSetLayouts = &set_layout_;
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+  res = vkCreatePipelineLayout(device, &pipelineLayoutInfo, allocator, &pipeline_layout_);
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error creating polyline pipeline layout");
+    return res;
+  }
+
+  res = CreatePipeline();
+  if (res != VK_SUCCESS) {
+    return res;
+  }
+  TE_TRACE("Polyline renderer initialized with a {} MiB sample pool", pool_size >> 20);
+  return VK_SUCCESS;
+}
+
+VkResult PolylineRenderer::CreatePipeline() {
+  VkDevice device = v_->GetDevice();
+  const VkAllocationCallbacks *allocator = v_->GetAllocationCallbacks();
+
+  VkShaderModule vert = VK_NULL_HANDLE;
+  VkShaderModule frag = VK_NULL_HANDLE;
+  VkResult res =
+      CreateShaderModule(device, allocator, kPolylineVert, sizeof(kPolylineVert), &vert);
+  if (res == VK_SUCCESS) {
+    res = CreateShaderModule(device, allocator, kPolylineFrag, sizeof(kPolylineFrag), &frag);
+  }
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error creating polyline shader modules");
+    vkDestroyShaderModule(device, vert, allocator);
+    return res;
+  }
+
+  VkPipelineShaderStageCreateInfo stages[2] = {};
+  stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+  stages[0].module = vert;
+  stages[0].pName = "main";
+  stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+  stages[1].module = frag;
+  stages[1].pName = "main";
+
+  VkPipelineVertexInputStateCreateInfo vertexInput{};
+  vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+  VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+  inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+  inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+  VkPipelineViewportStateCreateInfo viewport{};
+  viewport.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+  viewport.viewportCount = 1;
+  viewport.scissorCount = 1;
+
+  VkPipelineRasterizationStateCreateInfo raster{};
+  raster.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+  raster.polygonMode = VK_POLYGON_MODE_FILL;
+  raster.cullMode = VK_CULL_MODE_NONE;
+  raster.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+  raster.lineWidth = 1.0f;
+
+  VkPipelineMultisampleStateCreateInfo multisample{};
+  multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+  multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+  // Same blending as ImGui's own pipeline
+  VkPipelineColorBlendAttachmentState blendAttachment{};
+  blendAttachment.blendEnable = VK_TRUE;
+  blendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+  blendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+  blendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+  blendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+  blendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+  blendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+  blendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                                   VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+  VkPipelineColorBlendStateCreateInfo blend{};
+  blend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+  blend.attachmentCount = 1;
+  blend.pAttachments = &blendAttachment;
+
+  VkPipelineDepthStencilStateCreateInfo depth{};
+  depth.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+
+  VkDynamicState dynamicStates[2] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+  VkPipelineDynamicStateCreateInfo dynamic{};
+  dynamic.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+  dynamic.dynamicStateCount = 2;
+  dynamic.pDynamicStates = dynamicStates;
+
+  VkGraphicsPipelineCreateInfo info{};
+  info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+  info.stageCount = 2;
+  info.pStages = stages;
+  info.pVertexInputState = &vertexInput;
+  info.pInputAssemblyState = &inputAssembly;
+  info.pViewportState = &viewport;
+  info.pRasterizationState = &raster;
+  info.pMultisampleState = &multisample;
+  info.pDepthStencilState = &depth;
+  info.pColorBlendState = &blend;
+  info.pDynamicState = &dynamic;
+  info.layout = pipeline_layout_;
+
+  // Compatible with whichever pass ImGui records into
+  VkPipelineRenderingCreateInfo renderingInfo{};
+  if (v_->UsesDynamicRendering()) {
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &v_->wd.SurfaceFormat.format;
+    info.pNext = &renderingInfo;
+  } else {
+    info.renderPass = v_->wd.RenderPass;
+    info.subpass = 0;
+  }
+
+  res = vkCreateGraphicsPipelines(device, v_->GetPipelineCache(), 1, &info, allocator,
+                                  &pipeline_);
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error creating polyline pipeline");
+  }
+  vkDestroyShaderModule(device, vert, allocator);
+  vkDestroyShaderModule(device, frag, allocator);
+  return res;
+}
+
+void PolylineRenderer::Destroy() {
+  if (!v_) {
+    return;
+  }
+  VkDevice device = v_->GetDevice();
+  const VkAllocationCallbacks *allocator = v_->GetAllocationCallbacks();
+  vkDeviceWaitIdle(device);
+
+  vkDestroyPipeline(device, pipeline_, allocator);
+  vkDestroyPipelineLayout(device, pipeline_layout_, allocator);
+  if (descriptor_set_ != VK_NULL_HANDLE) {
+    vkFreeDescriptorSets(device, v_->GetDescriptorPool(), 1, &descriptor_set_);
+  }
+  vkDestroyDescriptorSetLayout(device, set_layout_, allocator);
+  if (records_ != VK_NULL_HANDLE) {
+    vkDestroyBuffer(device, records_, allocator);
+    v_->GetDeviceAllocator().Free(records_memory_);
+  }
+  if (pool_ != VK_NULL_HANDLE) {
+    vkDestroyBuffer(device, pool_, allocator);
+    v_->GetDeviceAllocator().Free(pool_memory_);
+  }
+  *this = PolylineRenderer();
+}
+
+uint32_t PolylineRenderer::AddTrace(uint32_t capacity) {
+  Collect(false);
+  uint32_t rings = queued_frames_ + 1;
+  uint64_t offset =
+      pool_allocator_.Allocate(uint64_t{capacity} * rings * sizeof(float), sizeof(float));
+  if (offset == BuddyAllocator::kInvalidOffset) {
+    TE_WARN("Polyline sample pool is full, no room for {} rings of {} samples", rings, capacity);
+    return UINT32_MAX;
+  }
+  uint32_t index;
+  if (!free_traces_.empty()) {
+    index = free_traces_.back();
+    free_traces_.pop_back();
+  } else {
+    index = static_cast<uint32_t>(traces_.size());
+    traces_.emplace_back();
+  }
+  traces_[index] = {offset, capacity, 0, std::vector<ring>(rings)};
+  return index;
+}
+
+void PolylineRenderer::RemoveTrace(uint32_t trace) {
+  // Queued frames plus the one being built may still draw it
+  retired_.push_back({v_->GetSubmittedFrames() + queued_frames_ + 1, trace});
+}
+
+void PolylineRenderer::Collect(bool all) {
+  while (!retired_.empty() &&
+         (all || retired_.front().safe_after <= v_->GetCompletedFrames())) {
+    uint32_t index = retired_.front().trace;
+    pool_allocator_.Free(traces_[index].offset);
+    traces_[index] = {};
+    free_traces_.push_back(index);
+    retired_.pop_front();
+  }
+}
+
+VkResult PolylineRenderer::WriteSamples(uint32_t trace, uint64_t total, const float *history,
+                                        uint32_t count) {
+  PolylineRenderer::trace &t = traces_[trace];
+  if (t.rings[t.front].end == total) {
+    return VK_SUCCESS;
+  }
+  uint64_t completed = v_->GetCompletedFrames();
+  uint32_t index = 0;
+  while (index < t.rings.size() &&
+         (index == t.front || t.rings[index].busy_until > completed)) {
+    ++index;
+  }
+  if (index == t.rings.size()) {
+    return VK_SUCCESS;
+  }
+
+  // Only the last capacity samples survive the write, older ones in the ring stay valid when
+  // the new samples continue them
+  ring &r = t.rings[index];
+  uint64_t oldest = total - std::min(count, t.capacity);
+  if (r.end < oldest) {
+    r.begin = oldest;
+    r.end = oldest;
+  }
+  uint64_t base = t.offset + uint64_t{index} * t.capacity * sizeof(float);
+  while (r.end < total) {
+    uint32_t start = static_cast<uint32_t>(r.end % t.capacity);
+    uint32_t n = static_cast<uint32_t>(std::min<uint64_t>(total - r.end, t.capacity - start));
+    UploadTicket ticket;
+    VkResult res = v_->GetUploader().UploadSharedBuffer(
+        pool_, base + uint64_t{start} * sizeof(float), history + (r.end - (total - count)),
+        uint64_t{n} * sizeof(float), &ticket);
+    if (res != VK_SUCCESS) {
+      TE_ERROR("Error uploading polyline samples");
+      return res;
+    }
+    r.end += n;
+  }
+  t.front = index;
+  return VK_SUCCESS;
+}
+
+void PolylineRenderer::Draw(ImDrawList *list, const polylineTrace *traces, uint32_t count) {
+  if (pipeline_ == VK_NULL_HANDLE) {
+    return;
+  }
+  count = std::min(count, kRecordRingSize);
+  callbackHeader header{};
+  header.renderer = this;
+  const ImGuiViewport *viewport = ImGui::GetMainViewport();
+  header.display_pos = viewport->Pos;
+  header.display_size = viewport->Size;
+  header.framebuffer_scale = ImGui::GetIO().DisplayFramebufferScale;
+
+  scratch_.resize(sizeof(callbackHeader) + sizeof(gpuRecord) * count);
+  auto *records = reinterpret_cast<gpuRecord *>(scratch_.data() + sizeof(callbackHeader));
+  // Queued frames plus the one being built may draw the front rings
+  uint64_t busy_until = v_->GetSubmittedFrames() + queued_frames_ + 1;
+  for (uint32_t i = 0; i < count; ++i) {
+    const polylineTrace &src = traces[i];
+    trace &t = traces_[src.trace];
+    ring &front = t.rings[t.front];
+    // A ring that couldn't catch up yet draws what it has, in place
+    uint64_t held = std::max(front.begin, front.end - std::min<uint64_t>(front.end, t.capacity));
+    uint64_t end = std::min(src.first + src.count, front.end);
+    uint64_t first = std::max(src.first, held);
+    if (end < first + 2) {
+      continue;
+    }
+    uint32_t points = static_cast<uint32_t>(end - first);
+    front.busy_until = busy_until;
+    gpuRecord &r = records[header.records++];
+    r.first_segment = header.segments;
+    r.offset = static_cast<uint32_t>(
+        (t.offset + uint64_t{t.front} * t.capacity * sizeof(float)) / sizeof(float));
+    r.capacity = t.capacity;
+    r.start = static_cast<uint32_t>(first % t.capacity);
+    r.count = points;
+    r.color = src.color;
+    r.x = src.x + static_cast<float>(first - src.first) * src.x_step;
+    r.y = src.y;
+    r.x_step = src.x_step;
+    r.y_scale = src.y_scale;
+    r.thickness = src.thickness;
+    r.pad = 0;
+    header.segments += points - 1;
+  }
+  if (header.segments == 0) {
+    return;
+  }
+  std::memcpy(scratch_.data(), &header, sizeof(header));
+  list->AddCallback(&PolylineRenderer::RecordCallback, scratch_.data(),
+                    sizeof(callbackHeader) + sizeof(gpuRecord) * header.records);
+  // ImGui rebinds its pipeline and buffers before the next command
+  list->AddCallback(ImDrawCallback_ResetRenderState, nullptr);
+}
+
+void PolylineRenderer::RecordCallback(const ImDrawList *list, const ImDrawCmd *cmd) {
+  static_cast<void>(list);
+  // Callback data has no alignment guarantee
+  callbackHeader header;
+  std::memcpy(&header, cmd->UserCallbackData, sizeof(header));
+  const auto *records = static_cast<const uint8_t *>(cmd->UserCallbackData) + sizeof(header);
+  auto *state =
+      static_cast<ImGui_ImplVulkan_RenderState *>(ImGui::GetPlatformIO().Renderer_RenderState);
+  header.renderer->Record(state->CommandBuffer, header, cmd->ClipRect, records);
+}
+
+void PolylineRenderer::Record(VkCommandBuffer cmd, const callbackHeader &header,
+                              const ImVec4 &clip_rect, const void *records) {
+  TE_ZONE("PolylineRenderer::Record");
+  // Same clip rectangle math as ImGui_ImplVulkan_RenderDrawData
+  ImVec2 scale = header.framebuffer_scale;
+  float fb_width = header.display_size.x * scale.x;
+  float fb_height = header.display_size.y * scale.y;
+  float min_x = std::max((clip_rect.x - header.display_pos.x) * scale.x, 0.0f);
+  float min_y = std::max((clip_rect.y - header.display_pos.y) * scale.y, 0.0f);
+  float max_x = std::min((clip_rect.z - header.display_pos.x) * scale.x, fb_width);
+  float max_y = std::min((clip_rect.w - header.display_pos.y) * scale.y, fb_height);
+  if (max_x <= min_x || max_y <= min_y) {
+    return;
+  }
+
+  uint64_t first;
+  if (!AllocateRecords(header.records, &first)) {
+    TE_WARN("Polyline record ring is full, skipping {} traces", header.records);
+    return;
+  }
+  auto *ring = static_cast<gpuRecord *>(records_memory_.mapped);
+  std::memcpy(ring + first % kRecordRingSize, records, sizeof(gpuRecord) * header.records);
+
+  VkRect2D scissor;
+  scissor.offset = {static_cast<int32_t>(min_x), static_cast<int32_t>(min_y)};
+  scissor.extent = {static_cast<uint32_t>(max_x - min_x), static_cast<uint32_t>(max_y - min_y)};
+
+  pushConstants push;
+  push.scale[0] = 2.0f / header.display_size.x;
+  push.scale[1] = 2.0f / header.display_size.y;
+  push.translate[0] = -1.0f - header.display_pos.x * push.scale[0];
+  push.translate[1] = -1.0f - header.display_pos.y * push.scale[1];
+  push.record_base = static_cast<uint32_t>(first % kRecordRingSize);
+  push.record_count = header.records;
+
+  // ImGui's viewport covering the framebuffer stays bound
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_);
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_, 0, 1,
+                          &descriptor_set_, 0, nullptr);
+  vkCmdPushConstants(cmd, pipeline_layout_, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(push), &push);
+  vkCmdSetScissor(cmd, 0, 1, &scissor);
+  vkCmdDraw(cmd, 6, header.segments, 0, 0);
+}
+
+bool PolylineRenderer::AllocateRecords(uint32_t count, uint64_t *first) {
+  uint64_t completed = v_->GetCompletedFrames();
+  while (!record_spans_.empty() && record_spans_.front().frame <= completed) {
+    record_tail_ = record_spans_.front().end;
+    record_spans_.pop_front();
+  }
+  if (record_spans_.empty()) {
+    record_tail_ = record_head_;
+  }
+
+  // A batch never wraps, skip to the start of the ring instead
+  uint64_t start = record_head_;
+  if (start % kRecordRingSize + count > kRecordRingSize) {
+    start += kRecordRingSize - start % kRecordRingSize;
+  }
+  if (start + count - record_tail_ > kRecordRingSize) {
+    return false;
+  }
+  record_head_ = start + count;
+  // Recorded into the frame FrameRender submits next
+  uint64_t frame = v_->GetSubmittedFrames() + 1;
+  if (!record_spans_.empty() && record_spans_.back().frame == frame) {
+    record_spans_.back().end = record_head_;
+  } else {
+    record_spans_.push_back({frame, record_head_});
+  }
+  *first = start;
+  return true;
+}
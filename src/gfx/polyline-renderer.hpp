@@ -0,0 +1,142 @@
+#pragma once
+#include "gfx/block-allocator.hpp"
+#include "gfx/vulkan-context.hpp"
+#include "imgui.h"
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// One polyline of a Draw call, drawn from samples already written to a trace
+struct polylineTrace {
+  uint32_t trace = 0;
+  // Absolute index of the first point, still has to be among the trace's last capacity samples
+  uint64_t first = 0;
+  uint32_t count = 0;
+  // Screen position of the first point for a value of 0, then pixels per sample and per unit.
+  // A negative y_scale draws larger values higher up.
+  float x = 0.0f;
+  float y = 0.0f;
+  float x_step = 1.0f;
+  float y_scale = -1.0f;
+  float thickness = 1.0f;
+  ImU32 color = IM_COL32_WHITE;
+};
+
+// Draws polylines straight from GPU-resident samples. Traces are rings inside one device local
+// sample pool and only samples are ever uploaded, a vertex-pulling shader expands every segment
+// into an anti-aliased quad. Each trace has one ring per frame that can be queued plus one.
+// New samples go to a ring no queued frame draws, frames draw the most recently written one.
+// A Draw call turns any number of traces into a single instanced draw, recorded through an
+// ImDrawList callback so it composites in ImGui's pass in draw order.
+// Everything but the recording callback runs on the thread that builds the UI.
+class PolylineRenderer {
+public:
+  static constexpr VkDeviceSize kDefaultPoolSize = VkDeviceSize{64} << 20;
+  // Records of every Draw call in flight share this ring
+  static constexpr uint32_t kRecordRingSize = 1u << 14;
+
+  // queued_frames is how many built frames can wait ahead of FrameRender
+  VkResult Init(VulkanContext *v, uint32_t queued_frames,
+                VkDeviceSize pool_size = kDefaultPoolSize);
+  // Waits for the device to go idle
+  void Destroy();
+
+  // Returns UINT32_MAX when the pool is full
+  uint32_t AddTrace(uint32_t capacity);
+  // The trace's samples are reused once no queued frame can draw them
+  void RemoveTrace(uint32_t trace);
+  uint32_t GetCapacity(uint32_t trace) const { return traces_[trace].capacity; }
+
+  // Brings a trace up to sample total. history holds samples [total - count, total), at least
+  // every sample since the previous call. When every ring is still drawn by a queued frame the
+  // trace catches up on a later call and draws stay a frame behind.
+  VkResult WriteSamples(uint32_t trace, uint64_t total, const float *history, uint32_t count);
+
+  void Draw(ImDrawList *list, const polylineTrace *traces, uint32_t count);
+
+private:
+  // Matches polylineRecord in polyline.vert
+  struct gpuRecord {
+    uint32_t first_segment;
+    uint32_t offset;
+    uint32_t capacity;
+    uint32_t start;
+    uint32_t count;
+    uint32_t color;
+    float x;
+    float y;
+    float x_step;
+    float y_scale;
+    float thickness;
+    uint32_t pad;
+  };
+
+  // Copied into the ImDrawList ahead of the records
+  struct callbackHeader {
+    PolylineRenderer *renderer;
+    ImVec2 display_pos;
+    ImVec2 display_size;
+    ImVec2 framebuffer_scale;
+    uint32_t records;
+    uint32_t segments;
+  };
+
+  struct ring {
+    // Holds samples [max(begin, end - capacity), end)
+    uint64_t begin = 0;
+    uint64_t end = 0;
+    // Frame that last draws it, see VulkanContext::GetCompletedFrames
+    uint64_t busy_until = 0;
+  };
+
+  struct trace {
+    // Rings are consecutive, capacity samples each
+    uint64_t offset = BuddyAllocator::kInvalidOffset;
+    uint32_t capacity = 0;
+    // The ring frames draw
+    uint32_t front = 0;
+    std::vector<ring> rings;
+  };
+
+  struct retiredTrace {
+    uint64_t safe_after;
+    uint32_t trace;
+  };
+
+  struct recordSpan {
+    uint64_t frame;
+    uint64_t end;
+  };
+
+  static void RecordCallback(const ImDrawList *list, const ImDrawCmd *cmd);
+  void Record(VkCommandBuffer cmd, const callbackHeader &header, const ImVec4 &clip_rect,
+              const void *records);
+  bool AllocateRecords(uint32_t count, uint64_t *first);
+  VkResult CreatePipeline();
+  void Collect(bool all);
+
+  VulkanContext *v_ = nullptr;
+  uint32_t queued_frames_ = 0;
+  VkDescriptorSetLayout set_layout_ = VK_NULL_HANDLE;
+  VkDescriptorSet descriptor_set_ = VK_NULL_HANDLE;
+  VkPipelineLayout pipeline_layout_ = VK_NULL_HANDLE;
+  VkPipeline pipeline_ = VK_NULL_HANDLE;
+
+  VkBuffer pool_ = VK_NULL_HANDLE;
+  deviceAllocation pool_memory_;
+  BuddyAllocator pool_allocator_;
+  std::vector<trace> traces_;
+  std::vector<uint32_t> free_traces_;
+  std::deque<retiredTrace> retired_;
+
+  // Persistently mapped, written by the recording thread only. Monotonic record counters, the
+  // ring holds [record_tail_, record_head_) modulo kRecordRingSize.
+  VkBuffer records_ = VK_NULL_HANDLE;
+  deviceAllocation records_memory_;
+  uint64_t record_head_ = 0;
+  uint64_t record_tail_ = 0;
+  std::deque<recordSpan> record_spans_;
+
+  // Reused by Draw to build callback data
+  std::vector<uint8_t> scratch_;
+};
@@ -0,0 +1,582 @@
+#include "uploader.hpp"
+#include "platform/log.hpp"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <vulkan/vk_enum_string_helper.h>
+
+namespace {
+
+// Buffer copies have no offset rules, this keeps the staged data vector aligned
+constexpr VkDeviceSize kStagingAlignment = 16;
+
+// vkCmdCopyBufferToImage offsets are multiples of both the texel size and 4, which for 3, 6 or
+// 12 byte texels is not a power of two
+VkDeviceSize ImageStagingAlignment(uint32_t texel_size) {
+  return std::lcm(VkDeviceSize{texel_size}, VkDeviceSize{4});
+}
+
+} // namespace
+
+VkResult Uploader::Init(VkDevice device, const VkAllocationCallbacks *allocator,
+                        DeviceAllocator *memory, uploaderQueue queue, uint32_t graphics_family,
+                        bool timeline) {
+  device_ = device;
+  allocator_ = allocator;
+  memory_ = memory;
+  queue_ = queue;
+  graphics_family_ = graphics_family;
+  shared_families_[0] = graphics_family;
+  shared_families_[1] = queue.family;
+  timeline_enabled_ = timeline;
+
+  VkCommandPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.flags =
+      VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  poolInfo.queueFamilyIndex = queue_.family;
+  VkResult res = vkCreateCommandPool(device_, &poolInfo, allocator_, &pool_);
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error creating upload command pool");
+    return res;
+  }
+
+  if (timeline_enabled_) {
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+    res = vkCreateSemaphore(device_, &semaphoreInfo, allocator_, &timeline_);
+    if (res != VK_SUCCESS) {
+      TE_ERROR("Error creating upload timeline semaphore");
+      return res;
+    }
+  }
+
+  VkBufferCreateInfo bufferInfo{};
+  bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferInfo.size = kStagingSize;
+  bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+  bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  res = memory_->CreateBuffer(bufferInfo, MemoryUsage::Upload, &ring_.buffer, &ring_.memory);
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error creating staging ring");
+    return res;
+  }
+  ring_space_ = RingAllocator(kStagingSize);
+
+  TE_TRACE("Uploader initialized on queue family {}{}", queue_.family,
+           HasDedicatedQueue() ? " (dedicated)" : "");
+  return VK_SUCCESS;
+}
+
+void Uploader::Destroy() {
+  std::lock_guard lock(mutex_);
+  if (has_open_) {
+    DestroyBatch(open_);
+    has_open_ = false;
+  }
+  for (batch &b : in_flight_) {
+    DestroyBatch(b);
+  }
+  in_flight_.clear();
+  for (batch &b : free_batches_) {
+    DestroyBatch(b);
+  }
+  free_batches_.clear();
+  buffer_acquires_.clear();
+  image_acquires_.clear();
+  recorded_buffer_acquires_ = 0;
+  recorded_image_acquires_ = 0;
+
+  if (ring_.buffer != VK_NULL_HANDLE) {
+    vkDestroyBuffer(device_, ring_.buffer, allocator_);
+    memory_->Free(ring_.memory);
+    ring_ = {};
+  }
+  ring_space_ = {};
+  vkDestroySemaphore(device_, timeline_, allocator_);
+  timeline_ = VK_NULL_HANDLE;
+  vkDestroyCommandPool(device_, pool_, allocator_);
+  pool_ = VK_NULL_HANDLE;
+}
+
+void Uploader::DestroyBatch(batch &b) {
+  for (stagingBuffer &temporary : b.temporaries) {
+    vkDestroyBuffer(device_, temporary.buffer, allocator_);
+    memory_->Free(temporary.memory);
+  }
+  vkDestroyFence(device_, b.fence, allocator_);
+  b = {};
+}
+
+VkResult Uploader::UploadBuffer(VkBuffer dst, VkDeviceSize offset, const void *data,
+                                VkDeviceSize size, UploadTicket *ticket) {
+  std::lock_guard lock(mutex_);
+  Collect();
+  return CopyToBuffer(dst, offset, data, size, false, ticket);
+}
+
+void Uploader::ShareBuffer(VkBufferCreateInfo *info) const {
+  if (!HasDedicatedQueue()) {
+    info->sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    return;
+  }
+  info->sharingMode = VK_SHARING_MODE_CONCURRENT;
+  info->queueFamilyIndexCount = 2;
+  info->pQueueFamilyIndices = shared_families_;
+}
+
+VkResult Uploader::UploadSharedBuffer(VkBuffer dst, VkDeviceSize offset, const void *data,
+                                      VkDeviceSize size, UploadTicket *ticket) {
+  std::lock_guard lock(mutex_);
+  Collect();
+  return CopyToBuffer(dst, offset, data, size, true, ticket);
+}
+
+VkResult Uploader::CopyToBuffer(VkBuffer dst, VkDeviceSize offset, const void *data,
+                                VkDeviceSize size, bool shared, UploadTicket *ticket) {
+  VkBuffer src;
+  VkDeviceSize srcOffset;
+  VkResult res = Stage(data, size, kStagingAlignment, &src, &srcOffset);
+  if (res != VK_SUCCESS) {
+    return res;
+  }
+
+  if (shared) {
+    // The range may have been written by an earlier batch or earlier in this one
+    VkBufferMemoryBarrier order{};
+    order.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    order.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    order.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    order.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    order.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    order.buffer = dst;
+    order.offset = offset;
+    order.size = size;
+    vkCmdPipelineBarrier(open_.cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 1, &order, 0, nullptr);
+  }
+
+  VkBufferCopy region{};
+  region.srcOffset = srcOffset;
+  region.dstOffset = offset;
+  region.size = size;
+  vkCmdCopyBuffer(open_.cmd, src, dst, 1, &region);
+
+  bool transfer = HasDedicatedQueue();
+  bool handOver = transfer && !shared;
+  VkBufferMemoryBarrier release{};
+  release.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  release.dstAccessMask = transfer ? 0 : VK_ACCESS_MEMORY_READ_BIT;
+  release.srcQueueFamilyIndex = handOver ? queue_.family : VK_QUEUE_FAMILY_IGNORED;
+  release.dstQueueFamilyIndex = handOver ? graphics_family_ : VK_QUEUE_FAMILY_IGNORED;
+  release.buffer = dst;
+  release.offset = offset;
+  release.size = size;
+  open_.buffer_releases.push_back(release);
+
+  *ticket = open_.value;
+  return VK_SUCCESS;
+}
+
+VkResult Uploader::UploadImage(VkImage dst, uint32_t width, uint32_t height, uint32_t texel_size,
+                               const void *data, VkImageLayout final_layout,
+                               UploadTicket *ticket) {
+  std::lock_guard lock(mutex_);
+  Collect();
+  // The previous contents are discarded
+  return CopyToImage(dst, width, 0, height, texel_size, data, VK_IMAGE_LAYOUT_UNDEFINED,
+                     final_layout, false, ticket);
+}
+
+void Uploader::ShareImage(VkImageCreateInfo *info) const {
+  if (!HasDedicatedQueue()) {
+    info->sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    return;
+  }
+  info->sharingMode = VK_SHARING_MODE_CONCURRENT;
+  info->queueFamilyIndexCount = 2;
+  info->pQueueFamilyIndices = shared_families_;
+}
+
+VkResult Uploader::UploadImageRows(VkImage dst, uint32_t width, uint32_t first_row, uint32_t rows,
+                                   uint32_t texel_size, const void *data,
+                                   VkImageLayout old_layout, VkImageLayout final_layout,
+                                   UploadTicket *ticket) {
+  std::lock_guard lock(mutex_);
+  Collect();
+  return CopyToImage(dst, width, first_row, rows, texel_size, data, old_layout, final_layout,
+                     true, ticket);
+}
+
+VkResult Uploader::CopyToImage(VkImage dst, uint32_t width, uint32_t first_row, uint32_t rows,
+                               uint32_t texel_size, const void *data, VkImageLayout old_layout,
+                               VkImageLayout final_layout, bool shared, UploadTicket *ticket) {
+  VkBuffer src;
+  VkDeviceSize srcOffset;
+  VkDeviceSize size = VkDeviceSize{width} * rows * texel_size;
+  VkResult res = Stage(data, size, ImageStagingAlignment(texel_size), &src, &srcOffset);
+  if (res != VK_SUCCESS) {
+    return res;
+  }
+
+  VkImageSubresourceRange range{};
+  range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  range.levelCount = 1;
+  range.layerCount = 1;
+
+  // An image already copied to in this batch stays in TRANSFER_DST until the batch's releases
+  // and only needs its earlier copies ordered before this one
+  bool inBatch = std::any_of(open_.image_releases.begin(), open_.image_releases.end(),
+                             [dst](const VkImageMemoryBarrier &b) { return b.image == dst; });
+  bool transfer = HasDedicatedQueue();
+  // Rows outside the copy survive unless old_layout is undefined. On the graphics queue the
+  // transition also waits for earlier frames' reads, a transfer queue can't wait on those
+  // stages and relies on the caller's guarantee that no frame still samples the image.
+  bool waitReads = !inBatch && !transfer && old_layout != VK_IMAGE_LAYOUT_UNDEFINED;
+  VkPipelineStageFlags srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+  VkImageMemoryBarrier toTransfer{};
+  toTransfer.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  toTransfer.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  toTransfer.oldLayout = old_layout;
+  toTransfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  toTransfer.image = dst;
+  toTransfer.subresourceRange = range;
+  if (inBatch) {
+    srcStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    toTransfer.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    toTransfer.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  } else if (waitReads) {
+    srcStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    toTransfer.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  }
+  vkCmdPipelineBarrier(open_.cmd, srcStage, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                       nullptr, 1, &toTransfer);
+
+  VkBufferImageCopy region{};
+  region.bufferOffset = srcOffset;
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.layerCount = 1;
+  region.imageOffset = {0, static_cast<int32_t>(first_row), 0};
+  region.imageExtent = {width, rows, 1};
+  vkCmdCopyBufferToImage(open_.cmd, src, dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+  if (!inBatch) {
+    // Shared images only change layout, the frame's wait on the batch makes the writes visible
+    bool handOver = transfer && !shared;
+    VkImageMemoryBarrier release{};
+    release.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    release.dstAccessMask = transfer ? 0 : VK_ACCESS_SHADER_READ_BIT;
+    release.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    release.newLayout = final_layout;
+    release.srcQueueFamilyIndex = handOver ? queue_.family : VK_QUEUE_FAMILY_IGNORED;
+    release.dstQueueFamilyIndex = handOver ? graphics_family_ : VK_QUEUE_FAMILY_IGNORED;
+    release.image = dst;
+    release.subresourceRange = range;
+    open_.image_releases.push_back(release);
+  }
+
+  *ticket = open_.value;
+  return VK_SUCCESS;
+}
+
+VkResult Uploader::Stage(const void *data, VkDeviceSize size, VkDeviceSize alignment,
+                         VkBuffer *buffer, VkDeviceSize *offset) {
+  if (size <= kMaxRingUpload) {
+    // A full ring waits on the uploading thread, never on the render loop
+    while ((*offset = ring_space_.Allocate(size, alignment)) == RingAllocator::kInvalidOffset) {
+      if (has_open_) {
+        VkResult res = SubmitOpen();
+        if (res != VK_SUCCESS) {
+          return res;
+        }
+      }
+      VkResult res = WaitOldest();
+      if (res != VK_SUCCESS) {
+        return res;
+      }
+    }
+    VkResult res = OpenBatch();
+    if (res != VK_SUCCESS) {
+      return res;
+    }
+    std::memcpy(static_cast<char *>(ring_.memory.mapped) + *offset, data, size);
+    *buffer = ring_.buffer;
+    return VK_SUCCESS;
+  }
+
+  VkResult res = OpenBatch();
+  if (res != VK_SUCCESS) {
+    return res;
+  }
+  VkBufferCreateInfo bufferInfo{};
+  bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferInfo.size = size;
+  bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+  bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  stagingBuffer temporary;
+  res = memory_->CreateBuffer(bufferInfo, MemoryUsage::Upload, &temporary.buffer,
+                              &temporary.memory);
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error creating {} byte staging buffer", size);
+    return res;
+  }
+  std::memcpy(temporary.memory.mapped, data, size);
+  open_.temporaries.push_back(temporary);
+  *buffer = temporary.buffer;
+  *offset = 0;
+  return VK_SUCCESS;
+}
+
+VkResult Uploader::OpenBatch() {
+  if (has_open_) {
+    return VK_SUCCESS;
+  }
+
+  if (!free_batches_.empty()) {
+    open_ = std::move(free_batches_.back());
+    free_batches_.pop_back();
+  } else {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = pool_;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    VkResult res = vkAllocateCommandBuffers(device_, &allocInfo, &open_.cmd);
+    if (res != VK_SUCCESS) {
+      TE_ERROR("Error allocating upload command buffer");
+      return res;
+    }
+    if (!timeline_enabled_) {
+      VkFenceCreateInfo fenceInfo{};
+      fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+      res = vkCreateFence(device_, &fenceInfo, allocator_, &open_.fence);
+      if (res != VK_SUCCESS) {
+        TE_ERROR("Error creating upload fence");
+        return res;
+      }
+    }
+  }
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  VkResult res = vkBeginCommandBuffer(open_.cmd, &beginInfo);
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error beginning upload command buffer");
+    return res;
+  }
+  open_.value = next_value_++;
+  has_open_ = true;
+  return VK_SUCCESS;
+}
+
+VkResult Uploader::Flush() {
+  std::lock_guard lock(mutex_);
+  Collect();
+  return has_open_ ? SubmitOpen() : VK_SUCCESS;
+}
+
+VkResult Uploader::SubmitOpen() {
+  bool transfer = HasDedicatedQueue();
+  if (!open_.buffer_releases.empty() || !open_.image_releases.empty()) {
+    // A release only needs the source half, the graphics queue acquire makes the writes
+    // visible. Without an ownership transfer this barrier covers every later submission.
+    vkCmdPipelineBarrier(
+        open_.cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        transfer ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+        0, nullptr, static_cast<uint32_t>(open_.buffer_releases.size()),
+        open_.buffer_releases.data(), static_cast<uint32_t>(open_.image_releases.size()),
+        open_.image_releases.data());
+  }
+
+  VkResult res = vkEndCommandBuffer(open_.cmd);
+  if (res == VK_SUCCESS) {
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &open_.value;
+
+    VkSubmitInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    info.pNext = timeline_enabled_ ? &timelineInfo : nullptr;
+    info.commandBufferCount = 1;
+    info.pCommandBuffers = &open_.cmd;
+    info.signalSemaphoreCount = timeline_enabled_ ? 1 : 0;
+    info.pSignalSemaphores = &timeline_;
+
+    std::unique_lock<std::mutex> queueLock;
+    if (queue_.mutex) {
+      queueLock = std::unique_lock(*queue_.mutex);
+    }
+    res = vkQueueSubmit(queue_.queue, 1, &info, open_.fence);
+  }
+
+  has_open_ = false;
+  open_.ring_end = ring_space_.GetHead();
+  if (res != VK_SUCCESS) {
+    // Out of memory or a lost device. The batch never ran, so its uploads are dropped and only
+    // its own staging space is reused, batches in flight keep theirs until they complete.
+    TE_ERROR("Error submitting upload batch: {}", string_VkResult(res));
+    ring_space_.Rewind(in_flight_.empty() ? 0 : in_flight_.back().ring_end);
+    Recycle(open_);
+    open_ = {};
+    return res;
+  }
+
+  if (transfer) {
+    // Each acquire matches its release exactly, shared resources have none
+    for (VkBufferMemoryBarrier acquire : open_.buffer_releases) {
+      if (acquire.srcQueueFamilyIndex == VK_QUEUE_FAMILY_IGNORED) {
+        continue;
+      }
+      acquire.srcAccessMask = 0;
+      acquire.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+      buffer_acquires_.push_back(acquire);
+    }
+    for (VkImageMemoryBarrier acquire : open_.image_releases) {
+      if (acquire.srcQueueFamilyIndex == VK_QUEUE_FAMILY_IGNORED) {
+        continue;
+      }
+      acquire.srcAccessMask = 0;
+      acquire.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+      image_acquires_.push_back(acquire);
+    }
+  }
+  if (timeline_enabled_) {
+    acquire_value_ = open_.value;
+  }
+  in_flight_.push_back(std::move(open_));
+  open_ = {};
+  return VK_SUCCESS;
+}
+
+void Uploader::Collect() {
+  uint64_t reached = completed_value_;
+  if (timeline_enabled_) {
+    vkGetSemaphoreCounterValue(device_, timeline_, &reached);
+  }
+  while (!in_flight_.empty()) {
+    batch &oldest = in_flight_.front();
+    bool done = timeline_enabled_ ? oldest.value <= reached
+                                  : vkGetFenceStatus(device_, oldest.fence) == VK_SUCCESS;
+    if (!done) {
+      break;
+    }
+    batch finished = std::move(oldest);
+    in_flight_.pop_front();
+    Retire(finished);
+  }
+}
+
+VkResult Uploader::WaitOldest() {
+  if (in_flight_.empty()) {
+    return VK_SUCCESS;
+  }
+  batch &oldest = in_flight_.front();
+  VkResult res;
+  if (timeline_enabled_) {
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &timeline_;
+    waitInfo.pValues = &oldest.value;
+    res = vkWaitSemaphores(device_, &waitInfo, UINT64_MAX);
+  } else {
+    res = vkWaitForFences(device_, 1, &oldest.fence, VK_TRUE, UINT64_MAX);
+  }
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error waiting for upload batch");
+    return res;
+  }
+  Collect();
+  return VK_SUCCESS;
+}
+
+void Uploader::Retire(batch &done) {
+  ring_space_.Release(done.ring_end);
+  completed_value_ = std::max(completed_value_, done.value);
+  Recycle(done);
+}
+
+void Uploader::Recycle(batch &b) {
+  for (stagingBuffer &temporary : b.temporaries) {
+    vkDestroyBuffer(device_, temporary.buffer, allocator_);
+    memory_->Free(temporary.memory);
+  }
+  b.temporaries.clear();
+  b.buffer_releases.clear();
+  b.image_releases.clear();
+  vkResetCommandBuffer(b.cmd, 0);
+  if (b.fence != VK_NULL_HANDLE) {
+    vkResetFences(device_, 1, &b.fence);
+  }
+  free_batches_.push_back(std::move(b));
+}
+
+bool Uploader::IsComplete(UploadTicket ticket) {
+  std::lock_guard lock(mutex_);
+  Collect();
+  return ticket <= completed_value_;
+}
+
+VkResult Uploader::Wait(UploadTicket ticket) {
+  std::lock_guard lock(mutex_);
+  if (has_open_ && ticket >= open_.value) {
+    VkResult res = SubmitOpen();
+    if (res != VK_SUCCESS) {
+      return res;
+    }
+  }
+  Collect();
+  while (ticket > completed_value_ && !in_flight_.empty()) {
+    VkResult res = WaitOldest();
+    if (res != VK_SUCCESS) {
+      return res;
+    }
+  }
+  return VK_SUCCESS;
+}
+
+uint64_t Uploader::RecordAcquires(VkCommandBuffer cmd) {
+  std::lock_guard lock(mutex_);
+  if (!buffer_acquires_.empty() || !image_acquires_.empty()) {
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                         VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr,
+                         static_cast<uint32_t>(buffer_acquires_.size()), buffer_acquires_.data(),
+                         static_cast<uint32_t>(image_acquires_.size()), image_acquires_.data());
+  }
+  recorded_buffer_acquires_ = buffer_acquires_.size();
+  recorded_image_acquires_ = image_acquires_.size();
+  // Every frame waits on the latest batch, a semaphore wait only orders its own submission.
+  // Waiting on a value that has already been reached is free.
+  return acquire_value_;
+}
+
+void Uploader::CommitAcquires() {
+  std::lock_guard lock(mutex_);
+  buffer_acquires_.erase(buffer_acquires_.begin(),
+                         buffer_acquires_.begin() + recorded_buffer_acquires_);
+  image_acquires_.erase(image_acquires_.begin(),
+                        image_acquires_.begin() + recorded_image_acquires_);
+  recorded_buffer_acquires_ = 0;
+  recorded_image_acquires_ = 0;
+}
+
+bool Uploader::HasPendingWork() {
+  std::lock_guard lock(mutex_);
+  return has_open_ || !buffer_acquires_.empty() || !image_acquires_.empty();
+}
+
+VkDeviceSize Uploader::GetRingUsed() {
+  std::lock_guard lock(mutex_);
+  Collect();
+  return ring_space_.GetUsed();
+}
@@ -0,0 +1,145 @@
+#pragma once
+#include "gfx/block-allocator.hpp"
+#include "gfx/device-allocator.hpp"
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+// Completion value of an upload, compare against Uploader::IsComplete
+using UploadTicket = uint64_t;
+
+struct uploaderQueue {
+  VkQueue queue = VK_NULL_HANDLE;
+  uint32_t family = 0;
+  // Held around submissions when the queue is shared with the render loop, nullptr otherwise
+  std::mutex *mutex = nullptr;
+};
+
+// Streams buffer and image data to the GPU through a persistently mapped staging ring. Copies are
+// batched into one submission per frame on the upload queue, which is a dedicated transfer queue
+// where the device has one. Batches signal a timeline semaphore the next frame waits on, and
+// resources cross to the graphics family with a release/acquire ownership transfer.
+// Without timeline semaphores uploads share the graphics queue and batches signal fences.
+// All methods are thread safe.
+class Uploader {
+public:
+  static constexpr VkDeviceSize kStagingSize = VkDeviceSize{32} << 20;
+  // Larger uploads get a temporary staging buffer instead of stalling on the ring
+  static constexpr VkDeviceSize kMaxRingUpload = kStagingSize / 2;
+
+  VkResult Init(VkDevice device, const VkAllocationCallbacks *allocator, DeviceAllocator *memory,
+                uploaderQueue queue, uint32_t graphics_family, bool timeline);
+  void Destroy();
+
+  // dst must be created with TRANSFER_DST usage and must not be in use by the GPU
+  VkResult UploadBuffer(VkBuffer dst, VkDeviceSize offset, const void *data, VkDeviceSize size,
+                        UploadTicket *ticket);
+  // Buffers written in place over their lifetime are shared between the upload and graphics
+  // families like ShareImage's images. Sets the sharing fields of info.
+  void ShareBuffer(VkBufferCreateInfo *info) const;
+  // UploadBuffer for a buffer created with ShareBuffer. The range must not be in use by the GPU,
+  // earlier uploads to it are ordered before this one.
+  VkResult UploadSharedBuffer(VkBuffer dst, VkDeviceSize offset, const void *data,
+                              VkDeviceSize size, UploadTicket *ticket);
+  // Replaces the contents of a single mip, single layer 2D color image of
+  // width * height * texel_size bytes and leaves it in final_layout
+  VkResult UploadImage(VkImage dst, uint32_t width, uint32_t height, uint32_t texel_size,
+                       const void *data, VkImageLayout final_layout, UploadTicket *ticket);
+  // Images updated in place over their lifetime are shared between the upload and graphics
+  // families, so their uploads need no ownership transfer and keep the rows they don't touch.
+  // Sets the sharing fields of info, which must outlive the call that creates the image.
+  void ShareImage(VkImageCreateInfo *info) const;
+  // Replaces rows [first_row, first_row + rows) of a single mip, single layer 2D color image
+  // created with ShareImage and leaves it in final_layout. The image is in old_layout, or still
+  // in transfer from an earlier call in the same batch, and UNDEFINED discards the other rows.
+  // Like any upload destination it must not be in use by the GPU, double buffer images that
+  // frames keep sampling.
+  VkResult UploadImageRows(VkImage dst, uint32_t width, uint32_t first_row, uint32_t rows,
+                           uint32_t texel_size, const void *data, VkImageLayout old_layout,
+                           VkImageLayout final_layout, UploadTicket *ticket);
+
+  // Submits everything recorded since the last flush
+  VkResult Flush();
+  bool IsComplete(UploadTicket ticket);
+  VkResult Wait(UploadTicket ticket);
+
+  // Records the graphics side of the ownership transfers for every batch submitted so far into
+  // a frame's command buffer, outside of any render pass. Returns the timeline value that frame
+  // has to wait on, 0 when there is nothing to wait for.
+  uint64_t RecordAcquires(VkCommandBuffer cmd);
+  // Drops the acquires of the last RecordAcquires once its command buffer has been submitted.
+  // Until then they stay queued, so a frame that fails to submit leaves them to the next one.
+  void CommitAcquires();
+  // True while uploads wait for a frame to flush them or to record their acquires
+  bool HasPendingWork();
+  VkSemaphore GetTimeline() const { return timeline_; }
+
+  bool HasDedicatedQueue() const { return queue_.family != graphics_family_; }
+  VkDeviceSize GetRingUsed();
+
+private:
+  struct stagingBuffer {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    deviceAllocation memory;
+  };
+
+  struct batch {
+    VkCommandBuffer cmd = VK_NULL_HANDLE;
+    VkFence fence = VK_NULL_HANDLE;
+    uint64_t value = 0;
+    // Ring head at submission, the ring is free up to here once the batch completes
+    VkDeviceSize ring_end = 0;
+    std::vector<stagingBuffer> temporaries;
+    std::vector<VkBufferMemoryBarrier> buffer_releases;
+    std::vector<VkImageMemoryBarrier> image_releases;
+  };
+
+  VkResult CopyToBuffer(VkBuffer dst, VkDeviceSize offset, const void *data, VkDeviceSize size,
+                        bool shared, UploadTicket *ticket);
+  VkResult CopyToImage(VkImage dst, uint32_t width, uint32_t first_row, uint32_t rows,
+                       uint32_t texel_size, const void *data, VkImageLayout old_layout,
+                       VkImageLayout final_layout, bool shared, UploadTicket *ticket);
+  VkResult Stage(const void *data, VkDeviceSize size, VkDeviceSize alignment, VkBuffer *buffer,
+                 VkDeviceSize *offset);
+  VkResult OpenBatch();
+  VkResult SubmitOpen();
+  void Collect();
+  VkResult WaitOldest();
+  void Retire(batch &done);
+  // Resets a batch that completed or was never submitted for reuse
+  void Recycle(batch &b);
+  void DestroyBatch(batch &b);
+
+  VkDevice device_ = VK_NULL_HANDLE;
+  const VkAllocationCallbacks *allocator_ = nullptr;
+  DeviceAllocator *memory_ = nullptr;
+  uploaderQueue queue_;
+  uint32_t graphics_family_ = 0;
+  // Queue families of resources created with ShareBuffer and ShareImage
+  uint32_t shared_families_[2] = {};
+  bool timeline_enabled_ = false;
+
+  std::mutex mutex_;
+  VkCommandPool pool_ = VK_NULL_HANDLE;
+  VkSemaphore timeline_ = VK_NULL_HANDLE;
+  stagingBuffer ring_;
+  RingAllocator ring_space_;
+
+  batch open_;
+  bool has_open_ = false;
+  std::deque<batch> in_flight_;
+  std::vector<batch> free_batches_;
+  uint64_t next_value_ = 1;
+  uint64_t completed_value_ = 0;
+
+  // Acquire halves of submitted batches, recorded by the next frame
+  std::vector<VkBufferMemoryBarrier> buffer_acquires_;
+  std::vector<VkImageMemoryBarrier> image_acquires_;
+  // Leading acquires recorded by the last RecordAcquires, later batches append after them
+  size_t recorded_buffer_acquires_ = 0;
+  size_t recorded_image_acquires_ = 0;
+  // Timeline value of the last submitted batch
+  uint64_t acquire_value_ = 0;
+};
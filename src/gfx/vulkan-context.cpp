@@ -1,11 +1,88 @@
 #include "vulkan-context.hpp"
+#include "gfx/pipeline-cache.hpp"
 #include "platform/log.hpp"
+#include "platform/memory-stats.hpp"
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <vulkan/vk_enum_string_helper.h>
 #include <vulkan/vulkan_core.h>
 
-VkResult VulkanContext::Init(GLFWwindow *window) {
+vulkanOpts VulkanContext::FromEnvironment(vulkanOpts opts) {
+  if (const char *mode = std::getenv("OSC_PRESENT_MODE")) {
+    if (std::strcmp(mode, "fifo") == 0) {
+      opts.present_mode = VK_PRESENT_MODE_FIFO_KHR;
+    } else if (std::strcmp(mode, "fifo_relaxed") == 0) {
+      opts.present_mode = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+    } else if (std::strcmp(mode, "mailbox") == 0) {
+      opts.present_mode = VK_PRESENT_MODE_MAILBOX_KHR;
+    } else if (std::strcmp(mode, "immediate") == 0) {
+      opts.present_mode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+    } else {
+      TE_WARN("Unknown OSC_PRESENT_MODE '{}'", mode);
+    }
+  }
+  if (const char *frames = std::getenv("OSC_FRAMES_IN_FLIGHT")) {
+    opts.frames_in_flight = static_cast<uint32_t>(std::strtoul(frames, nullptr, 10));
+  }
+  if (const char *latency = std::getenv("OSC_LATENCY_FIRST")) {
+    opts.latency_first = std::strcmp(latency, "0") != 0;
+  }
+  if (const char *vulkan13 = std::getenv("OSC_VULKAN13")) {
+    opts.allow_vulkan13 = std::strcmp(vulkan13, "0") != 0;
+  }
+  if (const char *capture = std::getenv("OSC_FRAME_CAPTURE")) {
+    opts.frame_capture = capture;
+  }
+  if (const char *device = std::getenv("OSC_DEVICE")) {
+    if (std::strcmp(device, "performance") == 0) {
+      opts.device.policy = DevicePolicy::Performance;
+    } else if (std::strcmp(device, "low_power") == 0) {
+      opts.device.policy = DevicePolicy::LowPower;
+    } else if (std::strcmp(device, "software") == 0) {
+      opts.device.policy = DevicePolicy::Software;
+    } else if (ParseDeviceUuid(device, opts.device.uuid)) {
+      opts.device.policy = DevicePolicy::Pinned;
+    } else {
+      TE_WARN("Unknown OSC_DEVICE '{}', expected a policy or a device UUID", device);
+    }
+  }
+  if (const char *benchmark = std::getenv("OSC_DEVICE_BENCHMARK")) {
+    opts.device.benchmark = std::strcmp(benchmark, "0") != 0;
+  }
+  return opts;
+}
+
+VkResult VulkanContext::Init(GLFWwindow *window, tf::Executor *executor, vulkanOpts opts) {
+  VkResult result = InitInstance(executor, opts);
+  if (result != VK_SUCCESS) {
+    return result;
+  }
+  LoadPipelineCache(opts.pipeline_cache_dir);
+  result = InitDevice();
+  if (result != VK_SUCCESS) {
+    return result;
+  }
+  result = CreatePipelineCache();
+  if (result != VK_SUCCESS) {
+    return result;
+  }
+  return InitWindow(window, opts);
+}
+
+VkResult VulkanContext::InitInstance(tf::Executor *executor, const vulkanOpts &opts) {
+  platform::MemoryScope memoryScope(platform::MemoryTag::Gfx);
+  executor_ = executor;
   swap_chain_rebuild_ = false;
+  headless_ = opts.headless;
+  requested_present_mode_ = opts.present_mode;
+  frames_in_flight_ = std::clamp<uint32_t>(opts.frames_in_flight, 1, kMaxFramesInFlight);
+  latency_first_ = opts.latency_first;
+  allow_vulkan13_ = opts.allow_vulkan13;
+  device_opts_ = opts.device;
 
   VkResult result = CreateInstance();
   if (result != VK_SUCCESS) {
@@ -19,18 +96,49 @@ VkResult VulkanContext::Init(GLFWwindow *window) {
   if (result != VK_SUCCESS) {
     return result;
   }
-  result = CreateLogicalDevice();
+  CheckVulkan13Support();
+  return VK_SUCCESS;
+}
+
+VkResult VulkanContext::InitDevice() {
+  platform::MemoryScope memoryScope(platform::MemoryTag::Gfx);
+  SelectTransferQueue();
+  VkResult result = CreateLogicalDevice();
   if (result != VK_SUCCESS) {
     return result;
   }
-  result = CreateDescriptorPool();
+  result = device_allocator_.Init(device_, physical_device_, allocator_);
   if (result != VK_SUCCESS) {
     return result;
   }
-  result = SetupVulkanWindow(window);
+  uploaderQueue uploadQueue{transfer_queue_, transfer_family_,
+                            transfer_queue_ == queue_ ? &queue_mutex_ : nullptr};
+  result = uploader_.Init(device_, allocator_, &device_allocator_, uploadQueue,
+                          static_cast<uint32_t>(queue_family_), use_vulkan13_);
   if (result != VK_SUCCESS) {
     return result;
   }
+  return CreateDescriptorPool();
+}
+
+VkResult VulkanContext::InitWindow(GLFWwindow *window, const vulkanOpts &opts) {
+  platform::MemoryScope memoryScope(platform::MemoryTag::Gfx);
+  VkResult result = SetupVulkanWindow(window);
+  if (result != VK_SUCCESS) {
+    return result;
+  }
+  result = CreateFrames();
+  if (result != VK_SUCCESS) {
+    return result;
+  }
+  if (opts.frame_capture) {
+    frameCaptureOpts captureOpts;
+    captureOpts.path = opts.frame_capture;
+    captureOpts.format = std::filesystem::path(captureOpts.path).extension() == ".y4m"
+                             ? FrameCaptureFormat::Y4m
+                             : FrameCaptureFormat::Png;
+    result = StartFrameCapture(std::move(captureOpts));
+  }
 
   return result;
 }
@@ -44,6 +152,17 @@ VkResult VulkanContext::CreateInstance() {
   appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
   appInfo.apiVersion = VK_API_VERSION_1_0;
 
+  // vkEnumerateInstanceVersion is missing from 1.0 loaders
+  auto enumerateInstanceVersion = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(
+      vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion"));
+  uint32_t loaderVersion = VK_API_VERSION_1_0;
+  if (allow_vulkan13_ && enumerateInstanceVersion &&
+      enumerateInstanceVersion(&loaderVersion) == VK_SUCCESS &&
+      loaderVersion >= VK_API_VERSION_1_3) {
+    appInfo.apiVersion = VK_API_VERSION_1_3;
+  }
+  api_version_ = appInfo.apiVersion;
+
   VkInstanceCreateInfo createInfo{};
   createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
   createInfo.pApplicationInfo = &appInfo;
@@ -57,8 +176,13 @@ VkResult VulkanContext::CreateInstance() {
 
   std::vector<const char *> requiredExtensions;
 
-  for (uint32_t i = 0; i < glfwExtensionCount; i++) {
-    requiredExtensions.emplace_back(glfwExtensions[i]);
+  if (headless_) {
+    requiredExtensions.emplace_back(VK_KHR_SURFACE_EXTENSION_NAME);
+    requiredExtensions.emplace_back(VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME);
+  } else {
+    for (uint32_t i = 0; i < glfwExtensionCount; i++) {
+      requiredExtensions.emplace_back(glfwExtensions[i]);
+    }
   }
 
 #ifdef __APPLE__
@@ -70,7 +194,7 @@ VkResult VulkanContext::CreateInstance() {
   createInfo.enabledExtensionCount = (uint32_t)requiredExtensions.size();
   createInfo.ppEnabledExtensionNames = requiredExtensions.data();
 
-  VkResult result = vkCreateInstance(&createInfo, nullptr, &instance_);
+  VkResult result = vkCreateInstance(&createInfo, allocator_, &instance_);
   if (result != VK_SUCCESS) {
     TE_CRITICAL("Cannot create Vulkan instance");
     return result;
@@ -80,26 +204,17 @@ VkResult VulkanContext::CreateInstance() {
 }
 
 VkResult VulkanContext::SelectPhysicalDevice() {
-  uint32_t physicalDeviceCount;
-
-  VkResult res = vkEnumeratePhysicalDevices(instance_, &physicalDeviceCount, &physical_devices_[0]);
+  DeviceSelector selector;
+  VkResult res = selector.Probe(instance_, api_version_,
+                                headless_ ? nullptr : glfwGetPhysicalDevicePresentationSupport);
   if (res != VK_SUCCESS) {
-    TE_CRITICAL("Cannot enumerate physical devices");
     return res;
   }
-
-  physical_devices_.resize(physicalDeviceCount);
-  res = vkEnumeratePhysicalDevices(instance_, &physicalDeviceCount, &physical_devices_[0]);
-  TE_TRACE("Found {} VkDevices", physicalDeviceCount);
-
-  for (size_t i = 0; i < physicalDeviceCount; ++i) {
-    physical_device_ = physical_devices_[i];
-    VkPhysicalDeviceProperties deviceProperties;
-    vkGetPhysicalDeviceProperties(physical_device_, &deviceProperties);
-    if (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) {
-      break;
-    }
+  int chosen = selector.Select(device_opts_, allocator_);
+  if (chosen < 0) {
+    return VK_ERROR_INITIALIZATION_FAILED;
   }
+  physical_device_ = selector.GetDevices()[chosen].device;
   TE_TRACE("Physical device successfully selected");
   return VK_SUCCESS;
 }
@@ -125,28 +240,141 @@ VkResult VulkanContext::GetGraphicalQueueIndex() {
   return VK_ERROR_INITIALIZATION_FAILED;
 }
 
+void VulkanContext::SelectTransferQueue() {
+  transfer_family_ = static_cast<uint32_t>(queue_family_);
+  transfer_queue_index_ = 0;
+  // A separate queue needs a semaphore between upload and frame submissions, only the timeline
+  // path has one
+  if (!use_vulkan13_) {
+    TE_TRACE("Uploads share the graphics queue");
+    return;
+  }
+
+  uint32_t familyCount;
+  vkGetPhysicalDeviceQueueFamilyProperties(physical_device_, &familyCount, nullptr);
+  std::vector<VkQueueFamilyProperties> queueFamilyProperties(familyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(physical_device_, &familyCount,
+                                           queueFamilyProperties.data());
+
+  // Prefer a transfer-only family (DMA engine), then an async compute family. Graphics and
+  // compute families implicitly support transfers.
+  uint32_t asyncCompute = UINT32_MAX;
+  for (uint32_t i = 0; i < familyCount; i++) {
+    VkQueueFlags flags = queueFamilyProperties[i].queueFlags;
+    if (i == queue_family_ || (flags & VK_QUEUE_GRAPHICS_BIT) != 0) {
+      continue;
+    }
+    if ((flags & VK_QUEUE_COMPUTE_BIT) == 0 && (flags & VK_QUEUE_TRANSFER_BIT) != 0) {
+      transfer_family_ = i;
+      TE_TRACE("Using dedicated transfer queue family {}", i);
+      return;
+    }
+    if ((flags & VK_QUEUE_COMPUTE_BIT) != 0 && asyncCompute == UINT32_MAX) {
+      asyncCompute = i;
+    }
+  }
+  if (asyncCompute != UINT32_MAX) {
+    transfer_family_ = asyncCompute;
+    TE_TRACE("Using async compute queue family {} for transfers", asyncCompute);
+    return;
+  }
+  // A second graphics queue at least keeps uploads from queueing behind frames
+  if (queueFamilyProperties[queue_family_].queueCount > 1) {
+    transfer_queue_index_ = 1;
+    TE_TRACE("Using a second graphics queue for transfers");
+    return;
+  }
+  TE_TRACE("Uploads share the graphics queue");
+}
+
+void VulkanContext::CheckVulkan13Support() {
+  use_vulkan13_ = false;
+  if (api_version_ < VK_API_VERSION_1_3) {
+    TE_TRACE("Using the Vulkan 1.0 render path");
+    return;
+  }
+
+  VkPhysicalDeviceProperties deviceProperties;
+  vkGetPhysicalDeviceProperties(physical_device_, &deviceProperties);
+  if (deviceProperties.apiVersion < VK_API_VERSION_1_3) {
+    TE_TRACE("Device only supports Vulkan {}.{}, using the 1.0 render path",
+             VK_API_VERSION_MAJOR(deviceProperties.apiVersion),
+             VK_API_VERSION_MINOR(deviceProperties.apiVersion));
+    api_version_ = VK_API_VERSION_1_0;
+    return;
+  }
+
+  VkPhysicalDeviceVulkan13Features features13{};
+  features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+  VkPhysicalDeviceVulkan12Features features12{};
+  features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  features12.pNext = &features13;
+  VkPhysicalDeviceFeatures2 features{};
+  features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features.pNext = &features12;
+  vkGetPhysicalDeviceFeatures2(physical_device_, &features);
+
+  use_vulkan13_ =
+      features13.dynamicRendering && features13.synchronization2 && features12.timelineSemaphore;
+  TE_TRACE("Using the Vulkan {} render path", use_vulkan13_ ? "1.3" : "1.0");
+}
+
 VkResult VulkanContext::CreateLogicalDevice() {
   std::vector<const char *> device_extensions;
   device_extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 
-  float queue_priority = 0.0f;
+  // Budgets are read through vkGetPhysicalDeviceMemoryProperties2, core from 1.1
+  memory_budget_ = false;
+  if (api_version_ >= VK_API_VERSION_1_1) {
+    uint32_t count = 0;
+    vkEnumerateDeviceExtensionProperties(physical_device_, nullptr, &count, nullptr);
+    std::vector<VkExtensionProperties> extensions(count);
+    vkEnumerateDeviceExtensionProperties(physical_device_, nullptr, &count, extensions.data());
+    for (const VkExtensionProperties &extension : extensions) {
+      if (std::strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0) {
+        memory_budget_ = true;
+        device_extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        break;
+      }
+    }
+  }
+
+  float queue_priorities[2] = {0.0f, 0.0f};
+  std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
   VkDeviceQueueCreateInfo queueCreateInfo{};
+  queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
   queueCreateInfo.flags = VkDeviceQueueCreateFlags();
   queueCreateInfo.queueFamilyIndex = static_cast<uint32_t>(queue_family_);
-  queueCreateInfo.queueCount = 1;
-  queueCreateInfo.pQueuePriorities = &queue_priority;
+  queueCreateInfo.queueCount = transfer_queue_index_ + 1;
+  queueCreateInfo.pQueuePriorities = queue_priorities;
+  queueCreateInfos.push_back(queueCreateInfo);
+  if (transfer_family_ != queue_family_) {
+    queueCreateInfo.queueFamilyIndex = transfer_family_;
+    queueCreateInfo.queueCount = 1;
+    queueCreateInfos.push_back(queueCreateInfo);
+  }
+
+  VkPhysicalDeviceVulkan13Features features13{};
+  features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+  features13.dynamicRendering = VK_TRUE;
+  features13.synchronization2 = VK_TRUE;
+  VkPhysicalDeviceVulkan12Features features12{};
+  features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  features12.pNext = &features13;
+  features12.timelineSemaphore = VK_TRUE;
 
   VkDeviceCreateInfo deviceCreateInfo{};
   deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-  deviceCreateInfo.queueCreateInfoCount = 1;
-  deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+  deviceCreateInfo.pNext = use_vulkan13_ ? &features12 : nullptr;
+  deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
+  deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
   deviceCreateInfo.enabledExtensionCount = device_extensions.size();
   deviceCreateInfo.ppEnabledExtensionNames = device_extensions.data();
 
-  VkResult res = vkCreateDevice(physical_device_, &deviceCreateInfo, nullptr, &device_);
-  if (!device_) {
-    TE_ERROR("Error creating logical device");
-    return VK_ERROR_INITIALIZATION_FAILED;
+  VkResult res = vkCreateDevice(physical_device_, &deviceCreateInfo, allocator_, &device_);
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error creating logical device: {}", string_VkResult(res));
+    return res;
   }
   TE_TRACE("Device created successfully");
 
@@ -157,20 +385,54 @@ VkResult VulkanContext::CreateLogicalDevice() {
   }
   TE_TRACE("Queue gained successfully");
 
+  vkGetDeviceQueue(device_, transfer_family_, transfer_queue_index_, &transfer_queue_);
+  if (!transfer_queue_) {
+    TE_ERROR("Error getting transfer queue");
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
   return res;
 }
 
+void VulkanContext::GetHeapUsage(std::vector<platform::deviceHeapUsage> *heaps) {
+  const VkPhysicalDeviceMemoryProperties &properties = device_allocator_.GetMemoryProperties();
+  VkPhysicalDeviceMemoryBudgetPropertiesEXT budget{};
+  budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+  if (memory_budget_) {
+    VkPhysicalDeviceMemoryProperties2 properties2{};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    properties2.pNext = &budget;
+    vkGetPhysicalDeviceMemoryProperties2(physical_device_, &properties2);
+  }
+
+  heaps->resize(properties.memoryHeapCount);
+  for (uint32_t i = 0; i < properties.memoryHeapCount; ++i) {
+    platform::deviceHeapUsage &heap = (*heaps)[i];
+    heap.size = properties.memoryHeaps[i].size;
+    heap.budget = memory_budget_ ? budget.heapBudget[i] : heap.size;
+    heap.usage = memory_budget_ ? budget.heapUsage[i] : 0;
+    heap.reserved = device_allocator_.GetHeapReservedBytes(i);
+    heap.device_local = (properties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+  }
+}
+
 VkResult VulkanContext::CreateDescriptorPool() {
   std::vector<VkDescriptorPoolSize> pool_sizes = {
+      // ImGui's own textures plus SpectrumView::kMaxWaterfalls waterfalls
       {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-       IMGUI_IMPL_VULKAN_MINIMUM_IMAGE_SAMPLER_POOL_SIZE}};
+       IMGUI_IMPL_VULKAN_MINIMUM_IMAGE_SAMPLER_POOL_SIZE + 64},
+      // Polyline sample pool and record ring
+      {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 16}};
 
   VkDescriptorPoolCreateInfo poolCreateInfo{};
+  poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  // ImGui texture descriptor sets are freed individually when textures are replaced
+  poolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
   poolCreateInfo.maxSets = 1000;
   poolCreateInfo.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
   poolCreateInfo.pPoolSizes = pool_sizes.data();
 
-  VkResult res = vkCreateDescriptorPool(device_, &poolCreateInfo, nullptr, &descriptor_pool_);
+  VkResult res = vkCreateDescriptorPool(device_, &poolCreateInfo, allocator_, &descriptor_pool_);
   if (res != VK_SUCCESS) {
     TE_ERROR("Error creating descriptor pool");
     return res;
@@ -179,20 +441,78 @@ VkResult VulkanContext::CreateDescriptorPool() {
   return res;
 }
 
+void VulkanContext::LoadPipelineCache(const char *dir) {
+  if (!dir) {
+    return;
+  }
+  VkPhysicalDeviceProperties deviceProperties;
+  vkGetPhysicalDeviceProperties(physical_device_, &deviceProperties);
+  pipeline_cache_path_ = PipelineCachePath(dir, deviceProperties);
+  pipeline_cache_data_ = LoadPipelineCacheData(pipeline_cache_path_, deviceProperties);
+}
+
+VkResult VulkanContext::CreatePipelineCache() {
+  std::vector<uint8_t> initialData = std::move(pipeline_cache_data_);
+  pipeline_cache_data_.clear();
+
+  VkPipelineCacheCreateInfo createInfo{};
+  createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  createInfo.initialDataSize = initialData.size();
+  createInfo.pInitialData = initialData.data();
+
+  VkResult res = vkCreatePipelineCache(device_, &createInfo, allocator_, &pipeline_cache_);
+  if (res != VK_SUCCESS && !initialData.empty()) {
+    TE_WARN("Driver rejected the stored pipeline cache, starting with an empty one");
+    createInfo.initialDataSize = 0;
+    createInfo.pInitialData = nullptr;
+    res = vkCreatePipelineCache(device_, &createInfo, allocator_, &pipeline_cache_);
+  }
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error creating pipeline cache");
+    return res;
+  }
+  TE_TRACE("Pipeline cache created successfully");
+  return res;
+}
+
+void VulkanContext::SavePipelineCache() {
+  if (pipeline_cache_path_.empty()) {
+    return;
+  }
+
+  size_t size = 0;
+  if (vkGetPipelineCacheData(device_, pipeline_cache_, &size, nullptr) != VK_SUCCESS) {
+    TE_WARN("Error querying pipeline cache size");
+    return;
+  }
+  std::vector<uint8_t> data(size);
+  if (vkGetPipelineCacheData(device_, pipeline_cache_, &size, data.data()) != VK_SUCCESS) {
+    TE_WARN("Error reading pipeline cache data");
+    return;
+  }
+  data.resize(size);
+
+  VkPhysicalDeviceProperties deviceProperties;
+  vkGetPhysicalDeviceProperties(physical_device_, &deviceProperties);
+  SavePipelineCacheData(pipeline_cache_path_, deviceProperties, data);
+}
+
 VkResult VulkanContext::SetupVulkanWindow(GLFWwindow *window) {
   int w;
   int h;
 
   glfwGetFramebufferSize(window, &w, &h);
 
-  min_image_count_ = 2;
-
   const VkFormat requestSurfaceImageFormat[] = {VK_FORMAT_B8G8R8A8_UNORM, VK_FORMAT_R8G8B8A8_UNORM,
                                                 VK_FORMAT_B8G8R8_UNORM, VK_FORMAT_R8G8B8_UNORM};
 
   const VkColorSpaceKHR requestSurfaceColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
 
-  glfwCreateWindowSurface(instance_, window, nullptr, &surface_);
+  if (headless_) {
+    CreateHeadlessSurface();
+  } else {
+    glfwCreateWindowSurface(instance_, window, allocator_, &surface_);
+  }
   if (!surface_) {
     TE_ERROR("Error creating window surface");
     return VK_ERROR_INITIALIZATION_FAILED;
@@ -203,116 +523,876 @@ VkResult VulkanContext::SetupVulkanWindow(GLFWwindow *window) {
       physical_device_, wd.Surface, requestSurfaceImageFormat,
       (size_t)IM_ARRAYSIZE(requestSurfaceImageFormat), requestSurfaceColorSpace);
 
-#ifdef APP_USE_UNLIMITED_FRAME_RATE
-  VkPresentModeKHR present_modes[] = {VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR,
-                                      VK_PRESENT_MODE_FIFO_KHR};
-#else
-  VkPresentModeKHR present_modes[] = {VK_PRESENT_MODE_FIFO_KHR};
-#endif
+  uint32_t modeCount = 0;
+  vkGetPhysicalDeviceSurfacePresentModesKHR(physical_device_, wd.Surface, &modeCount, nullptr);
+  supported_present_modes_.resize(modeCount);
+  vkGetPhysicalDeviceSurfacePresentModesKHR(physical_device_, wd.Surface, &modeCount,
+                                            supported_present_modes_.data());
 
-  wd.PresentMode = ImGui_ImplVulkanH_SelectPresentMode(
-      physical_device_, wd.Surface, &present_modes[0], IM_ARRAYSIZE(present_modes));
+  SelectPresentMode();
+
+  // No render pass or framebuffers, resizing only recreates the swapchain images and views
+  wd.UseDynamicRendering = use_vulkan13_;
+  if (!use_vulkan13_) {
+    VkResult res = CreateRenderPass();
+    if (res != VK_SUCCESS) {
+      return res;
+    }
+  }
 
-  ImGui_ImplVulkanH_CreateOrResizeWindow(instance_, physical_device_, device_, &wd, queue_family_,
-                                         nullptr, w, h, min_image_count_, 0);
+  VkResult res = CreateSwapChain(w, h);
+  if (res != VK_SUCCESS) {
+    return res;
+  }
   TE_TRACE("Vulkan window setup successfully done");
   return VK_SUCCESS;
 }
 
-VkResult VulkanContext::FrameRender(ImDrawData *draw_data) {
-  VkSemaphore imageAcquiredSemaphore = wd.FrameSemaphores[wd.SemaphoreIndex].ImageAcquiredSemaphore;
-  VkSemaphore renderCompleteSemaphore =
-      wd.FrameSemaphores[wd.SemaphoreIndex].RenderCompleteSemaphore;
+VkResult VulkanContext::CreateRenderPass() {
+  VkAttachmentDescription attachment{};
+  attachment.format = wd.SurfaceFormat.format;
+  attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+  VkAttachmentReference colorAttachment{};
+  colorAttachment.attachment = 0;
+  colorAttachment.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+  VkSubpassDescription subpass{};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = 1;
+  subpass.pColorAttachments = &colorAttachment;
+
+  // Orders the layout transition after the acquire semaphore wait
+  VkSubpassDependency dependency{};
+  dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependency.dstSubpass = 0;
+  dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependency.srcAccessMask = 0;
+  dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+  VkRenderPassCreateInfo info{};
+  info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  info.attachmentCount = 1;
+  info.pAttachments = &attachment;
+  info.subpassCount = 1;
+  info.pSubpasses = &subpass;
+  info.dependencyCount = 1;
+  info.pDependencies = &dependency;
+  VkResult res = vkCreateRenderPass(device_, &info, allocator_, &wd.RenderPass);
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error creating render pass");
+    return res;
+  }
+  TE_TRACE("Render pass created successfully");
+  return res;
+}
 
-  VkResult res = vkAcquireNextImageKHR(device_, wd.Swapchain, UINT64_MAX, imageAcquiredSemaphore,
-                                       nullptr, &wd.FrameIndex);
-  if (res == VK_ERROR_OUT_OF_DATE_KHR || res == VK_SUBOPTIMAL_KHR) {
-    swap_chain_rebuild_ = true;
+VkResult VulkanContext::CreateSwapChain(int width, int height) {
+  TE_ZONE("CreateSwapChain");
+  VkSurfaceCapabilitiesKHR caps;
+  VkResult res = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physical_device_, wd.Surface, &caps);
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error getting surface capabilities");
+    return res;
+  }
+
+  uint32_t imageCount = std::max(min_image_count_, caps.minImageCount);
+  if (caps.maxImageCount != 0) {
+    imageCount = std::min(imageCount, caps.maxImageCount);
+  }
+
+  // 0xFFFFFFFF means the surface size follows the swapchain
+  VkExtent2D extent = caps.currentExtent;
+  if (extent.width == UINT32_MAX) {
+    extent.width = std::clamp(static_cast<uint32_t>(width), caps.minImageExtent.width,
+                              caps.maxImageExtent.width);
+    extent.height = std::clamp(static_cast<uint32_t>(height), caps.minImageExtent.height,
+                               caps.maxImageExtent.height);
   }
+
+  VkSwapchainKHR oldSwapchain = wd.Swapchain;
+  VkSwapchainCreateInfoKHR info{};
+  info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+  info.surface = wd.Surface;
+  info.minImageCount = imageCount;
+  info.imageFormat = wd.SurfaceFormat.format;
+  info.imageColorSpace = wd.SurfaceFormat.colorSpace;
+  info.imageExtent = extent;
+  info.imageArrayLayers = 1;
+  // Frame capture copies out of the presented images
+  swapchain_transfer_src_ = (caps.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) != 0;
+  info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                    (swapchain_transfer_src_ ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0);
+  info.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  info.preTransform = (caps.supportedTransforms & VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR)
+                          ? VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR
+                          : caps.currentTransform;
+  info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+  info.presentMode = wd.PresentMode;
+  info.clipped = VK_TRUE;
+  info.oldSwapchain = oldSwapchain;
+
+  // The old swapchain is retired by this call even when it fails, frames already in flight
+  // keep their images and present them normally
+  VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+  res = vkCreateSwapchainKHR(device_, &info, allocator_, &swapchain);
+  RetireSwapChain();
+  wd.Swapchain = swapchain;
   if (res != VK_SUCCESS) {
-    TE_ERROR("Error getting next image in FrameRender");
+    TE_ERROR("Error creating swapchain");
     return res;
   }
+  wd.Width = static_cast<int>(extent.width);
+  wd.Height = static_cast<int>(extent.height);
 
-  ImGui_ImplVulkanH_Frame fd = wd.Frames[wd.FrameIndex];
-  {
-    res = vkWaitForFences(device_, 1, &fd.Fence, VK_TRUE, UINT64_MAX);
+  res = vkGetSwapchainImagesKHR(device_, wd.Swapchain, &imageCount, nullptr);
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error getting swapchain images");
+    return res;
+  }
+  std::vector<VkImage> images(imageCount);
+  vkGetSwapchainImagesKHR(device_, wd.Swapchain, &imageCount, images.data());
+
+  wd.ImageCount = imageCount;
+  wd.SemaphoreCount = imageCount;
+  wd.Frames.resize(static_cast<int>(imageCount), ImGui_ImplVulkanH_Frame());
+  wd.FrameSemaphores.resize(static_cast<int>(imageCount), ImGui_ImplVulkanH_FrameSemaphores());
+  for (uint32_t i = 0; i < imageCount; ++i) {
+    ImGui_ImplVulkanH_Frame &fd = wd.Frames[static_cast<int>(i)];
+    fd.Backbuffer = images[i];
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = fd.Backbuffer;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = wd.SurfaceFormat.format;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    res = vkCreateImageView(device_, &viewInfo, allocator_, &fd.BackbufferView);
     if (res != VK_SUCCESS) {
-      TE_ERROR("Error waiting for fences");
+      TE_ERROR("Error creating swapchain image view");
       return res;
     }
 
-    res = vkResetFences(device_, 1, &fd.Fence);
+    if (!use_vulkan13_) {
+      VkFramebufferCreateInfo framebufferInfo{};
+      framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+      framebufferInfo.renderPass = wd.RenderPass;
+      framebufferInfo.attachmentCount = 1;
+      framebufferInfo.pAttachments = &fd.BackbufferView;
+      framebufferInfo.width = extent.width;
+      framebufferInfo.height = extent.height;
+      framebufferInfo.layers = 1;
+      res = vkCreateFramebuffer(device_, &framebufferInfo, allocator_, &fd.Framebuffer);
+      if (res != VK_SUCCESS) {
+        TE_ERROR("Error creating swapchain framebuffer");
+        return res;
+      }
+    }
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    res = vkCreateSemaphore(device_, &semaphoreInfo, allocator_,
+                            &wd.FrameSemaphores[static_cast<int>(i)].RenderCompleteSemaphore);
     if (res != VK_SUCCESS) {
-      TE_ERROR("Error reseting fences");
+      TE_ERROR("Error creating render complete semaphore");
+      return res;
+    }
+  }
+  wd.FrameIndex = 0;
+
+  TE_TRACE("Swapchain created successfully ({}x{}, {} images)", wd.Width, wd.Height, imageCount);
+  return VK_SUCCESS;
+}
+
+void VulkanContext::RetireSwapChain() {
+  std::vector<VkImageView> views;
+  std::vector<VkFramebuffer> framebuffers;
+  std::vector<VkSemaphore> semaphores;
+  for (int i = 0; i < wd.Frames.Size; ++i) {
+    views.push_back(wd.Frames[i].BackbufferView);
+    framebuffers.push_back(wd.Frames[i].Framebuffer);
+  }
+  for (int i = 0; i < wd.FrameSemaphores.Size; ++i) {
+    semaphores.push_back(wd.FrameSemaphores[i].RenderCompleteSemaphore);
+  }
+  wd.Frames.clear();
+  wd.FrameSemaphores.clear();
+
+  VkSwapchainKHR swapchain = wd.Swapchain;
+  wd.Swapchain = VK_NULL_HANDLE;
+  if (swapchain == VK_NULL_HANDLE && views.empty()) {
+    return;
+  }
+
+  VkDevice device = device_;
+  const VkAllocationCallbacks *allocator = allocator_;
+  DeferDestroy([device, allocator, swapchain, views = std::move(views),
+                framebuffers = std::move(framebuffers), semaphores = std::move(semaphores)] {
+    for (VkFramebuffer framebuffer : framebuffers) {
+      vkDestroyFramebuffer(device, framebuffer, allocator);
+    }
+    for (VkImageView view : views) {
+      vkDestroyImageView(device, view, allocator);
+    }
+    for (VkSemaphore semaphore : semaphores) {
+      vkDestroySemaphore(device, semaphore, allocator);
+    }
+    vkDestroySwapchainKHR(device, swapchain, allocator);
+  });
+}
+
+void VulkanContext::SelectPresentMode() {
+  // FIFO is the only mode every driver has to support
+  VkPresentModeKHR present_modes[] = {requested_present_mode_, VK_PRESENT_MODE_FIFO_KHR};
+  wd.PresentMode = ImGui_ImplVulkanH_SelectPresentMode(
+      physical_device_, wd.Surface, &present_modes[0], IM_ARRAYSIZE(present_modes));
+  if (wd.PresentMode != requested_present_mode_) {
+    TE_WARN("{} is not supported, falling back to {}",
+            string_VkPresentModeKHR(requested_present_mode_),
+            string_VkPresentModeKHR(wd.PresentMode));
+  }
+
+  // Mailbox needs a spare image to replace the queued one without blocking
+  min_image_count_ = wd.PresentMode == VK_PRESENT_MODE_MAILBOX_KHR ? 3 : 2;
+  TE_TRACE("Present mode {} selected", string_VkPresentModeKHR(wd.PresentMode));
+}
+
+void VulkanContext::SetPresentMode(VkPresentModeKHR mode) {
+  if (mode == requested_present_mode_) {
+    return;
+  }
+  requested_present_mode_ = mode;
+  swap_chain_rebuild_ = true;
+}
+
+VkResult VulkanContext::CreateFrames() {
+  frames_.resize(frames_in_flight_);
+  for (frameContext &frame : frames_) {
+    // Secondary pools are created on first use by the thread that owns them
+    frame.thread_pools.resize(executor_ ? executor_->num_workers() + 1 : 1);
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = static_cast<uint32_t>(queue_family_);
+    VkResult res = vkCreateCommandPool(device_, &poolInfo, allocator_, &frame.command_pool);
+    if (res != VK_SUCCESS) {
+      TE_ERROR("Error creating frame command pool");
+      return res;
+    }
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = frame.command_pool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    res = vkAllocateCommandBuffers(device_, &allocInfo, &frame.command_buffer);
+    if (res != VK_SUCCESS) {
+      TE_ERROR("Error allocating frame command buffer");
+      return res;
+    }
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    res = vkCreateFence(device_, &fenceInfo, allocator_, &frame.fence);
+    if (res != VK_SUCCESS) {
+      TE_ERROR("Error creating frame fence");
+      return res;
+    }
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    res = vkCreateSemaphore(device_, &semaphoreInfo, allocator_, &frame.image_acquired);
+    if (res != VK_SUCCESS) {
+      TE_ERROR("Error creating image acquired semaphore");
       return res;
     }
   }
+  frame_slot_ = 0;
+
+  if (use_vulkan13_ && frame_timeline_ == VK_NULL_HANDLE) {
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = frame_number_;
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+    VkResult res = vkCreateSemaphore(device_, &semaphoreInfo, allocator_, &frame_timeline_);
+    if (res != VK_SUCCESS) {
+      TE_ERROR("Error creating frame timeline semaphore");
+      return res;
+    }
+  }
+  TE_TRACE("Created {} frames in flight", frames_in_flight_);
+
+  return gpu_profiler_.Init(device_, physical_device_, queue_family_, frames_in_flight_,
+                            allocator_);
+}
+
+void VulkanContext::DestroyFrames() {
+  for (frameContext &frame : frames_) {
+    for (threadCommandPool &threadPool : frame.thread_pools) {
+      vkDestroyCommandPool(device_, threadPool.pool, allocator_);
+    }
+    vkDestroySemaphore(device_, frame.image_acquired, allocator_);
+    vkDestroyFence(device_, frame.fence, allocator_);
+    vkDestroyCommandPool(device_, frame.command_pool, allocator_);
+  }
+  frames_.clear();
+}
+
+VkResult VulkanContext::SetFramesInFlight(uint32_t count) {
+  count = std::clamp<uint32_t>(count, 1, kMaxFramesInFlight);
+  if (count == frames_in_flight_) {
+    return VK_SUCCESS;
+  }
+
+  vkDeviceWaitIdle(device_);
+  CollectDeferred(true);
+  DestroyFrames();
+  frames_in_flight_ = count;
+  return CreateFrames();
+}
+
+VkResult VulkanContext::StartFrameCapture(frameCaptureOpts opts) {
+  StopFrameCapture();
+  if (!swapchain_transfer_src_) {
+    TE_WARN("Swapchain images can't be copied, frame capture records nothing");
+  }
+  VkExtent2D extent{static_cast<uint32_t>(wd.Width), static_cast<uint32_t>(wd.Height)};
+  return frame_capture_.Start(device_, &device_allocator_, extent, std::move(opts), allocator_);
+}
+
+void VulkanContext::StopFrameCapture() {
+  if (!frame_capture_.IsActive()) {
+    return;
+  }
+  // Every recorded copy has to land before its slot is encoded and freed
+  vkDeviceWaitIdle(device_);
+  frame_capture_.Stop();
+}
+
+void VulkanContext::WaitForPreviousFrame() {
+  WaitForFrame((frame_slot_ + frames_in_flight_ - 1) % frames_in_flight_);
+}
+
+VkResult VulkanContext::WaitForFrame(uint32_t slot) {
+  frameContext &frame = frames_[slot];
+  VkResult res;
+  if (use_vulkan13_) {
+    // Waits for exactly the submission that last used this slot
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &frame_timeline_;
+    waitInfo.pValues = &frame.frame_number;
+    res = vkWaitSemaphores(device_, &waitInfo, UINT64_MAX);
+  } else {
+    res = vkWaitForFences(device_, 1, &frame.fence, VK_TRUE, UINT64_MAX);
+  }
+
+  // Both signals cover every earlier submission on the queue
+  if (res == VK_SUCCESS) {
+    completed_frames_ = std::max<uint64_t>(completed_frames_, frame.frame_number);
+  }
+  return res;
+}
+
+void VulkanContext::DeferDestroy(std::function<void()> destroy) {
+  // Frames up to frame_number_ may still use the resource, the extra frames in flight give the
+  // presentation engine time to release retired swapchain images and semaphores
+  deletion_queue_.push_back({frame_number_ + frames_in_flight_, std::move(destroy)});
+}
+
+void VulkanContext::CollectDeferred(bool all) {
+  while (!deletion_queue_.empty() &&
+         (all || deletion_queue_.front().safe_after <= completed_frames_)) {
+    deletion_queue_.front().destroy();
+    deletion_queue_.pop_front();
+  }
+}
+
+VkResult VulkanContext::CreateHeadlessSurface() {
+  auto createHeadlessSurface = reinterpret_cast<PFN_vkCreateHeadlessSurfaceEXT>(
+      vkGetInstanceProcAddr(instance_, "vkCreateHeadlessSurfaceEXT"));
+  if (!createHeadlessSurface) {
+    TE_ERROR("VK_EXT_headless_surface is not available");
+    return VK_ERROR_EXTENSION_NOT_PRESENT;
+  }
+
+  VkHeadlessSurfaceCreateInfoEXT createInfo{};
+  createInfo.sType = VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT;
+
+  VkResult res = createHeadlessSurface(instance_, &createInfo, allocator_, &surface_);
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error creating headless surface");
+    return res;
+  }
+  TE_TRACE("Headless surface created successfully");
+  return res;
+}
+
+VkResult VulkanContext::FrameRender(ImDrawData *draw_data) {
+  TE_ZONE("FrameRender");
+  frame_submitted_ = false;
+  frameContext &frame = frames_[frame_slot_];
+
+  VkResult res = WaitForFrame(frame_slot_);
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error waiting for frame");
+    return res;
+  }
+  CollectDeferred(false);
+  if (frame_capture_.IsActive()) {
+    frame_capture_.Collect(completed_frames_);
+  }
+
+  // A failed recreation leaves no swapchain until the next ResizeSwapChain succeeds
+  if (wd.Swapchain == VK_NULL_HANDLE) {
+    swap_chain_rebuild_ = true;
+    return VK_ERROR_OUT_OF_DATE_KHR;
+  }
+
+  res = vkAcquireNextImageKHR(device_, wd.Swapchain, UINT64_MAX, frame.image_acquired,
+                              VK_NULL_HANDLE, &wd.FrameIndex);
+  if (res == VK_ERROR_OUT_OF_DATE_KHR) {
+    swap_chain_rebuild_ = true;
+    return res;
+  }
+  // A suboptimal image is still acquired and has to be rendered and presented
+  if (res == VK_SUBOPTIMAL_KHR) {
+    swap_chain_rebuild_ = true;
+  } else if (res != VK_SUCCESS) {
+    TE_ERROR("Error getting next image in FrameRender");
+    return res;
+  }
+
+  VkCommandBuffer cmd = frame.command_buffer;
 
   {
-    res = vkResetCommandPool(device_, fd.CommandPool, 0);
+    res = vkResetCommandPool(device_, frame.command_pool, 0);
     if (res != VK_SUCCESS) {
       TE_ERROR("Error reseting command pool");
+      AbandonFrame(frame);
       return res;
     }
+    for (threadCommandPool &threadPool : frame.thread_pools) {
+      if (threadPool.used > 0) {
+        vkResetCommandPool(device_, threadPool.pool, 0);
+        threadPool.used = 0;
+      }
+    }
 
     VkCommandBufferBeginInfo info{};
     info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     info.flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-    res = vkBeginCommandBuffer(fd.CommandBuffer, &info);
+    res = vkBeginCommandBuffer(cmd, &info);
     if (res != VK_SUCCESS) {
       TE_ERROR("Error begining command buffer");
+      AbandonFrame(frame);
       return res;
     }
+
+    // Uploads recorded since the last frame go out ahead of it
+    res = uploader_.Flush();
+    if (res != VK_SUCCESS) {
+      TE_ERROR("Error flushing uploads");
+      AbandonFrame(frame);
+      return res;
+    }
+    upload_wait_ = uploader_.RecordAcquires(cmd);
+
+    gpu_profiler_.BeginFrame(cmd, frame_slot_);
   }
-  {
-    VkRenderPassBeginInfo info{};
-    info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    info.renderPass = wd.RenderPass;
-    info.framebuffer = fd.Framebuffer;
-    info.renderArea.extent.width = wd.Width;
-    info.renderArea.extent.height = wd.Height;
-    info.clearValueCount = 1;
-    info.pClearValues = &wd.ClearValue;
-    vkCmdBeginRenderPass(fd.CommandBuffer, &info, VK_SUBPASS_CONTENTS_INLINE);
+
+  std::lock_guard layersLock(layers_mutex_);
+  secondary_cmds_.clear();
+  if (!render_layers_.empty()) {
+    res = RecordSecondaries(draw_data);
+    if (res != VK_SUCCESS) {
+      TE_ERROR("Error recording secondary command buffers");
+      AbandonFrame(frame);
+      return res;
+    }
   }
 
-  ImGui_ImplVulkan_RenderDrawData(draw_data, fd.CommandBuffer);
+  if (use_vulkan13_) {
+    RecordDynamicRendering(cmd, draw_data);
+  } else {
+    RecordRenderPass(cmd, draw_data);
+  }
+  if (frame_capture_.IsActive() && swapchain_transfer_src_) {
+    frame_capture_.Record(cmd, wd.Frames[wd.FrameIndex].Backbuffer, wd.SurfaceFormat.format,
+                          {static_cast<uint32_t>(wd.Width), static_cast<uint32_t>(wd.Height)});
+  }
+  gpu_profiler_.EndFrame(cmd);
 
-  vkCmdEndRenderPass(fd.CommandBuffer);
-  {
-    VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    VkSubmitInfo info{};
-    info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    info.waitSemaphoreCount = 1;
-    info.pWaitSemaphores = &imageAcquiredSemaphore;
-    info.pWaitDstStageMask = &wait_stage;
-    info.commandBufferCount = 1;
-    info.pCommandBuffers = &fd.CommandBuffer;
-    info.signalSemaphoreCount = 1;
-    info.pSignalSemaphores = &renderCompleteSemaphore;
+  res = vkEndCommandBuffer(cmd);
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error ending command buffer");
+    AbandonFrame(frame);
+    return res;
+  }
+
+  // Reset only once nothing but the submit that signals it again can fail
+  if (!use_vulkan13_) {
+    res = vkResetFences(device_, 1, &frame.fence);
+    if (res != VK_SUCCESS) {
+      TE_ERROR("Error reseting fences");
+      AbandonFrame(frame);
+      return res;
+    }
+  }
+
+  res = use_vulkan13_ ? Submit2(frame) : Submit(frame);
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error submiting queue");
+    AbandonFrame(frame);
+    return res;
+  }
+  uploader_.CommitAcquires();
+  frame.frame_number = ++frame_number_;
+  if (frame_capture_.IsActive()) {
+    frame_capture_.Submitted(frame.frame_number);
+  }
+
+  frame_submitted_ = true;
+  return VK_SUCCESS;
+}
+
+void VulkanContext::RecordContent(VkCommandBuffer cmd, ImDrawData *draw_data) {
+  if (!secondary_cmds_.empty()) {
+    vkCmdExecuteCommands(cmd, static_cast<uint32_t>(secondary_cmds_.size()),
+                         secondary_cmds_.data());
+    return;
+  }
+  gpu_profiler_.BeginZone(cmd, GpuZone::ImGui);
+  ImGui_ImplVulkan_RenderDrawData(draw_data, cmd);
+  gpu_profiler_.EndZone(cmd, GpuZone::ImGui);
+}
 
-    res = vkEndCommandBuffer(fd.CommandBuffer);
+uint32_t VulkanContext::AddRenderLayer(uint32_t chunks, RenderLayer record) {
+  std::lock_guard lock(layers_mutex_);
+  uint32_t id = next_layer_id_++;
+  render_layers_.push_back({id, std::max<uint32_t>(chunks, 1), std::move(record)});
+  record_graph_dirty_ = true;
+  return id;
+}
+
+void VulkanContext::RemoveRenderLayer(uint32_t id) {
+  std::lock_guard lock(layers_mutex_);
+  std::erase_if(render_layers_, [id](const renderLayer &layer) { return layer.id == id; });
+  record_graph_dirty_ = true;
+}
+
+uint32_t VulkanContext::ThreadPoolIndex() const {
+  int worker = executor_ ? executor_->this_worker_id() : -1;
+  return worker < 0 ? 0 : static_cast<uint32_t>(worker) + 1;
+}
+
+VkResult VulkanContext::BeginSecondary(VkCommandBuffer *cmd) {
+  threadCommandPool &threadPool = frames_[frame_slot_].thread_pools[ThreadPoolIndex()];
+  if (threadPool.pool == VK_NULL_HANDLE) {
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = static_cast<uint32_t>(queue_family_);
+    VkResult res = vkCreateCommandPool(device_, &poolInfo, allocator_, &threadPool.pool);
     if (res != VK_SUCCESS) {
-      TE_ERROR("Error ending command buffer");
+      TE_ERROR("Error creating thread command pool");
       return res;
     }
-    res = vkQueueSubmit(queue_, 1, &info, fd.Fence);
+  }
+  if (threadPool.used == threadPool.secondaries.size()) {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = threadPool.pool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    allocInfo.commandBufferCount = 1;
+    VkCommandBuffer secondary;
+    VkResult res = vkAllocateCommandBuffers(device_, &allocInfo, &secondary);
     if (res != VK_SUCCESS) {
-      TE_ERROR("Error submiting queue");
+      TE_ERROR("Error allocating secondary command buffer");
       return res;
     }
+    threadPool.secondaries.push_back(secondary);
   }
+  *cmd = threadPool.secondaries[threadPool.used++];
+
+  VkCommandBufferBeginInfo info{};
+  info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+               VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+  info.pInheritanceInfo = &inheritance_;
+  return vkBeginCommandBuffer(*cmd, &info);
+}
 
-  return VK_SUCCESS;
+void VulkanContext::BuildRecordGraph() {
+  record_jobs_.clear();
+  for (const renderLayer &layer : render_layers_) {
+    for (uint32_t chunk = 0; chunk < layer.chunks; ++chunk) {
+      record_jobs_.push_back({&layer.record, chunk});
+    }
+  }
+  // ImGui draws last, on top of every layer
+  record_jobs_.push_back({nullptr, 0});
+
+  record_graph_.clear();
+  for (uint32_t i = 0; i < record_jobs_.size(); ++i) {
+    record_graph_.emplace([this, i] { RecordJob(i); });
+  }
+  record_graph_dirty_ = false;
+}
+
+void VulkanContext::RecordJob(uint32_t index) {
+  TE_ZONE("RecordSecondary");
+  VkCommandBuffer secondary;
+  if (BeginSecondary(&secondary) != VK_SUCCESS) {
+    record_failed_ = true;
+    return;
+  }
+
+  const recordJob &job = record_jobs_[index];
+  if (job.record) {
+    (*job.record)(secondary, job.chunk);
+  } else {
+    gpu_profiler_.BeginZone(secondary, GpuZone::ImGui);
+    ImGui_ImplVulkan_RenderDrawData(record_draw_data_, secondary);
+    gpu_profiler_.EndZone(secondary, GpuZone::ImGui);
+  }
+
+  if (vkEndCommandBuffer(secondary) != VK_SUCCESS) {
+    record_failed_ = true;
+  }
+  secondary_cmds_[index] = secondary;
 }
+
+VkResult VulkanContext::RecordSecondaries(ImDrawData *draw_data) {
+  TE_ZONE("RecordSecondaries");
+  inheritance_rendering_ = {};
+  inheritance_rendering_.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+  inheritance_rendering_.colorAttachmentCount = 1;
+  inheritance_rendering_.pColorAttachmentFormats = &wd.SurfaceFormat.format;
+  inheritance_rendering_.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+  inheritance_ = {};
+  inheritance_.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  if (use_vulkan13_) {
+    inheritance_.pNext = &inheritance_rendering_;
+  } else {
+    inheritance_.renderPass = wd.RenderPass;
+    inheritance_.subpass = 0;
+    inheritance_.framebuffer = wd.Frames[wd.FrameIndex].Framebuffer;
+  }
+
+  if (record_graph_dirty_) {
+    BuildRecordGraph();
+  }
+  record_draw_data_ = draw_data;
+  record_failed_ = false;
+  // Filled by index so execution order follows registration order, whichever thread finishes
+  // first
+  secondary_cmds_.assign(record_jobs_.size(), VK_NULL_HANDLE);
+
+  if (!executor_) {
+    for (uint32_t i = 0; i < record_jobs_.size(); ++i) {
+      RecordJob(i);
+    }
+  } else if (executor_->this_worker_id() >= 0) {
+    // Already on a worker in pipelined mode, corun keeps this worker busy on the graph instead
+    // of blocking it
+    executor_->corun(record_graph_);
+  } else {
+    executor_->run(record_graph_).wait();
+  }
+  return record_failed_ ? VK_ERROR_UNKNOWN : VK_SUCCESS;
+}
+
+void VulkanContext::RecordRenderPass(VkCommandBuffer cmd, ImDrawData *draw_data) {
+  VkRenderPassBeginInfo info{};
+  info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+  info.renderPass = wd.RenderPass;
+  info.framebuffer = wd.Frames[wd.FrameIndex].Framebuffer;
+  info.renderArea.extent.width = wd.Width;
+  info.renderArea.extent.height = wd.Height;
+  info.clearValueCount = 1;
+  info.pClearValues = &wd.ClearValue;
+  gpu_profiler_.BeginZone(cmd, GpuZone::RenderPass);
+  vkCmdBeginRenderPass(cmd, &info,
+                       secondary_cmds_.empty() ? VK_SUBPASS_CONTENTS_INLINE
+                                               : VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+  RecordContent(cmd, draw_data);
+  vkCmdEndRenderPass(cmd);
+  gpu_profiler_.EndZone(cmd, GpuZone::RenderPass);
+}
+
+void VulkanContext::RecordDynamicRendering(VkCommandBuffer cmd, ImDrawData *draw_data) {
+  VkImageMemoryBarrier2 barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+  barrier.srcStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+  barrier.srcAccessMask = VK_ACCESS_2_NONE;
+  barrier.dstStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+  barrier.dstAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = wd.Frames[wd.FrameIndex].Backbuffer;
+  barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+  VkDependencyInfo dependency{};
+  dependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+  dependency.imageMemoryBarrierCount = 1;
+  dependency.pImageMemoryBarriers = &barrier;
+  vkCmdPipelineBarrier2(cmd, &dependency);
+
+  VkRenderingAttachmentInfo colorAttachment{};
+  colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+  colorAttachment.imageView = wd.Frames[wd.FrameIndex].BackbufferView;
+  colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  colorAttachment.clearValue = wd.ClearValue;
+
+  VkRenderingInfo renderingInfo{};
+  renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+  renderingInfo.renderArea.extent.width = wd.Width;
+  renderingInfo.renderArea.extent.height = wd.Height;
+  renderingInfo.layerCount = 1;
+  renderingInfo.colorAttachmentCount = 1;
+  renderingInfo.pColorAttachments = &colorAttachment;
+  if (!secondary_cmds_.empty()) {
+    renderingInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+  }
+
+  gpu_profiler_.BeginZone(cmd, GpuZone::RenderPass);
+  vkCmdBeginRendering(cmd, &renderingInfo);
+  RecordContent(cmd, draw_data);
+  vkCmdEndRendering(cmd);
+  gpu_profiler_.EndZone(cmd, GpuZone::RenderPass);
+
+  // Presentation engine reads happen after the render-complete semaphore, no dst stage needed
+  barrier.srcStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+  barrier.srcAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+  barrier.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+  barrier.dstAccessMask = VK_ACCESS_2_NONE;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  vkCmdPipelineBarrier2(cmd, &dependency);
+}
+
+void VulkanContext::AbandonFrame(frameContext &frame) {
+  // The acquired image can't be presented without rendering it, a new swapchain gives it back
+  swap_chain_rebuild_ = true;
+
+  VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+  VkSubmitInfo info{};
+  info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  info.waitSemaphoreCount = 1;
+  info.pWaitSemaphores = &frame.image_acquired;
+  info.pWaitDstStageMask = &waitStage;
+
+  uint64_t signalValue = frame_number_ + 1;
+  VkTimelineSemaphoreSubmitInfo timelineInfo{};
+  VkFence fence = VK_NULL_HANDLE;
+  if (use_vulkan13_) {
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &signalValue;
+    info.pNext = &timelineInfo;
+    info.signalSemaphoreCount = 1;
+    info.pSignalSemaphores = &frame_timeline_;
+  } else {
+    vkResetFences(device_, 1, &frame.fence);
+    fence = frame.fence;
+  }
+
+  VkResult res;
+  {
+    std::lock_guard lock(queue_mutex_);
+    res = vkQueueSubmit(queue_, 1, &info, fence);
+  }
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error releasing an abandoned frame: {}", string_VkResult(res));
+    return;
+  }
+  if (use_vulkan13_) {
+    frame.frame_number = ++frame_number_;
+  }
+}
+
+VkResult VulkanContext::Submit(frameContext &frame) {
+  VkSemaphore renderCompleteSemaphore = wd.FrameSemaphores[wd.FrameIndex].RenderCompleteSemaphore;
+  VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  VkSubmitInfo info{};
+  info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  info.waitSemaphoreCount = 1;
+  info.pWaitSemaphores = &frame.image_acquired;
+  info.pWaitDstStageMask = &wait_stage;
+  info.commandBufferCount = 1;
+  info.pCommandBuffers = &frame.command_buffer;
+  info.signalSemaphoreCount = 1;
+  info.pSignalSemaphores = &renderCompleteSemaphore;
+
+  std::lock_guard lock(queue_mutex_);
+  return vkQueueSubmit(queue_, 1, &info, frame.fence);
+}
+
+VkResult VulkanContext::Submit2(frameContext &frame) {
+  VkSemaphoreSubmitInfo waitInfos[2]{};
+  waitInfos[0].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+  waitInfos[0].semaphore = frame.image_acquired;
+  waitInfos[0].stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+  waitInfos[1].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+  waitInfos[1].semaphore = uploader_.GetTimeline();
+  waitInfos[1].value = upload_wait_;
+  waitInfos[1].stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+  VkSemaphoreSubmitInfo signalInfos[2]{};
+  signalInfos[0].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+  signalInfos[0].semaphore = wd.FrameSemaphores[wd.FrameIndex].RenderCompleteSemaphore;
+  signalInfos[0].stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+  signalInfos[1].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+  signalInfos[1].semaphore = frame_timeline_;
+  signalInfos[1].value = frame_number_ + 1;
+  signalInfos[1].stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+  VkCommandBufferSubmitInfo cmdInfo{};
+  cmdInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+  cmdInfo.commandBuffer = frame.command_buffer;
+
+  VkSubmitInfo2 info{};
+  info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+  info.waitSemaphoreInfoCount = upload_wait_ > 0 ? 2 : 1;
+  info.pWaitSemaphoreInfos = waitInfos;
+  info.commandBufferInfoCount = 1;
+  info.pCommandBufferInfos = &cmdInfo;
+  info.signalSemaphoreInfoCount = 2;
+  info.pSignalSemaphoreInfos = signalInfos;
+
+  std::lock_guard lock(queue_mutex_);
+  return vkQueueSubmit2(queue_, 1, &info, VK_NULL_HANDLE);
+}
+
 VkResult VulkanContext::FramePresent() {
-  if (swap_chain_rebuild_) {
+  TE_ZONE("FramePresent");
+  if (!frame_submitted_) {
     return VK_SUCCESS;
   }
+  frame_submitted_ = false;
+  frame_slot_ = (frame_slot_ + 1) % frames_in_flight_;
+
   VkSemaphore render_complete_semaphore =
-      wd.FrameSemaphores[wd.SemaphoreIndex].RenderCompleteSemaphore;
+      wd.FrameSemaphores[wd.FrameIndex].RenderCompleteSemaphore;
   VkPresentInfoKHR info = {};
   info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
   info.waitSemaphoreCount = 1;
@@ -321,53 +1401,77 @@ VkResult VulkanContext::FramePresent() {
   info.pSwapchains = &wd.Swapchain;
   info.pImageIndices = &wd.FrameIndex;
 
-  VkResult res = vkQueuePresentKHR(queue_, &info);
+  VkResult res;
+  {
+    std::lock_guard lock(queue_mutex_);
+    res = vkQueuePresentKHR(queue_, &info);
+  }
   if (res == VK_ERROR_OUT_OF_DATE_KHR || res == VK_SUBOPTIMAL_KHR) {
     swap_chain_rebuild_ = true;
+    return VK_SUCCESS;
   }
   if (res != VK_SUCCESS) {
     TE_ERROR("Error queueing image for presentation (QueuePresent)");
     return res;
   }
-
-  wd.SemaphoreIndex = (wd.SemaphoreIndex + 1) % wd.SemaphoreCount;
   return VK_SUCCESS;
 }
 
 void VulkanContext::ResizeSwapChain(int width, int height) {
+  TE_ZONE("ResizeSwapChain");
   if (swap_chain_rebuild_ || wd.Width != width || wd.Height != height) {
-    ImGui_ImplVulkan_SetMinImageCount(min_image_count_);
-    ImGui_ImplVulkanH_CreateOrResizeWindow(instance_, physical_device_, device_, &wd, queue_family_,
-                                           nullptr, width, height, min_image_count_, 0);
-    wd.FrameIndex = 0;
-    swap_chain_rebuild_ = false;
+    uint32_t previousMinImageCount = min_image_count_;
+    SelectPresentMode();
+    if (min_image_count_ != previousMinImageCount) {
+      ImGui_ImplVulkan_SetMinImageCount(min_image_count_);
+    }
+    if (CreateSwapChain(width, height) == VK_SUCCESS) {
+      swap_chain_rebuild_ = false;
+    }
   }
 }
 
 VkResult VulkanContext::Terminate() {
   vkDeviceWaitIdle(device_);
-  ImGui_ImplVulkanH_DestroyWindow(instance_, device_, &wd, nullptr);
+  frame_capture_.Stop();
+  DestroyFrames();
+  if (frame_timeline_ != VK_NULL_HANDLE) {
+    vkDestroySemaphore(device_, frame_timeline_, allocator_);
+  }
+  RetireSwapChain();
+  CollectDeferred(true);
+  vkDestroyRenderPass(device_, wd.RenderPass, allocator_);
+  vkDestroySurfaceKHR(instance_, wd.Surface, allocator_);
+
+  gpu_profiler_.Destroy();
+  uploader_.Destroy();
+  device_allocator_.Destroy();
 
   if (descriptor_pool_ == VK_NULL_HANDLE) {
     TE_WARN("Attemted to terminate null Vulkan descriptor pool");
     return VK_ERROR_INITIALIZATION_FAILED;
   }
 
-  vkDestroyDescriptorPool(device_, descriptor_pool_, nullptr);
+  vkDestroyDescriptorPool(device_, descriptor_pool_, allocator_);
+
+  if (pipeline_cache_ != VK_NULL_HANDLE) {
+    SavePipelineCache();
+    vkDestroyPipelineCache(device_, pipeline_cache_, allocator_);
+  }
 
   if (device_ == VK_NULL_HANDLE) {
     TE_WARN("Attemted to terminate null Vulkan device");
     return VK_ERROR_INITIALIZATION_FAILED;
   }
 
-  vkDestroyDevice(device_, nullptr);
+  vkDestroyDevice(device_, allocator_);
 
   if (instance_ == VK_NULL_HANDLE) {
     TE_WARN("Attemted to terminate null Vulkan instance");
     return VK_ERROR_INITIALIZATION_FAILED;
   }
 
-  vkDestroyInstance(instance_, nullptr);
+  vkDestroyInstance(instance_, allocator_);
 
   TE_TRACE("Vulkan successfully terminated");
   return VK_SUCCESS;
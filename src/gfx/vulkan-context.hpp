@@ -1,18 +1,92 @@
 #pragma once
 #define GLFW_INCLUDE_VULKAN
 #include "GLFW/glfw3.h"
+#include "gfx/device-allocator.hpp"
+#include "gfx/device-selector.hpp"
+#include "gfx/frame-capture.hpp"
+#include "gfx/gpu-profiler.hpp"
+#include "gfx/host-allocator.hpp"
+#include "gfx/uploader.hpp"
+#include "platform/memory-telemetry.hpp"
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
 #include <imgui_impl_vulkan.h>
+#include <mutex>
+#include <string>
+#include <taskflow/taskflow.hpp>
 #include <vector>
 
+struct vulkanOpts {
+  // Render through a VK_EXT_headless_surface instead of a window system surface
+  bool headless = false;
+  // Directory holding the persistent pipeline cache, nullptr disables it
+  const char *pipeline_cache_dir = ".";
+  // Falls back to FIFO when the surface doesn't support the requested mode
+  VkPresentModeKHR present_mode = VK_PRESENT_MODE_FIFO_KHR;
+  uint32_t frames_in_flight = 2;
+  // Wait for the previous frame to finish on the GPU before sampling input
+  bool latency_first = false;
+  // Dynamic rendering, synchronization2 and timeline semaphore pacing where the device has them
+  bool allow_vulkan13 = true;
+  // Records every presented frame from the start, a .y4m path is a video stream and anything
+  // else a directory of PNGs. nullptr doesn't record.
+  const char *frame_capture = nullptr;
+  // Which physical device to run on, every candidate and the reasons for the choice are logged
+  deviceSelectionOpts device;
+};
+
+// Records one chunk of a render layer into a secondary command buffer that continues the frame's
+// render pass. Viewport and scissor are not inherited and have to be set by the recorder.
+using RenderLayer = std::function<void(VkCommandBuffer cmd, uint32_t chunk)>;
+
 class VulkanContext {
 public:
-  VkResult Init(GLFWwindow *window);
+  static constexpr uint32_t kMaxFramesInFlight = 4;
+
+  // Overrides opts with OSC_PRESENT_MODE, OSC_FRAMES_IN_FLIGHT, OSC_LATENCY_FIRST,
+  // OSC_VULKAN13 and OSC_FRAME_CAPTURE
+  static vulkanOpts FromEnvironment(vulkanOpts opts = {});
+
+  // Secondary command buffers are recorded on executor, nullptr records them inline
+  VkResult Init(GLFWwindow *window, tf::Executor *executor, vulkanOpts opts = {});
+  // Init in phases that can overlap other startup work. InitInstance needs glfwInit, after it
+  // LoadPipelineCache (disk) and InitDevice may run concurrently, CreatePipelineCache follows
+  // both and InitWindow comes last.
+  VkResult InitInstance(tf::Executor *executor, const vulkanOpts &opts);
+  void LoadPipelineCache(const char *dir);
+  VkResult InitDevice();
+  VkResult CreatePipelineCache();
+  VkResult InitWindow(GLFWwindow *window, const vulkanOpts &opts);
   VkResult Terminate();
 
   VkResult FrameRender(ImDrawData *draw_data);
   VkResult FramePresent();
 
+  // Recreates the swapchain without draining the GPU, the old one keeps presenting until the
+  // new one replaces it and its resources are destroyed once no frame can reference them
   void ResizeSwapChain(int width, int height);
+  bool NeedsSwapChainRebuild() { return swap_chain_rebuild_; }
+
+  // Takes effect on the next ResizeSwapChain, which rebuilds the swapchain
+  void SetPresentMode(VkPresentModeKHR mode);
+  VkResult SetFramesInFlight(uint32_t count);
+  void SetLatencyFirst(bool enabled) { latency_first_ = enabled; }
+  void WaitForPreviousFrame();
+
+  // Copies each presented frame into a readback ring encoded on its own thread, frames are
+  // dropped rather than waited for when the encoder falls behind. Like SetFramesInFlight these
+  // must not run concurrently with FrameRender.
+  VkResult StartFrameCapture(frameCaptureOpts opts);
+  void StopFrameCapture();
+  const FrameCapture &GetFrameCapture() { return frame_capture_; }
+
+  // Layer chunks are recorded in parallel on the executor, each into its own secondary command
+  // buffer from a per-thread, per-frame pool, and executed in registration order before ImGui.
+  // Without layers ImGui records straight into the primary command buffer.
+  uint32_t AddRenderLayer(uint32_t chunks, RenderLayer record);
+  void RemoveRenderLayer(uint32_t id);
 
   ImGui_ImplVulkanH_Window wd;
 
@@ -22,30 +96,183 @@ public:
   VkInstance GetInstance() { return instance_; }
   size_t GetQueueFamily() { return queue_family_; }
   VkQueue GetQueue() { return queue_; }
+  // Held around every submission and present on GetQueue()
+  std::mutex &GetQueueMutex() { return queue_mutex_; }
+  uint32_t GetTransferFamily() { return transfer_family_; }
   VkDescriptorPool GetDescriptorPool() { return descriptor_pool_; }
+  VkPipelineCache GetPipelineCache() { return pipeline_cache_; }
+  const VkAllocationCallbacks *GetAllocationCallbacks() { return allocator_; }
+  const HostAllocator &GetHostAllocator() { return host_allocator_; }
+  DeviceAllocator &GetDeviceAllocator() { return device_allocator_; }
+  // Uploads are flushed by every FrameRender and complete before that frame executes
+  Uploader &GetUploader() { return uploader_; }
   uint32_t GetMinImageCount() { return min_image_count_; }
+  // ImGui keeps one set of vertex buffers per image, enough for any frames-in-flight setting
+  uint32_t GetImageCount() { return std::max<uint32_t>(wd.ImageCount, kMaxFramesInFlight); }
+  bool IsHeadless() { return headless_; }
+  VkPresentModeKHR GetPresentMode() { return wd.PresentMode; }
+  const std::vector<VkPresentModeKHR> &GetSupportedPresentModes() {
+    return supported_present_modes_;
+  }
+  uint32_t GetFramesInFlight() { return frames_in_flight_; }
+  bool IsLatencyFirst() { return latency_first_; }
+  uint32_t GetApiVersion() { return api_version_; }
+  bool UsesDynamicRendering() { return use_vulkan13_; }
+  // Safe to read from any thread, a resource used by frames up to N can be destroyed once
+  // GetCompletedFrames() reaches N
+  uint64_t GetSubmittedFrames() { return frame_number_; }
+  uint64_t GetCompletedFrames() { return completed_frames_; }
+
+  // GPU time of the most recently completed frame in milliseconds, negative when unavailable
+  double GetGpuFrameTime() { return gpu_profiler_.GetLastTime(GpuZone::Frame); }
+  const GpuProfiler &GetGpuProfiler() { return gpu_profiler_; }
+  // One entry per memory heap. Budget and process usage come from VK_EXT_memory_budget when the
+  // device has it, otherwise the budget is the heap size and only the allocator's share is known.
+  void GetHeapUsage(std::vector<platform::deviceHeapUsage> *heaps);
+  bool HasMemoryBudget() { return memory_budget_; }
 
 private:
   VkResult CreateInstance();
   VkResult SelectPhysicalDevice();
   VkResult GetGraphicalQueueIndex();
+  void SelectTransferQueue();
   VkResult CreateLogicalDevice();
   VkResult CreateCommandPool();
   VkResult CreateDescriptorPool();
+  void SavePipelineCache();
 
   VkResult SetupVulkanWindow(GLFWwindow *window);
+  void SelectPresentMode();
+  VkResult CreateRenderPass();
+  VkResult CreateSwapChain(int width, int height);
+  void RetireSwapChain();
+  void DeferDestroy(std::function<void()> destroy);
+  void CollectDeferred(bool all);
+  VkResult CreateFrames();
+  void DestroyFrames();
+  void CheckVulkan13Support();
+  VkResult WaitForFrame(uint32_t slot);
+  void RecordContent(VkCommandBuffer cmd, ImDrawData *draw_data);
+  void RecordRenderPass(VkCommandBuffer cmd, ImDrawData *draw_data);
+  void RecordDynamicRendering(VkCommandBuffer cmd, ImDrawData *draw_data);
+  VkResult CreateHeadlessSurface();
 
 private:
+  // Reset with its frame and only ever used by one thread
+  struct threadCommandPool {
+    VkCommandPool pool = VK_NULL_HANDLE;
+    std::vector<VkCommandBuffer> secondaries;
+    uint32_t used = 0;
+  };
+
+  // Per frame in flight, independent of the swapchain image count
+  struct frameContext {
+    VkCommandPool command_pool = VK_NULL_HANDLE;
+    VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+    VkFence fence = VK_NULL_HANDLE;
+    VkSemaphore image_acquired = VK_NULL_HANDLE;
+    // frame_number_ of this slot's last submission, also the frame_timeline_ value it signals
+    uint64_t frame_number = 0;
+    // Indexed by ThreadPoolIndex()
+    std::vector<threadCommandPool> thread_pools;
+  };
+
+  struct renderLayer {
+    uint32_t id;
+    uint32_t chunks;
+    RenderLayer record;
+  };
+
+  // nullptr record is the ImGui pass
+  struct recordJob {
+    const RenderLayer *record;
+    uint32_t chunk;
+  };
+
+  uint32_t ThreadPoolIndex() const;
+  VkResult BeginSecondary(VkCommandBuffer *cmd);
+  void BuildRecordGraph();
+  void RecordJob(uint32_t index);
+  VkResult RecordSecondaries(ImDrawData *draw_data);
+
+  // After a failure between acquire and submit: an empty batch consumes image_acquired and
+  // signals the slot's fence or timeline, so the slot's next wait returns and the semaphore can
+  // be reused
+  void AbandonFrame(frameContext &frame);
+  VkResult Submit(frameContext &frame);
+  VkResult Submit2(frameContext &frame);
+
+  // Declared first, every Vulkan object below is created and destroyed through it
+  HostAllocator host_allocator_;
+  const VkAllocationCallbacks *allocator_ = host_allocator_.GetCallbacks();
+  DeviceAllocator device_allocator_;
+
   VkInstance instance_ = VK_NULL_HANDLE;
-  std::vector<VkPhysicalDevice> physical_devices_;
   VkPhysicalDevice physical_device_ = VK_NULL_HANDLE;
   VkDevice device_ = VK_NULL_HANDLE;
   VkSurfaceKHR surface_ = VK_NULL_HANDLE;
   size_t queue_family_;
   VkQueue queue_ = VK_NULL_HANDLE;
+  std::mutex queue_mutex_;
+  // Same family and queue as graphics when the device has no separate queue to spare
+  uint32_t transfer_family_ = 0;
+  uint32_t transfer_queue_index_ = 0;
+  VkQueue transfer_queue_ = VK_NULL_HANDLE;
+  Uploader uploader_;
+  uint64_t upload_wait_ = 0;
   VkDescriptorPool descriptor_pool_ = VK_NULL_HANDLE;
+  VkPipelineCache pipeline_cache_ = VK_NULL_HANDLE;
+  std::string pipeline_cache_path_;
+  // Read by LoadPipelineCache, handed to the driver by CreatePipelineCache
+  std::vector<uint8_t> pipeline_cache_data_;
 
   uint32_t min_image_count_;
 
-  bool swap_chain_rebuild_;
+  // Set by FrameRender/FramePresent on the render worker, read by the main thread
+  std::atomic<bool> swap_chain_rebuild_ = false;
+  bool headless_ = false;
+
+  VkPresentModeKHR requested_present_mode_ = VK_PRESENT_MODE_FIFO_KHR;
+  std::vector<VkPresentModeKHR> supported_present_modes_;
+
+  std::vector<frameContext> frames_;
+  uint32_t frames_in_flight_ = 2;
+  uint32_t frame_slot_ = 0;
+  bool frame_submitted_ = false;
+  bool latency_first_ = false;
+
+  uint32_t api_version_ = VK_API_VERSION_1_0;
+  deviceSelectionOpts device_opts_;
+  bool allow_vulkan13_ = true;
+  bool use_vulkan13_ = false;
+  bool memory_budget_ = false;
+  VkSemaphore frame_timeline_ = VK_NULL_HANDLE;
+  // Frames submitted so far and frames known to have finished on the GPU, written by the render
+  // worker
+  std::atomic<uint64_t> frame_number_ = 0;
+  std::atomic<uint64_t> completed_frames_ = 0;
+
+  struct deferredDestroy {
+    uint64_t safe_after;
+    std::function<void()> destroy;
+  };
+  std::deque<deferredDestroy> deletion_queue_;
+
+  GpuProfiler gpu_profiler_;
+  FrameCapture frame_capture_;
+  // The surface allows copying out of swapchain images
+  bool swapchain_transfer_src_ = false;
+
+  tf::Executor *executor_ = nullptr;
+  std::mutex layers_mutex_;
+  std::vector<renderLayer> render_layers_;
+  uint32_t next_layer_id_ = 0;
+  std::vector<recordJob> record_jobs_;
+  tf::Taskflow record_graph_;
+  bool record_graph_dirty_ = true;
+  ImDrawData *record_draw_data_ = nullptr;
+  std::atomic<bool> record_failed_ = false;
+  VkCommandBufferInheritanceRenderingInfo inheritance_rendering_{};
+  VkCommandBufferInheritanceInfo inheritance_{};
+  std::vector<VkCommandBuffer> secondary_cmds_;
 };
@@ -0,0 +1,238 @@
+#include "ingest/ingest.hpp"
+#include "platform/log.hpp"
+#include "platform/memory-stats.hpp"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace ingest {
+
+uint32_t Ingest::AddChannel(const channelOpts &opts) {
+  platform::MemoryScope memoryScope(platform::MemoryTag::Ingest);
+  auto c = std::make_unique<channel>();
+  if (opts.multi_producer) {
+    c->mpsc = std::make_unique<MpscRing<float>>(opts.capacity);
+  } else {
+    c->spsc = std::make_unique<SpscRing<float>>(opts.capacity);
+  }
+  return Register(std::move(c), opts);
+}
+
+uint32_t Ingest::AddSharedChannel(const channelOpts &opts, const ShmRing &ring) {
+  platform::MemoryScope memoryScope(platform::MemoryTag::Ingest);
+  auto c = std::make_unique<channel>();
+  c->shm = std::make_unique<ShmRing>(ring);
+  return Register(std::move(c), opts);
+}
+
+uint32_t Ingest::Register(std::unique_ptr<channel> c, const channelOpts &opts) {
+  c->name = opts.name;
+  c->history_size = std::max<size_t>(opts.history, 1);
+  c->history.resize(c->history_size * 2);
+  size_t blocks = (c->history_size + kHistoryBlock - 1) / kHistoryBlock;
+  c->history_min.resize(blocks);
+  c->history_max.resize(blocks);
+  c->record.reserve(opts.record);
+  c->pyramid.Reserve(opts.record);
+  if (opts.trigger && !c->spsc) {
+    TE_WARN("Ingest channel '{}' has no single local producer, its trigger is ignored",
+            opts.name);
+  } else if (opts.trigger) {
+    c->trigger = std::make_unique<dsp::TriggerEngine>(*opts.trigger);
+    c->trigger_opts = std::make_unique<TripleBuffer<dsp::triggerOpts>>();
+    c->trigger_events = std::make_unique<SpscRing<dsp::triggerEvent>>(1024);
+    c->trigger_current = *opts.trigger;
+    c->triggers.reserve(kTriggerHistory + 1024);
+  }
+  channels_.push_back(std::move(c));
+  TE_TRACE("Ingest channel '{}' added", opts.name);
+  return static_cast<uint32_t>(channels_.size() - 1);
+}
+
+size_t Ingest::Available(const channel &c) {
+  if (c.spsc) {
+    return c.spsc->Available();
+  }
+  return c.mpsc ? c.mpsc->Available() : c.shm->Available();
+}
+
+uint64_t Ingest::GetOverruns(const channel &c) {
+  if (c.spsc) {
+    return c.spsc->GetOverruns();
+  }
+  return c.mpsc ? c.mpsc->GetOverruns() : c.shm->GetOverruns();
+}
+
+size_t Ingest::Push(uint32_t channel, const float *samples, size_t count) {
+  Ingest::channel &c = *channels_[channel];
+  if (!c.spsc) {
+    return c.mpsc ? c.mpsc->Push(samples, count) : 0;
+  }
+  size_t pushed = c.spsc->Push(samples, count);
+  if (c.trigger) {
+    // Only accepted samples, so event positions match what the consumer counts
+    RunTrigger(c, samples, pushed);
+  }
+  return pushed;
+}
+
+void Ingest::RunTrigger(channel &c, const float *samples, size_t count) {
+  dsp::triggerOpts opts;
+  if (c.trigger_opts->Read(&opts)) {
+    c.trigger->SetOptions(opts);
+  }
+  dsp::triggerEvent events[kTriggerBatch];
+  size_t n = c.trigger->Process(samples, count, events, kTriggerBatch);
+  c.trigger_events->Push(events, n);
+}
+
+void Ingest::SetTrigger(uint32_t channel, const dsp::triggerOpts &opts) {
+  Ingest::channel &c = *channels_[channel];
+  if (c.trigger) {
+    c.trigger_current = opts;
+    c.trigger_opts->Write(opts);
+  }
+}
+
+const dsp::triggerOpts *Ingest::GetTrigger(uint32_t channel) const {
+  const Ingest::channel &c = *channels_[channel];
+  return c.trigger ? &c.trigger_current : nullptr;
+}
+
+void Ingest::Consume() {
+  TE_ZONE("Ingest::Consume");
+  platform::MemoryScope memoryScope(platform::MemoryTag::Ingest);
+  for (auto &c : channels_) {
+    c->cut = Available(*c);
+  }
+
+  for (uint32_t i = 0; i < channels_.size(); ++i) {
+    channel &ch = *channels_[i];
+    auto append = [this, &ch, i](const float *samples, size_t count) {
+      AppendHistory(ch, samples, count);
+      AppendRecord(ch, samples, count);
+      if (capture_) {
+        capture_->Append(i, samples, count);
+      }
+    };
+    if (ch.spsc) {
+      ch.new_samples = ch.spsc->Read(ch.cut, append);
+    } else {
+      ch.new_samples = ch.mpsc ? ch.mpsc->Read(ch.cut, append) : ch.shm->Read(ch.cut, append);
+    }
+    ch.total += ch.new_samples;
+    if (ch.trigger) {
+      DrainTriggers(ch);
+    }
+  }
+}
+
+void Ingest::DrainTriggers(channel &c) {
+  // The producer publishes samples before their events, so events can be ahead of the cut but
+  // never behind it
+  c.trigger_events->Read(c.trigger_events->Available(),
+                         [&c](const dsp::triggerEvent *events, size_t count) {
+                           c.triggers.insert(c.triggers.end(), events, events + count);
+                         });
+  auto end = std::partition_point(c.triggers.begin(), c.triggers.end(),
+                                  [&c](const dsp::triggerEvent &e) { return e.sample < c.total; });
+  size_t visible = static_cast<size_t>(end - c.triggers.begin());
+  if (visible > kTriggerHistory) {
+    c.triggers.erase(c.triggers.begin(), c.triggers.begin() + (visible - kTriggerHistory));
+    visible = kTriggerHistory;
+  }
+  c.visible_triggers = visible;
+}
+
+void Ingest::AppendHistory(channel &c, const float *samples, size_t count) {
+  // Only the newest history_size samples can survive this append
+  if (count > c.history_size) {
+    samples += count - c.history_size;
+    count = c.history_size;
+  }
+  while (count > 0) {
+    size_t start = c.history_head % c.history_size;
+    size_t n = std::min(count, c.history_size - start);
+    std::memcpy(c.history.data() + start, samples, n * sizeof(float));
+    std::memcpy(c.history.data() + start + c.history_size, samples, n * sizeof(float));
+    SummarizeHistory(c, start, n);
+    c.history_head += n;
+    samples += n;
+    count -= n;
+  }
+}
+
+void Ingest::SummarizeHistory(channel &c, size_t start, size_t count) {
+  size_t end = start + count;
+  for (size_t pos = start; pos < end;) {
+    size_t block = pos / kHistoryBlock;
+    size_t blockEnd = std::min(end, (block + 1) * kHistoryBlock);
+    auto [lo, hi] = std::minmax_element(c.history.data() + pos, c.history.data() + blockEnd);
+    // Writes go in order, so a block starts over when its first position is written
+    bool fresh = pos == block * kHistoryBlock;
+    c.history_min[block] = fresh ? *lo : std::min(c.history_min[block], *lo);
+    c.history_max[block] = fresh ? *hi : std::max(c.history_max[block], *hi);
+    pos = blockEnd;
+  }
+}
+
+void Ingest::AppendRecord(channel &c, const float *samples, size_t count) {
+  // Never grows past the reservation, so the pyramid only ever sees appends
+  count = std::min(count, c.record.capacity() - c.record.size());
+  if (count == 0) {
+    return;
+  }
+  c.record.insert(c.record.end(), samples, samples + count);
+  c.pyramid.Append(samples, count);
+}
+
+channelSnapshot Ingest::GetSnapshot(uint32_t channel) const {
+  const Ingest::channel &c = *channels_[channel];
+  channelSnapshot snapshot;
+  snapshot.count = static_cast<size_t>(std::min<uint64_t>(c.history_head, c.history_size));
+  snapshot.samples =
+      c.history.data() + c.history_head % c.history_size + c.history_size - snapshot.count;
+  snapshot.new_samples = c.new_samples;
+  snapshot.total = c.total;
+  snapshot.overruns = GetOverruns(c);
+  if (c.record.capacity() > 0) {
+    snapshot.record = c.record.data();
+    snapshot.pyramid = &c.pyramid;
+  }
+  if (c.visible_triggers > 0) {
+    snapshot.triggers = c.triggers.data();
+    snapshot.trigger_count = c.visible_triggers;
+  }
+  return snapshot;
+}
+
+dsp::plotColumn Ingest::GetHistoryRange(uint32_t channel, uint64_t first, uint64_t last) const {
+  const Ingest::channel &c = *channels_[channel];
+  dsp::plotColumn range{std::numeric_limits<float>::infinity(),
+                        -std::numeric_limits<float>::infinity(), 0.0f};
+  while (first < last) {
+    // At most two spans, split where the ring wraps
+    size_t pos = static_cast<size_t>(first % c.history_size);
+    size_t end = pos + static_cast<size_t>(std::min<uint64_t>(last - first, c.history_size - pos));
+    first += end - pos;
+    while (pos < end) {
+      size_t block = pos / kHistoryBlock;
+      size_t blockStart = block * kHistoryBlock;
+      size_t blockEnd = std::min(blockStart + kHistoryBlock, c.history_size);
+      size_t spanEnd = std::min(end, blockEnd);
+      // The window ends at the head, so a block it covers whole holds a single pass of samples
+      if (pos == blockStart && spanEnd == blockEnd) {
+        range.min = std::min(range.min, c.history_min[block]);
+        range.max = std::max(range.max, c.history_max[block]);
+      } else {
+        auto [lo, hi] = std::minmax_element(c.history.data() + pos, c.history.data() + spanEnd);
+        range.min = std::min(range.min, *lo);
+        range.max = std::max(range.max, *hi);
+      }
+      pos = spanEnd;
+    }
+  }
+  return range;
+}
+
+} // namespace ingest
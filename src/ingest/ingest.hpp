@@ -0,0 +1,137 @@
+#pragma once
+#include "capture/writer.hpp"
+#include "dsp/minmax-pyramid.hpp"
+#include "dsp/trigger.hpp"
+#include "ingest/mpsc-ring.hpp"
+#include "ingest/shm-protocol.hpp"
+#include "ingest/spsc-ring.hpp"
+#include "ingest/triple-buffer.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace ingest {
+
+struct channelOpts {
+  std::string name;
+  // Samples that can arrive between two frames before overruns start, rounded up to a power
+  // of two
+  size_t capacity = size_t{1} << 20;
+  // Samples kept for display
+  size_t history = size_t{1} << 16;
+  // Several acquisition threads push into this channel
+  bool multi_producer = false;
+  // Samples recorded in full for zooming and panning, allocated up front, recording stops once
+  // it is full. 0 disables recording.
+  size_t record = 0;
+  // Runs a trigger engine on the producer thread as samples are pushed. Single producer
+  // channels only.
+  std::optional<dsp::triggerOpts> trigger;
+};
+
+// Consumer view of a channel, valid until the next Consume()
+struct channelSnapshot {
+  // The most recent count samples, oldest first and contiguous
+  const float *samples = nullptr;
+  size_t count = 0;
+  // Samples consumed by the last Consume() and since the channel was added
+  uint64_t new_samples = 0;
+  uint64_t total = 0;
+  // Samples producers dropped because the ring was full
+  uint64_t overruns = 0;
+  // Everything recorded so far and its decimation pyramid, null without recording
+  const float *record = nullptr;
+  const dsp::MinMaxPyramid *pyramid = nullptr;
+  // Latest trigger events inside the consumed samples, oldest first
+  const dsp::triggerEvent *triggers = nullptr;
+  size_t trigger_count = 0;
+};
+
+// Live sample streams from acquisition threads into the frame loop. Every channel has its own
+// bounded ring, producers never lock or allocate and drop samples when the consumer falls
+// behind. The frame loop drains all channels once per frame into per-channel history windows.
+// An idle frame loop only wakes on platform::Wake() or its idle timeout.
+class Ingest {
+public:
+  // Setup only, before producers start, channels are never removed
+  uint32_t AddChannel(const channelOpts &opts);
+  // A channel fed by another process through a shared memory ring, see ShmSource. The ring's
+  // segment has to stay mapped while the channel is consumed.
+  uint32_t AddSharedChannel(const channelOpts &opts, const ShmRing &ring);
+
+  // Producer thread, returns the number of samples accepted. Accepted samples go through the
+  // channel's trigger engine before returning. Shared channels accept nothing here.
+  size_t Push(uint32_t channel, const float *samples, size_t count);
+
+  // Frame loop thread. Reads every channel's publish index before draining any of them, so one
+  // frame sees a single cut across channels.
+  void Consume();
+  // Every consumed sample is also appended to writer under its channel index, nullptr stops
+  void SetCapture(capture::Writer *writer) { capture_ = writer; }
+
+  // Frame loop thread, the producer picks the options up on its next push
+  void SetTrigger(uint32_t channel, const dsp::triggerOpts &opts);
+  // nullptr when the channel has no trigger
+  const dsp::triggerOpts *GetTrigger(uint32_t channel) const;
+
+  channelSnapshot GetSnapshot(uint32_t channel) const;
+  // Min/max of samples [first, last) of the latest snapshot's history by sample index. Whole
+  // blocks come from summaries Consume keeps, so the cost hardly depends on the range.
+  dsp::plotColumn GetHistoryRange(uint32_t channel, uint64_t first, uint64_t last) const;
+  uint32_t GetChannelCount() const { return static_cast<uint32_t>(channels_.size()); }
+  const std::string &GetChannelName(uint32_t channel) const { return channels_[channel]->name; }
+  size_t GetHistorySize(uint32_t channel) const { return channels_[channel]->history_size; }
+
+private:
+  struct channel {
+    std::string name;
+    std::unique_ptr<SpscRing<float>> spsc;
+    std::unique_ptr<MpscRing<float>> mpsc;
+    std::unique_ptr<ShmRing> shm;
+    // Written twice, at i and i + history_size, so the latest window is always contiguous
+    std::vector<float> history;
+    size_t history_size = 0;
+    uint64_t history_head = 0;
+    // Min/max of each kHistoryBlock positions of history, the block being written only covers
+    // what was written since it was started
+    std::vector<float> history_min;
+    std::vector<float> history_max;
+    size_t cut = 0;
+    uint64_t new_samples = 0;
+    uint64_t total = 0;
+    std::vector<float> record;
+    dsp::MinMaxPyramid pyramid;
+    // Producer side engine, the newest options travel to it through a triple buffer and
+    // events come back through a ring
+    std::unique_ptr<dsp::TriggerEngine> trigger;
+    std::unique_ptr<TripleBuffer<dsp::triggerOpts>> trigger_opts;
+    std::unique_ptr<SpscRing<dsp::triggerEvent>> trigger_events;
+    dsp::triggerOpts trigger_current;
+    // Drained events, the ones past total wait for their samples to be consumed
+    std::vector<dsp::triggerEvent> triggers;
+    size_t visible_triggers = 0;
+  };
+
+  static constexpr size_t kHistoryBlock = 256;
+  // Events kept per channel once their samples are consumed
+  static constexpr size_t kTriggerHistory = 64;
+  // Events one push can report, the rest count as dropped
+  static constexpr size_t kTriggerBatch = 256;
+
+  uint32_t Register(std::unique_ptr<channel> c, const channelOpts &opts);
+  static size_t Available(const channel &c);
+  static uint64_t GetOverruns(const channel &c);
+  static void AppendHistory(channel &c, const float *samples, size_t count);
+  static void SummarizeHistory(channel &c, size_t start, size_t count);
+  static void AppendRecord(channel &c, const float *samples, size_t count);
+  static void RunTrigger(channel &c, const float *samples, size_t count);
+  static void DrainTriggers(channel &c);
+
+  std::vector<std::unique_ptr<channel>> channels_;
+  capture::Writer *capture_ = nullptr;
+};
+
+} // namespace ingest
@@ -0,0 +1,120 @@
+#pragma once
+#include "ingest/spsc-ring.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+namespace ingest {
+
+// Bounded multi-producer single-consumer ring. Producers claim a range of slots with one CAS on
+// the head, copy their items in and publish each slot through its sequence number, so a slow
+// producer only holds back the consumer, never the other producers. Full rings drop and count
+// overruns like SpscRing.
+template <typename T> class MpscRing {
+  static_assert(std::is_trivially_copyable_v<T>);
+
+public:
+  // capacity is rounded up to a power of two
+  explicit MpscRing(size_t capacity)
+      : capacity_(RoundUpPow2(capacity)), mask_(capacity_ - 1),
+        data_(std::make_unique<T[]>(capacity_)),
+        sequence_(std::make_unique<std::atomic<uint64_t>[]>(capacity_)) {}
+
+  MpscRing(const MpscRing &) = delete;
+  MpscRing &operator=(const MpscRing &) = delete;
+
+  // Any thread. Returns the number of items pushed, the rest are overruns.
+  size_t Push(const T *items, size_t count) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    size_t pushed;
+    for (;;) {
+      uint64_t tail = tail_.load(std::memory_order_acquire);
+      // Other producers and the consumer moved on since head was read
+      if (tail > head) {
+        head = head_.load(std::memory_order_relaxed);
+        continue;
+      }
+      pushed = std::min<size_t>(count, capacity_ - std::min<size_t>(head - tail, capacity_));
+      if (pushed == 0) {
+        // Only a current head proves the ring full, a stale one is retried
+        uint64_t current = head_.load(std::memory_order_relaxed);
+        if (current == head) {
+          break;
+        }
+        head = current;
+        continue;
+      }
+      // A stale head fails the exchange and is reloaded by it
+      if (head_.compare_exchange_weak(head, head + pushed, std::memory_order_relaxed)) {
+        break;
+      }
+    }
+
+    if (pushed < count) {
+      overruns_.fetch_add(count - pushed, std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < pushed;) {
+      size_t start = (head + i) & mask_;
+      size_t n = std::min(pushed - i, capacity_ - start);
+      std::memcpy(data_.get() + start, items + i, n * sizeof(T));
+      i += n;
+    }
+    // A slot holds position + 1 once written, stale values from the previous lap never match
+    for (size_t i = 0; i < pushed; ++i) {
+      sequence_[(head + i) & mask_].store(head + i + 1, std::memory_order_release);
+    }
+    return pushed;
+  }
+
+  // Consumer thread, same contract as SpscRing::Read. Stops at the first slot a producer is
+  // still writing.
+  template <typename Visit> size_t Read(size_t max, Visit &&visit) {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    size_t count = 0;
+    while (count < max &&
+           sequence_[(tail + count) & mask_].load(std::memory_order_acquire) == tail + count + 1) {
+      ++count;
+    }
+    size_t start = tail & mask_;
+    size_t first = std::min(count, capacity_ - start);
+    if (first > 0) {
+      visit(data_.get() + start, first);
+    }
+    if (count > first) {
+      visit(data_.get(), count - first);
+    }
+    tail_.store(tail + count, std::memory_order_release);
+    return count;
+  }
+
+  size_t Pop(T *out, size_t max) {
+    return Read(max, [&out](const T *items, size_t n) {
+      std::memcpy(out, items, n * sizeof(T));
+      out += n;
+    });
+  }
+
+  // Consumer thread, items claimed so far including ones still being written
+  size_t Available() const {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_relaxed);
+  }
+
+  size_t Capacity() const { return capacity_; }
+  uint64_t GetPushed() const { return head_.load(std::memory_order_relaxed); }
+  uint64_t GetOverruns() const { return overruns_.load(std::memory_order_relaxed); }
+
+private:
+  const size_t capacity_;
+  const size_t mask_;
+  std::unique_ptr<T[]> data_;
+  std::unique_ptr<std::atomic<uint64_t>[]> sequence_;
+  alignas(kCacheLine) std::atomic<uint64_t> head_{0};
+  std::atomic<uint64_t> overruns_{0};
+  alignas(kCacheLine) std::atomic<uint64_t> tail_{0};
+};
+
+} // namespace ingest
@@ -0,0 +1,135 @@
+#pragma once
+// Producer side of the shared memory transport, header only so acquisition daemons can include
+// it without linking osc. Linux only: POSIX shared memory, flock and futex.
+#include "ingest/shm-protocol.hpp"
+#include <climits>
+#include <cstdio>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <string>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+namespace ingest {
+
+// Creates a segment under /dev/shm and streams samples into it. Each channel has one producer
+// thread, Publish may be called from any of them. The segment stays locked while the producer
+// lives, the kernel drops the lock when the process dies however it dies, and that is how the
+// consumer tells a crash from a pause.
+class ShmProducer {
+public:
+  ShmProducer() = default;
+  ~ShmProducer() { Close(); }
+
+  ShmProducer(const ShmProducer &) = delete;
+  ShmProducer &operator=(const ShmProducer &) = delete;
+
+  // name is a POSIX shared memory name like "/osc-daq". A segment left behind by a crashed
+  // producer is replaced, one whose producer is still running fails the call. capacity is
+  // samples per channel, rounded up to a power of two.
+  bool Create(const std::string &name, const std::vector<std::string> &channels,
+              uint32_t capacity) {
+    Close();
+    if (channels.empty() || channels.size() > kShmMaxChannels) {
+      std::fprintf(stderr, "shm: 1 to %u channels per segment\n", kShmMaxChannels);
+      return false;
+    }
+    uint32_t rounded = 1;
+    while (rounded < capacity) {
+      rounded <<= 1;
+    }
+    // A segment whose lock can be taken has no live producer, one whose lock is held does
+    int existing = shm_open(name.c_str(), O_RDWR, 0);
+    if (existing >= 0) {
+      if (flock(existing, LOCK_EX | LOCK_NB) != 0) {
+        std::fprintf(stderr, "shm: %s belongs to a running producer\n", name.c_str());
+        close(existing);
+        return false;
+      }
+      shm_unlink(name.c_str());
+      close(existing);
+    }
+    fd_ = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd_ < 0 || flock(fd_, LOCK_EX | LOCK_NB) != 0) {
+      std::perror("shm: create");
+      Close();
+      return false;
+    }
+    size_ = ShmSegmentBytes(static_cast<uint32_t>(channels.size()), rounded);
+    if (ftruncate(fd_, static_cast<off_t>(size_)) != 0) {
+      std::perror("shm: ftruncate");
+      Close();
+      return false;
+    }
+    void *base = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (base == MAP_FAILED) {
+      std::perror("shm: mmap");
+      Close();
+      return false;
+    }
+    base_ = base;
+    name_ = name;
+
+    // ftruncate zero filled everything, so every ring starts empty
+    header_ = static_cast<shmHeader *>(base_);
+    header_->magic = kShmMagic;
+    header_->version = kShmVersion;
+    header_->channel_count = static_cast<uint32_t>(channels.size());
+    header_->capacity = rounded;
+    for (size_t i = 0; i < channels.size(); ++i) {
+      std::strncpy(header_->names[i], channels[i].c_str(), kShmNameSize - 1);
+      rings_.emplace_back(base_, static_cast<uint32_t>(i), rounded);
+    }
+    // Consumers only trust the header once this is visible
+    header_->state.store(kShmLive, std::memory_order_release);
+    return true;
+  }
+
+  // Returns the number of samples accepted, the rest are counted as overruns
+  size_t Push(uint32_t channel, const float *samples, size_t count) {
+    return rings_[channel].Push(samples, count);
+  }
+
+  // Wakes a sleeping consumer. Once per batch of pushes is enough, the syscall is only made
+  // while the consumer actually sleeps.
+  void Publish() {
+    header_->sequence.fetch_add(1, std::memory_order_seq_cst);
+    if (header_->consumer_waiting.load(std::memory_order_seq_cst) != 0) {
+      syscall(SYS_futex, &header_->sequence, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    }
+  }
+
+  // Marks the segment closed and removes its name, a consumer that has it mapped keeps reading
+  // what is left
+  void Close() {
+    if (header_) {
+      header_->state.store(kShmClosed, std::memory_order_release);
+      Publish();
+    }
+    if (base_) {
+      munmap(base_, size_);
+      shm_unlink(name_.c_str());
+    }
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+    fd_ = -1;
+    base_ = nullptr;
+    header_ = nullptr;
+    size_ = 0;
+    rings_.clear();
+  }
+
+private:
+  int fd_ = -1;
+  void *base_ = nullptr;
+  size_t size_ = 0;
+  shmHeader *header_ = nullptr;
+  std::string name_;
+  std::vector<ShmRing> rings_;
+};
+
+} // namespace ingest
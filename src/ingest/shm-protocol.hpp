@@ -0,0 +1,129 @@
+#pragma once
+// Layout of a shared memory ingest segment and the ring both processes run on it. Producer
+// processes include this and shm-producer.hpp only, nothing else from osc.
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace ingest {
+
+inline constexpr uint32_t kShmMagic = 0x5343534f; // "OSCS"
+inline constexpr uint32_t kShmVersion = 1;
+inline constexpr uint32_t kShmMaxChannels = 64;
+inline constexpr size_t kShmNameSize = 32;
+inline constexpr size_t kShmAlign = 64;
+
+// Set by the producer once the segment is initialized and when it closes it cleanly. A segment
+// whose producer is gone without reaching kShmClosed crashed.
+inline constexpr uint32_t kShmLive = 1;
+inline constexpr uint32_t kShmClosed = 2;
+
+// The counters are shared between processes, which needs them to be lock-free
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+struct shmHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t channel_count;
+  // Samples per channel, a power of two
+  uint32_t capacity;
+  std::atomic<uint32_t> state;
+  // Bumped by every publish, the consumer sleeps on it as a futex word
+  std::atomic<uint32_t> sequence;
+  // Publishes only make the wake syscall while this is set
+  std::atomic<uint32_t> consumer_waiting;
+  uint32_t pad;
+  char names[kShmMaxChannels][kShmNameSize];
+};
+
+struct shmRing {
+  alignas(kShmAlign) std::atomic<uint64_t> head;
+  std::atomic<uint64_t> overruns;
+  alignas(kShmAlign) std::atomic<uint64_t> tail;
+};
+
+inline size_t ShmAlignUp(size_t bytes) { return (bytes + kShmAlign - 1) & ~(kShmAlign - 1); }
+
+// Header, then per channel its ring followed by capacity samples
+inline size_t ShmChannelBytes(uint32_t capacity) {
+  return ShmAlignUp(sizeof(shmRing) + size_t{capacity} * sizeof(float));
+}
+
+inline size_t ShmSegmentBytes(uint32_t channels, uint32_t capacity) {
+  return ShmAlignUp(sizeof(shmHeader)) + size_t{channels} * ShmChannelBytes(capacity);
+}
+
+// View of one channel's ring inside a mapped segment, the same protocol as SpscRing: the
+// producer owns head, the consumer owns tail, and whatever doesn't fit is an overrun.
+class ShmRing {
+public:
+  ShmRing(void *segment, uint32_t channel, uint32_t capacity)
+      : ring_(reinterpret_cast<shmRing *>(static_cast<char *>(segment) +
+                                          ShmAlignUp(sizeof(shmHeader)) +
+                                          channel * ShmChannelBytes(capacity))),
+        data_(reinterpret_cast<float *>(ring_ + 1)), capacity_(capacity), mask_(capacity - 1) {}
+
+  // Producer process
+  size_t Push(const float *samples, size_t count) {
+    uint64_t head = ring_->head.load(std::memory_order_relaxed);
+    if (head + count - cached_tail_ > capacity_) {
+      cached_tail_ = ring_->tail.load(std::memory_order_acquire);
+    }
+    size_t pushed = std::min<size_t>(count, capacity_ - (head - cached_tail_));
+    if (pushed < count) {
+      ring_->overruns.fetch_add(count - pushed, std::memory_order_relaxed);
+    }
+    if (pushed > 0) {
+      size_t start = head & mask_;
+      size_t first = std::min(pushed, capacity_ - start);
+      std::memcpy(data_ + start, samples, first * sizeof(float));
+      std::memcpy(data_, samples + first, (pushed - first) * sizeof(float));
+    }
+    ring_->head.store(head + pushed, std::memory_order_release);
+    return pushed;
+  }
+
+  // Consumer process, same contract as SpscRing::Read. head comes from another process and is
+  // never trusted to be within a lap of tail: what a broken producer claims beyond the ring is
+  // skipped and counted as overruns, a head behind tail resyncs to it.
+  template <typename Visit> size_t Read(size_t max, Visit &&visit) {
+    uint64_t tail = ring_->tail.load(std::memory_order_relaxed);
+    uint64_t head = ring_->head.load(std::memory_order_acquire);
+    if (head < tail) {
+      tail = head;
+    } else if (head - tail > capacity_) {
+      ring_->overruns.fetch_add(head - tail - capacity_, std::memory_order_relaxed);
+      tail = head - capacity_;
+    }
+    size_t count = std::min<size_t>(max, head - tail);
+    size_t start = tail & mask_;
+    size_t first = std::min(count, capacity_ - start);
+    if (first > 0) {
+      visit(data_ + start, first);
+    }
+    if (count > first) {
+      visit(data_, count - first);
+    }
+    ring_->tail.store(tail + count, std::memory_order_release);
+    return count;
+  }
+
+  size_t Available() const {
+    uint64_t head = ring_->head.load(std::memory_order_acquire);
+    uint64_t tail = ring_->tail.load(std::memory_order_relaxed);
+    return head < tail ? 0 : std::min<uint64_t>(head - tail, capacity_);
+  }
+  uint64_t GetOverruns() const { return ring_->overruns.load(std::memory_order_relaxed); }
+
+private:
+  shmRing *ring_;
+  float *data_;
+  size_t capacity_;
+  size_t mask_;
+  uint64_t cached_tail_ = 0;
+};
+
+} // namespace ingest
@@ -0,0 +1,160 @@
+#include "ingest/shm-source.hpp"
+#include "ingest/shm-protocol.hpp"
+#include "platform/log.hpp"
+
+#if defined(__linux__)
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace ingest {
+
+#if defined(__linux__)
+
+namespace {
+
+// Also how often a silent producer is checked for being alive
+constexpr long kWatchTimeoutNs = 100'000'000;
+constexpr std::chrono::milliseconds kWakeInterval{2};
+
+} // namespace
+
+bool ShmSource::Open(const std::string &name, Ingest &ingest, const channelOpts &opts,
+                     std::function<void()> wake) {
+  Close();
+  fd_ = shm_open(name.c_str(), O_RDWR, 0);
+  if (fd_ < 0) {
+    TE_ERROR("Error opening shared memory '{}': {}", name, std::strerror(errno));
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd_, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(shmHeader)) {
+    TE_ERROR("Shared memory '{}' is not an ingest segment", name);
+    Close();
+    return false;
+  }
+  size_ = static_cast<size_t>(st.st_size);
+  void *base = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (base == MAP_FAILED) {
+    TE_ERROR("Error mapping shared memory '{}': {}", name, std::strerror(errno));
+    Close();
+    return false;
+  }
+  base_ = base;
+
+  auto *header = static_cast<shmHeader *>(base_);
+  if (header->state.load(std::memory_order_acquire) != kShmLive || header->magic != kShmMagic ||
+      header->version != kShmVersion || header->channel_count == 0 ||
+      header->channel_count > kShmMaxChannels || header->capacity == 0 ||
+      (header->capacity & (header->capacity - 1)) != 0 ||
+      ShmSegmentBytes(header->channel_count, header->capacity) > size_) {
+    TE_ERROR("Shared memory '{}' is not a live ingest segment", name);
+    Close();
+    return false;
+  }
+
+  name_ = name;
+  std::string prefix = name.front() == '/' ? name.substr(1) : name;
+  for (uint32_t i = 0; i < header->channel_count; ++i) {
+    channelOpts channel = opts;
+    channel.name = prefix + "/" + std::string(header->names[i], strnlen(header->names[i],
+                                                                        kShmNameSize));
+    ingest.AddSharedChannel(channel, ShmRing(base_, i, header->capacity));
+  }
+  wake_ = std::move(wake);
+  alive_.store(true, std::memory_order_release);
+  stop_.store(false, std::memory_order_relaxed);
+  // Read here rather than on the watcher, a publish before the thread starts must still wake
+  uint32_t seen = header->sequence.load(std::memory_order_acquire);
+  watcher_ = std::thread([this, seen] { Watch(seen); });
+  TE_TRACE("Shared memory '{}' opened, {} channels", name, header->channel_count);
+  return true;
+}
+
+bool ShmSource::ProducerGone() {
+  // The producer holds an exclusive lock for as long as its process lives
+  if (flock(fd_, LOCK_EX | LOCK_NB) != 0) {
+    return false;
+  }
+  flock(fd_, LOCK_UN);
+  return true;
+}
+
+void ShmSource::Watch(uint32_t seen) {
+  auto *header = static_cast<shmHeader *>(base_);
+  while (!stop_.load(std::memory_order_acquire)) {
+    // Announce the wait before checking, a publish in between changes the word and the futex
+    // returns at once
+    header->consumer_waiting.store(1, std::memory_order_seq_cst);
+    if (header->sequence.load(std::memory_order_seq_cst) == seen) {
+      timespec timeout{0, kWatchTimeoutNs};
+      syscall(SYS_futex, &header->sequence, FUTEX_WAIT, seen, &timeout, nullptr, 0);
+    }
+    header->consumer_waiting.store(0, std::memory_order_relaxed);
+
+    uint32_t sequence = header->sequence.load(std::memory_order_acquire);
+    bool fresh = sequence != seen;
+    seen = sequence;
+    if (fresh && wake_) {
+      wake_();
+      // Publishes in the meantime coalesce into the next wake, the frame loop drains them all
+      std::this_thread::sleep_for(kWakeInterval);
+    }
+    bool closed = header->state.load(std::memory_order_acquire) == kShmClosed;
+    if (closed || (!fresh && ProducerGone())) {
+      if (closed) {
+        TE_TRACE("Shared memory producer of '{}' closed", name_);
+      } else {
+        TE_WARN("Shared memory producer of '{}' died", name_);
+      }
+      alive_.store(false, std::memory_order_release);
+      if (wake_) {
+        wake_();
+      }
+      return;
+    }
+  }
+}
+
+void ShmSource::Close() {
+  if (watcher_.joinable()) {
+    stop_.store(true, std::memory_order_release);
+    syscall(SYS_futex, &static_cast<shmHeader *>(base_)->sequence, FUTEX_WAKE, INT_MAX, nullptr,
+            nullptr, 0);
+    watcher_.join();
+  }
+  if (base_) {
+    munmap(base_, size_);
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+  fd_ = -1;
+  base_ = nullptr;
+  size_ = 0;
+  alive_.store(false, std::memory_order_release);
+}
+
+#else
+
+bool ShmSource::Open(const std::string &name, Ingest &, const channelOpts &,
+                     std::function<void()>) {
+  TE_ERROR("Shared memory ingest of '{}' needs Linux", name);
+  return false;
+}
+
+void ShmSource::Close() {}
+
+#endif
+
+} // namespace ingest
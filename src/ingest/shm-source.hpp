@@ -0,0 +1,45 @@
+#pragma once
+#include "ingest/ingest.hpp"
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace ingest {
+
+// Consumer side of a shared memory segment created by ShmProducer in another process. Every
+// channel of the segment becomes an Ingest channel whose ring is the one in the segment, so
+// Consume reads the producer's samples in place. A watcher thread sleeps on the segment's futex,
+// calls wake when data arrives and notices when the producer closes or dies.
+class ShmSource {
+public:
+  ShmSource() = default;
+  ~ShmSource() { Close(); }
+
+  ShmSource(const ShmSource &) = delete;
+  ShmSource &operator=(const ShmSource &) = delete;
+
+  // Setup only, like Ingest::AddChannel. Channels are named "segment/channel", opts supplies
+  // history and recording. The source has to outlive every Consume of ingest.
+  bool Open(const std::string &name, Ingest &ingest, const channelOpts &opts,
+            std::function<void()> wake = {});
+  void Close();
+
+  // False once the producer closed the segment or its process is gone
+  bool IsProducerAlive() const { return alive_.load(std::memory_order_acquire); }
+
+private:
+  void Watch(uint32_t seen);
+  bool ProducerGone();
+
+  int fd_ = -1;
+  void *base_ = nullptr;
+  size_t size_ = 0;
+  std::string name_;
+  std::function<void()> wake_;
+  std::thread watcher_;
+  std::atomic<bool> stop_{false};
+  std::atomic<bool> alive_{false};
+};
+
+} // namespace ingest
@@ -0,0 +1,119 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+namespace ingest {
+
+// Producer and consumer indices live on separate cache lines so they don't false share
+inline constexpr size_t kCacheLine = 64;
+
+inline size_t RoundUpPow2(size_t value) {
+  size_t result = 1;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+// Bounded single-producer single-consumer ring. Storage is allocated once in the constructor,
+// pushes never block: whatever doesn't fit is dropped and counted as an overrun. Each side keeps
+// a cached copy of the other side's index and only reloads it when the ring looks full or empty.
+template <typename T> class SpscRing {
+  static_assert(std::is_trivially_copyable_v<T>);
+
+public:
+  // capacity is rounded up to a power of two
+  explicit SpscRing(size_t capacity)
+      : capacity_(RoundUpPow2(capacity)), mask_(capacity_ - 1),
+        data_(std::make_unique<T[]>(capacity_)) {}
+
+  SpscRing(const SpscRing &) = delete;
+  SpscRing &operator=(const SpscRing &) = delete;
+
+  // Producer thread. Returns the number of items pushed, the rest are overruns.
+  size_t Push(const T *items, size_t count) {
+    uint64_t head = producer_.head.load(std::memory_order_relaxed);
+    if (head + count - producer_.cached_tail > capacity_) {
+      producer_.cached_tail = consumer_.tail.load(std::memory_order_acquire);
+    }
+    size_t pushed = std::min<size_t>(count, capacity_ - (head - producer_.cached_tail));
+    if (pushed < count) {
+      producer_.overruns.fetch_add(count - pushed, std::memory_order_relaxed);
+    }
+    CopyIn(head, items, pushed);
+    producer_.head.store(head + pushed, std::memory_order_release);
+    return pushed;
+  }
+
+  // Consumer thread. Calls visit(const T *, size_t) with up to two contiguous spans covering at
+  // most max items and releases them once visit returns. Returns the number of items read.
+  template <typename Visit> size_t Read(size_t max, Visit &&visit) {
+    uint64_t tail = consumer_.tail.load(std::memory_order_relaxed);
+    if (consumer_.cached_head - tail < max) {
+      consumer_.cached_head = producer_.head.load(std::memory_order_acquire);
+    }
+    size_t count = std::min<size_t>(max, consumer_.cached_head - tail);
+    size_t start = tail & mask_;
+    size_t first = std::min(count, capacity_ - start);
+    if (first > 0) {
+      visit(data_.get() + start, first);
+    }
+    if (count > first) {
+      visit(data_.get(), count - first);
+    }
+    consumer_.tail.store(tail + count, std::memory_order_release);
+    return count;
+  }
+
+  size_t Pop(T *out, size_t max) {
+    return Read(max, [&out](const T *items, size_t n) {
+      std::memcpy(out, items, n * sizeof(T));
+      out += n;
+    });
+  }
+
+  // Consumer thread, items published so far
+  size_t Available() const {
+    return producer_.head.load(std::memory_order_acquire) -
+           consumer_.tail.load(std::memory_order_relaxed);
+  }
+
+  size_t Capacity() const { return capacity_; }
+  uint64_t GetPushed() const { return producer_.head.load(std::memory_order_relaxed); }
+  uint64_t GetOverruns() const { return producer_.overruns.load(std::memory_order_relaxed); }
+
+private:
+  void CopyIn(uint64_t head, const T *items, size_t count) {
+    if (count == 0) {
+      return;
+    }
+    size_t start = head & mask_;
+    size_t first = std::min(count, capacity_ - start);
+    std::memcpy(data_.get() + start, items, first * sizeof(T));
+    std::memcpy(data_.get(), items + first, (count - first) * sizeof(T));
+  }
+
+  struct alignas(kCacheLine) producerSide {
+    std::atomic<uint64_t> head{0};
+    uint64_t cached_tail = 0;
+    std::atomic<uint64_t> overruns{0};
+  };
+
+  struct alignas(kCacheLine) consumerSide {
+    std::atomic<uint64_t> tail{0};
+    uint64_t cached_head = 0;
+  };
+
+  const size_t capacity_;
+  const size_t mask_;
+  std::unique_ptr<T[]> data_;
+  producerSide producer_;
+  consumerSide consumer_;
+};
+
+} // namespace ingest
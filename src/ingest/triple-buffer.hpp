@@ -0,0 +1,49 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+namespace ingest {
+
+// Hands the newest value of a setting from one writer thread to one reader thread. Writes never
+// block or fail, a write the reader hasn't picked up yet is replaced. Each side owns one of three
+// slots and they swap through the shared middle slot, so neither ever sees a half written value.
+template <typename T> class TripleBuffer {
+  static_assert(std::is_trivially_copyable_v<T>);
+
+public:
+  TripleBuffer() = default;
+  TripleBuffer(const TripleBuffer &) = delete;
+  TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+  // Writer thread
+  void Write(const T &value) {
+    slots_[back_] = value;
+    uint8_t previous = middle_.exchange(back_ | kFresh, std::memory_order_acq_rel);
+    back_ = previous & kIndex;
+  }
+
+  // Reader thread. Stores the newest value and returns true when one was written since the last
+  // read, returns false and leaves value alone otherwise.
+  bool Read(T *value) {
+    if ((middle_.load(std::memory_order_relaxed) & kFresh) == 0) {
+      return false;
+    }
+    uint8_t previous = middle_.exchange(front_, std::memory_order_acq_rel);
+    front_ = previous & kIndex;
+    *value = slots_[front_];
+    return true;
+  }
+
+private:
+  static constexpr uint8_t kIndex = 3;
+  static constexpr uint8_t kFresh = 4;
+
+  T slots_[3] = {};
+  // Index of the shared slot, kFresh while it holds a write the reader hasn't taken
+  std::atomic<uint8_t> middle_{1};
+  uint8_t front_ = 0;
+  uint8_t back_ = 2;
+};
+
+} // namespace ingest
@@ -1,11 +1,63 @@
 #include "app/application.hpp"
+#include "capture/writer.hpp"
+#include "ingest/shm-source.hpp"
 #include "platform/log.hpp"
+#include "platform/platform.hpp"
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
 
 int main() {
-  platform::Log::Init();
-  platform::windowOpts opts{500, 500, "osc"};
+  platform::Log::Init(platform::Log::FromEnvironment());
+  {
+    platform::windowOpts opts{500, 500, "osc"};
 
-  core::Application app(opts);
-  app.Run();
+    core::Application app(opts, VulkanContext::FromEnvironment());
+    runOpts run_opts;
+    capture::Reader playback;
+    if (const char *path = std::getenv("OSC_PLAYBACK"); path && playback.Open(path)) {
+      run_opts.playback = &playback;
+    }
+    // Comma separated shared memory segments, e.g. OSC_SHM=/osc-gen
+    ingest::Ingest ingest;
+    std::vector<std::unique_ptr<ingest::ShmSource>> sources;
+    if (const char *segments = std::getenv("OSC_SHM")) {
+      std::stringstream list(segments);
+      for (std::string name; std::getline(list, name, ',');) {
+        auto source = std::make_unique<ingest::ShmSource>();
+        if (source->Open(name, ingest, {}, platform::Wake)) {
+          sources.push_back(std::move(source));
+        }
+      }
+      run_opts.ingest = &ingest;
+    }
+    // Records every consumed sample of every channel, e.g. OSC_CAPTURE=session.osc
+    ingest::Ingest &consumed = run_opts.ingest ? *run_opts.ingest : app.GetIngest();
+    capture::Writer capture;
+    if (const char *path = std::getenv("OSC_CAPTURE")) {
+      std::vector<std::string> names;
+      for (uint32_t i = 0; i < consumed.GetChannelCount(); ++i) {
+        names.push_back(consumed.GetChannelName(i));
+      }
+      if (names.empty()) {
+        TE_WARN("OSC_CAPTURE is set but there are no channels to capture");
+      } else if (capture.Open(path, names)) {
+        consumed.SetCapture(&capture);
+      }
+    }
+    app.Run(run_opts);
+    if (capture.IsOpen()) {
+      // The frame loop has stopped consuming, the writer drains its queue and writes the index
+      consumed.SetCapture(nullptr);
+      if (!capture.Close()) {
+        TE_ERROR("Capture is incomplete");
+      } else if (uint64_t dropped = capture.GetDroppedChunks(); dropped > 0) {
+        TE_WARN("Capture dropped {} chunks the disk couldn't keep up with", dropped);
+      }
+    }
+  }
+  platform::Log::Shutdown();
   return 0;
 }
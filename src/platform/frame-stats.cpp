@@ -0,0 +1,33 @@
+#include "frame-stats.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace platform {
+
+void FrameStats::Reserve(size_t frames) {
+  cpu_ms_.reserve(frames);
+  gpu_ms_.reserve(frames);
+}
+
+frameTimeSummary FrameStats::Summarize(const std::vector<double> &samples, size_t skip) {
+  frameTimeSummary summary;
+  if (samples.size() <= skip) {
+    return summary;
+  }
+
+  std::vector<double> sorted(samples.begin() + static_cast<std::ptrdiff_t>(skip), samples.end());
+  std::sort(sorted.begin(), sorted.end());
+
+  summary.samples = sorted.size();
+  summary.min_ms = sorted.front();
+  summary.max_ms = sorted.back();
+  summary.avg_ms = std::accumulate(sorted.begin(), sorted.end(), 0.0) / sorted.size();
+
+  // Nearest-rank percentile
+  size_t rank = static_cast<size_t>(std::ceil(0.99 * sorted.size()));
+  summary.p99_ms = sorted[std::max<size_t>(rank, 1) - 1];
+  return summary;
+}
+
+} // namespace platform
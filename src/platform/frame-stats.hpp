@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+namespace platform {
+
+struct frameTimeSummary {
+  size_t samples = 0;
+  double min_ms = 0.0;
+  double avg_ms = 0.0;
+  double p99_ms = 0.0;
+  double max_ms = 0.0;
+};
+
+class FrameStats {
+public:
+  void Reserve(size_t frames);
+  void AddCpuFrame(double ms) { cpu_ms_.push_back(ms); }
+  void AddGpuFrame(double ms) { gpu_ms_.push_back(ms); }
+
+  // Drops the first `skip` samples so warmup frames don't skew the result
+  frameTimeSummary SummarizeCpu(size_t skip = 0) const { return Summarize(cpu_ms_, skip); }
+  frameTimeSummary SummarizeGpu(size_t skip = 0) const { return Summarize(gpu_ms_, skip); }
+
+private:
+  static frameTimeSummary Summarize(const std::vector<double> &samples, size_t skip);
+
+  std::vector<double> cpu_ms_;
+  std::vector<double> gpu_ms_;
+};
+
+} // namespace platform
@@ -1,32 +1,107 @@
 // app/log.cpp
 #include "log.hpp"
+#include "platform/memory-stats.hpp"
+#include "spdlog/async.h"
+#include "spdlog/async_logger.h"
 #include "spdlog/common.h"
 #include "spdlog/logger.h"
 #include "spdlog/sinks/basic_file_sink.h"
 #include "spdlog/sinks/stdout_color_sinks.h"
 #include "spdlog/spdlog.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 
 namespace platform {
 
 std::shared_ptr<spdlog::logger> Log::s_core_logger;
 std::shared_ptr<spdlog::logger> Log::s_client_logger;
 
-void platform::Log::Init() {
+namespace {
+
+std::shared_ptr<spdlog::logger> MakeLogger(const char *name, std::vector<spdlog::sink_ptr> &sinks,
+                                           const logOpts &opts) {
+  std::shared_ptr<spdlog::logger> logger;
+  if (opts.async) {
+    auto policy = opts.overflow == logOverflow::Block ? spdlog::async_overflow_policy::block
+                                                      : spdlog::async_overflow_policy::discard_new;
+    logger = std::make_shared<spdlog::async_logger>(name, begin(sinks), end(sinks),
+                                                    spdlog::thread_pool(), policy);
+  } else {
+    logger = std::make_shared<spdlog::logger>(name, begin(sinks), end(sinks));
+  }
+  spdlog::register_logger(logger);
+  logger->set_level(opts.level);
+  logger->flush_on(opts.flush_level);
+  return logger;
+}
+
+} // namespace
+
+void platform::Log::Init(logOpts opts) {
+  platform::MemoryScope memoryScope(platform::MemoryTag::Platform);
   std::vector<spdlog::sink_ptr> logSinks;
   logSinks.emplace_back(std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
-  logSinks.emplace_back(std::make_shared<spdlog::sinks::basic_file_sink_mt>("tEngine.log", true));
-
   logSinks[0]->set_pattern("%^[%T] %n: %v%$");
-  logSinks[1]->set_pattern("[%T] [%l] %n: %v");
+  if (opts.file) {
+    logSinks.emplace_back(std::make_shared<spdlog::sinks::basic_file_sink_mt>(opts.file, true));
+    logSinks[1]->set_pattern("[%T] [%l] %n: %v");
+  }
+
+  if (opts.async) {
+    // One worker drains a queue preallocated to queue_size messages, shared by both loggers
+    spdlog::init_thread_pool(opts.queue_size, 1);
+  }
 
-  s_core_logger = std::make_shared<spdlog::logger>("tEngine", begin(logSinks), end(logSinks));
-  spdlog::register_logger(s_core_logger);
-  s_core_logger->set_level(spdlog::level::trace);
-  s_core_logger->flush_on(spdlog::level::trace);
+  s_core_logger = MakeLogger("tEngine", logSinks, opts);
+  s_client_logger = MakeLogger("APP", logSinks, opts);
+
+  if (opts.flush_interval_s > 0) {
+    spdlog::flush_every(std::chrono::seconds(opts.flush_interval_s));
+  }
+  if (opts.unknown_level) {
+    s_core_logger->warn("Unknown OSC_LOG_LEVEL '{}', logging at {}", opts.unknown_level,
+                        spdlog::level::to_string_view(opts.level));
+  }
+}
+
+void platform::Log::Shutdown() {
+  if (size_t dropped = GetDroppedCount(); dropped > 0) {
+    s_core_logger->warn("{} log messages were dropped because the queue was full", dropped);
+  }
+  s_core_logger.reset();
+  s_client_logger.reset();
+  spdlog::shutdown();
+}
+
+logOpts platform::Log::FromEnvironment(logOpts opts) {
+  if (const char *level = std::getenv("OSC_LOG_LEVEL")) {
+    // from_str maps anything it doesn't know to off, which would silence the log
+    spdlog::level::level_enum parsed = spdlog::level::from_str(level);
+    if (parsed != spdlog::level::off || std::strcmp(level, "off") == 0) {
+      opts.level = parsed;
+    } else {
+      opts.unknown_level = level;
+    }
+  }
+  if (const char *file = std::getenv("OSC_LOG_FILE")) {
+    opts.file = *file ? file : nullptr;
+  }
+  if (const char *async = std::getenv("OSC_LOG_ASYNC")) {
+    opts.async = std::strcmp(async, "0") != 0;
+  }
+  if (const char *overflow = std::getenv("OSC_LOG_OVERFLOW")) {
+    opts.overflow = std::strcmp(overflow, "drop") == 0 ? logOverflow::DropAndCount
+                                                       : logOverflow::Block;
+  }
+  return opts;
+}
 
-  s_client_logger = std::make_shared<spdlog::logger>("APP", begin(logSinks), end(logSinks));
-  spdlog::register_logger(s_client_logger);
-  s_client_logger->set_level(spdlog::level::trace);
-  s_client_logger->flush_on(spdlog::level::trace);
+size_t platform::Log::GetDroppedCount() {
+  auto pool = spdlog::thread_pool();
+  if (!pool) {
+    return 0;
+  }
+  return pool->discard_counter() + pool->overrun_counter();
 }
 } // namespace platform
@@ -1,11 +1,42 @@
 // app/log.h
 #pragma once
+#include "platform/trace.hpp"
+#include "spdlog/common.h"
 #include "spdlog/logger.h"
 
 namespace platform {
+
+enum class logOverflow {
+  // Producers wait for room in the queue, nothing is lost
+  Block,
+  // New messages are dropped and counted when the queue is full, producers never wait
+  DropAndCount,
+};
+
+struct logOpts {
+  spdlog::level::level_enum level = spdlog::level::trace;
+  spdlog::level::level_enum flush_level = spdlog::level::warn;
+  // nullptr disables the file sink
+  const char *file = "tEngine.log";
+  bool async = true;
+  size_t queue_size = 8192;
+  logOverflow overflow = logOverflow::Block;
+  // How often the background flusher pushes buffered output to the sinks
+  int flush_interval_s = 1;
+  // An OSC_LOG_LEVEL that names no level, Init warns about it and keeps level
+  const char *unknown_level = nullptr;
+};
+
 class Log {
 public:
-  static void Init();
+  static void Init(logOpts opts = {});
+  static void Shutdown();
+
+  // Overrides opts with OSC_LOG_LEVEL, OSC_LOG_FILE, OSC_LOG_ASYNC and OSC_LOG_OVERFLOW
+  static logOpts FromEnvironment(logOpts opts = {});
+
+  // Messages lost to a full queue under logOverflow::DropAndCount
+  static size_t GetDroppedCount();
 
   inline static std::shared_ptr<spdlog::logger> &GetCoreLogger() { return s_core_logger; }
 
@@ -18,15 +49,40 @@ private:
 
 // core::log::getcorelogger()->warn("init log");
 
+// Calls below this level compile to nothing, levels follow SPDLOG_LEVEL_*
+#ifndef TE_LOG_ACTIVE_LEVEL
+#define TE_LOG_ACTIVE_LEVEL SPDLOG_LEVEL_TRACE
+#endif
+
+#define TE_LOG_DISABLED(...) static_cast<void>(0)
+
+#if TE_LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_TRACE
 #define TE_CORE_TRACE(...) ::platform::Log::GetCoreLogger()->trace(__VA_ARGS__)
+#define TE_TRACE(...) ::platform::Log::GetClientLogger()->trace(__VA_ARGS__)
+#else
+#define TE_CORE_TRACE(...) TE_LOG_DISABLED(__VA_ARGS__)
+#define TE_TRACE(...) TE_LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if TE_LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_INFO
 #define TE_CORE_INFO(...) ::platform::Log::GetCoreLogger()->info(__VA_ARGS__)
+#define TE_INFO(...) ::platform::Log::GetClientLogger()->info(__VA_ARGS__)
+#else
+#define TE_CORE_INFO(...) TE_LOG_DISABLED(__VA_ARGS__)
+#define TE_INFO(...) TE_LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if TE_LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_WARN
 #define TE_CORE_WARN(...) ::platform::Log::GetCoreLogger()->warn(__VA_ARGS__)
+#define TE_WARN(...) ::platform::Log::GetClientLogger()->warn(__VA_ARGS__)
+#else
+#define TE_CORE_WARN(...) TE_LOG_DISABLED(__VA_ARGS__)
+#define TE_WARN(...) TE_LOG_DISABLED(__VA_ARGS__)
+#endif
+
 #define TE_CORE_ERROR(...) ::platform::Log::GetCoreLogger()->error(__VA_ARGS__)
 #define TE_CORE_CRITICAL(...) ::platform::Log::GetCoreLogger()->critical(__VA_ARGS__)
 
-#define TE_TRACE(...) ::platform::Log::GetClientLogger()->trace(__VA_ARGS__)
-#define TE_INFO(...) ::platform::Log::GetClientLogger()->info(__VA_ARGS__)
-#define TE_WARN(...) ::platform::Log::GetClientLogger()->warn(__VA_ARGS__)
 #define TE_ERROR(...) ::platform::Log::GetClientLogger()->error(__VA_ARGS__)
 #define TE_CRITICAL(...) ::platform::Log::GetClientLogger()->critical(__VA_ARGS__)
 } // namespace platform
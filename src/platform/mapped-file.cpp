@@ -0,0 +1,99 @@
+#include "platform/mapped-file.hpp"
+#include "platform/log.hpp"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace platform {
+
+#if defined(_WIN32)
+
+bool MappedFile::Open(const std::string &path) {
+  Close();
+  file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file_ == INVALID_HANDLE_VALUE) {
+    file_ = nullptr;
+    TE_ERROR("Error opening '{}'", path);
+    return false;
+  }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file_, &size) || size.QuadPart == 0) {
+    TE_ERROR("Error reading the size of '{}'", path);
+    Close();
+    return false;
+  }
+  mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping_) {
+    data_ = static_cast<const uint8_t *>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+  }
+  if (!data_) {
+    TE_ERROR("Error mapping '{}'", path);
+    Close();
+    return false;
+  }
+  size_ = static_cast<uint64_t>(size.QuadPart);
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data_) {
+    UnmapViewOfFile(data_);
+  }
+  if (mapping_) {
+    CloseHandle(mapping_);
+  }
+  if (file_) {
+    CloseHandle(file_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+  mapping_ = nullptr;
+  file_ = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const std::string &path) {
+  Close();
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    TE_ERROR("Error opening '{}'", path);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    TE_ERROR("Error reading the size of '{}'", path);
+    ::close(fd);
+    return false;
+  }
+  // The mapping keeps the file referenced after the descriptor is closed
+  void *data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    TE_ERROR("Error mapping '{}'", path);
+    return false;
+  }
+  data_ = static_cast<const uint8_t *>(data);
+  size_ = static_cast<uint64_t>(st.st_size);
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data_) {
+    munmap(const_cast<uint8_t *>(data_), static_cast<size_t>(size_));
+  }
+  data_ = nullptr;
+  size_ = 0;
+}
+
+#endif
+
+} // namespace platform
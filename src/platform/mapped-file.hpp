@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace platform {
+
+// Read-only mapping of a whole file. Pages are only read from disk when first touched, so
+// opening is independent of the file size.
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile() { Close(); }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  bool Open(const std::string &path);
+  void Close();
+
+  const uint8_t *GetData() const { return data_; }
+  uint64_t GetSize() const { return size_; }
+
+private:
+  const uint8_t *data_ = nullptr;
+  uint64_t size_ = 0;
+#if defined(_WIN32)
+  void *file_ = nullptr;
+  void *mapping_ = nullptr;
+#endif
+};
+
+} // namespace platform
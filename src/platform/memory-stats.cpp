@@ -0,0 +1,137 @@
+#include "platform/memory-stats.hpp"
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace platform {
+
+namespace {
+
+struct tagCounters {
+  std::atomic<size_t> live_bytes{0};
+  std::atomic<size_t> peak_bytes{0};
+  std::atomic<uint64_t> allocations{0};
+  std::atomic<uint64_t> frees{0};
+};
+
+// Zero initialized before any constructor runs, operator new may count during static init
+std::array<tagCounters, MemoryStats::kTagCount> g_counters;
+
+thread_local MemoryTag t_tag = MemoryTag::Untagged;
+
+// Keeps the returned pointer aligned like malloc's
+struct alignas(std::max_align_t) allocationHeader {
+  size_t size;
+  MemoryTag tag;
+};
+
+} // namespace
+
+const char *MemoryTagName(MemoryTag tag) {
+  switch (tag) {
+  case MemoryTag::Untagged:
+    return "untagged";
+  case MemoryTag::Platform:
+    return "platform";
+  case MemoryTag::Gfx:
+    return "gfx";
+  case MemoryTag::Ui:
+    return "ui";
+  case MemoryTag::Ingest:
+    return "ingest";
+  default:
+    return "unknown";
+  }
+}
+
+void MemoryStats::CountAllocation(MemoryTag tag, size_t size) {
+  tagCounters &c = g_counters[static_cast<uint32_t>(tag)];
+  size_t live = c.live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+  c.allocations.fetch_add(1, std::memory_order_relaxed);
+  size_t peak = c.peak_bytes.load(std::memory_order_relaxed);
+  while (live > peak &&
+         !c.peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+  }
+}
+
+void MemoryStats::CountFree(MemoryTag tag, size_t size) {
+  tagCounters &c = g_counters[static_cast<uint32_t>(tag)];
+  c.live_bytes.fetch_sub(size, std::memory_order_relaxed);
+  c.frees.fetch_add(1, std::memory_order_relaxed);
+}
+
+memoryTagStats MemoryStats::Get(MemoryTag tag) {
+  const tagCounters &c = g_counters[static_cast<uint32_t>(tag)];
+  memoryTagStats stats;
+  stats.live_bytes = c.live_bytes.load(std::memory_order_relaxed);
+  stats.peak_bytes = c.peak_bytes.load(std::memory_order_relaxed);
+  stats.allocations = c.allocations.load(std::memory_order_relaxed);
+  stats.frees = c.frees.load(std::memory_order_relaxed);
+  return stats;
+}
+
+memoryTagStats MemoryStats::GetTotal() {
+  // Peaks of different tags happen at different times, their sum bounds the real peak
+  memoryTagStats total;
+  for (uint32_t i = 0; i < kTagCount; ++i) {
+    memoryTagStats stats = Get(static_cast<MemoryTag>(i));
+    total.live_bytes += stats.live_bytes;
+    total.peak_bytes += stats.peak_bytes;
+    total.allocations += stats.allocations;
+    total.frees += stats.frees;
+  }
+  return total;
+}
+
+bool MemoryStats::TracksHeap() {
+#ifdef TE_TRACK_HEAP
+  return true;
+#else
+  return false;
+#endif
+}
+
+void *MemoryStats::Allocate(size_t size, MemoryTag tag) {
+  auto *header = static_cast<allocationHeader *>(std::malloc(sizeof(allocationHeader) + size));
+  if (!header) {
+    return nullptr;
+  }
+  header->size = size;
+  header->tag = tag;
+  CountAllocation(tag, size);
+  return header + 1;
+}
+
+void MemoryStats::Free(void *memory) {
+  if (!memory) {
+    return;
+  }
+  allocationHeader *header = static_cast<allocationHeader *>(memory) - 1;
+  CountFree(header->tag, header->size);
+  std::free(header);
+}
+
+MemoryTag MemoryStats::GetThreadTag() { return t_tag; }
+
+void MemoryStats::SetThreadTag(MemoryTag tag) { t_tag = tag; }
+
+} // namespace platform
+
+#ifdef TE_TRACK_HEAP
+
+// The array and nothrow forms forward to these. Over-aligned new keeps
+// the library's implementation and goes uncounted.
+void *operator new(size_t size) {
+  void *memory = platform::MemoryStats::Allocate(size, platform::MemoryStats::GetThreadTag());
+  if (!memory) {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+void operator delete(void *memory) noexcept { platform::MemoryStats::Free(memory); }
+
+void operator delete(void *memory, size_t) noexcept { platform::MemoryStats::Free(memory); }
+
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace platform {
+
+// Subsystem a host allocation is charged to
+enum class MemoryTag : uint32_t { Untagged, Platform, Gfx, Ui, Ingest, Count };
+
+const char *MemoryTagName(MemoryTag tag);
+
+struct memoryTagStats {
+  size_t live_bytes = 0;
+  size_t peak_bytes = 0;
+  uint64_t allocations = 0;
+  uint64_t frees = 0;
+};
+
+// Process wide host memory counters per tag. Allocators that see every request of a subsystem
+// (ImGui's allocator functions, the Vulkan HostAllocator) count into their tag directly. With
+// OSC_TRACK_HEAP operator new is replaced too and charges the calling thread's MemoryScope, so
+// containers, spdlog and anything else show up as well. That puts a header and contended shared
+// atomics on every allocation of every thread, so it is a diagnostic build option, off by
+// default.
+class MemoryStats {
+public:
+  static constexpr uint32_t kTagCount = static_cast<uint32_t>(MemoryTag::Count);
+
+  static void CountAllocation(MemoryTag tag, size_t size);
+  static void CountFree(MemoryTag tag, size_t size);
+
+  static memoryTagStats Get(MemoryTag tag);
+  static memoryTagStats GetTotal();
+  // Whether operator new is counted
+  static bool TracksHeap();
+
+  // malloc that remembers size and tag, for allocator hooks that only pass the pointer to free
+  static void *Allocate(size_t size, MemoryTag tag);
+  static void Free(void *memory);
+
+  static MemoryTag GetThreadTag();
+  static void SetThreadTag(MemoryTag tag);
+};
+
+// Charges operator new on this thread to tag until it goes out of scope
+class MemoryScope {
+public:
+  explicit MemoryScope(MemoryTag tag) : previous_(MemoryStats::GetThreadTag()) {
+    MemoryStats::SetThreadTag(tag);
+  }
+  ~MemoryScope() { MemoryStats::SetThreadTag(previous_); }
+
+  MemoryScope(const MemoryScope &) = delete;
+  MemoryScope &operator=(const MemoryScope &) = delete;
+
+private:
+  MemoryTag previous_;
+};
+
+} // namespace platform
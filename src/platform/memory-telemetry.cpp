@@ -0,0 +1,99 @@
+#include "platform/memory-telemetry.hpp"
+#include "platform/log.hpp"
+#include "platform/trace.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+namespace platform {
+
+namespace {
+
+double Mib(uint64_t bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); }
+
+} // namespace
+
+MemoryTelemetry::MemoryTelemetry(memoryTelemetryOpts opts) : opts_(opts) {
+  total_ = MemoryStats::GetTotal();
+  last_allocations_ = total_.allocations;
+  sample_allocations_ = total_.allocations;
+  sample_bytes_ = total_.live_bytes;
+  sample_ns_ = Trace::SteadyNanoseconds();
+  log_ns_ = sample_ns_;
+}
+
+bool MemoryTelemetry::EndFrame() {
+  total_ = memoryTagStats{};
+  for (uint32_t i = 0; i < MemoryStats::kTagCount; ++i) {
+    tags_[i] = MemoryStats::Get(static_cast<MemoryTag>(i));
+    total_.live_bytes += tags_[i].live_bytes;
+    total_.peak_bytes += tags_[i].peak_bytes;
+    total_.allocations += tags_[i].allocations;
+    total_.frees += tags_[i].frees;
+  }
+
+  frame_allocations_ = total_.allocations - last_allocations_;
+  last_allocations_ = total_.allocations;
+  max_frame_allocations_ = std::max(max_frame_allocations_, frame_allocations_);
+  history_[history_head_] = static_cast<float>(frame_allocations_);
+  history_head_ = (history_head_ + 1) % kHistorySize;
+  history_count_ = std::min(history_count_ + 1, kHistorySize);
+
+  uint64_t now = Trace::SteadyNanoseconds();
+  double elapsed = static_cast<double>(now - sample_ns_) * 1e-9;
+  if (elapsed < opts_.sample_interval_s) {
+    return false;
+  }
+  allocation_rate_ = static_cast<double>(total_.allocations - sample_allocations_) / elapsed;
+  byte_growth_rate_ = (static_cast<double>(total_.live_bytes) -
+                       static_cast<double>(sample_bytes_)) /
+                      elapsed;
+  sample_ns_ = now;
+  sample_allocations_ = total_.allocations;
+  sample_bytes_ = total_.live_bytes;
+
+  if (opts_.log_interval_s > 0.0 &&
+      static_cast<double>(now - log_ns_) * 1e-9 >= opts_.log_interval_s) {
+    Log();
+    log_ns_ = now;
+  }
+  return true;
+}
+
+void MemoryTelemetry::SetDeviceHeaps(const std::vector<deviceHeapUsage> &heaps) {
+  if (heaps_.size() != heaps.size()) {
+    heaps_.assign(heaps.size(), deviceHeapUsage{});
+  }
+  for (size_t i = 0; i < heaps.size(); ++i) {
+    uint64_t peak = std::max(heaps_[i].peak, std::max(heaps[i].usage, heaps[i].reserved));
+    heaps_[i] = heaps[i];
+    heaps_[i].peak = peak;
+  }
+}
+
+void MemoryTelemetry::Log() const {
+  std::string line;
+  char text[128];
+  std::snprintf(text, sizeof(text), "%.1f MiB live (peak %.1f MiB),", Mib(total_.live_bytes),
+                Mib(total_.peak_bytes));
+  line += text;
+  for (uint32_t i = 0; i < MemoryStats::kTagCount; ++i) {
+    std::snprintf(text, sizeof(text), " %s %.1f", MemoryTagName(static_cast<MemoryTag>(i)),
+                  Mib(tags_[i].live_bytes));
+    line += text;
+  }
+  std::snprintf(text, sizeof(text), ", %.0f allocs/s, %+.1f KiB/s, %llu per frame (max %llu)",
+                allocation_rate_, byte_growth_rate_ / 1024.0,
+                static_cast<unsigned long long>(frame_allocations_),
+                static_cast<unsigned long long>(max_frame_allocations_));
+  line += text;
+  for (size_t i = 0; i < heaps_.size(); ++i) {
+    const deviceHeapUsage &heap = heaps_[i];
+    std::snprintf(text, sizeof(text), ", heap %zu %.0f/%.0f MiB (peak %.0f)", i,
+                  Mib(std::max(heap.usage, heap.reserved)), Mib(heap.budget), Mib(heap.peak));
+    line += text;
+  }
+  TE_INFO("Memory: {}", line);
+}
+
+} // namespace platform
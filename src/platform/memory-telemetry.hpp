@@ -0,0 +1,79 @@
+#pragma once
+#include "platform/memory-stats.hpp"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace platform {
+
+struct deviceHeapUsage {
+  uint64_t size = 0;
+  // What the process may use without paging, the heap size when the driver doesn't report one
+  uint64_t budget = 0;
+  // Whole process usage as reported by the driver, 0 when unavailable
+  uint64_t usage = 0;
+  // Blocks the device allocator holds in this heap
+  uint64_t reserved = 0;
+  uint64_t peak = 0;
+  bool device_local = false;
+};
+
+struct memoryTelemetryOpts {
+  // Rates and device heaps are refreshed this often
+  double sample_interval_s = 1.0;
+  // A summary line is logged this often, 0 disables it
+  double log_interval_s = 60.0;
+};
+
+// Samples MemoryStats once per frame for per-frame allocation counts, allocation rates and
+// high-water marks, and keeps the device heaps it is given. Frame loop thread only.
+class MemoryTelemetry {
+public:
+  static constexpr size_t kHistorySize = 256;
+
+  explicit MemoryTelemetry(memoryTelemetryOpts opts = {});
+
+  // Returns true when a sample interval has passed and device heaps should be refreshed
+  bool EndFrame();
+  // Keeps per heap peaks of the larger of usage and reserved
+  void SetDeviceHeaps(const std::vector<deviceHeapUsage> &heaps);
+  const std::vector<deviceHeapUsage> &GetDeviceHeaps() const { return heaps_; }
+
+  // Host allocations made during the last frame and the most in any frame so far
+  uint64_t GetFrameAllocations() const { return frame_allocations_; }
+  uint64_t GetMaxFrameAllocations() const { return max_frame_allocations_; }
+  // Per second over the last sample interval
+  double GetAllocationRate() const { return allocation_rate_; }
+  double GetByteGrowthRate() const { return byte_growth_rate_; }
+  memoryTagStats GetTagStats(MemoryTag tag) const { return tags_[static_cast<uint32_t>(tag)]; }
+  const memoryTagStats &GetTotalStats() const { return total_; }
+
+  // Allocations per frame, oldest sample at GetHistoryOffset()
+  const float *GetHistory() const { return history_.data(); }
+  size_t GetHistoryOffset() const { return history_count_ < kHistorySize ? 0 : history_head_; }
+  size_t GetHistoryCount() const { return history_count_; }
+
+private:
+  void Log() const;
+
+  memoryTelemetryOpts opts_;
+  std::array<memoryTagStats, MemoryStats::kTagCount> tags_{};
+  memoryTagStats total_;
+  std::vector<deviceHeapUsage> heaps_;
+
+  uint64_t last_allocations_ = 0;
+  uint64_t frame_allocations_ = 0;
+  uint64_t max_frame_allocations_ = 0;
+  std::array<float, kHistorySize> history_{};
+  size_t history_head_ = 0;
+  size_t history_count_ = 0;
+
+  uint64_t sample_ns_ = 0;
+  uint64_t sample_allocations_ = 0;
+  size_t sample_bytes_ = 0;
+  double allocation_rate_ = 0.0;
+  double byte_growth_rate_ = 0.0;
+  uint64_t log_ns_ = 0;
+};
+
+} // namespace platform
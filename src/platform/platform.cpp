@@ -1,7 +1,11 @@
 #include "platform.hpp"
 #include "platform/log.hpp"
 
-int platform::Init() {
+int platform::Init(bool headless) {
+  if (headless) {
+    // The null platform needs no display server and still provides windows and input state
+    glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+  }
   if (!glfwInit()) {
     TE_CRITICAL("Cannot initialize glfw");
     return GLFW_FALSE;
@@ -14,3 +18,5 @@ void platform::Exit() {
   glfwTerminate();
   TE_TRACE("Glfw successfuly terminated");
 }
+
+void platform::Wake() { glfwPostEmptyEvent(); }
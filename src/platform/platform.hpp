@@ -3,7 +3,10 @@
 
 namespace platform {
 
-int Init();
+int Init(bool headless = false);
 void Exit();
 
+// Wakes the frame loop from an idle wait, safe to call from any thread
+void Wake();
+
 } // namespace platform
@@ -0,0 +1,94 @@
+#include "platform/startup-report.hpp"
+#include "platform/log.hpp"
+#include "platform/trace.hpp"
+#include <algorithm>
+
+namespace platform {
+
+namespace {
+
+double Ms(uint64_t from, uint64_t to) { return static_cast<double>(to - from) * 1e-6; }
+
+} // namespace
+
+StartupReport::StartupReport() : origin_ns_(Trace::SteadyNanoseconds()) {}
+
+void StartupReport::Record(const char *name, uint64_t begin_ns, uint64_t end_ns) {
+  std::lock_guard lock(mutex_);
+  std::thread::id id = std::this_thread::get_id();
+  auto it = std::find(threads_.begin(), threads_.end(), id);
+  uint32_t thread = static_cast<uint32_t>(it - threads_.begin());
+  if (it == threads_.end()) {
+    threads_.push_back(id);
+  }
+  phases_.push_back({name, Ms(origin_ns_, std::max(begin_ns, origin_ns_)),
+                     Ms(origin_ns_, std::max(end_ns, origin_ns_)), thread});
+}
+
+void StartupReport::Finish() {
+  {
+    std::lock_guard lock(mutex_);
+    if (finish_ns_ != 0) {
+      return;
+    }
+    finish_ns_ = Trace::SteadyNanoseconds();
+  }
+  Log();
+}
+
+bool StartupReport::IsFinished() const {
+  std::lock_guard lock(mutex_);
+  return finish_ns_ != 0;
+}
+
+std::vector<startupPhase> StartupReport::GetPhases() const {
+  std::vector<startupPhase> phases;
+  {
+    std::lock_guard lock(mutex_);
+    phases = phases_;
+  }
+  std::stable_sort(phases.begin(), phases.end(),
+                   [](const startupPhase &a, const startupPhase &b) {
+                     return a.begin_ms < b.begin_ms;
+                   });
+  return phases;
+}
+
+double StartupReport::GetTotalMs() const {
+  std::lock_guard lock(mutex_);
+  return Ms(origin_ns_, finish_ns_ != 0 ? finish_ns_ : Trace::SteadyNanoseconds());
+}
+
+double StartupReport::GetBusyMs() const {
+  std::lock_guard lock(mutex_);
+  double busy = 0.0;
+  for (const startupPhase &phase : phases_) {
+    busy += phase.end_ms - phase.begin_ms;
+  }
+  return busy;
+}
+
+uint32_t StartupReport::GetThreadCount() const {
+  std::lock_guard lock(mutex_);
+  return static_cast<uint32_t>(threads_.size());
+}
+
+void StartupReport::Log() const {
+  TE_INFO("Startup: first frame after {:.1f} ms, {:.1f} ms of work on {} threads", GetTotalMs(),
+          GetBusyMs(), GetThreadCount());
+  for (const startupPhase &phase : GetPhases()) {
+    TE_INFO("  {:<20} {:8.1f} - {:8.1f} ms {:8.1f} ms  thread {}", phase.name, phase.begin_ms,
+            phase.end_ms, phase.end_ms - phase.begin_ms, phase.thread);
+  }
+}
+
+StartupScope::StartupScope(StartupReport *report, const char *name)
+    : report_(report), name_(name), begin_ns_(Trace::SteadyNanoseconds()) {}
+
+StartupScope::~StartupScope() {
+  if (report_) {
+    report_->Record(name_, begin_ns_, Trace::SteadyNanoseconds());
+  }
+}
+
+} // namespace platform
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace platform {
+
+struct startupPhase {
+  const char *name;
+  // Milliseconds since the report was created
+  double begin_ms;
+  double end_ms;
+  // Threads are numbered in order of their first phase
+  uint32_t thread;
+};
+
+// Times the phases of application startup, which run concurrently on several threads, and logs
+// them as one report once the first frame is out. Phase names must be string literals.
+class StartupReport {
+public:
+  StartupReport();
+
+  void Record(const char *name, uint64_t begin_ns, uint64_t end_ns);
+  // Stops the clock and logs the report, only the first call does anything
+  void Finish();
+  bool IsFinished() const;
+
+  // Ordered by start time
+  std::vector<startupPhase> GetPhases() const;
+  // Creation to Finish, or to now before it
+  double GetTotalMs() const;
+  // Sum of all phase durations, more than GetTotalMs() by what overlapping saved
+  double GetBusyMs() const;
+  uint32_t GetThreadCount() const;
+
+private:
+  void Log() const;
+
+  mutable std::mutex mutex_;
+  uint64_t origin_ns_;
+  uint64_t finish_ns_ = 0;
+  std::vector<startupPhase> phases_;
+  std::vector<std::thread::id> threads_;
+};
+
+// Records the enclosing scope as a phase, a null report records nothing
+class StartupScope {
+public:
+  StartupScope(StartupReport *report, const char *name);
+  ~StartupScope();
+
+  StartupScope(const StartupScope &) = delete;
+  StartupScope &operator=(const StartupScope &) = delete;
+
+private:
+  StartupReport *report_;
+  const char *name_;
+  uint64_t begin_ns_;
+};
+
+} // namespace platform
@@ -0,0 +1,173 @@
+#include "trace.hpp"
+#include "platform/log.hpp"
+#include "platform/memory-stats.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace platform {
+
+namespace {
+
+struct zoneEvent {
+  const char *name;
+  uint64_t begin;
+  uint64_t end;
+};
+
+// Written only by its owning thread. `written` is published with release ordering so a
+// concurrent dump sees complete events for every index below it.
+struct threadBuffer {
+  std::array<zoneEvent, Trace::kEventsPerThread> events;
+  std::atomic<uint64_t> written{0};
+  uint32_t thread_id = 0;
+  std::atomic<const char *> thread_name{nullptr};
+};
+
+struct traceRegistry {
+  // Reference point for converting Trace::Now() ticks to nanoseconds
+  uint64_t calibration_ticks = Trace::Now();
+  uint64_t calibration_ns = Trace::SteadyNanoseconds();
+
+  std::mutex mutex;
+  // Buffers outlive their threads so zones from finished workers still show up in a dump
+  std::vector<std::unique_ptr<threadBuffer>> buffers;
+};
+
+traceRegistry &Registry() {
+  static traceRegistry registry;
+  return registry;
+}
+
+threadBuffer *RegisterThread() {
+  MemoryScope memoryScope(MemoryTag::Platform);
+  auto buffer = std::make_unique<threadBuffer>();
+  traceRegistry &registry = Registry();
+  std::lock_guard lock(registry.mutex);
+  buffer->thread_id = static_cast<uint32_t>(registry.buffers.size()) + 1;
+  registry.buffers.push_back(std::move(buffer));
+  return registry.buffers.back().get();
+}
+
+threadBuffer *ThisThreadBuffer() {
+  thread_local threadBuffer *buffer = RegisterThread();
+  return buffer;
+}
+
+void WriteEscaped(std::FILE *file, const char *text) {
+  for (; *text; ++text) {
+    if (*text == '"' || *text == '\\') {
+      std::fputc('\\', file);
+    }
+    std::fputc(*text, file);
+  }
+}
+
+double TicksPerMicrosecond() {
+#if defined(_M_X64) || defined(__x86_64__)
+  constexpr uint64_t kMinCalibrationNs = 50'000'000;
+  traceRegistry &registry = Registry();
+  uint64_t elapsedNs = Trace::SteadyNanoseconds() - registry.calibration_ns;
+  if (elapsedNs < kMinCalibrationNs) {
+    std::this_thread::sleep_for(std::chrono::nanoseconds(kMinCalibrationNs - elapsedNs));
+  }
+  uint64_t ticks = Trace::Now() - registry.calibration_ticks;
+  elapsedNs = Trace::SteadyNanoseconds() - registry.calibration_ns;
+  return static_cast<double>(ticks) / static_cast<double>(elapsedNs) * 1e3;
+#else
+  return 1e3;
+#endif
+}
+
+} // namespace
+
+void Trace::Record(const char *name, uint64_t begin, uint64_t end) {
+  threadBuffer *buffer = ThisThreadBuffer();
+  uint64_t index = buffer->written.load(std::memory_order_relaxed);
+  buffer->events[index % kEventsPerThread] = {name, begin, end};
+  buffer->written.store(index + 1, std::memory_order_release);
+}
+
+void Trace::SetThreadName(const char *name) {
+  ThisThreadBuffer()->thread_name.store(name, std::memory_order_relaxed);
+}
+
+bool Trace::DumpChromeTrace(const std::string &path) {
+  std::FILE *file = std::fopen(path.c_str(), "w");
+  if (!file) {
+    TE_CORE_ERROR("Cannot open trace file {}", path);
+    return false;
+  }
+
+  Registry();
+  double ticksPerUs = TicksPerMicrosecond();
+  uint64_t epoch = UINT64_MAX;
+  std::vector<std::vector<zoneEvent>> snapshots;
+  std::vector<threadBuffer *> buffers;
+  {
+    std::lock_guard lock(Registry().mutex);
+    for (auto &buffer : Registry().buffers) {
+      buffers.push_back(buffer.get());
+    }
+  }
+
+  for (threadBuffer *buffer : buffers) {
+    uint64_t end = buffer->written.load(std::memory_order_acquire);
+    uint64_t begin = end > kEventsPerThread ? end - kEventsPerThread : 0;
+    std::vector<zoneEvent> events;
+    events.reserve(end - begin);
+    for (uint64_t i = begin; i < end; ++i) {
+      events.push_back(buffer->events[i % kEventsPerThread]);
+    }
+
+    // Slots the owner wrapped around onto while we were copying are no longer trustworthy
+    uint64_t after = buffer->written.load(std::memory_order_acquire);
+    uint64_t firstValid = after + 1 > kEventsPerThread ? after + 1 - kEventsPerThread : 0;
+    if (firstValid > begin) {
+      events.erase(events.begin(),
+                   events.begin() + static_cast<std::ptrdiff_t>(
+                                        std::min<uint64_t>(firstValid - begin, events.size())));
+    }
+
+    for (const zoneEvent &event : events) {
+      epoch = std::min(epoch, event.begin);
+    }
+    snapshots.push_back(std::move(events));
+  }
+
+  std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+  bool first = true;
+  size_t total = 0;
+  for (size_t t = 0; t < buffers.size(); ++t) {
+    if (const char *name = buffers[t]->thread_name.load(std::memory_order_relaxed)) {
+      std::fprintf(file,
+                   "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                   "\"args\":{\"name\":\"",
+                   first ? "" : ",", buffers[t]->thread_id);
+      WriteEscaped(file, name);
+      std::fputs("\"}}", file);
+      first = false;
+    }
+    for (const zoneEvent &event : snapshots[t]) {
+      std::fprintf(file, "%s\n{\"name\":\"", first ? "" : ",");
+      WriteEscaped(file, event.name);
+      std::fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                   buffers[t]->thread_id, (event.begin - epoch) / ticksPerUs,
+                   (event.end - event.begin) / ticksPerUs);
+      first = false;
+    }
+    total += snapshots[t].size();
+  }
+  std::fputs("\n]}\n", file);
+
+  bool ok = std::fclose(file) == 0;
+  TE_CORE_INFO("Wrote {} trace zones to {}", total, path);
+  return ok;
+}
+
+} // namespace platform
@@ -0,0 +1,67 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#if defined(_M_X64)
+#include <intrin.h>
+#elif defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+namespace platform {
+
+// Scoped CPU zones recorded into per-thread ring buffers and exported as Chrome trace JSON
+// (chrome://tracing, ui.perfetto.dev). Zone names must be string literals, only the pointer is
+// stored. Recording never locks or allocates except for the first zone on a new thread.
+class Trace {
+public:
+  static constexpr size_t kEventsPerThread = 1 << 16;
+
+  // Raw ticks, converted to time only when the trace is dumped. On x86-64 this is the TSC,
+  // which is several times cheaper to read than steady_clock.
+  static uint64_t Now() {
+#if defined(_M_X64) || defined(__x86_64__)
+    return __rdtsc();
+#else
+    return SteadyNanoseconds();
+#endif
+  }
+
+  static uint64_t SteadyNanoseconds() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+  }
+
+  static void Record(const char *name, uint64_t begin, uint64_t end);
+  static void SetThreadName(const char *name);
+
+  static bool DumpChromeTrace(const std::string &path);
+};
+
+class ScopedZone {
+public:
+  explicit ScopedZone(const char *name) : name_(name), begin_(Trace::Now()) {}
+  ~ScopedZone() { Trace::Record(name_, begin_, Trace::Now()); }
+
+  ScopedZone(const ScopedZone &) = delete;
+  ScopedZone &operator=(const ScopedZone &) = delete;
+
+private:
+  const char *name_;
+  uint64_t begin_;
+};
+
+} // namespace platform
+
+#define TE_ZONE_CONCAT_IMPL(a, b) a##b
+#define TE_ZONE_CONCAT(a, b) TE_ZONE_CONCAT_IMPL(a, b)
+
+#ifdef TE_ENABLE_ZONES
+#define TE_ZONE(name) ::platform::ScopedZone TE_ZONE_CONCAT(te_zone_, __LINE__)(name)
+#define TE_ZONE_THREAD(name) ::platform::Trace::SetThreadName(name)
+#else
+#define TE_ZONE(name) static_cast<void>(0)
+#define TE_ZONE_THREAD(name) static_cast<void>(0)
+#endif
@@ -11,9 +11,9 @@ Window::~Window() {}
 
 int Window::Init(windowOpts opts) {
   glfwWindowHint(GLFW_CLIENT_API, GLFW_FALSE);
-  glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+  glfwWindowHint(GLFW_RESIZABLE, opts.resizable ? GLFW_TRUE : GLFW_FALSE);
 
-  main_scale = ImGui_ImplGlfw_GetContentScaleForMonitor(glfwGetPrimaryMonitor());
+  main_scale = GetPrimaryMonitorScale();
 
   window_ =
       glfwCreateWindow(static_cast<int>(opts.width * main_scale),
@@ -22,10 +22,25 @@ int Window::Init(windowOpts opts) {
     TE_CRITICAL("Cannot create window");
     return GLFW_FALSE;
   }
+
+  glfwSetWindowUserPointer(window_, this);
+  glfwSetFramebufferSizeCallback(window_, FramebufferSizeCallback);
+  glfwGetFramebufferSize(window_, &fb_width_, &fb_height_);
   TE_TRACE("Window created successfully");
   return GLFW_TRUE;
 }
 
+float Window::GetPrimaryMonitorScale() {
+  return ImGui_ImplGlfw_GetContentScaleForMonitor(glfwGetPrimaryMonitor());
+}
+
+void Window::FramebufferSizeCallback(GLFWwindow *window, int width, int height) {
+  auto *self = static_cast<Window *>(glfwGetWindowUserPointer(window));
+  self->fb_width_ = width;
+  self->fb_height_ = height;
+  self->resized_ = true;
+}
+
 void Window::Destroy() {
   glfwDestroyWindow(window_);
   TE_TRACE("Window destroyed successfully");
@@ -1,5 +1,6 @@
 #pragma once
 #include <GLFW/glfw3.h>
+#include <utility>
 
 namespace platform {
 
@@ -7,6 +8,8 @@ struct windowOpts {
   int width;
   int height;
   const char *name = nullptr;
+  bool headless = false;
+  bool resizable = true;
 };
 
 class Window {
@@ -17,12 +20,28 @@ public:
   int Init(windowOpts opts);
   void Destroy();
 
+  // Content scale Init sizes the window by, main thread after glfwInit
+  static float GetPrimaryMonitorScale();
+
   GLFWwindow *GetWindowHandle() { return window_; }
 
+  // Size reported by the last framebuffer-size callback
+  void GetFramebufferSize(int *width, int *height) {
+    *width = fb_width_;
+    *height = fb_height_;
+  }
+  // True once after each framebuffer size change
+  bool ConsumeResize() { return std::exchange(resized_, false); }
+
   float main_scale;
 
 private:
+  static void FramebufferSizeCallback(GLFWwindow *window, int width, int height);
+
   GLFWwindow *window_;
+  int fb_width_ = 0;
+  int fb_height_ = 0;
+  bool resized_ = false;
 };
 
 } // namespace platform
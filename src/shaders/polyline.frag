@@ -0,0 +1,13 @@
+#version 450
+
+layout(location = 0) in vec4 in_color;
+layout(location = 1) in float in_edge;
+layout(location = 2) flat in float in_half_width;
+
+layout(location = 0) out vec4 out_color;
+
+void main() {
+  // Pixel coverage across the line, ramping over the fringe
+  float coverage = clamp(in_half_width + 0.5 - abs(in_edge), 0.0, 1.0);
+  out_color = vec4(in_color.rgb, in_color.a * coverage);
+}
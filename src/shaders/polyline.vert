@@ -0,0 +1,81 @@
+#version 450
+
+// Pulls two samples per instance and expands the segment between them into a quad with a
+// one pixel fringe, no vertex buffers are bound
+struct polylineRecord {
+  uint first_segment;
+  uint offset;
+  uint capacity;
+  uint start;
+  uint count;
+  uint color;
+  float x;
+  float y;
+  float x_step;
+  float y_scale;
+  float thickness;
+  uint pad;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer Samples {
+  float samples[];
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer Records {
+  polylineRecord records[];
+};
+
+layout(push_constant) uniform Push {
+  vec2 scale;
+  vec2 translate;
+  uint record_base;
+  uint record_count;
+} pc;
+
+layout(location = 0) out vec4 out_color;
+layout(location = 1) out float out_edge;
+layout(location = 2) flat out float out_half_width;
+
+const vec2 kCorners[6] = vec2[](vec2(0.0, -1.0), vec2(1.0, -1.0), vec2(0.0, 1.0),
+                                vec2(0.0, 1.0), vec2(1.0, -1.0), vec2(1.0, 1.0));
+
+vec2 Point(polylineRecord r, uint i) {
+  float value = samples[r.offset + (r.start + i) % r.capacity];
+  return vec2(r.x + float(i) * r.x_step, r.y + value * r.y_scale);
+}
+
+void main() {
+  // Last record starting at or before this segment
+  uint segment = gl_InstanceIndex;
+  uint lo = 0;
+  uint hi = pc.record_count;
+  while (hi - lo > 1) {
+    uint mid = (lo + hi) / 2;
+    if (records[pc.record_base + mid].first_segment <= segment) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  polylineRecord r = records[pc.record_base + lo];
+  uint k = segment - r.first_segment;
+
+  vec2 p0 = Point(r, k);
+  vec2 p1 = Point(r, k + 1);
+  vec2 dir = p1 - p0;
+  float len = length(dir);
+  dir = len > 0.0 ? dir / len : vec2(1.0, 0.0);
+  vec2 normal = vec2(-dir.y, dir.x);
+
+  float half_width = r.thickness * 0.5;
+  float extent = half_width + 1.0;
+  vec2 corner = kCorners[gl_VertexIndex];
+  // Ends overlap the neighbouring segments by half the width to close the joints
+  vec2 p = mix(p0, p1, corner.x) + dir * (corner.x * 2.0 - 1.0) * half_width +
+           normal * corner.y * extent;
+
+  gl_Position = vec4(p * pc.scale + pc.translate, 0.0, 1.0);
+  out_color = unpackUnorm4x8(r.color);
+  out_edge = corner.y * extent;
+  out_half_width = half_width;
+}
@@ -0,0 +1,73 @@
+#include "ui/draw-data-hash.hpp"
+#include <cstring>
+
+namespace {
+
+constexpr uint64_t kHashSeed = 0x9e3779b97f4a7c15ull;
+
+uint64_t Mix(uint64_t hash, uint64_t value) {
+  hash ^= value + kHashSeed + (hash << 6) + (hash >> 2);
+  hash *= 0xff51afd7ed558ccdull;
+  return hash ^ (hash >> 32);
+}
+
+// Word at a time, vertex buffers can be megabytes on busy dashboards
+uint64_t HashBytes(uint64_t hash, const void *data, size_t size) {
+  const auto *bytes = static_cast<const unsigned char *>(data);
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, bytes + i, sizeof(word));
+    hash = Mix(hash, word);
+  }
+  uint64_t tail = 0;
+  std::memcpy(&tail, bytes + i, size - i);
+  return Mix(hash, tail ^ size);
+}
+
+uint64_t FloatBits(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+} // namespace
+
+uint64_t HashDrawData(const ImDrawData *draw_data) {
+  uint64_t hash = kHashSeed;
+  hash = Mix(hash, FloatBits(draw_data->DisplayPos.x) << 32 | FloatBits(draw_data->DisplayPos.y));
+  hash = Mix(hash, FloatBits(draw_data->DisplaySize.x) << 32 | FloatBits(draw_data->DisplaySize.y));
+  hash = Mix(hash, FloatBits(draw_data->FramebufferScale.x) << 32 |
+                       FloatBits(draw_data->FramebufferScale.y));
+
+  for (const ImDrawList *list : draw_data->CmdLists) {
+    hash = HashBytes(hash, list->VtxBuffer.Data, list->VtxBuffer.size_in_bytes());
+    hash = HashBytes(hash, list->IdxBuffer.Data, list->IdxBuffer.size_in_bytes());
+    for (const ImDrawCmd &cmd : list->CmdBuffer) {
+      hash = HashBytes(hash, &cmd.ClipRect, sizeof(cmd.ClipRect));
+      hash = Mix(hash, static_cast<uint64_t>(cmd.TexRef.GetTexID()));
+      hash = Mix(hash, static_cast<uint64_t>(cmd.VtxOffset) << 32 | cmd.IdxOffset);
+      hash = Mix(hash, cmd.ElemCount);
+      hash = Mix(hash, reinterpret_cast<uintptr_t>(cmd.UserCallback));
+      // Data copied by AddCallback lives in the list's buffer at the same address every frame
+      if (cmd.UserCallbackDataSize > 0) {
+        hash = HashBytes(hash, cmd.UserCallbackData, static_cast<size_t>(cmd.UserCallbackDataSize));
+      } else {
+        hash = Mix(hash, reinterpret_cast<uintptr_t>(cmd.UserCallbackData));
+      }
+    }
+  }
+  return hash;
+}
+
+bool HasPendingTextureUpdates(const ImDrawData *draw_data) {
+  if (!draw_data->Textures) {
+    return false;
+  }
+  for (const ImTextureData *tex : *draw_data->Textures) {
+    if (tex->Status != ImTextureStatus_OK) {
+      return true;
+    }
+  }
+  return false;
+}
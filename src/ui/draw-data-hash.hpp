@@ -0,0 +1,10 @@
+#pragma once
+#include "imgui.h"
+#include <cstdint>
+
+// Fingerprint of everything that ends up on screen for a frame. Two frames with the same hash
+// render identical pixels, so the second one can be skipped.
+uint64_t HashDrawData(const ImDrawData *draw_data);
+
+// Font atlas and other texture uploads still have to reach the GPU even if geometry is unchanged
+bool HasPendingTextureUpdates(const ImDrawData *draw_data);
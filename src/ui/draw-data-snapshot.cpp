@@ -0,0 +1,43 @@
+#include "ui/draw-data-snapshot.hpp"
+
+DrawDataSnapshot::~DrawDataSnapshot() {
+  for (ImDrawList *list : lists_) {
+    IM_DELETE(list);
+  }
+}
+
+void DrawDataSnapshot::Capture(ImDrawData *draw_data) {
+  data_.Valid = draw_data->Valid;
+  data_.CmdListsCount = draw_data->CmdListsCount;
+  data_.TotalIdxCount = draw_data->TotalIdxCount;
+  data_.TotalVtxCount = draw_data->TotalVtxCount;
+  data_.DisplayPos = draw_data->DisplayPos;
+  data_.DisplaySize = draw_data->DisplaySize;
+  data_.FramebufferScale = draw_data->FramebufferScale;
+  data_.OwnerViewport = draw_data->OwnerViewport;
+  data_.Textures = nullptr;
+
+  while (lists_.Size < draw_data->CmdListsCount) {
+    lists_.push_back(IM_NEW(ImDrawList)(ImGui::GetDrawListSharedData()));
+  }
+  data_.CmdLists.resize(draw_data->CmdListsCount);
+  for (int i = 0; i < draw_data->CmdListsCount; ++i) {
+    ImDrawList *src = draw_data->CmdLists[i];
+    ImDrawList *dst = lists_[i];
+    dst->CmdBuffer.swap(src->CmdBuffer);
+    dst->IdxBuffer.swap(src->IdxBuffer);
+    dst->VtxBuffer.swap(src->VtxBuffer);
+    dst->_CallbacksDataBuf.swap(src->_CallbacksDataBuf);
+    dst->Flags = src->Flags;
+    // Resolve texture references now, the main thread may swap a texture's ID while this
+    // snapshot is still queued
+    for (ImDrawCmd &cmd : dst->CmdBuffer) {
+      cmd.TexRef = ImTextureRef(cmd.TexRef.GetTexID());
+      // Callback data copied by AddCallback moved along with the buffer
+      if (cmd.UserCallback && cmd.UserCallbackDataSize > 0) {
+        cmd.UserCallbackData = dst->_CallbacksDataBuf.Data + cmd.UserCallbackDataOffset;
+      }
+    }
+    data_.CmdLists[i] = dst;
+  }
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "imgui.h"
+
+// Copy of a frame's draw data that stays valid while ImGui builds the next frame. Capture swaps
+// buffers with ImGui's draw lists instead of copying them, ImGui clears and refills the
+// swapped-in buffers on the next NewFrame, so steady state capture doesn't allocate.
+class DrawDataSnapshot {
+public:
+  DrawDataSnapshot() = default;
+  ~DrawDataSnapshot();
+
+  DrawDataSnapshot(const DrawDataSnapshot &) = delete;
+  DrawDataSnapshot &operator=(const DrawDataSnapshot &) = delete;
+
+  // Leaves draw_data's lists with stale contents, call after anything else that reads them.
+  // Texture requests are not carried over, they have to be handled before capturing.
+  // Commands keep the texture IDs current at capture time.
+  void Capture(ImDrawData *draw_data);
+
+  ImDrawData *Get() { return &data_; }
+
+private:
+  ImDrawData data_;
+  ImVector<ImDrawList *> lists_;
+};
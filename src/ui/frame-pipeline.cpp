@@ -0,0 +1,49 @@
+#include "ui/frame-pipeline.hpp"
+#include "platform/log.hpp"
+
+FramePipeline::FramePipeline(tf::Executor *executor, VulkanContext *v)
+    : executor_(executor), v_(v) {}
+
+FramePipeline::~FramePipeline() { WaitIdle(); }
+
+void FramePipeline::Submit(ImDrawData *draw_data) {
+  if (!executor_) {
+    v_->FrameRender(draw_data);
+    v_->FramePresent();
+    return;
+  }
+
+  // The snapshot is reused every kDepth frames, which bounds how far the UI runs ahead
+  uint32_t slot = next_slot_;
+  next_slot_ = (next_slot_ + 1) % kDepth;
+  if (pending_[slot].valid()) {
+    TE_ZONE("WaitForRenderStage");
+    pending_[slot].get();
+  }
+  snapshots_[slot].Capture(draw_data);
+
+  VulkanContext *v = v_;
+  ImDrawData *snapshot = snapshots_[slot].Get();
+  auto render = [v, snapshot] {
+    TE_ZONE_THREAD("render");
+    TE_ZONE("RenderStage");
+    v->FrameRender(snapshot);
+    v->FramePresent();
+  };
+
+  tf::AsyncTask *first = &last_task_;
+  tf::AsyncTask *last = last_task_.empty() ? first : first + 1;
+  auto [task, future] = executor_->dependent_async(render, first, last);
+  last_task_ = std::move(task);
+  pending_[slot] = std::move(future);
+}
+
+void FramePipeline::WaitIdle() {
+  TE_ZONE("WaitRenderIdle");
+  for (std::future<void> &pending : pending_) {
+    if (pending.valid()) {
+      pending.get();
+    }
+  }
+  last_task_.reset();
+}
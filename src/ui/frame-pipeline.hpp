@@ -0,0 +1,38 @@
+#pragma once
+#include "gfx/vulkan-context.hpp"
+#include "ui/draw-data-snapshot.hpp"
+#include <array>
+#include <cstdint>
+#include <future>
+#include <taskflow/taskflow.hpp>
+
+// Two-stage frame pipeline. The main thread polls input and builds frame N+1's UI while an
+// executor worker records, submits and presents frame N. Render stages run strictly in order,
+// each one depends on the previous, and at most kDepth frames are queued ahead of the GPU.
+class FramePipeline {
+public:
+  static constexpr uint32_t kDepth = 2;
+
+  // A null executor renders inline on the calling thread
+  FramePipeline(tf::Executor *executor, VulkanContext *v);
+  ~FramePipeline();
+
+  FramePipeline(const FramePipeline &) = delete;
+  FramePipeline &operator=(const FramePipeline &) = delete;
+
+  void Submit(ImDrawData *draw_data);
+
+  // Blocks until every queued frame has been presented. Required before touching the
+  // swapchain or frame resources from the main thread.
+  void WaitIdle();
+
+  bool IsPipelined() const { return executor_ != nullptr; }
+
+private:
+  tf::Executor *executor_;
+  VulkanContext *v_;
+  std::array<DrawDataSnapshot, kDepth> snapshots_;
+  std::array<std::future<void>, kDepth> pending_;
+  tf::AsyncTask last_task_;
+  uint32_t next_slot_ = 0;
+};
@@ -0,0 +1,41 @@
+#include "ui/gpu-profiler-overlay.hpp"
+#include "imgui.h"
+#include <algorithm>
+#include <mutex>
+
+void DrawGpuProfilerOverlay(const GpuProfiler &profiler, bool *open) {
+  ImGui::SetNextWindowBgAlpha(0.8f);
+  if (!ImGui::Begin("GPU profiler", open, ImGuiWindowFlags_AlwaysAutoResize)) {
+    ImGui::End();
+    return;
+  }
+
+  ImGuiIO &io = ImGui::GetIO();
+  ImGui::Text("CPU frame: %.3f ms", 1000.0f / io.Framerate);
+  if (!profiler.IsEnabled()) {
+    ImGui::TextUnformatted("Timestamp queries are not supported on this device");
+    ImGui::End();
+    return;
+  }
+
+  std::lock_guard lock(profiler.GetResultsMutex());
+  int count = static_cast<int>(profiler.GetHistoryCount());
+  int offset = static_cast<int>(profiler.GetHistoryOffset());
+  for (uint32_t i = 0; i < GpuProfiler::kZoneCount; ++i) {
+    GpuZone zone = static_cast<GpuZone>(i);
+    const float *history = profiler.GetHistory(zone);
+    float peak = count > 0 ? *std::max_element(history, history + count) : 0.0f;
+
+    ImGui::PushID(static_cast<int>(i));
+    if (profiler.GetLastTime(zone) >= 0.0) {
+      ImGui::Text("%-12s %7.3f ms (max %.3f)", GpuZoneName(zone), profiler.GetLastTime(zone),
+                  peak);
+    } else {
+      ImGui::Text("%-12s     n/a", GpuZoneName(zone));
+    }
+    ImGui::PlotLines("##history", history, count, offset, nullptr, 0.0f, peak * 1.2f,
+                     ImVec2(0.0f, 40.0f));
+    ImGui::PopID();
+  }
+  ImGui::End();
+}
@@ -0,0 +1,4 @@
+#pragma once
+#include "gfx/gpu-profiler.hpp"
+
+void DrawGpuProfilerOverlay(const GpuProfiler &profiler, bool *open);
@@ -1,12 +1,98 @@
 #include "ui/imgui-context.hpp"
 #include "imgui.h"
+#include "platform/platform.hpp"
+#include "ui/draw-data-hash.hpp"
+#include "ui/frame-pipeline.hpp"
+#include "ui/gpu-profiler-overlay.hpp"
+#include "ui/memory-overlay.hpp"
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <future>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_vulkan.h>
 #include <platform/log.hpp>
+#include <vulkan/vk_enum_string_helper.h>
 
-void ImGuiContext::Run(VulkanContext *v, platform::Window *w) {
+namespace {
+
+const char *PresentModeLabel(VkPresentModeKHR mode) {
+  switch (mode) {
+  case VK_PRESENT_MODE_FIFO_KHR:
+    return "FIFO (vsync)";
+  case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+    return "FIFO relaxed";
+  case VK_PRESENT_MODE_MAILBOX_KHR:
+    return "Mailbox";
+  case VK_PRESENT_MODE_IMMEDIATE_KHR:
+    return "Immediate";
+  default:
+    return "Other";
+  }
+}
+
+void DrawPresentationSettings(VulkanContext *v, FramePipeline &pipeline) {
+  if (ImGui::BeginCombo("Present mode", PresentModeLabel(v->GetPresentMode()))) {
+    for (VkPresentModeKHR mode : v->GetSupportedPresentModes()) {
+      if (ImGui::Selectable(PresentModeLabel(mode), mode == v->GetPresentMode())) {
+        v->SetPresentMode(mode);
+      }
+    }
+    ImGui::EndCombo();
+  }
+
+  int frames_in_flight = static_cast<int>(v->GetFramesInFlight());
+  if (ImGui::SliderInt("Frames in flight", &frames_in_flight, 1,
+                       static_cast<int>(VulkanContext::kMaxFramesInFlight))) {
+    pipeline.WaitIdle();
+    v->SetFramesInFlight(static_cast<uint32_t>(frames_in_flight));
+  }
+
+  bool latency_first = v->IsLatencyFirst();
+  if (ImGui::Checkbox("Latency first", &latency_first)) {
+    v->SetLatencyFirst(latency_first);
+  }
+}
+
+void DrawRecordingSettings(VulkanContext *v, FramePipeline &pipeline, int &format) {
+  const FrameCapture &capture = v->GetFrameCapture();
+  if (!capture.IsActive()) {
+    ImGui::Combo("Format", &format, "Y4M video\0PNG frames\0");
+    if (ImGui::Button("Record")) {
+      // Named after the local start time so recordings never overwrite each other
+      char name[64];
+      std::time_t now = std::time(nullptr);
+      std::strftime(name, sizeof(name), "osc-%Y%m%d-%H%M%S", std::localtime(&now));
+      frameCaptureOpts opts;
+      opts.path = std::string(name) + (format == 0 ? ".y4m" : "");
+      opts.format = format == 0 ? FrameCaptureFormat::Y4m : FrameCaptureFormat::Png;
+      pipeline.WaitIdle();
+      v->StartFrameCapture(std::move(opts));
+    }
+    return;
+  }
+  ImGui::Text("Recording to %s", capture.GetPath().c_str());
+  ImGui::Text("%llu frames captured, %llu written, %llu dropped",
+              static_cast<unsigned long long>(capture.GetCapturedFrames()),
+              static_cast<unsigned long long>(capture.GetWrittenFrames()),
+              static_cast<unsigned long long>(capture.GetDroppedFrames()));
+  if (ImGui::Button("Stop")) {
+    pipeline.WaitIdle();
+    v->StopFrameCapture();
+  }
+}
+
+} // namespace
+
+void ImGuiContext::InitFonts(float scale) {
+  platform::MemoryScope memoryScope(platform::MemoryTag::Ui);
   IMGUI_CHECKVERSION();
   TE_TRACE("ImGui version: {}", IMGUI_VERSION);
+  ImGui::SetAllocatorFunctions(
+      [](size_t size, void *) {
+        return platform::MemoryStats::Allocate(size, platform::MemoryTag::Ui);
+      },
+      [](void *memory, void *) { platform::MemoryStats::Free(memory); });
   ImGui::CreateContext();
   ImGuiIO &io = ImGui::GetIO();
   static_cast<void>(io);
@@ -16,51 +102,305 @@ void ImGuiContext::Run(VulkanContext *v, platform::Window *w) {
   ImGui::StyleColorsDark();
 
   ImGuiStyle &style = ImGui::GetStyle();
-  style.ScaleAllSizes(w->main_scale);
-  style.FontScaleDpi = w->main_scale;
+  style.ScaleAllSizes(scale);
+  style.FontScaleDpi = scale;
 
+  // A frame without backends loads imgui.ini, builds the atlas and rasterizes ASCII at the UI
+  // size. The Vulkan backend sets the flag again, the atlas texture is uploaded with the first
+  // real frame.
+  io.BackendFlags |= ImGuiBackendFlags_RendererHasTextures;
+  io.DisplaySize = ImVec2(1.0f, 1.0f);
+  ImGui::NewFrame();
+  ImFontBaked *baked = ImGui::GetFontBaked();
+  for (ImWchar c = 0x20; c < 0x7f; ++c) {
+    baked->FindGlyph(c);
+  }
+  ImGui::EndFrame();
+  TE_TRACE("ImGui fonts rasterized");
+}
+
+VkResult ImGuiContext::Init(VulkanContext *v, platform::Window *w, tf::Executor *executor) {
+  platform::MemoryScope memoryScope(platform::MemoryTag::Ui);
+  if (!ImGui::GetCurrentContext()) {
+    InitFonts(w->main_scale);
+  }
+
+  // The polyline pipeline compiles on a worker alongside ImGui's, both through the pipeline cache
+  std::future<VkResult> polylines;
+  if (executor) {
+    polylines = executor->async([this, v] {
+      platform::MemoryScope workerScope(platform::MemoryTag::Ui);
+      return polylines_.Init(v, FramePipeline::kDepth);
+    });
+  }
   ImGui_ImplGlfw_InitForVulkan(w->GetWindowHandle(), true);
   ImGui_ImplVulkan_InitInfo initInfo = {};
+  initInfo.ApiVersion = v->GetApiVersion();
   initInfo.Instance = v->GetInstance();
   initInfo.PhysicalDevice = v->GetPhysicalDevice();
   initInfo.Device = v->GetDevice();
   initInfo.QueueFamily = v->GetQueueFamily();
   initInfo.Queue = v->GetQueue();
-  initInfo.PipelineCache = nullptr;
+  initInfo.PipelineCache = v->GetPipelineCache();
   initInfo.DescriptorPool = v->GetDescriptorPool();
   initInfo.MinImageCount = v->GetMinImageCount();
-  initInfo.ImageCount = v->wd.ImageCount;
-  initInfo.Allocator = nullptr;
+  initInfo.ImageCount = v->GetImageCount();
+  initInfo.Allocator = v->GetAllocationCallbacks();
   initInfo.PipelineInfoMain.RenderPass = v->wd.RenderPass;
   initInfo.PipelineInfoMain.Subpass = 0;
   initInfo.PipelineInfoMain.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
+  if (v->UsesDynamicRendering()) {
+    initInfo.UseDynamicRendering = true;
+    VkPipelineRenderingCreateInfoKHR &renderingInfo =
+        initInfo.PipelineInfoMain.PipelineRenderingCreateInfo;
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &v->wd.SurfaceFormat.format;
+  }
   initInfo.CheckVkResultFn = nullptr;
   ImGui_ImplVulkan_Init(&initInfo);
+  textures_.Init(v);
+  VkResult res =
+      polylines.valid() ? polylines.get() : polylines_.Init(v, FramePipeline::kDepth);
+  // Set even on failure, the ImGui backends are up and Terminate must shut them down
+  initialized_ = true;
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error initializing the polyline renderer: {}", string_VkResult(res));
+    return res;
+  }
+  TE_TRACE("Imgui sucessfully initialized");
+  return VK_SUCCESS;
+}
+
+void ImGuiContext::UpdateChannelTraces(const ingest::Ingest &ingest) {
+  while (channel_traces_.size() < ingest.GetChannelCount()) {
+    uint32_t channel = static_cast<uint32_t>(channel_traces_.size());
+    channel_traces_.push_back(
+        polylines_.AddTrace(static_cast<uint32_t>(ingest.GetHistorySize(channel))));
+  }
+  for (uint32_t i = 0; i < ingest.GetChannelCount(); ++i) {
+    ingest::channelSnapshot snapshot = ingest.GetSnapshot(i);
+    if (channel_traces_[i] == UINT32_MAX) {
+      continue;
+    }
+    polylines_.WriteSamples(channel_traces_[i], snapshot.total, snapshot.samples,
+                            static_cast<uint32_t>(snapshot.count));
+  }
+}
+
+void ImGuiContext::LockTriggers(const ingest::Ingest &ingest) {
+  channel_locks_.resize(ingest.GetChannelCount(), UINT64_MAX);
+  for (uint32_t i = 0; i < ingest.GetChannelCount(); ++i) {
+    ingest::channelSnapshot snapshot = ingest.GetSnapshot(i);
+    // Half the history either side of the trigger, so the newest event whose trailing half has
+    // arrived. Until one has, the previous lock holds while it is still in the history.
+    uint64_t half = snapshot.count / 4;
+    uint64_t oldest = snapshot.total - snapshot.count;
+    uint64_t &lock = channel_locks_[i];
+    if (lock != UINT64_MAX && (half == 0 || lock < oldest + half)) {
+      lock = UINT64_MAX;
+    }
+    for (size_t e = snapshot.trigger_count; e-- > 0;) {
+      uint64_t at = snapshot.triggers[e].sample;
+      if (half > 0 && at + half <= snapshot.total && at >= oldest + half) {
+        lock = at;
+        break;
+      }
+    }
+  }
+}
+
+void ImGuiContext::DrawTriggerSettings(ingest::Ingest &ingest, uint32_t channel) {
+  const dsp::triggerOpts *current = ingest.GetTrigger(channel);
+  if (!current) {
+    return;
+  }
+  dsp::triggerOpts opts = *current;
+  bool changed = false;
+  const char *modes[] = {"Rising", "Falling", "Window", "Pulse width", "Glitch"};
+  int mode = static_cast<int>(opts.mode);
+  ImGui::SetNextItemWidth(120.0f);
+  if (ImGui::Combo("Trigger", &mode, modes, IM_ARRAYSIZE(modes))) {
+    opts.mode = static_cast<dsp::TriggerMode>(mode);
+    changed = true;
+  }
+  ImGui::SameLine();
+  ImGui::SetNextItemWidth(200.0f);
+  if (opts.mode == dsp::TriggerMode::Window) {
+    changed |= ImGui::DragFloatRange2("Window", &opts.low, &opts.high, 0.01f);
+  } else {
+    changed |= ImGui::DragFloat("Level", &opts.level, 0.01f);
+  }
+  if (opts.mode == dsp::TriggerMode::PulseWidth || opts.mode == dsp::TriggerMode::Glitch) {
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(200.0f);
+    int widths[2] = {static_cast<int>(opts.min_width), static_cast<int>(opts.max_width)};
+    if (ImGui::DragInt2("Width", widths, 1.0f, 0, 1 << 20)) {
+      opts.min_width = static_cast<uint32_t>(widths[0]);
+      opts.max_width = static_cast<uint32_t>(std::max(widths[0], widths[1]));
+      changed = true;
+    }
+  }
+  if (changed) {
+    ingest.SetTrigger(channel, opts);
+  }
+}
+
+void ImGuiContext::DrawChannels(ingest::Ingest &ingest) {
+  trace_views_.resize(ingest.GetChannelCount());
+  channel_draws_.clear();
+  for (uint32_t i = 0; i < ingest.GetChannelCount(); ++i) {
+    ingest::channelSnapshot snapshot = ingest.GetSnapshot(i);
+    ImGui::Text("%s: %llu new, %llu total, %llu overruns", ingest.GetChannelName(i).c_str(),
+                static_cast<unsigned long long>(snapshot.new_samples),
+                static_cast<unsigned long long>(snapshot.total),
+                static_cast<unsigned long long>(snapshot.overruns));
+    ImGui::PushID(static_cast<int>(i));
+    DrawTriggerSettings(ingest, i);
+    if (snapshot.pyramid) {
+      trace_views_[i].Draw("##record", snapshot.record, *snapshot.pyramid, ImVec2(0.0f, 80.0f));
+    } else if (channel_traces_[i] != UINT32_MAX && snapshot.count >= 2) {
+      // The history window straight from its GPU trace, only the vertical range is computed here
+      ImVec2 size(ImGui::GetContentRegionAvail().x, 80.0f);
+      ImVec2 origin = ImGui::GetCursorScreenPos();
+      ImGui::Dummy(size);
+      uint64_t first = snapshot.total - snapshot.count;
+      uint64_t count = snapshot.count;
+      uint64_t lock = i < channel_locks_.size() ? channel_locks_[i] : UINT64_MAX;
+      if (lock != UINT64_MAX) {
+        // Half the history centred on the trigger, so the picture holds still
+        count = snapshot.count / 4 * 2;
+        first = lock - count / 2;
+      }
+      dsp::plotColumn bounds = ingest.GetHistoryRange(i, first, first + count);
+      float range = bounds.max > bounds.min ? bounds.max - bounds.min : 1.0f;
+      polylineTrace draw;
+      draw.trace = channel_traces_[i];
+      draw.first = first;
+      draw.count = static_cast<uint32_t>(count);
+      draw.x = origin.x;
+      draw.y = origin.y + size.y + bounds.min * (size.y - 1.0f) / range;
+      draw.x_step = size.x / static_cast<float>(count - 1);
+      draw.y_scale = -(size.y - 1.0f) / range;
+      draw.color = ImGui::GetColorU32(ImGuiCol_PlotLines);
+      channel_draws_.push_back(draw);
+      if (lock != UINT64_MAX) {
+        float x = origin.x + size.x * 0.5f;
+        ImGui::GetWindowDrawList()->AddLine(ImVec2(x, origin.y), ImVec2(x, origin.y + size.y),
+                                            ImGui::GetColorU32(ImGuiCol_PlotHistogram));
+      }
+    }
+    ImGui::PopID();
+  }
+  // Every channel in one draw
+  polylines_.Draw(ImGui::GetWindowDrawList(), channel_draws_.data(),
+                  static_cast<uint32_t>(channel_draws_.size()));
+}
+
+void ImGuiContext::DrawPlayback(const capture::Reader &reader) {
+  if (!ImGui::Begin("Playback")) {
+    ImGui::End();
+    return;
+  }
+  ImGui::Text("%.1f s captured", static_cast<double>(reader.GetDurationNs()) * 1e-9);
+  playback_views_.resize(reader.GetChannelCount());
+  for (uint32_t i = 0; i < reader.GetChannelCount(); ++i) {
+    ImGui::Text("%s: %llu samples", reader.GetChannelName(i).c_str(),
+                static_cast<unsigned long long>(reader.GetSampleCount(i)));
+    ImGui::PushID(static_cast<int>(i));
+    playback_views_[i].Draw("##capture", reader, i, ImVec2(0.0f, 120.0f));
+    ImGui::PopID();
+  }
+  ImGui::End();
+}
+
+void ImGuiContext::Run(VulkanContext *v, platform::Window *w, tf::Executor *executor,
+                       runOpts opts) {
+  TE_ZONE_THREAD("main");
+  platform::MemoryScope memoryScope(platform::MemoryTag::Ui);
+  if (!initialized_ && Init(v, w, executor) != VK_SUCCESS) {
+    return;
+  }
+  memory_ = platform::MemoryTelemetry(opts.memory);
+  if (opts.spectrum && opts.ingest) {
+    spectra_.Init(v, executor);
+  }
+  FramePipeline pipeline(opts.pipelined ? executor : nullptr, v);
 
   // Size for imgui window
   float imgui_height = 100.f;
   float imgui_width = 100.f;
   ImVec2 imgui_size(imgui_height, imgui_width);
 
-  TE_TRACE("Imgui sucessfully initialized");
+  if (opts.stats) {
+    opts.stats->Reserve(opts.frame_limit);
+  }
+
+  uint32_t frames = 0;
   while (!glfwWindowShouldClose(w->GetWindowHandle())) {
-    glfwPollEvents();
+    if (opts.frame_limit != 0 && frames >= opts.frame_limit) {
+      break;
+    }
+    auto frame_start = std::chrono::steady_clock::now();
+
+    if (v->IsLatencyFirst()) {
+      // Sample input as late as possible, right before building the frame that shows it
+      TE_ZONE("WaitForPreviousFrame");
+      pipeline.WaitIdle();
+      v->WaitForPreviousFrame();
+    }
+
+    {
+      TE_ZONE("glfwPollEvents");
+      // Block until input, a platform::Wake() from a data producer or the timeout once the UI
+      // has settled, the timeout keeps tooltips and cursor blinking alive
+      if (opts.idle && unchanged_frames_ >= kIdleAfterFrames) {
+        glfwWaitEventsTimeout(opts.idle_timeout_s);
+      } else {
+        glfwPollEvents();
+      }
+    }
 
+    // Resizes arrive through the framebuffer-size callback during event polling
     int fb_width;
     int fb_height;
-    glfwGetFramebufferSize(w->GetWindowHandle(), &fb_width, &fb_height);
-    if (fb_width > 0 && fb_height > 0) {
+    w->GetFramebufferSize(&fb_width, &fb_height);
+    bool resized = w->ConsumeResize();
+    if ((resized || v->NeedsSwapChainRebuild()) && fb_width > 0 && fb_height > 0) {
+      pipeline.WaitIdle();
       v->ResizeSwapChain(fb_width, fb_height);
+      // The new swapchain has nothing presented yet, whatever the draw data hashes to
+      last_draw_hash_ = 0;
+      unchanged_frames_ = 0;
+    }
+
+    if (opts.ingest) {
+      opts.ingest->Consume();
+      UpdateChannelTraces(*opts.ingest);
+      LockTriggers(*opts.ingest);
+      if (opts.spectrum) {
+        spectra_.Update(*opts.ingest);
+      }
     }
 
     if (glfwGetWindowAttrib(w->GetWindowHandle(), GLFW_ICONIFIED) != 0) {
-      ImGui_ImplGlfw_Sleep(10);
+      // Draw the first frame after a restore even if the UI didn't change
+      last_draw_hash_ = 0;
+      unchanged_frames_ = 0;
+      if (opts.idle) {
+        glfwWaitEvents();
+      } else {
+        ImGui_ImplGlfw_Sleep(10);
+      }
       continue;
     }
 
-    ImGui_ImplGlfw_NewFrame();
-    ImGui_ImplVulkan_NewFrame();
-    ImGui::NewFrame();
+    {
+      TE_ZONE("ImGui::NewFrame");
+      ImGui_ImplGlfw_NewFrame();
+      ImGui_ImplVulkan_NewFrame();
+      ImGui::NewFrame();
+    }
 
     {
       ImGui::Begin("Controls", nullptr, ImGuiWindowFlags_NoResize);
@@ -68,21 +408,90 @@ void ImGuiContext::Run(VulkanContext *v, platform::Window *w) {
       if (ImGui::Button("Exit")) {
         glfwSetWindowShouldClose(w->GetWindowHandle(), GLFW_TRUE);
       }
+      ImGui::Checkbox("GPU profiler", &show_gpu_profiler_);
+      ImGui::SameLine();
+      ImGui::Checkbox("Memory", &show_memory_);
+      if (ImGui::CollapsingHeader("Presentation")) {
+        DrawPresentationSettings(v, pipeline);
+      }
+      if (ImGui::CollapsingHeader("Recording")) {
+        DrawRecordingSettings(v, pipeline, record_format_);
+      }
+      if (opts.ingest && opts.ingest->GetChannelCount() > 0 &&
+          ImGui::CollapsingHeader("Channels")) {
+        DrawChannels(*opts.ingest);
+      }
+      if (opts.spectrum && opts.ingest && opts.ingest->GetChannelCount() > 0 &&
+          ImGui::CollapsingHeader("Spectrum")) {
+        spectra_.Draw(*opts.ingest, 80.0f);
+      }
+#ifdef TE_ENABLE_ZONES
+      if (ImGui::Button("Dump trace")) {
+        platform::Trace::DumpChromeTrace("osc-trace.json");
+      }
+#endif
       ImGui::End();
     }
 
-    ImGui::Render();
+    if (show_gpu_profiler_) {
+      DrawGpuProfilerOverlay(v->GetGpuProfiler(), &show_gpu_profiler_);
+    }
+    if (show_memory_) {
+      DrawMemoryOverlay(memory_, &show_memory_);
+    }
+
+    if (opts.playback) {
+      DrawPlayback(*opts.playback);
+    }
+
+    {
+      TE_ZONE("ImGui::Render");
+      ImGui::Render();
+    }
     ImDrawData *draw_data = ImGui::GetDrawData();
     const bool is_minimized =
         (draw_data->DisplaySize.x <= 0.0f || draw_data->DisplaySize.y <= 0.0f);
-    if (!is_minimized) {
-      v->FrameRender(draw_data);
-      v->FramePresent();
+
+    bool unchanged = false;
+    if (opts.idle) {
+      uint64_t draw_hash = HashDrawData(draw_data);
+      // Uploads issued this frame are only acquired and waited on by a rendered frame
+      unchanged = draw_hash == last_draw_hash_ && !HasPendingTextureUpdates(draw_data) &&
+                  !v->GetUploader().HasPendingWork();
+      // Nothing reaches the screen while minimized, so nothing counts as already shown
+      last_draw_hash_ = is_minimized ? 0 : draw_hash;
+      unchanged_frames_ = unchanged ? unchanged_frames_ + 1 : 0;
+    }
+    if (!is_minimized && !unchanged) {
+      textures_.Update(draw_data);
+      pipeline.Submit(draw_data);
+    }
+
+    ++frames;
+    if (opts.stats) {
+      std::chrono::duration<double, std::milli> cpu_ms =
+          std::chrono::steady_clock::now() - frame_start;
+      opts.stats->AddCpuFrame(cpu_ms.count());
+      if (v->GetGpuFrameTime() >= 0.0) {
+        opts.stats->AddGpuFrame(v->GetGpuFrameTime());
+      }
+    }
+    if (memory_.EndFrame()) {
+      v->GetHeapUsage(&device_heaps_);
+      memory_.SetDeviceHeaps(device_heaps_);
+    }
+    // In pipelined mode the first frame is submitted on a worker, seen one iteration later
+    if (opts.startup && v->GetSubmittedFrames() > 0) {
+      opts.startup->Finish();
+      opts.startup = nullptr;
     }
   }
 }
 
 void ImGuiContext::Terminate() {
+  spectra_.Destroy();
+  polylines_.Destroy();
+  textures_.Destroy();
   ImGui_ImplVulkan_Shutdown();
   ImGui_ImplGlfw_Shutdown();
   ImGui::DestroyContext();
@@ -1,9 +1,78 @@
 #pragma once
+#include "capture/reader.hpp"
+#include "gfx/polyline-renderer.hpp"
 #include "gfx/vulkan-context.hpp"
+#include "ingest/ingest.hpp"
+#include "platform/frame-stats.hpp"
+#include "platform/memory-telemetry.hpp"
+#include "platform/startup-report.hpp"
 #include "platform/window.hpp"
+#include "ui/imgui-textures.hpp"
+#include "ui/spectrum-view.hpp"
+#include "ui/trace-view.hpp"
+#include <cstdint>
+#include <taskflow/taskflow.hpp>
+#include <vector>
+
+struct runOpts {
+  // Stop after this many rendered frames, 0 runs until the window is closed
+  uint32_t frame_limit = 0;
+  platform::FrameStats *stats = nullptr;
+  // Skip frames whose draw data is unchanged and sleep until input once the UI has settled
+  bool idle = true;
+  double idle_timeout_s = 0.25;
+  // Record and present frame N on an executor worker while frame N+1's UI is built
+  bool pipelined = true;
+  // Drained once per frame before the UI is built
+  ingest::Ingest *ingest = nullptr;
+  // Spectrum and waterfall of every ingest channel, computed on executor workers
+  bool spectrum = true;
+  // Shown in a Playback window
+  const capture::Reader *playback = nullptr;
+  // Memory overlay sampling and the periodic memory log line
+  platform::memoryTelemetryOpts memory;
+  // Finished and logged once the first frame is submitted
+  platform::StartupReport *startup = nullptr;
+};
 
 class ImGuiContext {
 public:
-  void Run(VulkanContext *v, platform::Window *window);
+  // Creates the ImGui context and rasterizes the default font. Touches no backend and may run
+  // on any thread while the window and device are still being created.
+  void InitFonts(float scale);
+  // Backends and renderers, main thread. Run calls it when startup hasn't.
+  VkResult Init(VulkanContext *v, platform::Window *window, tf::Executor *executor);
+  void Run(VulkanContext *v, platform::Window *window, tf::Executor *executor,
+           runOpts opts = {});
   void Terminate();
+
+private:
+  // Brings each channel's GPU trace up to date, every frame whether drawn or not
+  void UpdateChannelTraces(const ingest::Ingest &ingest);
+  // Picks the trigger each channel's view is centred on, UINT64_MAX free runs
+  void LockTriggers(const ingest::Ingest &ingest);
+  void DrawChannels(ingest::Ingest &ingest);
+  void DrawTriggerSettings(ingest::Ingest &ingest, uint32_t channel);
+  void DrawPlayback(const capture::Reader &reader);
+
+  static constexpr uint32_t kIdleAfterFrames = 3;
+
+  ImGuiTextures textures_;
+  PolylineRenderer polylines_;
+  SpectrumView spectra_;
+  // One per ingest channel
+  std::vector<TraceView> trace_views_;
+  std::vector<TraceView> playback_views_;
+  std::vector<uint32_t> channel_traces_;
+  std::vector<polylineTrace> channel_draws_;
+  std::vector<uint64_t> channel_locks_;
+  bool show_gpu_profiler_ = false;
+  bool show_memory_ = false;
+  platform::MemoryTelemetry memory_;
+  std::vector<platform::deviceHeapUsage> device_heaps_;
+  // Index into the Recording format combo, Y4M or PNG
+  int record_format_ = 0;
+  bool initialized_ = false;
+  uint64_t last_draw_hash_ = 0;
+  uint32_t unchanged_frames_ = 0;
 };
@@ -0,0 +1,166 @@
+#include "ui/imgui-textures.hpp"
+#include "platform/log.hpp"
+#include "ui/frame-pipeline.hpp"
+#include <imgui_impl_vulkan.h>
+
+void ImGuiTextures::Init(VulkanContext *v) {
+  v_ = v;
+
+  VkSamplerCreateInfo samplerInfo{};
+  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter = VK_FILTER_LINEAR;
+  samplerInfo.minFilter = VK_FILTER_LINEAR;
+  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.minLod = -1000;
+  samplerInfo.maxLod = 1000;
+  samplerInfo.maxAnisotropy = 1.0f;
+  if (vkCreateSampler(v_->GetDevice(), &samplerInfo, v_->GetAllocationCallbacks(), &sampler_) !=
+      VK_SUCCESS) {
+    TE_ERROR("Error creating ImGui texture sampler");
+  }
+}
+
+void ImGuiTextures::Update(ImDrawData *draw_data) {
+  Collect(false);
+  if (!draw_data->Textures) {
+    return;
+  }
+
+  for (ImTextureData *tex : *draw_data->Textures) {
+    switch (tex->Status) {
+    case ImTextureStatus_WantCreate:
+      Create(tex);
+      break;
+    case ImTextureStatus_WantUpdates:
+      // Rebuilding the whole image is cheaper than draining queued frames to patch it in place
+      Retire(tex);
+      Create(tex);
+      break;
+    case ImTextureStatus_WantDestroy:
+      Retire(tex);
+      tex->SetTexID(ImTextureID_Invalid);
+      tex->SetStatus(ImTextureStatus_Destroyed);
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+VkResult ImGuiTextures::Create(ImTextureData *tex) {
+  VkDevice device = v_->GetDevice();
+  const VkAllocationCallbacks *allocator = v_->GetAllocationCallbacks();
+  bool alpha = tex->Format == ImTextureFormat_Alpha8;
+  auto *result = new texture();
+
+  VkImageCreateInfo imageInfo{};
+  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.format = alpha ? VK_FORMAT_R8_UNORM : VK_FORMAT_R8G8B8A8_UNORM;
+  imageInfo.extent = {static_cast<uint32_t>(tex->Width), static_cast<uint32_t>(tex->Height), 1};
+  imageInfo.mipLevels = 1;
+  imageInfo.arrayLayers = 1;
+  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+  imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  VkResult res = v_->GetDeviceAllocator().CreateImage(imageInfo, MemoryUsage::GpuOnly,
+                                                      &result->image, &result->memory);
+  if (res != VK_SUCCESS) {
+    delete result;
+    return res;
+  }
+
+  VkImageViewCreateInfo viewInfo{};
+  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.image = result->image;
+  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.format = imageInfo.format;
+  if (alpha) {
+    viewInfo.components = {VK_COMPONENT_SWIZZLE_ONE, VK_COMPONENT_SWIZZLE_ONE,
+                           VK_COMPONENT_SWIZZLE_ONE, VK_COMPONENT_SWIZZLE_R};
+  }
+  viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  viewInfo.subresourceRange.levelCount = 1;
+  viewInfo.subresourceRange.layerCount = 1;
+  res = vkCreateImageView(device, &viewInfo, allocator, &result->view);
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error creating ImGui texture view");
+    DestroyTexture(result);
+    return res;
+  }
+
+  // Frames that sample the texture wait for the upload on the GPU, the CPU never blocks
+  UploadTicket ticket;
+  res = v_->GetUploader().UploadImage(result->image, imageInfo.extent.width,
+                                      imageInfo.extent.height, tex->BytesPerPixel,
+                                      tex->GetPixels(),
+                                      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, &ticket);
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error uploading ImGui texture");
+    DestroyTexture(result);
+    return res;
+  }
+
+  result->descriptor_set = ImGui_ImplVulkan_AddTexture(sampler_, result->view,
+                                                       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  tex->BackendUserData = result;
+  tex->SetTexID(reinterpret_cast<ImTextureID>(result->descriptor_set));
+  tex->SetStatus(ImTextureStatus_OK);
+  return VK_SUCCESS;
+}
+
+void ImGuiTextures::Retire(ImTextureData *tex) {
+  auto *old = static_cast<texture *>(tex->BackendUserData);
+  tex->BackendUserData = nullptr;
+  if (!old) {
+    return;
+  }
+  // Submitted frames and the ones queued in the frame pipeline may still sample it, the frame
+  // about to be captured already sees the new texture ID
+  retired_.push_back({v_->GetSubmittedFrames() + FramePipeline::kDepth, old});
+}
+
+void ImGuiTextures::DestroyTexture(texture *tex) {
+  VkDevice device = v_->GetDevice();
+  const VkAllocationCallbacks *allocator = v_->GetAllocationCallbacks();
+  if (tex->descriptor_set != VK_NULL_HANDLE) {
+    ImGui_ImplVulkan_RemoveTexture(tex->descriptor_set);
+  }
+  vkDestroyImageView(device, tex->view, allocator);
+  if (tex->image != VK_NULL_HANDLE) {
+    vkDestroyImage(device, tex->image, allocator);
+    v_->GetDeviceAllocator().Free(tex->memory);
+  }
+  delete tex;
+}
+
+void ImGuiTextures::Collect(bool all) {
+  // Descriptor sets go back to the shared pool here, on the main thread that allocates them
+  while (!retired_.empty() &&
+         (all || retired_.front().safe_after <= v_->GetCompletedFrames())) {
+    DestroyTexture(retired_.front().tex);
+    retired_.pop_front();
+  }
+}
+
+void ImGuiTextures::Destroy() {
+  if (!v_) {
+    return;
+  }
+  vkDeviceWaitIdle(v_->GetDevice());
+  // Cleared before ImGui_ImplVulkan_Shutdown, which would treat BackendUserData as its own
+  for (ImTextureData *tex : ImGui::GetPlatformIO().Textures) {
+    Retire(tex);
+    tex->SetTexID(ImTextureID_Invalid);
+    tex->SetStatus(ImTextureStatus_Destroyed);
+  }
+  Collect(true);
+  vkDestroySampler(v_->GetDevice(), sampler_, v_->GetAllocationCallbacks());
+  sampler_ = VK_NULL_HANDLE;
+  v_ = nullptr;
+}
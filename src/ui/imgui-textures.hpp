@@ -0,0 +1,39 @@
+#pragma once
+#include "gfx/vulkan-context.hpp"
+#include "imgui.h"
+#include <cstdint>
+#include <deque>
+
+// Renderer side of ImGui's dynamic textures (font atlas, user textures). Pixels stream through
+// the VulkanContext uploader instead of ImGui_ImplVulkan_UpdateTexture's blocking submit, and an
+// update builds a fresh image so queued frames keep sampling the old one until they retire.
+class ImGuiTextures {
+public:
+  void Init(VulkanContext *v);
+  // Main thread, after ImGui::Render and before the draw data is captured
+  void Update(ImDrawData *draw_data);
+  // Waits for the device to go idle
+  void Destroy();
+
+private:
+  struct texture {
+    VkImage image = VK_NULL_HANDLE;
+    deviceAllocation memory;
+    VkImageView view = VK_NULL_HANDLE;
+    VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
+  };
+
+  struct retiredTexture {
+    uint64_t safe_after;
+    texture *tex;
+  };
+
+  VkResult Create(ImTextureData *tex);
+  void Retire(ImTextureData *tex);
+  void DestroyTexture(texture *tex);
+  void Collect(bool all);
+
+  VulkanContext *v_ = nullptr;
+  VkSampler sampler_ = VK_NULL_HANDLE;
+  std::deque<retiredTexture> retired_;
+};
@@ -0,0 +1,76 @@
+#include "ui/memory-overlay.hpp"
+#include "imgui.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+float Mib(uint64_t bytes) { return static_cast<float>(bytes) / (1024.0f * 1024.0f); }
+
+} // namespace
+
+void DrawMemoryOverlay(const platform::MemoryTelemetry &telemetry, bool *open) {
+  ImGui::SetNextWindowBgAlpha(0.8f);
+  if (!ImGui::Begin("Memory", open, ImGuiWindowFlags_AlwaysAutoResize)) {
+    ImGui::End();
+    return;
+  }
+
+  const platform::memoryTagStats &total = telemetry.GetTotalStats();
+  ImGui::Text("Host: %.1f MiB live, %.1f MiB peak", Mib(total.live_bytes), Mib(total.peak_bytes));
+  ImGui::Text("%.0f allocs/s, %+.1f KiB/s", telemetry.GetAllocationRate(),
+              telemetry.GetByteGrowthRate() / 1024.0);
+  if (!platform::MemoryStats::TracksHeap()) {
+    ImGui::TextUnformatted("operator new is not tracked, build with OSC_TRACK_HEAP");
+  }
+
+  if (ImGui::BeginTable("tags", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit)) {
+    ImGui::TableSetupColumn("Tag");
+    ImGui::TableSetupColumn("Live MiB");
+    ImGui::TableSetupColumn("Peak MiB");
+    ImGui::TableSetupColumn("Allocs");
+    ImGui::TableSetupColumn("Frees");
+    ImGui::TableHeadersRow();
+    for (uint32_t i = 0; i < platform::MemoryStats::kTagCount; ++i) {
+      platform::MemoryTag tag = static_cast<platform::MemoryTag>(i);
+      platform::memoryTagStats stats = telemetry.GetTagStats(tag);
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(platform::MemoryTagName(tag));
+      ImGui::TableNextColumn();
+      ImGui::Text("%.2f", Mib(stats.live_bytes));
+      ImGui::TableNextColumn();
+      ImGui::Text("%.2f", Mib(stats.peak_bytes));
+      ImGui::TableNextColumn();
+      ImGui::Text("%llu", static_cast<unsigned long long>(stats.allocations));
+      ImGui::TableNextColumn();
+      ImGui::Text("%llu", static_cast<unsigned long long>(stats.frees));
+    }
+    ImGui::EndTable();
+  }
+
+  // A steady non-zero line here is the hot loop allocating every frame
+  ImGui::Text("Allocations per frame: %llu (max %llu)",
+              static_cast<unsigned long long>(telemetry.GetFrameAllocations()),
+              static_cast<unsigned long long>(telemetry.GetMaxFrameAllocations()));
+  int count = static_cast<int>(telemetry.GetHistoryCount());
+  const float *history = telemetry.GetHistory();
+  float peak = count > 0 ? *std::max_element(history, history + count) : 0.0f;
+  ImGui::PlotLines("##frame-allocations", history, count,
+                   static_cast<int>(telemetry.GetHistoryOffset()), nullptr, 0.0f,
+                   std::max(peak * 1.2f, 1.0f), ImVec2(0.0f, 40.0f));
+
+  const std::vector<platform::deviceHeapUsage> &heaps = telemetry.GetDeviceHeaps();
+  for (size_t i = 0; i < heaps.size(); ++i) {
+    const platform::deviceHeapUsage &heap = heaps[i];
+    uint64_t used = std::max(heap.usage, heap.reserved);
+    float fraction = heap.budget > 0 ? static_cast<float>(used) / static_cast<float>(heap.budget)
+                                     : 0.0f;
+    char label[96];
+    std::snprintf(label, sizeof(label), "%.0f / %.0f MiB (peak %.0f)", Mib(used),
+                  Mib(heap.budget), Mib(heap.peak));
+    ImGui::Text("Heap %zu%s", i, heap.device_local ? " (device local)" : "");
+    ImGui::ProgressBar(fraction, ImVec2(-1.0f, 0.0f), label);
+  }
+  ImGui::End();
+}
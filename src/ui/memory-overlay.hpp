@@ -0,0 +1,4 @@
+#pragma once
+#include "platform/memory-telemetry.hpp"
+
+void DrawMemoryOverlay(const platform::MemoryTelemetry &telemetry, bool *open);
@@ -0,0 +1,258 @@
+#include "ui/spectrum-view.hpp"
+#include "platform/log.hpp"
+#include "platform/trace.hpp"
+#include <algorithm>
+#include <imgui_impl_vulkan.h>
+
+void SpectrumView::Init(VulkanContext *v, tf::Executor *executor, const dsp::spectrumOpts &opts) {
+  v_ = v;
+  executor_ = executor;
+  opts_ = opts;
+
+  VkSamplerCreateInfo samplerInfo{};
+  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter = VK_FILTER_LINEAR;
+  samplerInfo.minFilter = VK_FILTER_LINEAR;
+  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  // Rows wrap around the texture, sampling across the seam would blend oldest and newest
+  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.maxAnisotropy = 1.0f;
+  if (vkCreateSampler(v_->GetDevice(), &samplerInfo, v_->GetAllocationCallbacks(), &sampler_) !=
+      VK_SUCCESS) {
+    TE_ERROR("Error creating waterfall sampler");
+  }
+}
+
+VkResult SpectrumView::CreateWaterfall(channel &c) {
+  VkDevice device = v_->GetDevice();
+  waterfallImage &w = c.images.emplace_back();
+
+  VkImageCreateInfo imageInfo{};
+  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+  imageInfo.extent = {c.analyzer->GetBinCount(), opts_.waterfall_rows, 1};
+  imageInfo.mipLevels = 1;
+  imageInfo.arrayLayers = 1;
+  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+  // Rows are added in place, so the image never changes queue family ownership
+  v_->GetUploader().ShareImage(&imageInfo);
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  VkResult res = v_->GetDeviceAllocator().CreateImage(imageInfo, MemoryUsage::GpuOnly, &w.image,
+                                                      &w.memory);
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error creating waterfall image");
+    c.images.pop_back();
+    return res;
+  }
+
+  VkImageViewCreateInfo viewInfo{};
+  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.image = w.image;
+  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.format = imageInfo.format;
+  viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  viewInfo.subresourceRange.levelCount = 1;
+  viewInfo.subresourceRange.layerCount = 1;
+  res = vkCreateImageView(device, &viewInfo, v_->GetAllocationCallbacks(), &w.view);
+  if (res != VK_SUCCESS) {
+    TE_ERROR("Error creating waterfall view");
+    DestroyImage(w);
+    c.images.pop_back();
+    return res;
+  }
+  w.descriptor_set =
+      ImGui_ImplVulkan_AddTexture(sampler_, w.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  return VK_SUCCESS;
+}
+
+SpectrumView::waterfallImage *SpectrumView::AcquireBackImage(channel &c) {
+  uint64_t completed = v_->GetCompletedFrames();
+  for (uint32_t i = 0; i < c.images.size(); ++i) {
+    // The front image is only free before its first upload
+    bool drawn = i == c.front && c.images[i].cleared;
+    if (!drawn && c.images[i].busy_until <= completed) {
+      return &c.images[i];
+    }
+  }
+  if (c.images.size() < kWaterfallImages && CreateWaterfall(c) == VK_SUCCESS) {
+    return &c.images.back();
+  }
+  return nullptr;
+}
+
+void SpectrumView::BuildBatch() {
+  batch_.clear();
+  // One worker stays free for the render stage, each task takes every n-th channel
+  size_t workers = executor_->num_workers();
+  size_t tasks = std::clamp<size_t>(workers > 1 ? workers - 1 : 1, 1, channels_.size());
+  for (size_t t = 0; t < tasks; ++t) {
+    batch_.emplace([this, t, tasks] {
+      TE_ZONE("SpectrumView::Batch");
+      for (size_t i = t; i < channels_.size(); i += tasks) {
+        channels_[i].analyzer->Process();
+      }
+    });
+  }
+  batch_dirty_ = false;
+}
+
+void SpectrumView::Wait() {
+  if (running_.valid()) {
+    TE_ZONE("SpectrumView::Wait");
+    running_.wait();
+  }
+}
+
+void SpectrumView::UploadRows(channel &c) {
+  uint64_t total = c.analyzer->GetRowCount();
+  if (c.images[c.front].rows == total && c.images[c.front].cleared) {
+    return;
+  }
+  // Queued frames still sample the front image. Without a free one the rows wait a frame.
+  waterfallImage *w = AcquireBackImage(c);
+  if (!w) {
+    return;
+  }
+  Uploader &uploader = v_->GetUploader();
+  uint32_t width = c.analyzer->GetBinCount();
+  uint32_t height = opts_.waterfall_rows;
+  UploadTicket ticket;
+  if (!w->cleared) {
+    blank_.assign(size_t{width} * height, 0xff000000u);
+    if (uploader.UploadImageRows(w->image, width, 0, height, sizeof(uint32_t), blank_.data(),
+                                 VK_IMAGE_LAYOUT_UNDEFINED,
+                                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                 &ticket) != VK_SUCCESS) {
+      TE_WARN("Error uploading waterfall image");
+      return;
+    }
+    w->cleared = true;
+  }
+
+  uint64_t kept = std::min<uint64_t>(total, height);
+  uint64_t first = std::max(w->rows, total - kept);
+  // At most two spans, split where the ring wraps
+  while (first < total) {
+    uint32_t start = static_cast<uint32_t>(first % height);
+    uint32_t n = static_cast<uint32_t>(std::min<uint64_t>(total - first, height - start));
+    if (uploader.UploadImageRows(w->image, width, start, n, sizeof(uint32_t),
+                                 c.analyzer->GetRow(first),
+                                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                 &ticket) != VK_SUCCESS) {
+      TE_WARN("Error uploading waterfall rows");
+      break;
+    }
+    first += n;
+  }
+  w->rows = first;
+  if (first == total) {
+    c.front = static_cast<uint32_t>(w - c.images.data());
+  }
+}
+
+void SpectrumView::Update(const ingest::Ingest &ingest) {
+  TE_ZONE("SpectrumView::Update");
+  Wait();
+  for (channel &c : channels_) {
+    if (!c.images.empty()) {
+      UploadRows(c);
+    }
+    const float *spectrum = c.analyzer->GetSpectrum();
+    c.spectrum.assign(spectrum, spectrum + c.analyzer->GetBinCount());
+  }
+
+  while (channels_.size() < ingest.GetChannelCount()) {
+    channel &c = channels_.emplace_back();
+    c.analyzer = std::make_unique<dsp::SpectrumAnalyzer>(opts_);
+    c.spectrum.assign(c.analyzer->GetBinCount(), opts_.min_db);
+    // Without images the channel only shows its spectrum
+    if (channels_.size() <= kMaxWaterfalls) {
+      CreateWaterfall(c);
+    }
+    batch_dirty_ = true;
+  }
+  if (channels_.empty()) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < channels_.size(); ++i) {
+    ingest::channelSnapshot snapshot = ingest.GetSnapshot(i);
+    uint64_t n = std::min<uint64_t>(snapshot.new_samples, snapshot.count);
+    channels_[i].analyzer->Feed(snapshot.samples + snapshot.count - n, static_cast<size_t>(n));
+  }
+
+  if (!executor_) {
+    for (channel &c : channels_) {
+      c.analyzer->Process();
+    }
+    return;
+  }
+  if (batch_dirty_) {
+    BuildBatch();
+  }
+  running_ = executor_->run(batch_);
+}
+
+void SpectrumView::Draw(const ingest::Ingest &ingest, float height) {
+  // Analyzers belong to the running batch, only the copies made in Update are read here
+  uint32_t count = std::min(static_cast<uint32_t>(channels_.size()), ingest.GetChannelCount());
+  for (uint32_t i = 0; i < count; ++i) {
+    channel &c = channels_[i];
+    ImGui::PushID(static_cast<int>(i));
+    ImVec2 size(ImGui::GetContentRegionAvail().x, height);
+    ImGui::PlotLines("##spectrum", c.spectrum.data(), static_cast<int>(c.spectrum.size()), 0,
+                     ingest.GetChannelName(i).c_str(), opts_.min_db, opts_.max_db, size);
+    if (!c.images.empty() && c.images[c.front].cleared) {
+      waterfallImage &w = c.images[c.front];
+      w.busy_until = v_->GetSubmittedFrames() + FramePipeline::kDepth;
+      ImVec2 origin = ImGui::GetCursorScreenPos();
+      ImGui::Dummy(size);
+      // Oldest row on top: from the ring head to the bottom of the texture, then the wrapped rows
+      float head = static_cast<float>(w.rows % opts_.waterfall_rows) /
+                   static_cast<float>(opts_.waterfall_rows);
+      float split = origin.y + size.y * (1.0f - head);
+      auto id = reinterpret_cast<ImTextureID>(w.descriptor_set);
+      ImDrawList *draw = ImGui::GetWindowDrawList();
+      draw->AddImage(id, origin, ImVec2(origin.x + size.x, split), ImVec2(0.0f, head),
+                     ImVec2(1.0f, 1.0f));
+      draw->AddImage(id, ImVec2(origin.x, split), ImVec2(origin.x + size.x, origin.y + size.y),
+                     ImVec2(0.0f, 0.0f), ImVec2(1.0f, head));
+    }
+    ImGui::PopID();
+  }
+}
+
+void SpectrumView::Destroy() {
+  if (!v_) {
+    return;
+  }
+  Wait();
+  vkDeviceWaitIdle(v_->GetDevice());
+  for (channel &c : channels_) {
+    for (waterfallImage &w : c.images) {
+      DestroyImage(w);
+    }
+  }
+  channels_.clear();
+  vkDestroySampler(v_->GetDevice(), sampler_, v_->GetAllocationCallbacks());
+  sampler_ = VK_NULL_HANDLE;
+  v_ = nullptr;
+}
+
+void SpectrumView::DestroyImage(waterfallImage &w) {
+  if (w.descriptor_set != VK_NULL_HANDLE) {
+    ImGui_ImplVulkan_RemoveTexture(w.descriptor_set);
+  }
+  vkDestroyImageView(v_->GetDevice(), w.view, v_->GetAllocationCallbacks());
+  if (w.image != VK_NULL_HANDLE) {
+    vkDestroyImage(v_->GetDevice(), w.image, v_->GetAllocationCallbacks());
+    v_->GetDeviceAllocator().Free(w.memory);
+  }
+  w = {};
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "dsp/spectrum.hpp"
+#include "gfx/vulkan-context.hpp"
+#include "imgui.h"
+#include "ingest/ingest.hpp"
+#include "ui/frame-pipeline.hpp"
+#include <cstdint>
+#include <memory>
+#include <taskflow/taskflow.hpp>
+#include <vector>
+
+// Spectra and scrolling waterfalls of every ingest channel. Each frame the main thread feeds the
+// new samples, and one batch transforms every channel on executor workers while the UI is built.
+// The next frame collects the batch and uploads only the waterfall rows it added.
+class SpectrumView {
+public:
+  // Waterfall textures are capped, channels past it only get a spectrum
+  static constexpr uint32_t kMaxWaterfalls = 64;
+  // Images per waterfall. Rows go to one that no queued frame samples, then it is drawn.
+  static constexpr uint32_t kWaterfallImages = FramePipeline::kDepth + 1;
+
+  // A null executor transforms inline in Update
+  void Init(VulkanContext *v, tf::Executor *executor, const dsp::spectrumOpts &opts = {});
+  // Main thread after Ingest::Consume, waits for the previous batch and starts the next one
+  void Update(const ingest::Ingest &ingest);
+  void Draw(const ingest::Ingest &ingest, float height);
+  // Waits for the batch and the device
+  void Destroy();
+
+private:
+  struct waterfallImage {
+    VkImage image = VK_NULL_HANDLE;
+    deviceAllocation memory;
+    VkImageView view = VK_NULL_HANDLE;
+    VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
+    // Analyzer rows up to this one are in the image
+    uint64_t rows = 0;
+    // False until the blank contents are uploaded
+    bool cleared = false;
+    // Frame that last samples it, see VulkanContext::GetCompletedFrames
+    uint64_t busy_until = 0;
+  };
+
+  struct channel {
+    std::unique_ptr<dsp::SpectrumAnalyzer> analyzer;
+    // Created on demand up to kWaterfallImages, empty for channels past kMaxWaterfalls
+    std::vector<waterfallImage> images;
+    // The image drawn, the one with the most rows
+    uint32_t front = 0;
+    // Copied between batches for drawing while the next batch runs
+    std::vector<float> spectrum;
+  };
+
+  VkResult CreateWaterfall(channel &c);
+  // An image of c that no queued frame samples, nullptr when all are busy
+  waterfallImage *AcquireBackImage(channel &c);
+  void UploadRows(channel &c);
+  void DestroyImage(waterfallImage &w);
+  void BuildBatch();
+  void Wait();
+
+  VulkanContext *v_ = nullptr;
+  tf::Executor *executor_ = nullptr;
+  dsp::spectrumOpts opts_;
+  VkSampler sampler_ = VK_NULL_HANDLE;
+  std::vector<channel> channels_;
+  // Rebuilt when channels are added, run once per frame
+  tf::Taskflow batch_;
+  bool batch_dirty_ = true;
+  tf::Future<void> running_;
+  // Initial contents of a waterfall
+  std::vector<uint32_t> blank_;
+};
@@ -0,0 +1,131 @@
+#include "ui/trace-view.hpp"
+#include "platform/trace.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Narrowest zoom, in samples across the whole widget
+constexpr double kMinSpan = 16.0;
+
+struct pyramidSource {
+  const float *raw;
+  const dsp::MinMaxPyramid &pyramid;
+
+  uint64_t GetSampleCount() const { return pyramid.GetSampleCount(); }
+  uint32_t Decimate(uint64_t first, uint64_t last, uint32_t columns, dsp::plotColumn *out) const {
+    return pyramid.Decimate(raw, first, last, columns, out);
+  }
+  dsp::plotColumn Reduce(uint64_t first, uint64_t last) const {
+    return pyramid.Reduce(raw, first, last);
+  }
+};
+
+struct captureSource {
+  const capture::Reader &reader;
+  uint32_t channel;
+
+  uint64_t GetSampleCount() const { return reader.GetSampleCount(channel); }
+  uint32_t Decimate(uint64_t first, uint64_t last, uint32_t columns, dsp::plotColumn *out) const {
+    return reader.Decimate(channel, first, last, columns, out);
+  }
+  dsp::plotColumn Reduce(uint64_t first, uint64_t last) const {
+    return reader.Reduce(channel, first, last);
+  }
+};
+
+} // namespace
+
+void TraceView::Draw(const char *id, const float *raw, const dsp::MinMaxPyramid &pyramid,
+                     ImVec2 size) {
+  DrawSource(id, pyramidSource{raw, pyramid}, size);
+}
+
+void TraceView::Draw(const char *id, const capture::Reader &reader, uint32_t channel,
+                     ImVec2 size) {
+  DrawSource(id, captureSource{reader, channel}, size);
+}
+
+template <typename Source>
+void TraceView::DrawSource(const char *id, const Source &source, ImVec2 size) {
+  TE_ZONE("TraceView::Draw");
+  if (size.x <= 0.0f) {
+    size.x = ImGui::GetContentRegionAvail().x;
+  }
+  ImVec2 origin = ImGui::GetCursorScreenPos();
+  ImVec2 corner(origin.x + size.x, origin.y + size.y);
+  ImGui::InvisibleButton(id, size);
+  ImDrawList *draw = ImGui::GetWindowDrawList();
+  draw->AddRectFilled(origin, corner, ImGui::GetColorU32(ImGuiCol_FrameBg));
+
+  const double total = static_cast<double>(source.GetSampleCount());
+  if (total < 2.0 || size.x < 1.0f) {
+    return;
+  }
+
+  ImGuiIO &io = ImGui::GetIO();
+  const bool hovered = ImGui::IsItemHovered();
+  if (hovered && ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left)) {
+    span_ = 0.0;
+  }
+  double span = span_ > 0.0 ? std::min(span_, total) : total;
+  double first = span_ > 0.0 ? first_ : 0.0;
+  if (hovered && io.MouseWheel != 0.0f) {
+    // Keep the sample under the cursor in place
+    double at = (io.MousePos.x - origin.x) / size.x;
+    double anchor = first + span * at;
+    span = std::clamp(span * std::pow(0.8, io.MouseWheel), std::min(kMinSpan, total), total);
+    first = anchor - span * at;
+    span_ = span;
+  }
+  if (ImGui::IsItemActive() && ImGui::IsMouseDragging(ImGuiMouseButton_Left)) {
+    first -= io.MouseDelta.x * span / size.x;
+    span_ = span;
+  }
+  first = std::clamp(first, 0.0, total - span);
+  first_ = first;
+
+  uint64_t begin = static_cast<uint64_t>(first);
+  uint64_t end = std::min(source.GetSampleCount(), static_cast<uint64_t>(std::ceil(first + span)));
+  uint32_t width = static_cast<uint32_t>(size.x);
+  columns_.resize(width);
+  uint32_t n = source.Decimate(begin, end, width, columns_.data());
+  if (n == 0) {
+    return;
+  }
+
+  dsp::plotColumn range = source.Reduce(begin, end);
+  if (range.min > range.max) {
+    // Nothing survived in the visible range
+    return;
+  }
+  float lo = range.min;
+  float hi = range.max > range.min ? range.max : range.min + 1.0f;
+  float scale = (size.y - 1.0f) / (hi - lo);
+  float step = size.x / static_cast<float>(n);
+  float bottom = corner.y - 1.0f;
+
+  // Zigzag through every column's min and max so one polyline draws the whole envelope
+  points_.resize(size_t{n} * 2);
+  for (uint32_t i = 0; i < n; ++i) {
+    // Samples dropped while capturing repeat the previous column
+    if (columns_[i].min > columns_[i].max) {
+      columns_[i] = i > 0 ? columns_[i - 1] : dsp::plotColumn{lo, lo, 0.0f};
+    }
+    float x = origin.x + (static_cast<float>(i) + 0.5f) * step;
+    float y_min = bottom - (columns_[i].min - lo) * scale;
+    float y_max = bottom - (columns_[i].max - lo) * scale;
+    bool rising = (i & 1) == 0;
+    points_[2 * i] = ImVec2(x, rising ? y_min : y_max);
+    points_[2 * i + 1] = ImVec2(x, rising ? y_max : y_min);
+  }
+  draw->PushClipRect(origin, corner, true);
+  draw->AddPolyline(points_.data(), static_cast<int>(points_.size()),
+                    ImGui::GetColorU32(ImGuiCol_PlotLines), ImDrawFlags_None, 1.0f);
+  draw->PopClipRect();
+
+  if (hovered) {
+    ImGui::SetTooltip("%llu..%llu  [%g, %g]", static_cast<unsigned long long>(begin),
+                      static_cast<unsigned long long>(end), range.min, range.max);
+  }
+}
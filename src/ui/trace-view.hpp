@@ -0,0 +1,26 @@
+#pragma once
+#include "capture/reader.hpp"
+#include "dsp/minmax-pyramid.hpp"
+#include "imgui.h"
+#include <cstdint>
+#include <vector>
+
+// Zoomable min/max envelope of a recorded trace. Each frame decimates the visible range to one
+// column per pixel, so drawing costs the same for a thousand samples or a hundred million.
+// Wheel zooms around the cursor, dragging pans, double click resets to following the tail.
+class TraceView {
+public:
+  void Draw(const char *id, const float *raw, const dsp::MinMaxPyramid &pyramid, ImVec2 size);
+  // Reads only the summaries and pages the visible range needs
+  void Draw(const char *id, const capture::Reader &reader, uint32_t channel, ImVec2 size);
+
+private:
+  template <typename Source> void DrawSource(const char *id, const Source &source, ImVec2 size);
+
+  // Visible range in samples, a zero span follows the whole trace as it grows
+  double first_ = 0.0;
+  double span_ = 0.0;
+  // Reused between frames, sized to the widget width
+  std::vector<dsp::plotColumn> columns_;
+  std::vector<ImVec2> points_;
+};
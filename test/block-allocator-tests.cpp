@@ -0,0 +1,117 @@
+#include "gfx/block-allocator.hpp"
+#include <gtest/gtest.h>
+
+TEST(BuddyAllocatorTest, SplitsAndMerges) {
+  BuddyAllocator buddy(1024, 64);
+  EXPECT_EQ(buddy.GetSize(), 1024u);
+
+  uint64_t a = buddy.Allocate(64);
+  uint64_t b = buddy.Allocate(100);
+  uint64_t c = buddy.Allocate(64);
+  EXPECT_EQ(a, 0u);
+  EXPECT_EQ(b, 128u);
+  EXPECT_EQ(c, 64u);
+  EXPECT_EQ(buddy.GetUsed(), 256u);
+  EXPECT_EQ(buddy.GetAllocationCount(), 3u);
+
+  buddy.Free(a);
+  buddy.Free(b);
+  buddy.Free(c);
+  EXPECT_TRUE(buddy.IsEmpty());
+  // Everything merged back into a single block
+  EXPECT_EQ(buddy.Allocate(1024), 0u);
+}
+
+TEST(BuddyAllocatorTest, HonoursAlignment) {
+  BuddyAllocator buddy(4096, 64);
+  buddy.Allocate(64);
+  uint64_t aligned = buddy.Allocate(64, 1024);
+  EXPECT_NE(aligned, BuddyAllocator::kInvalidOffset);
+  EXPECT_EQ(aligned % 1024, 0u);
+}
+
+TEST(BuddyAllocatorTest, FailsWhenFull) {
+  BuddyAllocator buddy(256, 64);
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_NE(buddy.Allocate(64), BuddyAllocator::kInvalidOffset);
+  }
+  EXPECT_EQ(buddy.Allocate(64), BuddyAllocator::kInvalidOffset);
+  EXPECT_EQ(buddy.Allocate(512), BuddyAllocator::kInvalidOffset);
+}
+
+TEST(LinearAllocatorTest, ResetsWhenEmpty) {
+  LinearAllocator linear(256);
+  uint64_t a = linear.Allocate(10);
+  uint64_t b = linear.Allocate(16, 16);
+  EXPECT_EQ(a, 0u);
+  EXPECT_EQ(b, 16u);
+  EXPECT_EQ(linear.Allocate(512), LinearAllocator::kInvalidOffset);
+
+  linear.Free(a);
+  EXPECT_EQ(linear.GetUsed(), 32u);
+  linear.Free(b);
+  EXPECT_TRUE(linear.IsEmpty());
+  EXPECT_EQ(linear.Allocate(256), 0u);
+}
+
+TEST(RingAllocatorTest, WrapsOnceOlderSpaceIsReleased) {
+  RingAllocator ring(100);
+  EXPECT_EQ(ring.Allocate(40), 0u);
+  uint64_t first = ring.GetHead();
+  EXPECT_EQ(ring.Allocate(40), 40u);
+  uint64_t second = ring.GetHead();
+  // 30 bytes don't fit in the 20 before the end, and the start is still in use
+  EXPECT_EQ(ring.Allocate(30), RingAllocator::kInvalidOffset);
+
+  ring.Release(first);
+  EXPECT_EQ(ring.GetUsed(), 40u);
+  EXPECT_EQ(ring.Allocate(30), 0u);
+  EXPECT_EQ(ring.Allocate(20), RingAllocator::kInvalidOffset);
+
+  ring.Release(second);
+  // The skipped 20 bytes at the end stay used until the wrapped allocation is released
+  EXPECT_EQ(ring.GetUsed(), 50u);
+  EXPECT_EQ(ring.Allocate(20), 30u);
+  // Releasing an older position again changes nothing
+  ring.Release(first);
+  EXPECT_EQ(ring.GetUsed(), 70u);
+  ring.Release(ring.GetHead());
+  EXPECT_TRUE(ring.IsEmpty());
+  EXPECT_EQ(ring.Allocate(100), 0u);
+}
+
+TEST(RingAllocatorTest, AlignsToTexelSizes) {
+  RingAllocator ring(100);
+  EXPECT_EQ(ring.Allocate(5), 0u);
+  EXPECT_EQ(ring.Allocate(12, 12), 12u);
+  EXPECT_EQ(ring.Allocate(1), 24u);
+  EXPECT_EQ(ring.Allocate(6, 12), 36u);
+  ring.Release(ring.GetHead());
+
+  ring.Allocate(91);
+  uint64_t first = ring.GetHead();
+  ring.Allocate(2);
+  ring.Release(first);
+  // Aligned to 96 it passes the end, so it wraps to 0
+  EXPECT_EQ(ring.Allocate(6, 12), 0u);
+}
+
+TEST(RingAllocatorTest, RewindKeepsLiveAllocations) {
+  RingAllocator ring(100);
+  ring.Allocate(30);
+  uint64_t inFlight = ring.GetHead();
+  ring.Allocate(50);
+  // The newest allocations are dropped, the older ones stay until released
+  ring.Rewind(inFlight);
+  EXPECT_EQ(ring.GetUsed(), 30u);
+  EXPECT_EQ(ring.Allocate(70), 30u);
+  ring.Rewind(inFlight);
+
+  ring.Release(inFlight);
+  EXPECT_TRUE(ring.IsEmpty());
+  ring.Allocate(10);
+  // A position from before the oldest live allocation drops everything
+  ring.Rewind(0);
+  EXPECT_TRUE(ring.IsEmpty());
+  EXPECT_EQ(ring.Allocate(100), 0u);
+}
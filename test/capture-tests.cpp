@@ -0,0 +1,116 @@
+#include "capture/reader.hpp"
+#include "capture/writer.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+namespace {
+
+std::string TempPath(const char *name) {
+  auto dir = std::filesystem::temp_directory_path() / "osc-capture-tests";
+  std::filesystem::create_directories(dir);
+  return (dir / name).string();
+}
+
+std::vector<float> RandomSamples(size_t count, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  std::vector<float> samples(count);
+  for (float &s : samples) {
+    s = dist(rng);
+  }
+  return samples;
+}
+
+} // namespace
+
+TEST(CaptureTest, RoundTripsChannelsThroughTheMapping) {
+  std::string path = TempPath("round-trip.osc");
+  std::vector<float> a = RandomSamples(10000, 1);
+  std::vector<float> b = RandomSamples(3000, 2);
+
+  capture::writerOpts opts;
+  opts.chunk_samples = 1024;
+  opts.index_chunks = 3;
+  capture::Writer writer;
+  ASSERT_TRUE(writer.Open(path, {"a", "b"}, opts));
+  // Interleaved, unevenly sized appends like a frame loop produces
+  for (size_t i = 0, j = 0; i < a.size() || j < b.size();) {
+    size_t na = std::min<size_t>(a.size() - i, 777);
+    size_t nb = std::min<size_t>(b.size() - j, 211);
+    writer.Append(0, a.data() + i, na);
+    writer.Append(1, b.data() + j, nb);
+    i += na;
+    j += nb;
+  }
+  ASSERT_TRUE(writer.Close());
+
+  capture::Reader reader;
+  ASSERT_TRUE(reader.Open(path));
+  ASSERT_EQ(reader.GetChannelCount(), 2u);
+  EXPECT_EQ(reader.GetChannelName(1), "b");
+  ASSERT_EQ(reader.GetSampleCount(0), a.size());
+  ASSERT_EQ(reader.GetSampleCount(1), b.size());
+
+  for (uint64_t s : {uint64_t{0}, uint64_t{1023}, uint64_t{1024}, uint64_t{9999}}) {
+    uint64_t first;
+    uint32_t count;
+    const float *samples = reader.GetSamples(0, s, &first, &count);
+    ASSERT_NE(samples, nullptr);
+    EXPECT_EQ(samples[s - first], a[s]);
+  }
+  uint64_t first;
+  uint32_t count;
+  EXPECT_EQ(reader.GetSamples(0, a.size(), &first, &count), nullptr);
+}
+
+TEST(CaptureTest, ReduceMatchesBruteForce) {
+  std::string path = TempPath("reduce.osc");
+  std::vector<float> samples = RandomSamples(50000, 3);
+  capture::writerOpts opts;
+  opts.chunk_samples = 4096;
+  capture::Writer writer;
+  ASSERT_TRUE(writer.Open(path, {"ch"}, opts));
+  writer.Append(0, samples.data(), samples.size());
+  ASSERT_TRUE(writer.Close());
+
+  capture::Reader reader;
+  ASSERT_TRUE(reader.Open(path));
+  std::mt19937 rng(9);
+  for (int i = 0; i < 300; ++i) {
+    uint64_t x = rng() % samples.size();
+    uint64_t y = rng() % samples.size();
+    uint64_t lo = std::min(x, y);
+    uint64_t hi = std::max(x, y) + 1;
+    dsp::plotColumn column = reader.Reduce(0, lo, hi);
+    EXPECT_EQ(column.min, *std::min_element(samples.begin() + lo, samples.begin() + hi));
+    EXPECT_EQ(column.max, *std::max_element(samples.begin() + lo, samples.begin() + hi));
+  }
+
+  std::vector<dsp::plotColumn> columns(300);
+  ASSERT_EQ(reader.Decimate(0, 0, samples.size(), 300, columns.data()), 300u);
+  EXPECT_EQ(std::min_element(columns.begin(), columns.end(),
+                             [](auto &l, auto &r) { return l.min < r.min; })
+                ->min,
+            *std::min_element(samples.begin(), samples.end()));
+}
+
+TEST(CaptureTest, RejectsTruncatedIndex) {
+  std::string path = TempPath("corrupt.osc");
+  std::vector<float> samples = RandomSamples(5000, 4);
+  capture::writerOpts opts;
+  opts.chunk_samples = 1024;
+  capture::Writer writer;
+  ASSERT_TRUE(writer.Open(path, {"ch"}, opts));
+  writer.Append(0, samples.data(), samples.size());
+  ASSERT_TRUE(writer.Close());
+
+  // Cut the file inside its only index block
+  uint64_t size = std::filesystem::file_size(path);
+  std::filesystem::resize_file(path, size - capture::kPageSize + 8);
+  capture::Reader reader;
+  EXPECT_FALSE(reader.Open(path));
+}
@@ -0,0 +1,126 @@
+#include "gfx/device-selector.hpp"
+#include <gtest/gtest.h>
+
+namespace {
+
+physicalDeviceInfo MakeDevice(VkPhysicalDeviceType type, VkDeviceSize local_gib, uint8_t id) {
+  physicalDeviceInfo info;
+  info.properties.deviceType = type;
+  info.properties.apiVersion = VK_API_VERSION_1_3;
+  info.properties.limits.maxImageDimension2D = 16384;
+  info.queue_families.push_back({VK_QUEUE_TRANSFER_BIT, 2, 0, {1, 1, 1}});
+  info.queue_families.push_back({VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT, 1, 64, {1, 1, 1}});
+  info.memory.memoryHeapCount = 1;
+  info.memory.memoryHeaps[0] = {local_gib << 30, VK_MEMORY_HEAP_DEVICE_LOCAL_BIT};
+  info.extensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+  info.uuid.fill(id);
+  info.has_uuid = true;
+  return info;
+}
+
+} // namespace
+
+TEST(DeviceSelectorTest, PoliciesRankDeviceClasses) {
+  std::vector<physicalDeviceInfo> devices = {
+      MakeDevice(VK_PHYSICAL_DEVICE_TYPE_CPU, 64, 1),
+      MakeDevice(VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU, 2, 2),
+      MakeDevice(VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 8, 3),
+  };
+  EXPECT_EQ(devices[2].GraphicsFamily(), 1);
+
+  deviceSelectionOpts opts;
+  EXPECT_EQ(PickDevice(devices, opts), 2);
+  opts.policy = DevicePolicy::LowPower;
+  EXPECT_EQ(PickDevice(devices, opts), 1);
+  opts.policy = DevicePolicy::Software;
+  EXPECT_EQ(PickDevice(devices, opts), 0);
+
+  // A pinned UUID beats every class, an absent one falls back to performance
+  opts.policy = DevicePolicy::Pinned;
+  opts.uuid.fill(2);
+  EXPECT_EQ(PickDevice(devices, opts), 1);
+  opts.uuid.fill(9);
+  EXPECT_EQ(PickDevice(devices, opts), 2);
+}
+
+TEST(DeviceSelectorTest, SkipsUnusableDevices) {
+  std::vector<physicalDeviceInfo> devices = {
+      MakeDevice(VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 8, 1),
+      MakeDevice(VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 8, 2),
+      MakeDevice(VK_PHYSICAL_DEVICE_TYPE_CPU, 1, 3),
+  };
+  devices[0].queue_families.resize(1);
+  devices[1].extensions.clear();
+
+  deviceSelectionOpts opts;
+  deviceScore score = ScoreDevice(devices[0], opts);
+  EXPECT_LT(score.score, 0);
+  ASSERT_EQ(score.reasons.size(), 1u);
+  EXPECT_EQ(score.reasons[0], "no graphics queue");
+  EXPECT_LT(ScoreDevice(devices[1], opts).score, 0);
+  EXPECT_EQ(PickDevice(devices, opts), 2);
+
+  devices.pop_back();
+  EXPECT_EQ(PickDevice(devices, opts), -1);
+  EXPECT_EQ(PickDevice({}, opts), -1);
+}
+
+TEST(DeviceSelectorTest, SkipsDevicesThatCannotPresent) {
+  std::vector<physicalDeviceInfo> devices = {
+      MakeDevice(VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 8, 1),
+      MakeDevice(VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU, 2, 2),
+  };
+  deviceSelectionOpts opts;
+  // Presenting from the transfer family doesn't help, frames present from the graphics queue
+  devices[0].present_families = {true, false};
+  devices[1].present_families = {false, true};
+  deviceScore score = ScoreDevice(devices[0], opts);
+  EXPECT_LT(score.score, 0);
+  ASSERT_EQ(score.reasons.size(), 1u);
+  EXPECT_EQ(score.reasons[0], "graphics queue can't present");
+  EXPECT_EQ(PickDevice(devices, opts), 1);
+
+  // Unchecked, e.g. headless, every device qualifies
+  devices[0].present_families.clear();
+  EXPECT_EQ(PickDevice(devices, opts), 0);
+}
+
+TEST(DeviceSelectorTest, BenchmarkBreaksTiesWithinAClass) {
+  std::vector<physicalDeviceInfo> devices = {
+      MakeDevice(VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 16, 1),
+      MakeDevice(VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 8, 2),
+      MakeDevice(VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU, 2, 3),
+  };
+  deviceSelectionOpts opts;
+  // More memory wins without measurements
+  EXPECT_EQ(PickDevice(devices, opts), 0);
+
+  devices[0].benchmark_ms = 3.0;
+  devices[1].benchmark_ms = 1.5;
+  devices[2].benchmark_ms = 0.5;
+  EXPECT_EQ(PickDevice(devices, opts), 1);
+
+  // A failed measurement loses to a successful one
+  devices[1].benchmark_ms = -1.0;
+  EXPECT_EQ(PickDevice(devices, opts), 0);
+}
+
+TEST(DeviceSelectorTest, ParsesAndFormatsUuids) {
+  std::array<uint8_t, VK_UUID_SIZE> uuid{};
+  ASSERT_TRUE(ParseDeviceUuid("00112233-4455-6677-8899-AABBCCDDEEFF", uuid));
+  EXPECT_EQ(uuid[0], 0x00);
+  EXPECT_EQ(uuid[5], 0x55);
+  EXPECT_EQ(uuid[15], 0xff);
+  EXPECT_EQ(FormatDeviceUuid(uuid), "00112233-4455-6677-8899-aabbccddeeff");
+
+  std::array<uint8_t, VK_UUID_SIZE> roundTrip{};
+  ASSERT_TRUE(ParseDeviceUuid(FormatDeviceUuid(uuid).c_str(), roundTrip));
+  EXPECT_EQ(roundTrip, uuid);
+
+  std::array<uint8_t, VK_UUID_SIZE> untouched{};
+  std::array<uint8_t, VK_UUID_SIZE> zero{};
+  EXPECT_FALSE(ParseDeviceUuid("performance", untouched));
+  EXPECT_FALSE(ParseDeviceUuid("0011", untouched));
+  EXPECT_FALSE(ParseDeviceUuid("00112233445566778899aabbccddeeff00", untouched));
+  EXPECT_EQ(untouched, zero);
+}
@@ -0,0 +1,82 @@
+#include "ui/draw-data-hash.hpp"
+#include <gtest/gtest.h>
+
+namespace {
+
+void NoopCallback(const ImDrawList *, const ImDrawCmd *) {}
+
+// One textured triangle followed by a callback carrying callback_bytes, built without an ImGui
+// context the way ImGui::Render leaves it
+struct drawFrame {
+  ImDrawList list{nullptr};
+  ImDrawData data;
+  float callback_bytes[4] = {1.0f, 2.0f, 3.0f, 4.0f};
+
+  drawFrame() {
+    for (int i = 0; i < 3; ++i) {
+      ImDrawVert vert{};
+      vert.pos = ImVec2(10.0f * i, 5.0f * i);
+      vert.col = IM_COL32_WHITE;
+      list.VtxBuffer.push_back(vert);
+      list.IdxBuffer.push_back(static_cast<ImDrawIdx>(i));
+    }
+    ImDrawCmd triangle;
+    triangle.ClipRect = ImVec4(0.0f, 0.0f, 100.0f, 100.0f);
+    triangle.TexRef = ImTextureRef(ImTextureID(1));
+    triangle.ElemCount = 3;
+    list.CmdBuffer.push_back(triangle);
+    ImDrawCmd callback;
+    callback.ClipRect = triangle.ClipRect;
+    callback.UserCallback = &NoopCallback;
+    callback.UserCallbackData = callback_bytes;
+    callback.UserCallbackDataSize = sizeof(callback_bytes);
+    list.CmdBuffer.push_back(callback);
+
+    data.Valid = true;
+    data.DisplaySize = ImVec2(100.0f, 100.0f);
+    data.FramebufferScale = ImVec2(1.0f, 1.0f);
+    data.CmdLists.push_back(&list);
+    data.CmdListsCount = 1;
+    data.TotalVtxCount = list.VtxBuffer.Size;
+    data.TotalIdxCount = list.IdxBuffer.Size;
+  }
+};
+
+} // namespace
+
+TEST(DrawDataHashTest, StableForIdenticalFrames) {
+  drawFrame a;
+  drawFrame b;
+  EXPECT_EQ(HashDrawData(&a.data), HashDrawData(&a.data));
+  EXPECT_EQ(HashDrawData(&a.data), HashDrawData(&b.data));
+  EXPECT_FALSE(HasPendingTextureUpdates(&a.data));
+}
+
+TEST(DrawDataHashTest, ChangesWithVerticesAndClipRects) {
+  drawFrame frame;
+  uint64_t base = HashDrawData(&frame.data);
+  frame.list.VtxBuffer[1].pos.x += 0.5f;
+  uint64_t moved = HashDrawData(&frame.data);
+  EXPECT_NE(moved, base);
+
+  frame.list.VtxBuffer[1].pos.x -= 0.5f;
+  EXPECT_EQ(HashDrawData(&frame.data), base);
+  frame.list.CmdBuffer[0].ClipRect.z = 50.0f;
+  EXPECT_NE(HashDrawData(&frame.data), base);
+}
+
+TEST(DrawDataHashTest, ChangesWithTextureIds) {
+  drawFrame frame;
+  uint64_t base = HashDrawData(&frame.data);
+  frame.list.CmdBuffer[0].TexRef = ImTextureRef(ImTextureID(2));
+  EXPECT_NE(HashDrawData(&frame.data), base);
+}
+
+TEST(DrawDataHashTest, ChangesWithCallbackDataBehindTheSamePointer) {
+  drawFrame frame;
+  uint64_t base = HashDrawData(&frame.data);
+  frame.callback_bytes[2] = 5.0f;
+  EXPECT_NE(HashDrawData(&frame.data), base);
+  frame.callback_bytes[2] = 3.0f;
+  EXPECT_EQ(HashDrawData(&frame.data), base);
+}
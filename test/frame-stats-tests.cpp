@@ -0,0 +1,23 @@
+#include "platform/frame-stats.hpp"
+#include <gtest/gtest.h>
+
+TEST(FrameStatsTest, EmptySummary) {
+  platform::FrameStats stats;
+  EXPECT_EQ(stats.SummarizeCpu().samples, 0u);
+  EXPECT_EQ(stats.SummarizeGpu(10).samples, 0u);
+}
+
+TEST(FrameStatsTest, SummarySkipsWarmup) {
+  platform::FrameStats stats;
+  stats.AddCpuFrame(100.0);
+  for (int i = 1; i <= 100; ++i) {
+    stats.AddCpuFrame(static_cast<double>(i));
+  }
+
+  platform::frameTimeSummary s = stats.SummarizeCpu(1);
+  EXPECT_EQ(s.samples, 100u);
+  EXPECT_DOUBLE_EQ(s.min_ms, 1.0);
+  EXPECT_DOUBLE_EQ(s.max_ms, 100.0);
+  EXPECT_DOUBLE_EQ(s.avg_ms, 50.5);
+  EXPECT_DOUBLE_EQ(s.p99_ms, 99.0);
+}
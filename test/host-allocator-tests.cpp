@@ -0,0 +1,53 @@
+#include "gfx/host-allocator.hpp"
+#include <cstdint>
+#include <cstring>
+#include <gtest/gtest.h>
+
+TEST(HostAllocatorTest, CountsPerScope) {
+  HostAllocator host;
+  const VkAllocationCallbacks *cb = host.GetCallbacks();
+
+  void *a = cb->pfnAllocation(cb->pUserData, 100, 64, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+  ASSERT_NE(a, nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(a) % 64, 0u);
+
+  hostScopeStats stats = host.GetStats(VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+  EXPECT_EQ(stats.live_bytes, 100u);
+  EXPECT_EQ(stats.live_allocations, 1u);
+  EXPECT_EQ(host.GetStats(VK_SYSTEM_ALLOCATION_SCOPE_DEVICE).live_allocations, 0u);
+
+  std::memset(a, 0x5a, 100);
+  void *b = cb->pfnReallocation(cb->pUserData, a, 200, 64, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+  ASSERT_NE(b, nullptr);
+  EXPECT_EQ(static_cast<unsigned char *>(b)[99], 0x5a);
+  EXPECT_EQ(host.GetStats(VK_SYSTEM_ALLOCATION_SCOPE_OBJECT).live_bytes, 200u);
+
+  cb->pfnFree(cb->pUserData, b);
+  stats = host.GetStats(VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+  EXPECT_EQ(stats.live_bytes, 0u);
+  EXPECT_EQ(stats.total_allocations, 2u);
+}
+
+TEST(HostAllocatorTest, CommandScopeUsesArena) {
+  HostAllocator host;
+  const VkAllocationCallbacks *cb = host.GetCallbacks();
+
+  void *a = cb->pfnAllocation(cb->pUserData, 128, 16, VK_SYSTEM_ALLOCATION_SCOPE_COMMAND);
+  void *b = cb->pfnAllocation(cb->pUserData, 128, 16, VK_SYSTEM_ALLOCATION_SCOPE_COMMAND);
+  ASSERT_NE(a, nullptr);
+  ASSERT_NE(b, nullptr);
+  cb->pfnFree(cb->pUserData, a);
+  cb->pfnFree(cb->pUserData, b);
+
+  // The arena rewound, the next command allocation reuses its start
+  void *c = cb->pfnAllocation(cb->pUserData, 128, 16, VK_SYSTEM_ALLOCATION_SCOPE_COMMAND);
+  EXPECT_EQ(c, a);
+  cb->pfnFree(cb->pUserData, c);
+
+  void *big = cb->pfnAllocation(cb->pUserData, HostAllocator::kArenaSize, 16,
+                                VK_SYSTEM_ALLOCATION_SCOPE_COMMAND);
+  ASSERT_NE(big, nullptr);
+  EXPECT_EQ(host.GetArenaFallbackCount(), 1u);
+  cb->pfnFree(cb->pUserData, big);
+  EXPECT_EQ(host.GetStats(VK_SYSTEM_ALLOCATION_SCOPE_COMMAND).live_allocations, 0u);
+}
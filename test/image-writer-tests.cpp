@@ -0,0 +1,131 @@
+#include "capture/image-writer.hpp"
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string TempPath(const char *name) {
+  auto dir = std::filesystem::temp_directory_path() / "osc-image-writer-tests";
+  std::filesystem::create_directories(dir);
+  return (dir / name).string();
+}
+
+std::vector<uint8_t> ReadFile(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+uint32_t Be32(const uint8_t *p) {
+  return (uint32_t{p[0]} << 24) | (uint32_t{p[1]} << 16) | (uint32_t{p[2]} << 8) | p[3];
+}
+
+std::vector<uint8_t> Gradient(uint32_t width, uint32_t height) {
+  std::vector<uint8_t> pixels(size_t{width} * height * 4);
+  for (uint32_t y = 0; y < height; ++y) {
+    for (uint32_t x = 0; x < width; ++x) {
+      uint8_t *p = &pixels[(size_t{y} * width + x) * 4];
+      p[0] = static_cast<uint8_t>(x);
+      p[1] = static_cast<uint8_t>(y);
+      p[2] = static_cast<uint8_t>(x ^ y);
+      p[3] = 255;
+    }
+  }
+  return pixels;
+}
+
+} // namespace
+
+TEST(ImageWriterTest, Crc32MatchesReference) {
+  const char *check = "123456789";
+  EXPECT_EQ(capture::Crc32(reinterpret_cast<const uint8_t *>(check), 9), 0xcbf43926u);
+}
+
+TEST(ImageWriterTest, PngStoresRowsAcrossBlocks) {
+  // Large enough for the stream to need two stored blocks
+  const uint32_t width = 200;
+  const uint32_t height = 150;
+  std::vector<uint8_t> pixels = Gradient(width, height);
+  capture::imageView image{pixels.data(), width, height, width * 4, capture::PixelOrder::Bgra};
+  std::string path = TempPath("gradient.png");
+  capture::PngWriter writer;
+  ASSERT_TRUE(writer.Write(path, image));
+
+  std::vector<uint8_t> file = ReadFile(path);
+  ASSERT_GT(file.size(), 8u);
+  ASSERT_EQ(file[1], 'P');
+  std::vector<uint8_t> zlib;
+  for (size_t at = 8; at + 12 <= file.size();) {
+    uint32_t length = Be32(&file[at]);
+    ASSERT_LE(at + 12 + length, file.size());
+    EXPECT_EQ(capture::Crc32(&file[at + 4], 4 + length), Be32(&file[at + 8 + length]));
+    std::string type(file.begin() + at + 4, file.begin() + at + 8);
+    if (type == "IHDR") {
+      EXPECT_EQ(Be32(&file[at + 8]), width);
+      EXPECT_EQ(Be32(&file[at + 12]), height);
+    } else if (type == "IDAT") {
+      zlib.insert(zlib.end(), file.begin() + at + 8, file.begin() + at + 8 + length);
+    }
+    at += 12 + length;
+  }
+
+  std::vector<uint8_t> raw;
+  size_t at = 2;
+  int blocks = 0;
+  while (true) {
+    ASSERT_LE(at + 5, zlib.size());
+    bool final = zlib[at] & 1;
+    uint32_t length = zlib[at + 1] | (zlib[at + 2] << 8);
+    EXPECT_EQ(length ^ 0xffff, static_cast<uint32_t>(zlib[at + 3] | (zlib[at + 4] << 8)));
+    raw.insert(raw.end(), zlib.begin() + at + 5, zlib.begin() + at + 5 + length);
+    at += 5 + length;
+    ++blocks;
+    if (final) {
+      break;
+    }
+  }
+  EXPECT_EQ(blocks, 2);
+  ASSERT_EQ(raw.size(), size_t{height} * (1 + width * 3));
+  // BGRA in, RGB out
+  const uint8_t *row = &raw[size_t{7} * (1 + width * 3)];
+  EXPECT_EQ(row[0], 0);
+  EXPECT_EQ(row[1 + 3 * 5], 5 ^ 7);
+  EXPECT_EQ(row[1 + 3 * 5 + 1], 7);
+  EXPECT_EQ(row[1 + 3 * 5 + 2], 5);
+}
+
+TEST(ImageWriterTest, Y4mWritesLimitedRangePlanes) {
+  const uint32_t width = 4;
+  const uint32_t height = 2;
+  std::vector<uint8_t> pixels(width * height * 4, 0);
+  // White top row, black bottom row
+  std::fill(pixels.begin(), pixels.begin() + width * 4, 255);
+  capture::imageView image{pixels.data(), width, height, width * 4, capture::PixelOrder::Rgba};
+  std::string path = TempPath("frames.y4m");
+  {
+    capture::Y4mWriter writer;
+    ASSERT_TRUE(writer.Open(path, width, height, 30));
+    ASSERT_TRUE(writer.WriteFrame(image));
+    ASSERT_TRUE(writer.WriteFrame(image));
+    capture::imageView wrong = image;
+    wrong.width = 2;
+    EXPECT_FALSE(writer.WriteFrame(wrong));
+  }
+
+  std::vector<uint8_t> file = ReadFile(path);
+  std::string text(file.begin(), file.end());
+  size_t header = text.find('\n') + 1;
+  EXPECT_EQ(text.substr(0, header), "YUV4MPEG2 W4 H2 F30:1 Ip A1:1 C444 XCOLORRANGE=LIMITED\n");
+  const size_t frame = 6 + width * height * 3;
+  ASSERT_EQ(file.size(), header + 2 * frame);
+  EXPECT_EQ(text.substr(header + frame, 6), "FRAME\n");
+  const uint8_t *ys = &file[header + 6];
+  EXPECT_EQ(ys[0], 235);
+  EXPECT_EQ(ys[width], 16);
+  const uint8_t *us = ys + width * height;
+  EXPECT_EQ(us[0], 128);
+  EXPECT_EQ(us[width], 128);
+}
@@ -0,0 +1,353 @@
+#include "ingest/ingest.hpp"
+#include "ingest/mpsc-ring.hpp"
+#include "ingest/spsc-ring.hpp"
+#include "ingest/triple-buffer.hpp"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+TEST(SpscRingTest, CapacityRoundsUpToPowerOfTwo) {
+  ingest::SpscRing<int> ring(100);
+  EXPECT_EQ(ring.Capacity(), 128u);
+}
+
+TEST(SpscRingTest, BatchPushPopWrapsAround) {
+  ingest::SpscRing<int> ring(8);
+  std::vector<int> in(6);
+  std::vector<int> out(8);
+  int next = 0;
+  int expected = 0;
+  for (int round = 0; round < 10; ++round) {
+    for (int &v : in) {
+      v = next++;
+    }
+    ASSERT_EQ(ring.Push(in.data(), in.size()), in.size());
+    ASSERT_EQ(ring.Pop(out.data(), out.size()), in.size());
+    for (size_t i = 0; i < in.size(); ++i) {
+      EXPECT_EQ(out[i], expected++);
+    }
+  }
+  EXPECT_EQ(ring.GetOverruns(), 0u);
+}
+
+TEST(SpscRingTest, FullRingCountsOverruns) {
+  ingest::SpscRing<int> ring(4);
+  std::vector<int> in = {1, 2, 3, 4, 5, 6};
+  EXPECT_EQ(ring.Push(in.data(), in.size()), 4u);
+  EXPECT_EQ(ring.Push(in.data(), 1), 0u);
+  EXPECT_EQ(ring.GetOverruns(), 3u);
+
+  int out[4];
+  ASSERT_EQ(ring.Pop(out, 4), 4u);
+  EXPECT_EQ(out[0], 1);
+  EXPECT_EQ(out[3], 4);
+}
+
+TEST(SpscRingTest, ConcurrentProducerDeliversInOrder) {
+  constexpr int kCount = 1 << 18;
+  ingest::SpscRing<int> ring(1024);
+  std::thread producer([&] {
+    int batch[64];
+    for (int next = 0; next < kCount;) {
+      int n = std::min(64, kCount - next);
+      std::iota(batch, batch + n, next);
+      // Retry what didn't fit, overruns still get counted
+      size_t pushed = ring.Push(batch, n);
+      if (pushed == 0) {
+        std::this_thread::yield();
+      }
+      next += static_cast<int>(pushed);
+    }
+  });
+
+  int expected = 0;
+  bool ordered = true;
+  while (expected < kCount) {
+    size_t read = ring.Read(256, [&](const int *items, size_t n) {
+      for (size_t i = 0; i < n; ++i) {
+        ordered &= items[i] == expected++;
+      }
+    });
+    if (read == 0) {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+  EXPECT_TRUE(ordered);
+  EXPECT_EQ(ring.GetPushed(), static_cast<uint64_t>(kCount));
+}
+
+TEST(MpscRingTest, ConcurrentProducersLoseNothingButOverruns) {
+  constexpr int kProducers = 4;
+  constexpr int kPerProducer = 1 << 18;
+  ingest::MpscRing<int> ring(4096);
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; ++p) {
+    producers.emplace_back([&ring, p] {
+      int batch[32];
+      for (int i = 0; i < kPerProducer; i += 32) {
+        std::fill(batch, batch + 32, p);
+        ring.Push(batch, 32);
+      }
+    });
+  }
+
+  std::vector<uint64_t> received(kProducers);
+  auto drain = [&] {
+    return ring.Read(1024, [&](const int *items, size_t n) {
+      for (size_t i = 0; i < n; ++i) {
+        ++received[items[i]];
+      }
+    });
+  };
+  while (ring.GetPushed() + ring.GetOverruns() <
+         static_cast<uint64_t>(kProducers) * kPerProducer) {
+    if (drain() == 0) {
+      std::this_thread::yield();
+    }
+  }
+  for (std::thread &t : producers) {
+    t.join();
+  }
+  while (drain() > 0) {
+  }
+
+  uint64_t total = std::accumulate(received.begin(), received.end(), uint64_t{0});
+  EXPECT_EQ(total, ring.GetPushed());
+  EXPECT_EQ(total + ring.GetOverruns(), static_cast<uint64_t>(kProducers) * kPerProducer);
+}
+
+TEST(MpscRingTest, ContendedProducersNeverOverrunARoomyRing) {
+  constexpr int kProducers = 4;
+  constexpr int kPerProducer = 1 << 16;
+  // Room for everything, so any overrun is a producer misreading a ring the consumer drained
+  ingest::MpscRing<int> ring(kProducers * kPerProducer);
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; ++p) {
+    producers.emplace_back([&ring, p] {
+      for (int i = 0; i < kPerProducer; ++i) {
+        ring.Push(&p, 1);
+      }
+    });
+  }
+
+  uint64_t received = 0;
+  while (ring.GetPushed() + ring.GetOverruns() <
+         static_cast<uint64_t>(kProducers) * kPerProducer) {
+    received += ring.Read(64, [](const int *, size_t) {});
+  }
+  for (std::thread &t : producers) {
+    t.join();
+  }
+  while (size_t n = ring.Read(64, [](const int *, size_t) {})) {
+    received += n;
+  }
+
+  EXPECT_EQ(ring.GetOverruns(), 0u);
+  EXPECT_EQ(received, static_cast<uint64_t>(kProducers) * kPerProducer);
+}
+
+TEST(TripleBufferTest, ReaderSeesOnlyTheNewestWrite) {
+  ingest::TripleBuffer<int> buffer;
+  int value = -1;
+  EXPECT_FALSE(buffer.Read(&value));
+  EXPECT_EQ(value, -1);
+  for (int i = 0; i < 10; ++i) {
+    buffer.Write(i);
+  }
+  ASSERT_TRUE(buffer.Read(&value));
+  EXPECT_EQ(value, 9);
+  EXPECT_FALSE(buffer.Read(&value));
+  buffer.Write(10);
+  ASSERT_TRUE(buffer.Read(&value));
+  EXPECT_EQ(value, 10);
+}
+
+TEST(TripleBufferTest, ConcurrentReaderNeverSeesTornOrOlderValues) {
+  struct pair {
+    uint64_t a;
+    uint64_t b;
+  };
+  constexpr uint64_t kWrites = 200000;
+  ingest::TripleBuffer<pair> buffer;
+  std::thread writer([&buffer] {
+    for (uint64_t i = 1; i <= kWrites; ++i) {
+      buffer.Write({i, ~i});
+    }
+  });
+  pair seen{0, ~uint64_t{0}};
+  while (seen.a < kWrites) {
+    pair next;
+    if (buffer.Read(&next)) {
+      ASSERT_EQ(next.b, ~next.a);
+      ASSERT_GT(next.a, seen.a);
+      seen = next;
+    }
+  }
+  writer.join();
+  EXPECT_EQ(seen.a, kWrites);
+}
+
+TEST(IngestTest, SnapshotKeepsLatestHistoryContiguous) {
+  ingest::Ingest hub;
+  ingest::channelOpts opts;
+  opts.name = "ch0";
+  opts.capacity = 64;
+  opts.history = 10;
+  uint32_t ch = hub.AddChannel(opts);
+
+  std::vector<float> samples(25);
+  std::iota(samples.begin(), samples.end(), 0.0f);
+  hub.Push(ch, samples.data(), 7);
+  hub.Consume();
+  ingest::channelSnapshot snapshot = hub.GetSnapshot(ch);
+  ASSERT_EQ(snapshot.count, 7u);
+  EXPECT_EQ(snapshot.samples[0], 0.0f);
+  EXPECT_EQ(snapshot.samples[6], 6.0f);
+
+  hub.Push(ch, samples.data() + 7, 18);
+  hub.Consume();
+  snapshot = hub.GetSnapshot(ch);
+  ASSERT_EQ(snapshot.count, 10u);
+  EXPECT_EQ(snapshot.new_samples, 18u);
+  EXPECT_EQ(snapshot.total, 25u);
+  for (size_t i = 0; i < snapshot.count; ++i) {
+    EXPECT_EQ(snapshot.samples[i], static_cast<float>(15 + i));
+  }
+}
+
+TEST(IngestTest, HistoryRangeMatchesTheSnapshot) {
+  ingest::Ingest hub;
+  ingest::channelOpts opts;
+  opts.capacity = 4096;
+  // Not a multiple of the summary blocks, so the last block is short
+  opts.history = 1000;
+  uint32_t ch = hub.AddChannel(opts);
+
+  std::vector<float> samples(700);
+  uint64_t pushed = 0;
+  for (int round = 0; round < 12; ++round) {
+    // Chunks of varying size wrap the history at every block offset
+    size_t n = 97 + static_cast<size_t>(round) * 53 % 600;
+    for (size_t j = 0; j < n; ++j) {
+      uint64_t k = pushed + j;
+      samples[j] = static_cast<float>((k * 7919) % 1009) - 500.0f;
+    }
+    hub.Push(ch, samples.data(), n);
+    hub.Consume();
+    pushed += n;
+
+    ingest::channelSnapshot snapshot = hub.GetSnapshot(ch);
+    uint64_t oldest = snapshot.total - snapshot.count;
+    for (uint64_t skip : {0, 1, 255, 256, 300}) {
+      for (uint64_t keep : {1, 2, 256, 513, 1000}) {
+        if (skip + keep > snapshot.count) {
+          continue;
+        }
+        const float *visible = snapshot.samples + skip;
+        auto [lo, hi] = std::minmax_element(visible, visible + keep);
+        dsp::plotColumn range = hub.GetHistoryRange(ch, oldest + skip, oldest + skip + keep);
+        EXPECT_EQ(range.min, *lo) << pushed << " " << skip << " " << keep;
+        EXPECT_EQ(range.max, *hi) << pushed << " " << skip << " " << keep;
+      }
+    }
+  }
+}
+
+TEST(IngestTest, ConsumeOnlyTakesWhatWasPublished) {
+  ingest::Ingest hub;
+  ingest::channelOpts opts;
+  opts.capacity = 8;
+  opts.multi_producer = true;
+  uint32_t ch = hub.AddChannel(opts);
+
+  std::vector<float> samples(12, 1.0f);
+  EXPECT_EQ(hub.Push(ch, samples.data(), samples.size()), 8u);
+  hub.Consume();
+  ingest::channelSnapshot snapshot = hub.GetSnapshot(ch);
+  EXPECT_EQ(snapshot.new_samples, 8u);
+  EXPECT_EQ(snapshot.overruns, 4u);
+
+  hub.Consume();
+  EXPECT_EQ(hub.GetSnapshot(ch).new_samples, 0u);
+}
+
+TEST(IngestTest, RecordStopsAtReservation) {
+  ingest::Ingest hub;
+  ingest::channelOpts opts;
+  opts.capacity = 64;
+  opts.record = 20;
+  uint32_t ch = hub.AddChannel(opts);
+
+  std::vector<float> samples(30);
+  std::iota(samples.begin(), samples.end(), 0.0f);
+  hub.Push(ch, samples.data(), 12);
+  hub.Consume();
+  hub.Push(ch, samples.data() + 12, 18);
+  hub.Consume();
+  ingest::channelSnapshot snapshot = hub.GetSnapshot(ch);
+  ASSERT_NE(snapshot.pyramid, nullptr);
+  EXPECT_EQ(snapshot.pyramid->GetSampleCount(), 20u);
+  EXPECT_EQ(snapshot.record[19], 19.0f);
+  dsp::plotColumn all = snapshot.pyramid->Reduce(snapshot.record, 0, 20);
+  EXPECT_EQ(all.min, 0.0f);
+  EXPECT_EQ(all.max, 19.0f);
+}
+
+TEST(IngestTest, TriggersFollowAcceptedSamples) {
+  ingest::Ingest hub;
+  ingest::channelOpts opts;
+  opts.capacity = 16;
+  opts.trigger = dsp::triggerOpts{};
+  opts.trigger->level = 0.5f;
+  uint32_t ch = hub.AddChannel(opts);
+
+  // Rising edges at 4, 12 and 20, a dropped push must not move the stream on
+  std::vector<float> samples(24, 0.0f);
+  for (size_t i : {4, 12, 20}) {
+    samples[i] = 1.0f;
+  }
+  EXPECT_EQ(hub.Push(ch, samples.data(), 8), 8u);
+  hub.Consume();
+  ASSERT_EQ(hub.GetSnapshot(ch).trigger_count, 1u);
+  EXPECT_EQ(hub.Push(ch, samples.data() + 8, 16), 16u);
+  EXPECT_EQ(hub.Push(ch, samples.data() + 4, 1), 0u);
+  hub.Consume();
+  ingest::channelSnapshot snapshot = hub.GetSnapshot(ch);
+  ASSERT_EQ(snapshot.trigger_count, 3u);
+  EXPECT_EQ(snapshot.triggers[0].sample, 4u);
+  EXPECT_EQ(snapshot.triggers[2].sample, 20u);
+
+  // Options reach the producer on its next push
+  dsp::triggerOpts falling;
+  falling.mode = dsp::TriggerMode::Falling;
+  falling.level = 0.5f;
+  hub.SetTrigger(ch, falling);
+  samples = {0.0f, 1.0f, 0.0f};
+  hub.Push(ch, samples.data(), samples.size());
+  hub.Consume();
+  snapshot = hub.GetSnapshot(ch);
+  EXPECT_EQ(snapshot.triggers[snapshot.trigger_count - 1].sample, 26u);
+  EXPECT_EQ(snapshot.triggers[snapshot.trigger_count - 1].mode, dsp::TriggerMode::Falling);
+
+  // A drag sends many options between two pushes, the producer applies the last one
+  for (float level : {0.1f, 0.2f, 0.3f, 0.4f, 0.5f, 0.6f, 0.7f, 0.8f}) {
+    dsp::triggerOpts rising;
+    rising.level = level;
+    hub.SetTrigger(ch, rising);
+  }
+  EXPECT_EQ(hub.GetTrigger(ch)->level, 0.8f);
+  samples = {0.0f, 0.75f, 0.0f, 0.9f};
+  hub.Push(ch, samples.data(), samples.size());
+  hub.Consume();
+  snapshot = hub.GetSnapshot(ch);
+  // Only 0.9 crosses 0.8, an older level would also fire at 0.75
+  ASSERT_GE(snapshot.trigger_count, 2u);
+  EXPECT_EQ(snapshot.triggers[snapshot.trigger_count - 1].sample, 30u);
+  EXPECT_EQ(snapshot.triggers[snapshot.trigger_count - 1].mode, dsp::TriggerMode::Rising);
+  EXPECT_LT(snapshot.triggers[snapshot.trigger_count - 2].sample, 27u);
+}
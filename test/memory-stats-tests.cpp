@@ -0,0 +1,74 @@
+#include "platform/memory-stats.hpp"
+#include "platform/memory-telemetry.hpp"
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+using platform::MemoryStats;
+using platform::MemoryTag;
+
+TEST(MemoryStatsTest, TaggedAllocationsCountIntoTheirTag) {
+  platform::memoryTagStats before = MemoryStats::Get(MemoryTag::Ingest);
+  void *a = MemoryStats::Allocate(1000, MemoryTag::Ingest);
+  void *b = MemoryStats::Allocate(24, MemoryTag::Ingest);
+  platform::memoryTagStats during = MemoryStats::Get(MemoryTag::Ingest);
+  EXPECT_EQ(during.live_bytes - before.live_bytes, 1024u);
+  EXPECT_EQ(during.allocations - before.allocations, 2u);
+  EXPECT_GE(during.peak_bytes, during.live_bytes);
+
+  MemoryStats::Free(a);
+  MemoryStats::Free(b);
+  MemoryStats::Free(nullptr);
+  platform::memoryTagStats after = MemoryStats::Get(MemoryTag::Ingest);
+  EXPECT_EQ(after.live_bytes, before.live_bytes);
+  EXPECT_EQ(after.frees - before.frees, 2u);
+  EXPECT_GE(after.peak_bytes, before.live_bytes + 1024);
+}
+
+TEST(MemoryStatsTest, ScopeChargesOperatorNew) {
+  if (!MemoryStats::TracksHeap()) {
+    GTEST_SKIP() << "operator new is not tracked in this build";
+  }
+  platform::memoryTagStats before = MemoryStats::Get(MemoryTag::Platform);
+  std::unique_ptr<char[]> buffer;
+  {
+    platform::MemoryScope scope(MemoryTag::Platform);
+    buffer = std::make_unique<char[]>(4096);
+  }
+  EXPECT_EQ(MemoryStats::GetThreadTag(), MemoryTag::Untagged);
+  EXPECT_GE(MemoryStats::Get(MemoryTag::Platform).live_bytes - before.live_bytes, 4096u);
+  // Freed outside the scope, still returned to the tag that paid for it
+  buffer.reset();
+  EXPECT_EQ(MemoryStats::Get(MemoryTag::Platform).live_bytes, before.live_bytes);
+}
+
+TEST(MemoryTelemetryTest, CountsAllocationsPerFrame) {
+  platform::memoryTelemetryOpts opts;
+  opts.log_interval_s = 0.0;
+  platform::MemoryTelemetry telemetry(opts);
+  telemetry.EndFrame();
+
+  std::vector<void *> blocks;
+  for (int i = 0; i < 5; ++i) {
+    blocks.push_back(MemoryStats::Allocate(64, MemoryTag::Ui));
+  }
+  telemetry.EndFrame();
+  EXPECT_GE(telemetry.GetFrameAllocations(), 5u);
+  EXPECT_GE(telemetry.GetMaxFrameAllocations(), 5u);
+  EXPECT_EQ(telemetry.GetHistoryCount(), 2u);
+  for (void *block : blocks) {
+    MemoryStats::Free(block);
+  }
+
+  platform::deviceHeapUsage heap;
+  heap.size = 1000;
+  heap.budget = 800;
+  heap.usage = 500;
+  telemetry.SetDeviceHeaps({heap});
+  heap.usage = 100;
+  heap.reserved = 200;
+  telemetry.SetDeviceHeaps({heap});
+  ASSERT_EQ(telemetry.GetDeviceHeaps().size(), 1u);
+  EXPECT_EQ(telemetry.GetDeviceHeaps()[0].peak, 500u);
+  EXPECT_EQ(telemetry.GetDeviceHeaps()[0].usage, 100u);
+}
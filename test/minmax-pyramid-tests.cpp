@@ -0,0 +1,82 @@
+#include "dsp/minmax-pyramid.hpp"
+#include <algorithm>
+#include <cmath>
+#include <gtest/gtest.h>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace {
+
+std::vector<float> RandomSamples(size_t count) {
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  std::vector<float> samples(count);
+  for (float &s : samples) {
+    s = dist(rng);
+  }
+  return samples;
+}
+
+} // namespace
+
+TEST(MinMaxPyramidTest, LevelsGrowWithSamples) {
+  dsp::MinMaxPyramid pyramid;
+  std::vector<float> samples(8 * 8 * 8);
+  pyramid.Append(samples.data(), samples.size());
+  EXPECT_EQ(pyramid.GetLevelCount(), 4u);
+  EXPECT_EQ(pyramid.GetBucketSize(3), 512u);
+  EXPECT_EQ(pyramid.SelectLevel(100.0), 2u);
+  EXPECT_EQ(pyramid.SelectLevel(0.5), 0u);
+}
+
+TEST(MinMaxPyramidTest, ReduceMatchesBruteForce) {
+  std::vector<float> samples = RandomSamples(100003);
+  dsp::MinMaxPyramid pyramid(true);
+  // Uneven appends exercise the pending bucket
+  for (size_t at = 0; at < samples.size();) {
+    size_t n = std::min<size_t>(samples.size() - at, 1 + at % 997);
+    pyramid.Append(samples.data() + at, n);
+    at += n;
+  }
+  ASSERT_EQ(pyramid.GetSampleCount(), samples.size());
+
+  std::mt19937 rng(7);
+  for (int i = 0; i < 200; ++i) {
+    uint64_t a = rng() % samples.size();
+    uint64_t b = rng() % samples.size();
+    uint64_t first = std::min(a, b);
+    uint64_t last = std::max(a, b) + 1;
+    dsp::plotColumn column = pyramid.Reduce(samples.data(), first, last);
+    EXPECT_EQ(column.min, *std::min_element(samples.begin() + first, samples.begin() + last));
+    EXPECT_EQ(column.max, *std::max_element(samples.begin() + first, samples.begin() + last));
+    double sum = std::accumulate(samples.begin() + first, samples.begin() + last, 0.0);
+    EXPECT_NEAR(column.mean, sum / static_cast<double>(last - first), 1e-4);
+  }
+}
+
+TEST(MinMaxPyramidTest, DecimateCoversEveryColumn) {
+  std::vector<float> samples = RandomSamples(1 << 16);
+  samples[12345] = 5.0f;
+  samples[54321] = -5.0f;
+  dsp::MinMaxPyramid pyramid;
+  pyramid.Append(samples.data(), samples.size());
+
+  std::vector<dsp::plotColumn> columns(640);
+  uint32_t written = pyramid.Decimate(samples.data(), 1000, samples.size(), 640, columns.data());
+  ASSERT_EQ(written, 640u);
+  float lo = 0.0f;
+  float hi = 0.0f;
+  for (const dsp::plotColumn &c : columns) {
+    EXPECT_LE(c.min, c.max);
+    lo = std::min(lo, c.min);
+    hi = std::max(hi, c.max);
+  }
+  // Spikes survive decimation
+  EXPECT_EQ(lo, -5.0f);
+  EXPECT_EQ(hi, 5.0f);
+
+  // Fewer samples than columns gives one column per sample
+  EXPECT_EQ(pyramid.Decimate(samples.data(), 10, 20, 640, columns.data()), 10u);
+  EXPECT_EQ(columns[3].min, samples[13]);
+}
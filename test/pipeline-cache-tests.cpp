@@ -0,0 +1,75 @@
+#include "gfx/pipeline-cache.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+
+namespace {
+
+VkPhysicalDeviceProperties MakeProperties() {
+  VkPhysicalDeviceProperties props{};
+  props.vendorID = 0x10de;
+  props.deviceID = 0x2204;
+  props.driverVersion = 42;
+  for (uint32_t i = 0; i < VK_UUID_SIZE; ++i) {
+    props.pipelineCacheUUID[i] = static_cast<uint8_t>(i);
+  }
+  return props;
+}
+
+std::vector<uint8_t> MakeBlob(const VkPhysicalDeviceProperties &props) {
+  VkPipelineCacheHeaderVersionOne header{};
+  header.headerSize = sizeof(header);
+  header.headerVersion = VK_PIPELINE_CACHE_HEADER_VERSION_ONE;
+  header.vendorID = props.vendorID;
+  header.deviceID = props.deviceID;
+  std::memcpy(header.pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE);
+
+  std::vector<uint8_t> blob(sizeof(header) + 64, 0xab);
+  std::memcpy(blob.data(), &header, sizeof(header));
+  return blob;
+}
+
+std::string TempDir() {
+  auto dir = std::filesystem::temp_directory_path() / "osc-pipeline-cache-tests";
+  std::filesystem::create_directories(dir);
+  return dir.string();
+}
+
+} // namespace
+
+TEST(PipelineCacheTest, RoundTrip) {
+  VkPhysicalDeviceProperties props = MakeProperties();
+  std::string path = PipelineCachePath(TempDir(), props);
+  std::vector<uint8_t> blob = MakeBlob(props);
+
+  ASSERT_TRUE(SavePipelineCacheData(path, props, blob));
+  EXPECT_EQ(LoadPipelineCacheData(path, props), blob);
+}
+
+TEST(PipelineCacheTest, RejectsOtherDriver) {
+  VkPhysicalDeviceProperties props = MakeProperties();
+  std::string path = PipelineCachePath(TempDir(), props);
+  ASSERT_TRUE(SavePipelineCacheData(path, props, MakeBlob(props)));
+
+  props.driverVersion++;
+  EXPECT_TRUE(LoadPipelineCacheData(path, props).empty());
+}
+
+TEST(PipelineCacheTest, RejectsCorruptData) {
+  VkPhysicalDeviceProperties props = MakeProperties();
+  std::string path = PipelineCachePath(TempDir(), props);
+  ASSERT_TRUE(SavePipelineCacheData(path, props, MakeBlob(props)));
+
+  {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(-1, std::ios::end);
+    file.put('\0');
+  }
+  EXPECT_TRUE(LoadPipelineCacheData(path, props).empty());
+}
+
+TEST(PipelineCacheTest, MissingFileIsEmpty) {
+  VkPhysicalDeviceProperties props = MakeProperties();
+  EXPECT_TRUE(LoadPipelineCacheData(TempDir() + "/does-not-exist.bin", props).empty());
+}
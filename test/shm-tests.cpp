@@ -0,0 +1,150 @@
+#include "ingest/ingest.hpp"
+#include "ingest/shm-producer.hpp"
+#include "ingest/shm-source.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <gtest/gtest.h>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+std::string SegmentName(const char *test) {
+  return "/osc-test-" + std::to_string(getpid()) + "-" + test;
+}
+
+bool WaitFor(const std::function<bool()> &done) {
+  for (int i = 0; i < 200; ++i) {
+    if (done()) {
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return false;
+}
+
+} // namespace
+
+TEST(ShmTest, ConsumeReadsProducerSamplesInPlace) {
+  std::string name = SegmentName("round-trip");
+  ingest::ShmProducer producer;
+  ASSERT_TRUE(producer.Create(name, {"a", "b"}, 100));
+
+  ingest::Ingest hub;
+  ingest::ShmSource source;
+  std::atomic<int> wakes{0};
+  ingest::channelOpts opts;
+  opts.history = 64;
+  ASSERT_TRUE(source.Open(name, hub, opts, [&wakes] { wakes.fetch_add(1); }));
+  ASSERT_EQ(hub.GetChannelCount(), 2u);
+  EXPECT_EQ(hub.GetChannelName(1), name.substr(1) + "/b");
+
+  // Capacity rounds up to 128, the rest of the second push is an overrun
+  std::vector<float> samples(150);
+  std::iota(samples.begin(), samples.end(), 0.0f);
+  EXPECT_EQ(producer.Push(0, samples.data(), 40), 40u);
+  EXPECT_EQ(producer.Push(1, samples.data(), 150), 128u);
+  producer.Publish();
+  EXPECT_TRUE(WaitFor([&wakes] { return wakes.load() > 0; }));
+
+  hub.Consume();
+  ingest::channelSnapshot a = hub.GetSnapshot(0);
+  ingest::channelSnapshot b = hub.GetSnapshot(1);
+  EXPECT_EQ(a.new_samples, 40u);
+  EXPECT_EQ(a.samples[39], 39.0f);
+  EXPECT_EQ(b.new_samples, 128u);
+  EXPECT_EQ(b.overruns, 22u);
+  EXPECT_EQ(b.samples[b.count - 1], 127.0f);
+  EXPECT_EQ(hub.Push(0, samples.data(), 1), 0u);
+
+  EXPECT_TRUE(source.IsProducerAlive());
+  producer.Close();
+  EXPECT_TRUE(WaitFor([&source] { return !source.IsProducerAlive(); }));
+}
+
+TEST(ShmTest, DetectsCrashedProducer) {
+  std::string name = SegmentName("crash");
+  int ready[2];
+  ASSERT_EQ(pipe(ready), 0);
+  pid_t child = fork();
+  ASSERT_GE(child, 0);
+  if (child == 0) {
+    // Dies holding the segment without closing it
+    ingest::ShmProducer producer;
+    char ok = producer.Create(name, {"x"}, 64) ? 1 : 0;
+    float sample = 1.0f;
+    producer.Push(0, &sample, 1);
+    producer.Publish();
+    (void)write(ready[1], &ok, 1);
+    pause();
+    _exit(0);
+  }
+  char ok = 0;
+  ASSERT_EQ(read(ready[0], &ok, 1), 1);
+  ASSERT_EQ(ok, 1);
+
+  ingest::Ingest hub;
+  ingest::ShmSource source;
+  ASSERT_TRUE(source.Open(name, hub, {}));
+  EXPECT_TRUE(source.IsProducerAlive());
+  kill(child, SIGKILL);
+  waitpid(child, nullptr, 0);
+  EXPECT_TRUE(WaitFor([&source] { return !source.IsProducerAlive(); }));
+
+  // What it wrote before dying is still there
+  hub.Consume();
+  EXPECT_EQ(hub.GetSnapshot(0).new_samples, 1u);
+
+  // The crashed segment may be replaced, a live one may not
+  ingest::ShmProducer replacement;
+  EXPECT_TRUE(replacement.Create(name, {"y"}, 64));
+  ingest::ShmProducer intruder;
+  EXPECT_FALSE(intruder.Create(name, {"z"}, 64));
+  replacement.Close();
+  close(ready[0]);
+  close(ready[1]);
+}
+
+TEST(ShmTest, ReadNeverLeavesTheRingOnABogusHead) {
+  constexpr uint32_t kCapacity = 16;
+  size_t bytes = ingest::ShmSegmentBytes(2, kCapacity);
+  std::unique_ptr<char, decltype(&std::free)> segment(
+      static_cast<char *>(std::aligned_alloc(ingest::kShmAlign, bytes)), &std::free);
+  std::memset(segment.get(), 0, bytes);
+
+  ingest::ShmRing ring(segment.get(), 0, kCapacity);
+  std::vector<float> samples(kCapacity, 1.0f);
+  ASSERT_EQ(ring.Push(samples.data(), kCapacity), kCapacity);
+  // A producer claiming far more than a lap, as if it had skipped the tail check
+  auto *raw = reinterpret_cast<ingest::shmRing *>(segment.get() +
+                                                   ingest::ShmAlignUp(sizeof(ingest::shmHeader)));
+  raw->head.store(1000);
+  EXPECT_EQ(ring.Available(), kCapacity);
+
+  const char *begin = segment.get() + ingest::ShmAlignUp(sizeof(ingest::shmHeader));
+  const char *end = begin + ingest::ShmChannelBytes(kCapacity);
+  size_t visited = 0;
+  size_t read = ring.Read(SIZE_MAX, [&](const float *items, size_t n) {
+    EXPECT_GE(reinterpret_cast<const char *>(items), begin);
+    EXPECT_LE(reinterpret_cast<const char *>(items + n), end);
+    visited += n;
+  });
+  EXPECT_EQ(read, kCapacity);
+  EXPECT_EQ(visited, kCapacity);
+  EXPECT_EQ(ring.GetOverruns(), 1000u - kCapacity);
+  EXPECT_EQ(raw->tail.load(), 1000u);
+
+  // A head behind tail reads nothing and resyncs
+  raw->head.store(10);
+  EXPECT_EQ(ring.Available(), 0u);
+  EXPECT_EQ(ring.Read(SIZE_MAX, [](const float *, size_t) {}), 0u);
+  EXPECT_EQ(raw->tail.load(), 10u);
+}
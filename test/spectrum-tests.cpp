@@ -0,0 +1,78 @@
+#include "dsp/fft.hpp"
+#include "dsp/spectrum.hpp"
+#include <cmath>
+#include <complex>
+#include <gtest/gtest.h>
+#include <numbers>
+#include <random>
+#include <vector>
+
+namespace {
+
+std::vector<float> Sine(size_t count, double cycles_per_sample, float amplitude) {
+  std::vector<float> samples(count);
+  for (size_t i = 0; i < count; ++i) {
+    double phase = 2.0 * std::numbers::pi * cycles_per_sample * static_cast<double>(i);
+    samples[i] = amplitude * static_cast<float>(std::sin(phase));
+  }
+  return samples;
+}
+
+} // namespace
+
+TEST(SpectrumTest, FftMatchesDft) {
+  std::mt19937 rng(3);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (uint32_t n : {4u, 8u, 32u, 256u}) {
+    std::vector<float> x(n);
+    for (float &v : x) {
+      v = dist(rng);
+    }
+    std::vector<float> re(n / 2 + 1);
+    std::vector<float> im(n / 2 + 1);
+    dsp::RealFft fft(n);
+    fft.Forward(x.data(), re.data(), im.data());
+    for (uint32_t k = 0; k <= n / 2; ++k) {
+      std::complex<double> sum = 0.0;
+      for (uint32_t i = 0; i < n; ++i) {
+        sum += static_cast<double>(x[i]) * std::polar(1.0, -2.0 * std::numbers::pi * k * i / n);
+      }
+      EXPECT_NEAR(re[k], sum.real(), 1e-4) << n << " bin " << k;
+      EXPECT_NEAR(im[k], sum.imag(), 1e-4) << n << " bin " << k;
+    }
+  }
+}
+
+TEST(SpectrumTest, FullScaleSineReadsZeroDb) {
+  for (auto window : {dsp::WindowKind::Hann, dsp::WindowKind::BlackmanHarris,
+                      dsp::WindowKind::FlatTop}) {
+    dsp::spectrumOpts opts;
+    opts.fft_size = 1024;
+    opts.window = window;
+    opts.averaging = dsp::Averaging::None;
+    dsp::SpectrumAnalyzer analyzer(opts);
+    std::vector<float> samples = Sine(1024, 64.0 / 1024.0, 1.0f);
+    analyzer.Feed(samples.data(), samples.size());
+    ASSERT_EQ(analyzer.Process(), 1u);
+    EXPECT_NEAR(analyzer.GetSpectrum()[64], 0.0f, 0.01f);
+    EXPECT_LT(analyzer.GetSpectrum()[200], -60.0f);
+  }
+}
+
+TEST(SpectrumTest, OverlapSetsTheHopAcrossFeeds) {
+  dsp::spectrumOpts opts;
+  opts.fft_size = 256;
+  opts.overlap = 0.75f;
+  opts.waterfall_rows = 8;
+  dsp::SpectrumAnalyzer analyzer(opts);
+  std::vector<float> samples = Sine(1000, 0.1, 0.5f);
+  // 256 + 11 hops of 64 fit in 960 samples, fed unevenly
+  analyzer.Feed(samples.data(), 300);
+  uint32_t frames = analyzer.Process();
+  analyzer.Feed(samples.data() + 300, 660);
+  frames += analyzer.Process();
+  EXPECT_EQ(frames, 12u);
+  EXPECT_EQ(analyzer.GetRowCount(), 12u);
+  // Rows wrap around the waterfall
+  EXPECT_EQ(analyzer.GetRow(11), analyzer.GetRow(3));
+}
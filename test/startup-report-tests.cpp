@@ -0,0 +1,48 @@
+#include "platform/startup-report.hpp"
+#include "platform/trace.hpp"
+#include <gtest/gtest.h>
+#include <thread>
+
+TEST(StartupReportTest, OrdersPhasesAndNumbersThreads) {
+  platform::StartupReport report;
+  uint64_t now = platform::Trace::SteadyNanoseconds();
+  report.Record("second", now + 2'000'000, now + 5'000'000);
+  std::thread worker([&] { report.Record("first", now, now + 4'000'000); });
+  worker.join();
+  report.Record("third", now + 3'000'000, now + 4'000'000);
+
+  std::vector<platform::startupPhase> phases = report.GetPhases();
+  ASSERT_EQ(phases.size(), 3u);
+  EXPECT_STREQ(phases[0].name, "first");
+  EXPECT_STREQ(phases[1].name, "second");
+  EXPECT_STREQ(phases[2].name, "third");
+  EXPECT_EQ(phases[0].thread, 1u);
+  EXPECT_EQ(phases[1].thread, 0u);
+  EXPECT_EQ(phases[2].thread, 0u);
+  EXPECT_EQ(report.GetThreadCount(), 2u);
+  EXPECT_NEAR(phases[1].end_ms - phases[1].begin_ms, 3.0, 1e-6);
+  // Overlapping phases add up to more work than wall time
+  EXPECT_NEAR(report.GetBusyMs(), 8.0, 1e-6);
+}
+
+TEST(StartupReportTest, FinishStopsTheClockOnce) {
+  platform::StartupReport report;
+  {
+    platform::StartupScope scope(&report, "scoped");
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  platform::StartupScope ignored(nullptr, "ignored");
+  ASSERT_FALSE(report.IsFinished());
+  report.Finish();
+  ASSERT_TRUE(report.IsFinished());
+  double total = report.GetTotalMs();
+  EXPECT_GE(total, 2.0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  report.Finish();
+  EXPECT_EQ(report.GetTotalMs(), total);
+
+  std::vector<platform::startupPhase> phases = report.GetPhases();
+  ASSERT_EQ(phases.size(), 1u);
+  EXPECT_GE(phases[0].end_ms - phases[0].begin_ms, 2.0);
+  EXPECT_LE(phases[0].end_ms, total);
+}
@@ -1,5 +1,18 @@
+#include "platform/log.hpp"
 #include <gtest/gtest.h>
 
+namespace {
+
+class LogEnvironment : public ::testing::Environment {
+public:
+  void SetUp() override { platform::Log::Init(); }
+  void TearDown() override { platform::Log::Shutdown(); }
+};
+
+const auto *log_environment = ::testing::AddGlobalTestEnvironment(new LogEnvironment);
+
+} // namespace
+
 TEST(SimpleTest, BasicAssertions) {
   EXPECT_EQ(2 + 2, 4);
   EXPECT_NE(2 + 2, 5);
@@ -0,0 +1,54 @@
+#include "platform/trace.hpp"
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+std::string ReadFile(const std::string &path) {
+  std::ifstream file(path);
+  std::stringstream ss;
+  ss << file.rdbuf();
+  return ss.str();
+}
+
+} // namespace
+
+TEST(TraceTest, DumpsZonesFromAllThreads) {
+  {
+    platform::ScopedZone zone("trace-test-main");
+  }
+  std::thread worker([] {
+    platform::Trace::SetThreadName("trace-test-worker");
+    platform::ScopedZone zone("trace-test-worker-zone");
+  });
+  worker.join();
+
+  std::string path = (std::filesystem::temp_directory_path() / "osc-trace-test.json").string();
+  ASSERT_TRUE(platform::Trace::DumpChromeTrace(path));
+
+  std::string json = ReadFile(path);
+  EXPECT_NE(json.find("\"traceEvents\""), std::string::npos);
+  EXPECT_NE(json.find("\"name\":\"trace-test-main\""), std::string::npos);
+  EXPECT_NE(json.find("\"name\":\"trace-test-worker-zone\""), std::string::npos);
+  EXPECT_NE(json.find("\"name\":\"trace-test-worker\""), std::string::npos);
+}
+
+TEST(TraceTest, KeepsMostRecentEventsWhenFull) {
+  std::thread worker([] {
+    platform::Trace::Record("trace-test-old", 0, 1);
+    for (size_t i = 0; i < platform::Trace::kEventsPerThread; ++i) {
+      platform::Trace::Record("trace-test-new", i, i + 1);
+    }
+  });
+  worker.join();
+
+  std::string path = (std::filesystem::temp_directory_path() / "osc-trace-test.json").string();
+  ASSERT_TRUE(platform::Trace::DumpChromeTrace(path));
+
+  std::string json = ReadFile(path);
+  EXPECT_EQ(json.find("trace-test-old"), std::string::npos);
+  EXPECT_NE(json.find("trace-test-new"), std::string::npos);
+}
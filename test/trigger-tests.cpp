@@ -0,0 +1,128 @@
+#include "dsp/trigger.hpp"
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+namespace {
+
+std::vector<dsp::triggerEvent> Scan(dsp::TriggerEngine &engine, const std::vector<float> &samples,
+                                   size_t block) {
+  std::vector<dsp::triggerEvent> events;
+  std::vector<dsp::triggerEvent> out(block + 1);
+  for (size_t i = 0; i < samples.size(); i += block) {
+    size_t n = std::min(block, samples.size() - i);
+    size_t written = engine.Process(samples.data() + i, n, out.data(), out.size());
+    events.insert(events.end(), out.begin(), out.begin() + written);
+  }
+  return events;
+}
+
+// Square wave of the given period with noise smaller than noise on top
+std::vector<float> NoisySquare(size_t count, size_t period, float noise, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> dist(-noise, noise);
+  std::vector<float> samples(count);
+  for (size_t i = 0; i < count; ++i) {
+    samples[i] = (i % period < period / 2 ? 1.0f : -1.0f) + dist(rng);
+  }
+  return samples;
+}
+
+} // namespace
+
+TEST(TriggerTest, KernelsAgreeWithScalar) {
+  const dsp::triggerKernels *scalar = dsp::GetTriggerKernels(dsp::TriggerIsa::Scalar);
+  std::mt19937 rng(5);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  std::vector<float> samples(1000);
+  for (float &s : samples) {
+    s = dist(rng);
+  }
+  for (auto isa : {dsp::TriggerIsa::Sse2, dsp::TriggerIsa::Avx2}) {
+    const dsp::triggerKernels *k = dsp::GetTriggerKernels(isa);
+    if (!k) {
+      continue;
+    }
+    for (int i = 0; i < 500; ++i) {
+      size_t first = rng() % samples.size();
+      size_t n = rng() % (samples.size() - first);
+      float t = dist(rng) * 1.2f;
+      const float *x = samples.data() + first;
+      EXPECT_EQ(k->first_at_or_above(x, n, t), scalar->first_at_or_above(x, n, t));
+      EXPECT_EQ(k->first_below(x, n, t), scalar->first_below(x, n, t));
+      EXPECT_EQ(k->first_outside(x, n, -0.99f, t), scalar->first_outside(x, n, -0.99f, t));
+      EXPECT_EQ(k->first_inside(x, n, t, t + 0.01f), scalar->first_inside(x, n, t, t + 0.01f));
+    }
+  }
+}
+
+TEST(TriggerTest, HysteresisFiresOncePerEdgeWhateverTheBlocks) {
+  std::vector<float> samples = NoisySquare(10000, 100, 0.2f, 1);
+  dsp::triggerOpts opts;
+  opts.hysteresis = 0.5f;
+  for (size_t block : {size_t{7}, size_t{64}, size_t{10000}}) {
+    dsp::TriggerEngine engine(opts);
+    std::vector<dsp::triggerEvent> events = Scan(engine, samples, block);
+    // Starts high, so the first rising edge is at 100
+    ASSERT_EQ(events.size(), 99u);
+    for (size_t i = 0; i < events.size(); ++i) {
+      EXPECT_EQ(events[i].sample, 100 * (i + 1));
+      EXPECT_EQ(events[i].width, 50u);
+    }
+  }
+
+  // Without hysteresis the noise around 0 would fire too, a noisy level stays quiet with it
+  std::vector<float> flat = NoisySquare(1000, 1000000, 0.3f, 2);
+  opts.level = 1.0f;
+  opts.hysteresis = 0.7f;
+  dsp::TriggerEngine engine(opts);
+  EXPECT_LE(Scan(engine, flat, 100).size(), 1u);
+}
+
+TEST(TriggerTest, PulseWidthAndGlitch) {
+  // Pulses of width 3, 10 and 30 samples, 100 apart
+  std::vector<float> samples(400, 0.0f);
+  size_t widths[] = {3, 10, 30};
+  for (size_t p = 0; p < 3; ++p) {
+    for (size_t i = 0; i < widths[p]; ++i) {
+      samples[100 * (p + 1) + i] = 1.0f;
+    }
+  }
+  dsp::triggerOpts opts;
+  opts.mode = dsp::TriggerMode::PulseWidth;
+  opts.level = 0.5f;
+  opts.min_width = 5;
+  opts.max_width = 20;
+  dsp::TriggerEngine pulse(opts, dsp::TriggerIsa::Scalar);
+  std::vector<dsp::triggerEvent> events = Scan(pulse, samples, 33);
+  ASSERT_EQ(events.size(), 1u);
+  EXPECT_EQ(events[0].sample, 210u);
+  EXPECT_EQ(events[0].width, 10u);
+
+  opts.mode = dsp::TriggerMode::Glitch;
+  opts.max_width = 5;
+  dsp::TriggerEngine glitch(opts);
+  events = Scan(glitch, samples, 400);
+  ASSERT_EQ(events.size(), 1u);
+  EXPECT_EQ(events[0].sample, 103u);
+}
+
+TEST(TriggerTest, WindowAndHoldoff) {
+  std::vector<float> samples(100, 0.0f);
+  samples[10] = 2.0f;
+  samples[12] = 2.0f;
+  samples[50] = -2.0f;
+  dsp::triggerOpts opts;
+  opts.mode = dsp::TriggerMode::Window;
+  dsp::TriggerEngine window(opts);
+  std::vector<dsp::triggerEvent> events = Scan(window, samples, 16);
+  ASSERT_EQ(events.size(), 3u);
+  EXPECT_EQ(events[1].sample, 12u);
+
+  opts.holdoff = 5;
+  dsp::TriggerEngine held(opts);
+  events = Scan(held, samples, 16);
+  ASSERT_EQ(events.size(), 2u);
+  EXPECT_EQ(events[0].sample, 10u);
+  EXPECT_EQ(events[1].sample, 50u);
+}
@@ -0,0 +1,120 @@
+// Stand-in for an acquisition daemon: streams test signals into a shared memory segment that
+// osc picks up with OSC_SHM=<name>. Only uses the producer header, like a real daemon would.
+#include "ingest/shm-producer.hpp"
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <numbers>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct genOpts {
+  std::string name = "/osc-gen";
+  uint32_t channels = 4;
+  double rate = 100000.0;
+  // 0 runs until interrupted
+  double seconds = 0.0;
+  uint32_t capacity = 1u << 20;
+};
+
+volatile std::sig_atomic_t g_stop = 0;
+
+void PrintUsage() {
+  std::printf("usage: osc_shm_gen [--name /NAME] [--channels N] [--rate HZ] [--seconds S] "
+              "[--capacity SAMPLES]\n");
+}
+
+bool ParseArgs(int argc, char **argv, genOpts &opts) {
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const char *value = argv[i + 1];
+    if (std::strcmp(argv[i], "--name") == 0) {
+      opts.name = value;
+    } else if (std::strcmp(argv[i], "--channels") == 0) {
+      opts.channels = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    } else if (std::strcmp(argv[i], "--rate") == 0) {
+      opts.rate = std::strtod(value, nullptr);
+    } else if (std::strcmp(argv[i], "--seconds") == 0) {
+      opts.seconds = std::strtod(value, nullptr);
+    } else if (std::strcmp(argv[i], "--capacity") == 0) {
+      opts.capacity = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    } else {
+      return false;
+    }
+  }
+  return argc % 2 == 1 && !opts.name.empty() && opts.name[0] == '/' && opts.channels > 0 &&
+         opts.channels <= ingest::kShmMaxChannels && opts.rate > 0.0 && opts.capacity > 0;
+}
+
+// Channel c cycles through sine, square, sawtooth and noise at a frequency of its own
+float Sample(uint32_t channel, uint64_t n, double rate, std::mt19937 &rng) {
+  double t = static_cast<double>(n) / rate;
+  double phase = std::fmod(t * 50.0 * (channel + 1), 1.0);
+  switch (channel % 4) {
+  case 0:
+    return static_cast<float>(std::sin(2.0 * std::numbers::pi * phase));
+  case 1:
+    return phase < 0.5 ? 1.0f : -1.0f;
+  case 2:
+    return static_cast<float>(2.0 * phase - 1.0);
+  default:
+    return std::uniform_real_distribution<float>(-1.0f, 1.0f)(rng);
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  genOpts opts;
+  if (!ParseArgs(argc, argv, opts)) {
+    PrintUsage();
+    return 2;
+  }
+  std::vector<std::string> names;
+  for (uint32_t c = 0; c < opts.channels; ++c) {
+    names.push_back("ch" + std::to_string(c));
+  }
+  ingest::ShmProducer producer;
+  if (!producer.Create(opts.name, names, opts.capacity)) {
+    return 1;
+  }
+  std::signal(SIGINT, [](int) { g_stop = 1; });
+  std::signal(SIGTERM, [](int) { g_stop = 1; });
+  std::printf("streaming %u channels at %.0f Hz into %s\n", opts.channels, opts.rate,
+              opts.name.c_str());
+
+  // One publish per millisecond, each with however many samples the clock says are due
+  std::mt19937 rng(1);
+  std::vector<float> block;
+  uint64_t sent = 0;
+  uint64_t dropped = 0;
+  auto start = std::chrono::steady_clock::now();
+  while (g_stop == 0) {
+    std::chrono::duration<double> elapsed_s = std::chrono::steady_clock::now() - start;
+    double elapsed = elapsed_s.count();
+    if (opts.seconds > 0.0 && elapsed >= opts.seconds) {
+      break;
+    }
+    auto due = static_cast<uint64_t>(elapsed * opts.rate);
+    block.resize(due - sent);
+    for (uint32_t c = 0; c < opts.channels; ++c) {
+      for (size_t i = 0; i < block.size(); ++i) {
+        block[i] = Sample(c, sent + i, opts.rate, rng);
+      }
+      dropped += block.size() - producer.Push(c, block.data(), block.size());
+    }
+    producer.Publish();
+    sent = due;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  producer.Close();
+  std::printf("sent %llu samples per channel, %llu dropped\n",
+              static_cast<unsigned long long>(sent), static_cast<unsigned long long>(dropped));
+  return 0;
+}